@@ -0,0 +1,37 @@
+struct VS_OUTPUT
+{
+    float4 pos     : SV_POSITION;
+    float3 fragPos : POSITION;
+    uint RTIndex   : SV_RenderTargetArrayIndex;
+};
+
+#ifndef SAMPLE_COUNT
+#define SAMPLE_COUNT 1
+#endif
+
+#if SAMPLE_COUNT > 1
+Texture2DMS<float> gDepth;
+#else
+Texture2D<float> gDepth;
+#endif
+
+TextureCube environmentMap;
+SamplerState g_sampler;
+
+// The light pass leaves samples without geometry black, the environment is blended in by the share of such samples.
+float4 main(VS_OUTPUT input) : SV_TARGET
+{
+    float coverage = 0;
+#if SAMPLE_COUNT > 1
+    [unroll (SAMPLE_COUNT)]
+    for (uint i = 0; i < SAMPLE_COUNT; ++i)
+        coverage += gDepth.Load(input.pos.xy, i) == 1.0;
+#else
+    coverage = gDepth.Load(int3(input.pos.xy, 0)) == 1.0;
+#endif
+    coverage /= SAMPLE_COUNT;
+    if (coverage == 0)
+        discard;
+    return float4(environmentMap.Sample(g_sampler, float3(input.fragPos.x, input.fragPos.y, -input.fragPos.z)).rgb,
+                  coverage);
+}
@@ -0,0 +1,57 @@
+// Box tests shared by the range and meshlet culling, bmin and bmax are in the space mvp transforms from.
+
+Texture2D<float> hiz;
+
+bool IsInFrustum(float3 bmin, float3 bmax, float4x4 mvp)
+{
+    uint outside_mask = 0x3f;
+    for (uint i = 0; i < 8; ++i)
+    {
+        float3 corner = float3(i & 1 ? bmax.x : bmin.x, i & 2 ? bmax.y : bmin.y, i & 4 ? bmax.z : bmin.z);
+        float4 clip = mul(float4(corner, 1.0), mvp);
+        uint mask = 0;
+        mask |= clip.x < -clip.w ? 0x01 : 0;
+        mask |= clip.x > clip.w ? 0x02 : 0;
+        mask |= clip.y < -clip.w ? 0x04 : 0;
+        mask |= clip.y > clip.w ? 0x08 : 0;
+        mask |= clip.z < -clip.w ? 0x10 : 0;
+        mask |= clip.z > clip.w ? 0x20 : 0;
+        outside_mask &= mask;
+    }
+    return outside_mask == 0;
+}
+
+// True when the box is behind the depth stored in the pyramid. Boxes crossing the near plane are never occluded.
+bool IsOccluded(float3 bmin, float3 bmax, float4x4 mvp)
+{
+    float2 uv_min = 1.0;
+    float2 uv_max = 0.0;
+    float z_min = 1.0;
+    for (uint i = 0; i < 8; ++i)
+    {
+        float3 corner = float3(i & 1 ? bmax.x : bmin.x, i & 2 ? bmax.y : bmin.y, i & 4 ? bmax.z : bmin.z);
+        float4 clip = mul(float4(corner, 1.0), mvp);
+        if (clip.w <= 0)
+            return false;
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv = ndc.xy * float2(0.5, -0.5) + 0.5;
+        uv_min = min(uv_min, uv);
+        uv_max = max(uv_max, uv);
+        z_min = min(z_min, ndc.z);
+    }
+    uv_min = saturate(uv_min);
+    uv_max = saturate(uv_max);
+
+    uint width, height, levels;
+    hiz.GetDimensions(0, width, height, levels);
+    float2 size = (uv_max - uv_min) * float2(width, height);
+    // At this level the rectangle is at most one texel wide, so four texels cover it.
+    uint level = min((uint)ceil(log2(max(max(size.x, size.y), 1.0))), levels - 1);
+    hiz.GetDimensions(level, width, height, levels);
+    uint2 dims = uint2(width, height);
+    uint2 p0 = min(uint2(uv_min * dims), dims - 1);
+    uint2 p1 = min(uint2(uv_max * dims), dims - 1);
+    float depth = max(max(hiz.Load(int3(p0.x, p0.y, level)), hiz.Load(int3(p1.x, p0.y, level))),
+                      max(hiz.Load(int3(p0.x, p1.y, level)), hiz.Load(int3(p1.x, p1.y, level))));
+    return z_min > depth;
+}
@@ -0,0 +1,19 @@
+#include "Instancing.hlsli"
+#include "PackedVertex.hlsli"
+
+cbuffer ConstantBuf
+{
+    float4x4 model;
+    float4x4 view;
+    float4x4 projection;
+};
+
+// Must produce bit-identical depth with GeometryPassPacked_VS, the G-buffer pass tests against it with an equal test.
+float4 main(uint vertex_id : SV_VertexID, uint instanceID : SV_InstanceID) : SV_POSITION
+{
+    Vertex vs_in = LoadPackedVertex(vertex_id);
+    float4 pos = float4(vs_in.pos, 1.0);
+    float4 worldPos = mul(mul(pos, model), instances[instanceID]);
+    precise float4 clipPos = mul(worldPos, mul(view, projection));
+    return clipPos;
+}
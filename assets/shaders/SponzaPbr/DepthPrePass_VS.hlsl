@@ -0,0 +1,22 @@
+#include "Instancing.hlsli"
+
+struct VS_INPUT
+{
+    float3 pos : POSITION;
+};
+
+cbuffer ConstantBuf
+{
+    float4x4 model;
+    float4x4 view;
+    float4x4 projection;
+};
+
+// Must produce bit-identical depth with GeometryPass_VS, the G-buffer pass tests against it with an equal test.
+float4 main(VS_INPUT vs_in, uint instanceID : SV_InstanceID) : SV_POSITION
+{
+    float4 pos = float4(vs_in.pos, 1.0);
+    float4 worldPos = mul(mul(pos, model), instances[instanceID]);
+    precise float4 clipPos = mul(worldPos, mul(view, projection));
+    return clipPos;
+}
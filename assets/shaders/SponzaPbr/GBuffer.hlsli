@@ -0,0 +1,48 @@
+// Compact G-buffer layout:
+//   gNormal   RG16_SFLOAT   octahedral encoded world space normal
+//   gAlbedo   RGBA8_SRGB    albedo, alpha marks covered samples
+//   gMaterial RGBA8_UNORM   roughness, metalness, ao, ibl probe index
+// World space position is reconstructed from the depth buffer.
+
+float2 SignNotZero(float2 v)
+{
+    return float2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+float2 OctWrap(float2 v)
+{
+    return (1.0 - abs(v.yx)) * SignNotZero(v);
+}
+
+float2 EncodeNormal(float3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy;
+}
+
+float3 DecodeNormal(float2 f)
+{
+    float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = saturate(-n.z);
+    n.xy -= SignNotZero(n.xy) * t;
+    return normalize(n);
+}
+
+// ibl_source is -1 for models without a probe, so the index is stored with a bias of one.
+float EncodeIblProbe(int ibl_source)
+{
+    return (ibl_source + 1) / 255.0;
+}
+
+int DecodeIblProbe(float value)
+{
+    return int(round(value * 255.0)) - 1;
+}
+
+float3 ReconstructPosition(float2 texcoord, float depth, float4x4 inverted_view_projection)
+{
+    float4 projected_pos = float4(texcoord.x * 2 - 1, (1 - texcoord.y) * 2 - 1, depth, 1.0);
+    float4 position = mul(projected_pos, inverted_view_projection);
+    return position.xyz / position.w;
+}
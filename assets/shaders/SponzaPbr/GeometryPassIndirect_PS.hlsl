@@ -0,0 +1,116 @@
+#include "GBuffer.hlsli"
+
+struct VS_OUTPUT
+{
+    float4 pos                    : SV_POSITION;
+    float3 fragPos                : POSITION;
+    float3 normal                 : NORMAL;
+    float3 tangent                : TANGENT;
+    float2 texCoord               : TEXCOORD;
+    nointerpolation uint material : MATERIAL;
+};
+
+// Two entries per material: descriptor ids of albedo, normal, gloss, roughness and metalness, ao, alpha, flags.
+StructuredBuffer<uint4> material_table;
+Texture2D texture_table[] : register(t, space10);
+
+SamplerState g_sampler;
+
+cbuffer Settings
+{
+    bool use_normal_mapping;
+    bool use_flip_normal_y;
+    int ibl_source;
+};
+
+static const uint kHasNormalMap = 1;
+static const uint kUseGlossInsteadOfRoughness = 2;
+static const uint kPackedNormal = 4;
+
+struct Material
+{
+    uint albedo;
+    uint normal;
+    uint gloss;
+    uint roughness;
+    uint metalness;
+    uint ao;
+    uint alpha;
+    uint flags;
+};
+
+Material LoadMaterial(uint id)
+{
+    uint4 a = material_table[2 * id];
+    uint4 b = material_table[2 * id + 1];
+    Material material;
+    material.albedo = a.x;
+    material.normal = a.y;
+    material.gloss = a.z;
+    material.roughness = a.w;
+    material.metalness = b.x;
+    material.ao = b.y;
+    material.alpha = b.z;
+    material.flags = b.w;
+    return material;
+}
+
+float4 getTexture(uint _id, float2 _tex_coord, bool _need_gamma = false)
+{
+    float4 _color = texture_table[NonUniformResourceIndex(_id)].Sample(g_sampler, _tex_coord);
+    if (_need_gamma)
+        _color = float4(pow(abs(_color.rgb), 2.2), _color.a);
+    return _color;
+}
+
+struct PS_OUT
+{
+    float2 gNormal   : SV_Target0;
+    float4 gAlbedo   : SV_Target1;
+    float4 gMaterial : SV_Target2;
+};
+
+float3 CalcBumpedNormal(VS_OUTPUT input, Material material)
+{
+    float3 N = normalize(input.normal);
+    float3 T = normalize(input.tangent);
+    T = normalize(T - dot(T, N) * N);
+    float3 B = normalize(cross(T, N));
+    float3x3 tbn = float3x3(T, B, N);
+    float3 normal = getTexture(material.normal, input.texCoord).rgb;
+    if (use_flip_normal_y)
+        normal.y = 1 - normal.y;
+    normal = 2.0 * normal - 1.0;
+    if (material.flags & kPackedNormal)
+        normal.z = sqrt(1 - saturate(dot(normal.xy, normal.xy)));
+    normal = normalize(normal);
+    normal = normalize(mul(normal, tbn));
+    return normal;
+}
+
+PS_OUT main(VS_OUTPUT input)
+{
+    Material material = LoadMaterial(input.material);
+    if (getTexture(material.alpha, input.texCoord).r < 0.5)
+        discard;
+
+    PS_OUT output;
+    float3 normal;
+    if (use_normal_mapping && (material.flags & kHasNormalMap))
+        normal = CalcBumpedNormal(input, material);
+    else
+        normal = normalize(input.normal);
+    output.gNormal = EncodeNormal(normal);
+
+    output.gAlbedo = float4(getTexture(material.albedo, input.texCoord, true).rgb, 1.0);
+
+    if (material.flags & kUseGlossInsteadOfRoughness)
+        output.gMaterial.r = 1.0 - getTexture(material.gloss, input.texCoord).r;
+    else
+        output.gMaterial.r = getTexture(material.roughness, input.texCoord).r;
+    output.gMaterial.g = getTexture(material.metalness, input.texCoord).r;
+    output.gMaterial.b = getTexture(material.ao, input.texCoord).r;
+    output.gMaterial.a = EncodeIblProbe(ibl_source);
+
+    return output;
+}
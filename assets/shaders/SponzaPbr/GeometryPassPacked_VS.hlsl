@@ -0,0 +1,36 @@
+#include "Instancing.hlsli"
+#include "PackedVertex.hlsli"
+
+cbuffer ConstantBuf
+{
+    float4x4 model;
+    float4x4 view;
+    float4x4 projection;
+    float4x4 normalMatrix;
+};
+
+struct VS_OUTPUT
+{
+    float4 pos       : SV_POSITION;
+    float3 fragPos   : POSITION;
+    float3 normal    : NORMAL;
+    float3 tangent   : TANGENT;
+    float2 texCoord  : TEXCOORD;
+};
+
+VS_OUTPUT main(uint vertex_id : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    Vertex vs_in = LoadPackedVertex(vertex_id);
+
+    VS_OUTPUT vs_out;
+    float4 pos = float4(vs_in.pos, 1.0);
+    float4x4 instance = instances[instanceID];
+    float4 worldPos = mul(mul(pos, model), instance);
+    vs_out.fragPos = worldPos.xyz;
+    precise float4 clipPos = mul(worldPos, mul(view, projection));
+    vs_out.pos = clipPos;
+    vs_out.texCoord = vs_in.texCoord;
+    vs_out.normal = mul(mul(vs_in.normal, (float3x3)normalMatrix), (float3x3)instance);
+    vs_out.tangent = mul(mul(vs_in.tangent, (float3x3)normalMatrix), (float3x3)instance);
+    return vs_out;
+}
@@ -1,3 +1,5 @@
+#include "GBuffer.hlsli"
+
 struct VS_OUTPUT
 {
     float4 pos       : SV_POSITION;
@@ -17,15 +19,21 @@ Texture2D alphaMap;
 
 SamplerState g_sampler;
 
+// Opaque ranges are drawn without the alpha test to keep early depth testing after the depth pre-pass.
+#ifndef ALPHA_TEST
+#define ALPHA_TEST 1
+#endif
+
 cbuffer Settings
 {
     bool use_normal_mapping;
     bool use_flip_normal_y;
     bool use_gloss_instead_of_roughness;
+    // The normal map only has xy, BC5 of the texture cache.
+    bool use_packed_normal;
     int ibl_source;
 };
 
-static const bool is_packed_normal = false;
 static const bool is_sun_temple = false;
 static const bool use_standard_channel_binding = true;
 
@@ -39,10 +47,9 @@ float4 getTexture(Texture2D _texture, SamplerState _sample, float2 _tex_coord, b
 
 struct PS_OUT
 {
-    float4 gPosition : SV_Target0;
-    float4 gNormal   : SV_Target1;
-    float4 gAlbedo   : SV_Target2;
-    float4 gMaterial : SV_Target3;
+    float2 gNormal   : SV_Target0;
+    float4 gAlbedo   : SV_Target1;
+    float4 gMaterial : SV_Target2;
 };
 
 float3 CalcBumpedNormal(VS_OUTPUT input)
@@ -55,18 +62,17 @@ float3 CalcBumpedNormal(VS_OUTPUT input)
     float3 normal = normalMap.Sample(g_sampler, input.texCoord).rgb;
     if (use_flip_normal_y)
         normal.y = 1 - normal.y;
-    normal = normalize(2.0 * normal - 1.0);
-    if (is_packed_normal)
-    {
+    normal = 2.0 * normal - 1.0;
+    if (use_packed_normal)
         normal.z = sqrt(1 - saturate(dot(normal.xy, normal.xy)));
-        normal = normalize(normal);
-    }
+    normal = normalize(normal);
     normal = normalize(mul(normal, tbn));
     return normal;
 }
 
 PS_OUT main(VS_OUTPUT input)
 {
+#if ALPHA_TEST
     if (use_standard_channel_binding)
     {
         if (getTexture(alphaMap, g_sampler, input.texCoord).r < 0.5)
@@ -77,15 +83,15 @@ PS_OUT main(VS_OUTPUT input)
         if (getTexture(albedoMap, g_sampler, input.texCoord).a < 0.5)
             discard;
     }
+#endif
 
     PS_OUT output;
-    output.gPosition = float4(input.fragPos.xyz, 1);
-
+    float3 normal;
     if (use_normal_mapping)
-        output.gNormal.rgb = CalcBumpedNormal(input);
+        normal = CalcBumpedNormal(input);
     else
-        output.gNormal.rgb = normalize(input.normal);
-    output.gNormal.a = input.pos.z;
+        normal = normalize(input.normal);
+    output.gNormal = EncodeNormal(normal);
 
     output.gAlbedo = float4(getTexture(albedoMap, g_sampler, input.texCoord, true).rgb, 1.0);
 
@@ -104,7 +110,7 @@ PS_OUT main(VS_OUTPUT input)
     }
 
     output.gMaterial.b = getTexture(aoMap, g_sampler, input.texCoord).r;
-    output.gMaterial.a = ibl_source;
+    output.gMaterial.a = EncodeIblProbe(ibl_source);
 
     return output;
 }
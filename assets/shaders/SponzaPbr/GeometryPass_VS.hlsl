@@ -1,3 +1,5 @@
+#include "Instancing.hlsli"
+
 struct VS_INPUT
 {
     float3 pos        : POSITION;
@@ -25,15 +27,17 @@ struct VS_OUTPUT
     float2 texCoord  : TEXCOORD;
 };
 
-VS_OUTPUT main(VS_INPUT vs_in)
+VS_OUTPUT main(VS_INPUT vs_in, uint instanceID : SV_InstanceID)
 {
     VS_OUTPUT vs_out;
     float4 pos = float4(vs_in.pos, 1.0);
-    float4 worldPos = mul(pos, model);
+    float4x4 instance = instances[instanceID];
+    float4 worldPos = mul(mul(pos, model), instance);
     vs_out.fragPos = worldPos.xyz;
-    vs_out.pos = mul(worldPos, mul(view, projection));
+    precise float4 clipPos = mul(worldPos, mul(view, projection));
+    vs_out.pos = clipPos;
     vs_out.texCoord = vs_in.texCoord;
-    vs_out.normal = mul(vs_in.normal, (float3x3)normalMatrix);
-    vs_out.tangent = mul(vs_in.tangent, (float3x3)normalMatrix);
+    vs_out.normal = mul(mul(vs_in.normal, (float3x3)normalMatrix), (float3x3)instance);
+    vs_out.tangent = mul(mul(vs_in.tangent, (float3x3)normalMatrix), (float3x3)instance);
     return vs_out;
 }
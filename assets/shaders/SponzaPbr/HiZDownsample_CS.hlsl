@@ -0,0 +1,25 @@
+Texture2D<float> inputTexture;
+RWTexture2D<float> outputTexture;
+
+// Every output texel keeps the farthest depth of all input texels it overlaps, odd sizes overlap three.
+[numthreads(8, 8, 1)]
+void main(uint3 threadId : SV_DispatchThreadID)
+{
+    uint width, height;
+    outputTexture.GetDimensions(width, height);
+    if (threadId.x >= width || threadId.y >= height)
+        return;
+    uint input_width, input_height;
+    inputTexture.GetDimensions(input_width, input_height);
+    uint2 size = uint2(width, height);
+    uint2 input_size = uint2(input_width, input_height);
+    uint2 first = threadId.xy * input_size / size;
+    uint2 last = min(((threadId.xy + 1) * input_size + size - 1) / size, input_size);
+    float value = 0;
+    for (uint y = first.y; y < last.y; ++y)
+    {
+        for (uint x = first.x; x < last.x; ++x)
+            value = max(value, inputTexture.Load(int3(x, y, 0)));
+    }
+    outputTexture[threadId.xy] = value;
+}
@@ -0,0 +1,29 @@
+#ifndef SAMPLE_COUNT
+#define SAMPLE_COUNT 1
+#endif
+
+#if SAMPLE_COUNT > 1
+Texture2DMS<float> depth;
+#else
+Texture2D<float> depth;
+#endif
+
+RWTexture2D<float> hiz;
+
+// Level 0 of the pyramid is the farthest depth of every pixel.
+[numthreads(8, 8, 1)]
+void main(uint3 threadId : SV_DispatchThreadID)
+{
+    uint width, height;
+    hiz.GetDimensions(width, height);
+    if (threadId.x >= width || threadId.y >= height)
+        return;
+#if SAMPLE_COUNT > 1
+    float value = 0;
+    for (uint i = 0; i < SAMPLE_COUNT; ++i)
+        value = max(value, depth.Load(threadId.xy, i));
+#else
+    float value = depth.Load(int3(threadId.xy, 0));
+#endif
+    hiz[threadId.xy] = value;
+}
@@ -0,0 +1,38 @@
+#include "Instancing.hlsli"
+#include "PackedVertex.hlsli"
+
+cbuffer ConstantBuf
+{
+    float4x4 model;
+    float4x4 normalMatrix;
+    float4x4 View[6];
+    float4x4 Projection;
+};
+
+struct VS_OUTPUT
+{
+    float4 pos       : SV_POSITION;
+    float3 fragPos   : POSITION;
+    float3 normal    : NORMAL;
+    float3 tangent   : TANGENT;
+    float2 texCoord  : TEXCOORD;
+    uint RTIndex     : SV_RenderTargetArrayIndex;
+};
+
+// Models with packed vertices have no animation, so there is no bone transform.
+VS_OUTPUT main(uint vertex_id : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    Vertex vs_in = LoadPackedVertex(vertex_id);
+
+    VS_OUTPUT vs_out;
+    float4x4 instance = instances[instanceID / 6];
+    float4 worldPos = mul(mul(float4(vs_in.pos, 1.0), model), instance);
+    vs_out.fragPos = worldPos.xyz;
+    float4 viewPosition = mul(worldPos, View[instanceID % 6]);
+    vs_out.pos = mul(viewPosition, Projection);
+    vs_out.texCoord = vs_in.texCoord;
+    vs_out.normal = mul(mul(vs_in.normal, (float3x3)normalMatrix), (float3x3)instance);
+    vs_out.tangent = mul(mul(vs_in.tangent, (float3x3)normalMatrix), (float3x3)instance);
+    vs_out.RTIndex = instanceID % 6;
+    return vs_out;
+}
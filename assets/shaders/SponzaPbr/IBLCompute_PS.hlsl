@@ -30,6 +30,8 @@ cbuffer Settings
     bool use_normal_mapping;
     bool use_flip_normal_y;
     bool use_gloss_instead_of_roughness;
+    // The normal map only has xy, BC5 of the texture cache.
+    bool use_packed_normal;
 };
 
 struct Material
@@ -222,7 +224,6 @@ Texture2D alphaMap;
 
 SamplerState g_sampler;
 
-static const bool is_packed_normal = false;
 static const bool is_sun_temple = false;
 static const bool use_standard_channel_binding = true;
 
@@ -249,12 +250,10 @@ float3 CalcBumpedNormal(VS_OUTPUT input)
     float3 normal = normalMap.Sample(g_sampler, input.texCoord).rgb;
     if (use_flip_normal_y)
         normal.y = 1 - normal.y;
-    normal = normalize(2.0 * normal - 1.0);
-    if (is_packed_normal)
-    {
+    normal = 2.0 * normal - 1.0;
+    if (use_packed_normal)
         normal.z = sqrt(1 - saturate(dot(normal.xy, normal.xy)));
-        normal = normalize(normal);
-    }
+    normal = normalize(normal);
     normal = normalize(mul(normal, tbn));
     return normal;
 }
@@ -1,4 +1,5 @@
 #include "BoneTransform.hlsli"
+#include "Instancing.hlsli"
 
 struct VS_INPUT
 {
@@ -44,13 +45,14 @@ VS_OUTPUT main(VS_INPUT vs_in, uint instanceID : SV_InstanceID)
 
     VS_OUTPUT vs_out;
     float4 pos = mul(float4(vs_in.pos, 1.0), transform);
-    float4 worldPos = mul(pos, model);
+    float4x4 instance = instances[instanceID / 6];
+    float4 worldPos = mul(mul(pos, model), instance);
     vs_out.fragPos = worldPos.xyz;
-    float4 viewPosition = mul(worldPos, View[instanceID]);
+    float4 viewPosition = mul(worldPos, View[instanceID % 6]);
     vs_out.pos = mul(viewPosition, Projection);
     vs_out.texCoord = vs_in.texCoord;
-    vs_out.normal = mul(mul(vs_in.normal, transform), (float3x3)normalMatrix);
-    vs_out.tangent = mul(mul(vs_in.tangent, transform), (float3x3)normalMatrix);
-    vs_out.RTIndex = instanceID;
+    vs_out.normal = mul(mul(mul(vs_in.normal, transform), (float3x3)normalMatrix), (float3x3)instance);
+    vs_out.tangent = mul(mul(mul(vs_in.tangent, transform), (float3x3)normalMatrix), (float3x3)instance);
+    vs_out.RTIndex = instanceID % 6;
     return vs_out;
 }
@@ -0,0 +1,4 @@
+// Transforms of the instances of the drawn model, see SceneInstances.h. They are applied after the model matrix and
+// are rigid with a uniform scale, so normals take the rotation of the instance after the normal matrix. The passes
+// drawing the six faces of a cube map draw six instances per instance, instanceID % 6 is the face.
+StructuredBuffer<float4x4> instances;
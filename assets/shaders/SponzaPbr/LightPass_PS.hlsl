@@ -1,3 +1,5 @@
+#include "GBuffer.hlsli"
+
 struct VS_OUTPUT
 {
     float4 pos      : SV_POSITION;
@@ -10,10 +12,13 @@ struct VS_OUTPUT
 
 #if SAMPLE_COUNT > 1
 #define TEXTURE_TYPE Texture2DMS<float4>
+#define DEPTH_TEXTURE_TYPE Texture2DMS<float>
 #else
 #define TEXTURE_TYPE Texture2D
+#define DEPTH_TEXTURE_TYPE Texture2D<float>
 #endif
 
+DEPTH_TEXTURE_TYPE gDepth;
 TEXTURE_TYPE gNormal;
 TEXTURE_TYPE gAlbedo;
 TEXTURE_TYPE gMaterial;
@@ -83,6 +88,19 @@ float4 getTexture(TEXTURE_TYPE _texture, float2 _tex_coord, int ss_index, bool _
     return _color;
 }
 
+float getDepth(float2 _tex_coord, int ss_index)
+{
+#if SAMPLE_COUNT > 1
+    float3 gbufferDim;
+    gDepth.GetDimensions(gbufferDim.x, gbufferDim.y, gbufferDim.z);
+    return gDepth.Load(_tex_coord * float2(gbufferDim.xy), ss_index);
+#else
+    uint2 dim;
+    gDepth.GetDimensions(dim.x, dim.y);
+    return gDepth.Load(uint3(dim * _tex_coord, 0));
+#endif
+}
+
 struct Material
 {
     float3 albedo;
@@ -266,25 +284,23 @@ float4 main(VS_OUTPUT input) : SV_TARGET
     [unroll (SAMPLE_COUNT)]
     for (uint i = 0; i < SAMPLE_COUNT; ++i)
     {
-        float4 albedo_rgba = getTexture(gAlbedo, input.texcoord, i);
-        float3 albedo = albedo_rgba.rgb;
-        float3 normal = normalize(getTexture(gNormal, input.texcoord, i).rgb);
-        float roughness = getTexture(gMaterial, input.texcoord, i).r;
-        float metallic = getTexture(gMaterial, input.texcoord, i).g;
-        int ibl_probe_index = getTexture(gMaterial, input.texcoord, i).a;
-
-        float x = input.texcoord.x * 2 - 1;
-        float y = (1 - input.texcoord.y) * 2 - 1;
-        float z = getTexture(gNormal, input.texcoord, i).a;
-        float4 vProjectedPos = float4(x, y, z, 1.0f);
-        // Transform by the inverse projection matrix
-        float4 vPositionVS = mul(vProjectedPos, inverted_mvp);  
-        // Divide by w to get the view-space position
-        float3 fragPos = vPositionVS.xyz / vPositionVS.w;
+        float depth = getDepth(input.texcoord, i);
+        // Samples without geometry are filled by the background pass.
+        if (depth == 1.0)
+            continue;
+
+        float3 albedo = getTexture(gAlbedo, input.texcoord, i).rgb;
+        float3 normal = DecodeNormal(getTexture(gNormal, input.texcoord, i).rg);
+        float4 material = getTexture(gMaterial, input.texcoord, i);
+        float roughness = material.r;
+        float metallic = material.g;
+        int ibl_probe_index = DecodeIblProbe(material.a);
+
+        float3 fragPos = ReconstructPosition(input.texcoord, depth, inverted_mvp);
 
         float ao = 1;
         if (use_ao)
-            ao = getTexture(gMaterial, input.texcoord, i).b;
+            ao = material.b;
 
         float ssao = 1;
         if (use_ssao)
@@ -323,12 +339,6 @@ float4 main(VS_OUTPUT input) : SV_TARGET
             continue;
         }
 
-        if (albedo_rgba.a == 0)
-        {
-            lighting += albedo;
-            continue;
-        }
-
         Material m;
         m.albedo = albedo;
         m.roughness = roughness;
@@ -0,0 +1,109 @@
+#include "CullingTests.hlsli"
+
+// Layout of GpuMeshlet in SceneMeshlets.cpp.
+struct Meshlet
+{
+    float3 bmin;          // model space bounds
+    uint start_index;     // first index in meshlet_indices
+    float3 bmax;
+    uint index_count;
+    float3 cone_axis;     // model space, see MeshletBuilder.h
+    float cone_cutoff;
+    uint range;           // draw the triangles are appended to
+    uint model;
+    uint never_culled;
+    uint padding;
+};
+
+StructuredBuffer<Meshlet> meshlets;
+StructuredBuffer<uint> meshlet_indices;   // relative to the base vertex of the range
+StructuredBuffer<float4x4> model_matrices;
+StructuredBuffer<float4> model_eyes;      // eye in the space of every model, for the cone test
+
+RWStructuredBuffer<uint> indices;         // culled index buffer, a region per range
+RWStructuredBuffer<uint> draw_args;       // five values per range, the start index is the start of its region
+RWStructuredBuffer<uint> occluded;        // meshlets rejected by the first phase occlusion test
+
+cbuffer Settings
+{
+    float4x4 view_projection;
+    float4x4 hiz_view_projection;
+    uint meshlet_count;
+    uint phase;
+    bool use_hiz;
+    float max_distance;
+    float3 eye;
+};
+
+groupshared uint visible_offset;
+
+// The test is done in model space, facing is preserved by affine transforms with a positive determinant.
+bool IsBackfacing(Meshlet meshlet, float3 model_eye)
+{
+    float3 center = (meshlet.bmin + meshlet.bmax) * 0.5;
+    float radius = length(meshlet.bmax - meshlet.bmin) * 0.5;
+    float3 direction = center - model_eye;
+    return dot(direction, meshlet.cone_axis) >= meshlet.cone_cutoff * length(direction) + radius;
+}
+
+bool IsInRange(Meshlet meshlet, float4x4 world)
+{
+    float3 center = mul(float4((meshlet.bmin + meshlet.bmax) * 0.5, 1.0), world).xyz;
+    float scale = max(max(length(world[0].xyz), length(world[1].xyz)), length(world[2].xyz));
+    float radius = length(meshlet.bmax - meshlet.bmin) * 0.5 * scale;
+    return length(center - eye) - radius <= max_distance;
+}
+
+bool IsVisible(uint id)
+{
+    Meshlet meshlet = meshlets[id];
+    if (meshlet.never_culled != 0)
+        return phase == 0;
+
+    float4x4 world = model_matrices[meshlet.model];
+    if (phase == 1)
+    {
+        // Retest what the first phase rejected against the pyramid of this frame's first phase depth.
+        return occluded[id] != 0 && !IsOccluded(meshlet.bmin, meshlet.bmax, mul(world, view_projection));
+    }
+
+    bool is_occluded = false;
+    bool visible = !IsBackfacing(meshlet, model_eyes[meshlet.model].xyz);
+    if (max_distance > 0)
+        visible = visible && IsInRange(meshlet, world);
+    else
+        visible = visible && IsInFrustum(meshlet.bmin, meshlet.bmax, mul(world, view_projection));
+    if (visible && use_hiz)
+        is_occluded = IsOccluded(meshlet.bmin, meshlet.bmax, mul(world, hiz_view_projection));
+    occluded[id] = is_occluded ? 1 : 0;
+    return visible && !is_occluded;
+}
+
+// One group per meshlet, the groups are laid out in rows of 65535.
+[numthreads(64, 1, 1)]
+void main(uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID)
+{
+    uint id = groupId.y * 65535 + groupId.x;
+    if (id >= meshlet_count)
+        return;
+
+    Meshlet meshlet = meshlets[id];
+    if (threadId.x == 0)
+    {
+        visible_offset = ~0u;
+        if (IsVisible(id))
+        {
+            uint slot;
+            InterlockedAdd(draw_args[5 * meshlet.range], meshlet.index_count, slot);
+            visible_offset = draw_args[5 * meshlet.range + 2] + slot;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (visible_offset == ~0u)
+        return;
+    for (uint i = threadId.x; i < meshlet.index_count; i += 64)
+    {
+        indices[visible_offset + i] = meshlet_indices[meshlet.start_index + i];
+    }
+}
@@ -0,0 +1,61 @@
+#include "CullingTests.hlsli"
+
+StructuredBuffer<uint4> range_info;      // index count, start index, base vertex, model id
+StructuredBuffer<float4> range_bounds;   // model space min and max, two entries per range
+StructuredBuffer<float4x4> model_matrices;
+StructuredBuffer<uint4> model_info;      // first draw of the model in draw_args, never culled flag, instance count
+
+RWStructuredBuffer<uint> draw_args;      // five values per draw, see IndirectDrawArgs
+RWStructuredBuffer<uint> draw_count;     // one counter per model
+RWStructuredBuffer<uint> occluded;       // ranges rejected by the first phase occlusion test
+
+cbuffer Settings
+{
+    float4x4 view_projection;
+    float4x4 hiz_view_projection;
+    uint range_count;
+    uint phase;
+    bool use_hiz;
+};
+
+[numthreads(64, 1, 1)]
+void main(uint3 threadId : SV_DispatchThreadID)
+{
+    uint id = threadId.x;
+    if (id >= range_count)
+        return;
+
+    uint4 info = range_info[id];
+    uint4 model = model_info[info.w];
+    float3 bmin = range_bounds[2 * id].xyz;
+    float3 bmax = range_bounds[2 * id + 1].xyz;
+    float4x4 world = model_matrices[info.w];
+
+    bool visible;
+    if (phase == 0)
+    {
+        // Objects visible last frame are the likely occluders, test against the previous frame's pyramid.
+        bool is_occluded = false;
+        visible = model.y != 0 || IsInFrustum(bmin, bmax, mul(world, view_projection));
+        if (visible && model.y == 0 && use_hiz)
+            is_occluded = IsOccluded(bmin, bmax, mul(world, hiz_view_projection));
+        occluded[id] = is_occluded ? 1 : 0;
+        visible = visible && !is_occluded;
+    }
+    else
+    {
+        // Retest what the first phase rejected against the pyramid of this frame's first phase depth.
+        visible = occluded[id] != 0 && !IsOccluded(bmin, bmax, mul(world, view_projection));
+    }
+    if (!visible)
+        return;
+
+    uint slot;
+    InterlockedAdd(draw_count[info.w], 1, slot);
+    uint offset = 5 * (model.x + slot);
+    draw_args[offset + 0] = info.x;
+    draw_args[offset + 1] = model.z;
+    draw_args[offset + 2] = info.y;
+    draw_args[offset + 3] = info.z;
+    draw_args[offset + 4] = 0;
+}
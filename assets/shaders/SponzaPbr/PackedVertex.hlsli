@@ -0,0 +1,47 @@
+#include "GBuffer.hlsli"
+
+// Layout of PackedVertex in PackedVertices.h.
+struct PackedVertex
+{
+    uint2 position; // x, y and z as unorm16 within the bounds of the range
+    uint normal;    // octahedral, snorm16 x2
+    uint tangent;   // octahedral, snorm16 x2
+    uint texcoord;  // half x2
+};
+
+StructuredBuffer<PackedVertex> packed_vertices;
+
+cbuffer PackedParams
+{
+    float4x4 dequantize;
+    uint base_vertex;
+};
+
+struct Vertex
+{
+    float3 pos;
+    float3 normal;
+    float2 texCoord;
+    float3 tangent;
+};
+
+float2 UnpackSnorm2x16(uint value)
+{
+    int2 s = int2(value << 16, value) >> 16;
+    return max(float2(s) / 32767.0, -1.0);
+}
+
+// The draw passes no base vertex, vertex_id is the value from the index buffer.
+Vertex LoadPackedVertex(uint vertex_id)
+{
+    PackedVertex packed = packed_vertices[base_vertex + vertex_id];
+    float3 quantized = float3(packed.position.x & 0xffff, packed.position.x >> 16, packed.position.y & 0xffff);
+    precise float4 pos = mul(float4(quantized / 65535.0, 1.0), dequantize);
+
+    Vertex vertex;
+    vertex.pos = pos.xyz;
+    vertex.normal = DecodeNormal(UnpackSnorm2x16(packed.normal));
+    vertex.tangent = DecodeNormal(UnpackSnorm2x16(packed.tangent));
+    vertex.texCoord = f16tof32(uint2(packed.texcoord, packed.texcoord >> 16));
+    return vertex;
+}
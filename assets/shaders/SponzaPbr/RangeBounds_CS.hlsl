@@ -0,0 +1,36 @@
+StructuredBuffer<float3> in_position;
+StructuredBuffer<uint> index_buffer;
+
+// Six values per range: min xyz then max xyz, encoded so that unsigned comparison matches float comparison.
+RWStructuredBuffer<uint> out_bounds;
+
+cbuffer cb
+{
+    uint IndexCount;
+    uint StartIndexLocation;
+    uint BaseVertexLocation;
+    uint RangeId;
+};
+
+uint EncodeOrdered(float value)
+{
+    uint bits = asuint(value);
+    return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+}
+
+[numthreads(256, 1, 1)]
+void main(uint3 threadId : SV_DispatchthreadId)
+{
+    if (threadId.x >= IndexCount)
+        return;
+    uint vertex_id = index_buffer[StartIndexLocation + threadId.x] + BaseVertexLocation;
+    float3 pos = in_position[vertex_id];
+    uint offset = 6 * RangeId;
+    uint prev;
+    InterlockedMin(out_bounds[offset + 0], EncodeOrdered(pos.x), prev);
+    InterlockedMin(out_bounds[offset + 1], EncodeOrdered(pos.y), prev);
+    InterlockedMin(out_bounds[offset + 2], EncodeOrdered(pos.z), prev);
+    InterlockedMax(out_bounds[offset + 3], EncodeOrdered(pos.x), prev);
+    InterlockedMax(out_bounds[offset + 4], EncodeOrdered(pos.y), prev);
+    InterlockedMax(out_bounds[offset + 5], EncodeOrdered(pos.z), prev);
+}
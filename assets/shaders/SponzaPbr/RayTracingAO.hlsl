@@ -1,3 +1,5 @@
+#include "GBuffer.hlsli"
+
 //--------------------------------------------------------------------------------
 // copy of https://github.com/NVIDIAGameWorks/GettingStartedWithRTXRayTracing/blob/master/05-ao/Data/Tutorial05/hlslUtils.hlsli
 //--------------------------------------------------------------------------------
@@ -61,6 +63,7 @@ cbuffer Settings
     uint frame_index;
     uint num_rays;
     bool use_alpha_test;
+    float4x4 inverted_mvp;
 };
 
 #ifndef SAMPLE_COUNT
@@ -69,11 +72,13 @@ cbuffer Settings
 
 #if SAMPLE_COUNT > 1
 #define TEXTURE_TYPE Texture2DMS<float4>
+#define DEPTH_TEXTURE_TYPE Texture2DMS<float>
 #else
 #define TEXTURE_TYPE Texture2D
+#define DEPTH_TEXTURE_TYPE Texture2D<float>
 #endif
 
-TEXTURE_TYPE gPosition;
+DEPTH_TEXTURE_TYPE gDepth;
 TEXTURE_TYPE gNormal;
 RaytracingAccelerationStructure geometry;
 RWTexture2D<float4> result;
@@ -98,6 +103,16 @@ float4 GetValue(Texture2D tex, uint2 tex_coord, uint ss_index = 0)
     return tex[tex_coord];
 }
 
+float GetDepth(Texture2DMS<float> tex, uint2 tex_coord, uint ss_index)
+{
+    return tex.Load(tex_coord, ss_index);
+}
+
+float GetDepth(Texture2D<float> tex, uint2 tex_coord, uint ss_index = 0)
+{
+    return tex[tex_coord];
+}
+
 float ShootAmbientOcclusionRay(float3 orig, float3 dir)
 {
     RayPayload rayPayload = { 0.0f };
@@ -122,10 +137,12 @@ void RayGen()
     float ao = 0.0;
     for (uint i = 0; i < SAMPLE_COUNT; ++i)
     {
-        float4 position = GetValue(gPosition, launch_index, i);
-        float3 normal = GetValue(gNormal, launch_index, i).xyz;
-        if (position.w == 0.0)
+        float depth = GetDepth(gDepth, launch_index, i);
+        if (depth == 1.0)
             continue;
+        float2 texcoord = (launch_index + 0.5) / launch_dim;
+        float3 position = ReconstructPosition(texcoord, depth, inverted_mvp);
+        float3 normal = DecodeNormal(GetValue(gNormal, launch_index, i).xy);
         for (uint j = i * kernel_per_sample; j < (i + 1) * kernel_per_sample; ++j)
         {
             float3 dir = getCosHemisphereSample(rand_seed, normal);
@@ -1,3 +1,5 @@
+#include "GBuffer.hlsli"
+
 struct VS_OUTPUT
 {
     float4 pos      : SV_POSITION;
@@ -10,11 +12,13 @@ struct VS_OUTPUT
 
 #if SAMPLE_COUNT > 1
 #define TEXTURE_TYPE Texture2DMS<float4>
+#define DEPTH_TEXTURE_TYPE Texture2DMS<float>
 #else
 #define TEXTURE_TYPE Texture2D
+#define DEPTH_TEXTURE_TYPE Texture2D<float>
 #endif
 
-TEXTURE_TYPE gPosition;
+DEPTH_TEXTURE_TYPE gDepth;
 TEXTURE_TYPE gNormal;
 Texture2D noiseTexture;
 
@@ -24,8 +28,8 @@ Texture2D noiseTexture;
 cbuffer SSAOBuffer
 {
     float4x4 projection;
-    float4x4 view;
     float4x4 viewInverse;
+    float4x4 projectionInverse;
     float4 samples[KERNEL_SIZE];
     int width;
     int height;
@@ -49,16 +53,28 @@ float4 getTexture(Texture2D _texture, float2 _tex_coord, int ss_index = 0)
     return _color;
 }
 
+float getDepth(Texture2DMS<float> _texture, float2 _tex_coord, int ss_index)
+{
+    float3 gbufferDim;
+    _texture.GetDimensions(gbufferDim.x, gbufferDim.y, gbufferDim.z);
+    return _texture.Load(_tex_coord * float2(gbufferDim.xy), ss_index);
+}
+
+float getDepth(Texture2D<float> _texture, float2 _tex_coord, int ss_index = 0)
+{
+    uint2 dim;
+    _texture.GetDimensions(dim.x, dim.y);
+    return _texture.Load(uint3(dim * _tex_coord, 0));
+}
+
 float3 get_pos(float2 texCoord, int ss_index)
 {
-    float4 fragPos = getTexture(gPosition, texCoord, ss_index);
-    fragPos = mul(fragPos, view);
-    return fragPos.xyz;
+    return ReconstructPosition(texCoord, getDepth(gDepth, texCoord, ss_index), projectionInverse);
 }
 
 float3 get_normal(float2 texCoord, int ss_index)
 {
-    float3 normal = normalize(getTexture(gNormal, texCoord, ss_index).xyz);
+    float3 normal = DecodeNormal(getTexture(gNormal, texCoord, ss_index).xy);
     normal = normalize(mul(normal, (float3x3)viewInverse));
     return normal;
 }
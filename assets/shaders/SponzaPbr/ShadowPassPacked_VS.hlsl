@@ -0,0 +1,30 @@
+#include "Instancing.hlsli"
+#include "PackedVertex.hlsli"
+
+cbuffer VSParams
+{
+    float4x4 World;
+    float4x4 View[6];
+    float4x4 Projection;
+};
+
+struct VertexOutput
+{
+    float4 pos : SV_POSITION;
+    float2 texCoord  : TEXCOORD;
+    uint RTIndex : SV_RenderTargetArrayIndex;
+};
+
+VertexOutput main(uint vertex_id : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+    Vertex input = LoadPackedVertex(vertex_id);
+
+    VertexOutput output;
+    float4 worldPosition = mul(float4(input.pos, 1.0), World);
+    worldPosition = mul(worldPosition, instances[instanceID / 6]);
+    float4 viewPosition = mul(worldPosition, View[instanceID % 6]);
+    output.pos = mul(viewPosition, Projection);
+    output.texCoord = input.texCoord;
+    output.RTIndex = instanceID % 6;
+    return output;
+}
@@ -1,3 +1,5 @@
+#include "Instancing.hlsli"
+
 cbuffer VSParams
 {
     float4x4 World;
@@ -22,9 +24,10 @@ VertexOutput main(VertexInput input, uint instanceID : SV_InstanceID)
 {
     VertexOutput output;
     float4 worldPosition = mul(float4(input.Position, 1.0), World);
-    float4 viewPosition = mul(worldPosition, View[instanceID]);
+    worldPosition = mul(worldPosition, instances[instanceID / 6]);
+    float4 viewPosition = mul(worldPosition, View[instanceID % 6]);
     output.pos = mul(viewPosition, Projection);
     output.texCoord = input.texCoord;
-    output.RTIndex = instanceID;
+    output.RTIndex = instanceID % 6;
     return output;
 }
@@ -0,0 +1,140 @@
+#include "AppOptions.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace {
+
+// The whole value must be a number in the range of T.
+template <typename T>
+bool ParseNumber(const char* str, T& value)
+{
+    char* end = nullptr;
+    errno = 0;
+    if constexpr (std::is_floating_point_v<T>) {
+        double res = std::strtod(str, &end);
+        if (end == str || *end || errno == ERANGE) {
+            return false;
+        }
+        value = static_cast<T>(res);
+    } else {
+        long long res = std::strtoll(str, &end, 10);
+        if (end == str || *end || errno == ERANGE || res < std::numeric_limits<T>::min() ||
+            res > std::numeric_limits<T>::max()) {
+            return false;
+        }
+        value = static_cast<T>(res);
+    }
+    return true;
+}
+
+} // namespace
+
+bool ParseAppOptions(int argc, char* argv[], AppOptions& options)
+{
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i) {
+        std::string arg(argv[i]);
+        bool has_value = i + 1 < argc;
+        auto parse = [&](auto& value) {
+            if (!ParseNumber(argv[++i], value)) {
+                std::cerr << "Invalid value " << argv[i] << " for " << arg << std::endl;
+                valid = false;
+            }
+        };
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && has_value) {
+            parse(options.frames);
+        } else if (arg == "--width" && has_value) {
+            parse(options.width);
+        } else if (arg == "--height" && has_value) {
+            parse(options.height);
+        } else if (arg == "--dump-frame" && has_value) {
+            uint32_t frame = 0;
+            parse(frame);
+            options.dump_frames.insert(frame);
+        } else if (arg == "--dump-prefix" && has_value) {
+            options.dump_prefix = argv[++i];
+        } else if (arg == "--dump-format" && has_value) {
+            options.dump_format = argv[++i];
+        } else if (arg == "--benchmark" && has_value) {
+            options.benchmark_path = argv[++i];
+        } else if (arg == "--report" && has_value) {
+            options.benchmark_report = argv[++i];
+        } else if (arg == "--warmup" && has_value) {
+            parse(options.warmup_frames);
+        } else if (arg == "--timestep" && has_value) {
+            parse(options.timestep);
+        } else if (arg == "--profile" && has_value) {
+            options.profile_report = argv[++i];
+        } else if (arg == "--preset" && has_value) {
+            options.preset = argv[++i];
+        } else if (arg == "--set" && has_value) {
+            options.overrides.push_back(argv[++i]);
+        } else if (arg == "--save-preset" && has_value) {
+            options.save_preset = argv[++i];
+        } else if (arg == "--sweep" && has_value) {
+            options.sweep_path = argv[++i];
+        } else if (arg == "--sweep-report" && has_value) {
+            options.sweep_report = argv[++i];
+        } else if (arg == "--sweep-frames" && has_value) {
+            parse(options.sweep_frames);
+        } else if (arg == "--cull-benchmark" && has_value) {
+            parse(options.cull_benchmark);
+        }
+    }
+
+    if (!valid) {
+        return false;
+    }
+    if (options.width <= 0 || options.height <= 0) {
+        std::cerr << "Invalid size " << options.width << "x" << options.height << std::endl;
+        return false;
+    }
+    if (options.dump_format != "png" && options.dump_format != "exr") {
+        std::cerr << "Unsupported dump format " << options.dump_format << ", png will be used" << std::endl;
+        options.dump_format = "png";
+    }
+    if ((!options.benchmark_path.empty() || !options.sweep_path.empty()) && options.timestep == 0.0f) {
+        options.timestep = 1.0f / 60.0f;
+    }
+    if (!options.sweep_path.empty() && options.warmup_frames == 0) {
+        // Settings changes recreate resources and pipelines, the first frames of a cell are not representative.
+        options.warmup_frames = 30;
+    }
+    if (options.headless && options.frames == 0 && options.benchmark_path.empty() && options.sweep_path.empty()) {
+        options.frames = 1;
+        if (!options.dump_frames.empty()) {
+            options.frames = *options.dump_frames.rbegin() + 1;
+        }
+    }
+    return true;
+}
+
+void PrintAppOptionsUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options]" << std::endl
+              << "  --headless                  render offscreen without presenting" << std::endl
+              << "  --frames N                  exit after N frames" << std::endl
+              << "  --width W --height H        offscreen resolution" << std::endl
+              << "  --dump-frame N              save frame N, may be repeated" << std::endl
+              << "  --dump-prefix P             path prefix of saved frames" << std::endl
+              << "  --dump-format png|exr       final image or HDR light pass output" << std::endl
+              << "  --benchmark PATH            run the camera path and write a report" << std::endl
+              << "  --report PATH               benchmark report" << std::endl
+              << "  --warmup N                  frames rendered before measuring" << std::endl
+              << "  --timestep S                fixed scene time step in seconds" << std::endl
+              << "  --profile PATH              enable the GPU profiler and write its averages" << std::endl
+              << "  --preset PATH               load a settings preset" << std::endl
+              << "  --set NAME=VALUE            override a setting, may be repeated" << std::endl
+              << "  --save-preset PATH          save the settings after the overrides" << std::endl
+              << "  --sweep PATH                render every cell of a settings matrix" << std::endl
+              << "  --sweep-report PATH         sweep report" << std::endl
+              << "  --sweep-frames N            measured frames per sweep cell" << std::endl
+              << "  --cull-benchmark N          run the culling microbenchmark on N boxes" << std::endl;
+}
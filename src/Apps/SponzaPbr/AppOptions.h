@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+struct AppOptions {
+    bool headless = false;
+    // Number of frames to render before exiting, 0 means until the window is closed.
+    uint32_t frames = 0;
+    int width = 1280;
+    int height = 720;
+    std::set<uint32_t> dump_frames;
+    // Frame N is written to "<dump_prefix><N>.<dump_format>", png stores the final image and exr the HDR
+    // output of the light pass.
+    std::string dump_prefix = "SponzaPbr_frame_";
+    std::string dump_format = "png";
+    // Camera path file, see CameraPath. Enables the fixed timestep and per-frame GPU timing.
+    std::string benchmark_path;
+    std::string benchmark_report = "SponzaPbr_benchmark.csv";
+    // Frames rendered before the path starts, they are not part of the report.
+    uint32_t warmup_frames = 0;
+    // Scene time step in seconds, 0 uses the wall clock.
+    float timestep = 0.0f;
+    // Enables the GPU profiler and writes its averages on exit.
+    std::string profile_report;
+    // Settings preset loaded at startup, followed by "name=value" overrides in command line order.
+    std::string preset;
+    std::vector<std::string> overrides;
+    // Written after the preset and overrides are applied.
+    std::string save_preset;
+    // Settings matrix file, see SettingsSweep. Every cell renders warmup_frames plus sweep_frames.
+    std::string sweep_path;
+    std::string sweep_report = "SponzaPbr_sweep.csv";
+    uint32_t sweep_frames = 100;
+    // Runs the frustum culling microbenchmark on this many boxes and exits without creating a window.
+    uint32_t cull_benchmark = 0;
+};
+
+// Reads the SponzaPbr specific arguments, everything else is left to ParseArgs. Returns false if a value is
+// malformed, options are left partially filled then.
+bool ParseAppOptions(int argc, char* argv[], AppOptions& options);
+void PrintAppOptionsUsage(const char* program);
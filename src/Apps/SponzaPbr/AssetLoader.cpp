@@ -0,0 +1,259 @@
+#include "AssetLoader.h"
+#include "TextureData.h"
+#include "TextureStreaming.h"
+
+#include "Geometry/ModelLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+namespace {
+
+// Collects the meshes the importer hands to a model.
+class MeshRecorder : public IModel {
+public:
+    void AddMesh(const IMesh& mesh) override
+    {
+        meshes.push_back(mesh);
+    }
+
+    Bones& GetBones() override
+    {
+        return bones;
+    }
+
+    std::vector<IMesh> meshes;
+    Bones bones;
+};
+
+double GetMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+std::optional<TextureRole> GetMaterialTextureRole(aiTextureType type)
+{
+    switch (type) {
+    case aiTextureType_DIFFUSE:
+        return TextureRole::kAlbedo;
+    case aiTextureType_HEIGHT:
+    case aiTextureType_NORMALS:
+        return TextureRole::kNormal;
+    case aiTextureType_SHININESS:
+    case aiTextureType_SPECULAR:
+    case aiTextureType_AMBIENT:
+    case aiTextureType_LIGHTMAP:
+    case aiTextureType_OPACITY:
+        return TextureRole::kMask;
+    default:
+        return std::nullopt;
+    }
+}
+
+AssetLoader::AssetLoader(RenderDevice& device, ThreadPool& thread_pool)
+    : m_device(device)
+    , m_thread_pool(thread_pool)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+    // The texture loads queued by the model workers reference this object.
+    for (auto& load : m_models) {
+        if (!load.model.valid()) {
+            continue;
+        }
+        try {
+            LoadedModel loaded = load.model.get();
+            for (auto& texture : loaded.textures) {
+                if (texture.result.valid()) {
+                    texture.result.wait();
+                }
+            }
+        } catch (...) {
+        }
+    }
+    for (auto& load : m_textures) {
+        if (load.result.valid()) {
+            load.result.wait();
+        }
+    }
+}
+
+void AssetLoader::LoadModel(const ModelSource& source, std::function<void(Model&)> setup)
+{
+    auto& load = m_models.emplace_back();
+    load.path = source.path;
+    load.setup = std::move(setup);
+    load.model = m_thread_pool.Push([this, source] {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ModelLoadInfo info;
+        info.source_key = GetSceneCacheKey(source);
+        SceneCache scene_cache;
+        CachedModel cached;
+        bool cache_found = scene_cache.Load(info.source_key, cached);
+        if (cache_found) {
+            info.textures = std::move(cached.textures);
+            info.uv_densities = std::move(cached.uv_densities);
+        } else {
+            // Model keeps no texture lists, they are taken from an import of our own.
+            MeshRecorder recorder;
+            ModelLoader(source.path, source.flags, recorder);
+            info.skinned = std::any_of(recorder.meshes.begin(), recorder.meshes.end(),
+                                       [](const IMesh& mesh) { return !mesh.bones_count.empty(); });
+            for (const auto& mesh : recorder.meshes) {
+                if (!info.skinned) {
+                    info.textures.push_back(mesh.textures);
+                }
+                info.uv_densities.push_back(ComputeUvDensity(mesh));
+            }
+        }
+
+        // Model decodes the textures it imports. Every file with a compressed version in the texture cache for its
+        // role is loaded once more on a worker of its own and replaces them in Finish.
+        std::vector<MaterialTextureLoad> textures;
+        std::map<std::pair<std::string, std::optional<TextureRole>>, size_t> texture_ids;
+        std::vector<std::optional<TextureRole>> roles;
+        for (size_t mesh_id = 0; mesh_id < info.textures.size(); ++mesh_id) {
+            for (const auto& texture : info.textures[mesh_id]) {
+                std::optional<TextureRole> role = GetMaterialTextureRole(texture.type);
+                auto it = texture_ids.emplace(std::make_pair(texture.path, role), textures.size()).first;
+                if (it->second == textures.size()) {
+                    textures.emplace_back().texture.path = texture.path;
+                    roles.push_back(role);
+                }
+                textures[it->second].texture.slots.emplace_back(mesh_id, texture.type);
+            }
+        }
+        for (size_t i = 0; i < textures.size(); ++i) {
+            const std::string& path = textures[i].texture.path;
+            if (roles[i] && !TextureCompressionCache(kTextureCachePath).Find(path, *roles[i]).empty()) {
+                textures[i].result = PushTexture(path, roles[i]);
+            } else {
+                textures[i].texture.file = path;
+            }
+        }
+
+        // The import creates the device objects as it goes, so it runs behind the mutex as a whole.
+        std::lock_guard<std::mutex> lock(m_device_mutex);
+        std::shared_ptr<RenderCommandList> command_list = m_device.CreateRenderCommandList();
+        Model model(m_device, *command_list, source.path, source.flags);
+        ModelLods lods;
+        if (cache_found && scene_cache.Restore(*command_list, model, cached)) {
+            info.restored = true;
+            if (!cached.lod_ranges.empty()) {
+                lods.indices.reset(new IAIndexBuffer(m_device, *command_list, cached.lod_indices,
+                                                     gli::format::FORMAT_R32_UINT_PACK32));
+                lods.ranges = std::move(cached.lod_ranges);
+            }
+        }
+        command_list->Close();
+        LoadedModel loaded = { std::move(model), std::move(lods), std::move(info), command_list };
+        loaded.milliseconds = GetMilliseconds(start);
+        loaded.textures = std::move(textures);
+        return loaded;
+    });
+}
+
+void AssetLoader::LoadTexture(const std::string& path, TextureRole role, std::shared_ptr<Resource>& texture)
+{
+    auto& load = m_textures.emplace_back();
+    load.path = path;
+    load.texture = &texture;
+    load.result = PushTexture(path, role);
+}
+
+std::future<AssetLoader::LoadedTexture> AssetLoader::PushTexture(const std::string& path,
+                                                                  std::optional<TextureRole> role)
+{
+    return m_thread_pool.Push([this, path, role] {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string file;
+        if (role) {
+            file = TextureCompressionCache(kTextureCachePath).Find(path, *role);
+        }
+        if (file.empty()) {
+            file = path;
+        }
+        TextureData data;
+        bool decoded = LoadTextureData(file, data);
+
+        LoadedTexture result;
+        result.file = file;
+        std::lock_guard<std::mutex> lock(m_device_mutex);
+        result.command_list = m_device.CreateRenderCommandList();
+        if (decoded) {
+            result.texture = CreateTextureFromData(m_device, *result.command_list, data);
+        } else {
+            // Formats LoadTextureData doesn't read are decoded by the texture module, behind the mutex.
+            result.texture = CreateTexture(m_device, *result.command_list, file);
+        }
+        result.command_list->Close();
+        result.milliseconds = GetMilliseconds(start);
+        return result;
+    });
+}
+
+void AssetLoader::Finish(SceneModels& scene_list, SceneLods& lods, std::vector<ModelLoadInfo>& infos)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<RenderCommandList>> command_lists;
+    for (auto& load : m_models) {
+        LoadedModel loaded = load.model.get();
+        Model& model = scene_list.emplace_back(std::move(loaded.model));
+        command_lists.push_back(loaded.command_list);
+        size_t texture_count = 0;
+        double texture_milliseconds = 0;
+        for (auto& texture : loaded.textures) {
+            if (texture.result.valid()) {
+                LoadedTexture result = texture.result.get();
+                for (const auto& [mesh_id, type] : texture.texture.slots) {
+                    if (auto* slot = GetMaterialSlot(model.GetMaterial(mesh_id), type, texture.texture.path)) {
+                        *slot = result.texture;
+                    }
+                }
+                texture.texture.file = result.file;
+                command_lists.push_back(result.command_list);
+                texture_milliseconds += result.milliseconds;
+                ++texture_count;
+            }
+            loaded.info.texture_files.push_back(std::move(texture.texture));
+        }
+        if (load.setup) {
+            load.setup(model);
+        }
+        lods.resize(scene_list.size());
+        lods.back() = std::move(loaded.lods);
+        infos.push_back(std::move(loaded.info));
+        std::cout << "Loaded " << load.path << (infos.back().restored ? " from the scene cache" : "") << " in "
+                  << std::fixed << std::setprecision(1) << loaded.milliseconds << " ms, its "
+                  << texture_count << " compressed textures in " << texture_milliseconds << " ms on the workers"
+                  << std::endl;
+    }
+    for (auto& load : m_textures) {
+        LoadedTexture result = load.result.get();
+        *load.texture = result.texture;
+        command_lists.push_back(result.command_list);
+        std::cout << "Loaded " << load.path << " in " << std::fixed << std::setprecision(1) << result.milliseconds
+                  << " ms" << std::endl;
+    }
+
+    std::vector<uint64_t> fence_values;
+    for (auto& command_list : command_lists) {
+        m_device.ExecuteCommandLists({ command_list });
+        fence_values.push_back(command_list->GetFenceValue());
+    }
+    for (uint64_t fence_value : fence_values) {
+        m_device.Wait(fence_value);
+    }
+    std::cout << "Assets loaded on " << m_thread_pool.GetThreadCount() << " workers, " << std::fixed
+              << std::setprecision(1) << GetMilliseconds(start) << " ms spent waiting for them" << std::endl;
+
+    m_models.clear();
+    m_textures.clear();
+}
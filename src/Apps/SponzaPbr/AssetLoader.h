@@ -0,0 +1,153 @@
+#pragma once
+
+#include "AssetCache/TextureCompression.h"
+#include "SceneCache.h"
+#include "ThreadPool.h"
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A material texture file of a model as it was loaded.
+struct MaterialTextureFile {
+    // Path listed by the importer.
+    std::string path;
+    // File the texture was created from, the compressed version of path if the texture cache has one for its role.
+    // Otherwise path, which Model imported itself.
+    std::string file;
+    // Material slots the texture is assigned to as (mesh id, texture type), see GetMaterialSlot.
+    std::vector<std::pair<size_t, aiTextureType>> slots;
+};
+
+// What the loader knows about a scene model besides the Model itself.
+struct ModelLoadInfo {
+    // Scene cache key of the source, 0 if the source can't be read.
+    uint64_t source_key = 0;
+    // The streams of the scene cache were uploaded over the imported ones, they already have their final layout and
+    // the LODs are restored.
+    bool restored = false;
+    // Imported by Model itself since the bones and animations come from the importer, never cached.
+    bool skinned = false;
+    // Material textures the importer listed for every mesh, indexed by range id.
+    std::vector<std::vector<IMesh::Texture>> textures;
+    // Every texture file assigned to the materials, once per file and role.
+    std::vector<MaterialTextureFile> texture_files;
+    // Texel footprint of every mesh in uv units per model space unit, see ComputeUvDensity.
+    std::vector<float> uv_densities;
+};
+
+// Role of a texture of the given type in the texture cache, the same as the texture compressor picks for the map
+// statements of an OBJ material library. Nothing for types the passes don't sample.
+std::optional<TextureRole> GetMaterialTextureRole(aiTextureType type);
+
+// Material slot a texture listed by the importer goes to, nullptr for types the passes don't sample. The PBR
+// models keep roughness in the shininess map, only files named as gloss maps hold glossiness.
+template <typename Material>
+std::shared_ptr<Resource>* GetMaterialSlot(Material& material, aiTextureType type, const std::string& path)
+{
+    switch (type) {
+    case aiTextureType_DIFFUSE:
+        return &material.texture.albedo;
+    case aiTextureType_HEIGHT:
+    case aiTextureType_NORMALS:
+        return &material.texture.normal;
+    case aiTextureType_SHININESS:
+        if (path.find("gloss") != std::string::npos) {
+            return &material.texture.glossiness;
+        }
+        return &material.texture.roughness;
+    case aiTextureType_SPECULAR:
+        return &material.texture.metalness;
+    case aiTextureType_AMBIENT:
+    case aiTextureType_LIGHTMAP:
+        return &material.texture.occlusion;
+    case aiTextureType_OPACITY:
+        return &material.texture.opacity;
+    default:
+        return nullptr;
+    }
+}
+
+// Loads the scene assets on the workers of a thread pool. Models are imported by Model, which also decodes their
+// material textures, and a valid scene cache is restored over them. Every texture file of a model which has a
+// compressed version in the texture cache for its role is read on a worker of its own and assigned to the materials
+// by Finish, as are the environment textures.
+//
+// RenderDevice is not known to be safe to use from several threads. The workers parse, decode and import in
+// parallel, but creating device objects and recording uploads, which creates upload buffers, is serialized behind
+// a mutex of the loader. Every asset records its uploads on its own command list, the lists are submitted by the
+// caller's thread in request order and waited for with their fences. The caller must not use the device between
+// the first request and Finish.
+class AssetLoader {
+public:
+    AssetLoader(RenderDevice& device, ThreadPool& thread_pool);
+    ~AssetLoader();
+
+    // setup is called on the caller's thread by Finish, once the model is part of the scene list.
+    void LoadModel(const ModelSource& source, std::function<void(Model&)> setup = {});
+    // texture is set by Finish. The block compressed version of path is used if the texture compressor has put one
+    // into the texture cache for role.
+    void LoadTexture(const std::string& path, TextureRole role, std::shared_ptr<Resource>& texture);
+
+    // Appends the models to scene_list in request order, their restored LODs to lods and what is known about them
+    // to infos, executes the upload command lists and waits for them. The load time of every asset is written to
+    // stdout.
+    void Finish(SceneModels& scene_list, SceneLods& lods, std::vector<ModelLoadInfo>& infos);
+
+private:
+    struct LoadedTexture {
+        std::shared_ptr<Resource> texture;
+        std::shared_ptr<RenderCommandList> command_list;
+        // File the texture was created from.
+        std::string file;
+        // Time spent on the worker.
+        double milliseconds = 0;
+    };
+
+    struct MaterialTextureLoad {
+        // The file is set by Finish for the textures which are loaded.
+        MaterialTextureFile texture;
+        // Not valid if the texture imported by Model is kept.
+        std::future<LoadedTexture> result;
+    };
+
+    struct LoadedModel {
+        Model model;
+        ModelLods lods;
+        ModelLoadInfo info;
+        std::shared_ptr<RenderCommandList> command_list;
+        double milliseconds = 0;
+        // Queued by the worker of the model once its meshes are known.
+        std::vector<MaterialTextureLoad> textures;
+    };
+
+    struct ModelLoad {
+        std::string path;
+        std::function<void(Model&)> setup;
+        std::future<LoadedModel> model;
+    };
+
+    struct TextureLoad {
+        std::string path;
+        std::shared_ptr<Resource>* texture;
+        std::future<LoadedTexture> result;
+    };
+
+    // Queues the load of path. With a role, the compressed version for it is used if the texture cache has one.
+    // Called on the caller's thread and on the workers.
+    std::future<LoadedTexture> PushTexture(const std::string& path, std::optional<TextureRole> role);
+
+    RenderDevice& m_device;
+    ThreadPool& m_thread_pool;
+    std::mutex m_device_mutex;
+    std::vector<ModelLoad> m_models;
+    std::vector<TextureLoad> m_textures;
+};
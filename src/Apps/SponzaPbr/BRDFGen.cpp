@@ -1,5 +1,8 @@
 #include "BRDFGen.h"
 
+#include "GpuProfiler.h"
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -8,7 +11,8 @@ BRDFGen::BRDFGen(RenderDevice& device, const Input& input)
     , m_input(input)
     , m_program(device)
 {
-    output.brdf = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
+    output.brdf = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kCopySource |
+                                             BindFlag::kCopyDest,
                                          gli::format::FORMAT_RG32_SFLOAT_PACK32, 1, m_size, m_size, 1);
     m_dsv =
         m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_size, m_size, 1);
@@ -19,9 +23,10 @@ void BRDFGen::OnUpdate() {}
 void BRDFGen::OnRender(RenderCommandList& command_list)
 {
     if (!is) {
-        command_list.BeginEvent("DrawBRDF");
-        DrawBRDF(command_list);
-        command_list.EndEvent();
+        {
+            ScopedEvent event(command_list, "DrawBRDF");
+            DrawBRDF(command_list);
+        }
 
         is = true;
     }
@@ -53,7 +58,7 @@ void BRDFGen::DrawBRDF(RenderCommandList& command_list)
 
 void BRDFGen::OnResize(int width, int height) {}
 
-void BRDFGen::OnModifySponzaSettings(const SponzaSettings& settings)
+void BRDFGen::OnSetupRenderGraph(RenderGraphBuilder& builder)
 {
-    m_settings = settings;
+    builder.Write(output.brdf);
 }
@@ -19,15 +19,20 @@ public:
 
     BRDFGen(RenderDevice& device, const Input& input);
 
+    // The output was restored from the IBL cache, it is drawn again only if a setting requires it.
+    void MarkBaked()
+    {
+        is = true;
+    }
+
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
     void DrawBRDF(RenderCommandList& command_list);
 
-    SponzaSettings m_settings;
     RenderDevice& m_device;
     Input m_input;
     std::shared_ptr<Resource> m_dsv;
@@ -1,5 +1,7 @@
 #include "BackgroundPass.h"
 
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -8,7 +10,13 @@ BackgroundPass::BackgroundPass(RenderDevice& device, const Input& input, int wid
     , m_input(input)
     , m_width(width)
     , m_height(height)
-    , m_program(device)
+    , m_program(device,
+                input.thread_pool,
+                "BackgroundPass",
+                GetSampleCounts(),
+                m_settings.sample_count,
+                "SAMPLE_COUNT",
+                [](auto& program) -> auto& { return program.ps; })
 {
     m_sampler = m_device.CreateSampler({
         SamplerFilter::kAnisotropic,
@@ -19,38 +27,46 @@ BackgroundPass::BackgroundPass(RenderDevice& device, const Input& input, int wid
 
 void BackgroundPass::OnUpdate()
 {
-    m_program.vs.cbuffer.ConstantBuf.projection = glm::transpose(m_input.camera.GetProjectionMatrix());
-    m_program.vs.cbuffer.ConstantBuf.view = glm::transpose(m_input.camera.GetViewMatrix());
-    m_program.vs.cbuffer.ConstantBuf.face = 0;
+    auto& program = m_program.Get();
+
+    program.vs.cbuffer.ConstantBuf.projection = glm::transpose(m_input.camera.GetProjectionMatrix());
+    program.vs.cbuffer.ConstantBuf.view = glm::transpose(m_input.camera.GetViewMatrix());
+    program.vs.cbuffer.ConstantBuf.face = 0;
 }
 
 void BackgroundPass::OnRender(RenderCommandList& command_list)
 {
+    auto& program = m_program.Get();
+
     command_list.SetViewport(0, 0, m_width, m_height);
 
-    command_list.UseProgram(m_program);
-    command_list.Attach(m_program.vs.cbv.ConstantBuf, m_program.vs.cbuffer.ConstantBuf);
+    command_list.UseProgram(program);
+    command_list.Attach(program.vs.cbv.ConstantBuf, program.vs.cbuffer.ConstantBuf);
 
-    command_list.SetDepthStencilState({ true, ComparisonFunc::kLessEqual });
+    // The depth buffer is multisampled while the lit image is not, so coverage is resolved in the shader and the
+    // environment is added on top of the lit image.
+    command_list.SetDepthStencilState({ false, ComparisonFunc::kLessEqual });
+    command_list.SetBlendState({ true, Blend::kSrcAlpha, Blend::kOne, BlendOp::kAdd, Blend::kZero, Blend::kOne,
+                                 BlendOp::kAdd });
 
-    command_list.Attach(m_program.ps.sampler.g_sampler, m_sampler);
+    command_list.Attach(program.ps.sampler.g_sampler, m_sampler);
 
     RenderPassBeginDesc render_pass_desc = {};
-    render_pass_desc.colors[m_program.ps.om.rtv0].texture = m_input.rtv;
-    render_pass_desc.colors[m_program.ps.om.rtv0].load_op = RenderPassLoadOp::kLoad;
-    render_pass_desc.depth_stencil.texture = m_input.dsv;
-    render_pass_desc.depth_stencil.depth_load_op = RenderPassLoadOp::kLoad;
+    render_pass_desc.colors[program.ps.om.rtv0].texture = m_input.rtv;
+    render_pass_desc.colors[program.ps.om.rtv0].load_op = RenderPassLoadOp::kLoad;
 
     m_input.model.ia.indices.Bind(command_list);
-    m_input.model.ia.positions.BindToSlot(command_list, m_program.vs.ia.POSITION);
+    m_input.model.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
 
-    command_list.Attach(m_program.ps.srv.environmentMap, m_input.environment);
+    command_list.Attach(program.ps.srv.environmentMap, m_input.environment);
+    command_list.Attach(program.ps.srv.gDepth, m_input.dsv);
 
     command_list.BeginRenderPass(render_pass_desc);
     for (auto& range : m_input.model.ia.ranges) {
         command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location, 0);
     }
     command_list.EndRenderPass();
+    command_list.SetBlendState({});
 }
 
 void BackgroundPass::OnResize(int width, int height)
@@ -59,7 +75,33 @@ void BackgroundPass::OnResize(int width, int height)
     m_height = height;
 }
 
-void BackgroundPass::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask BackgroundPass::GetSponzaSettingsSubscription() const
+{
+    return { SponzaSetting::sample_count };
+}
+
+void BackgroundPass::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
     m_settings = settings;
+    if (changes.Test(SponzaSetting::sample_count)) {
+        m_program.Select(m_settings.sample_count);
+    }
+}
+
+bool BackgroundPass::HasPrograms(const SponzaSettingsValues& settings) const
+{
+    return m_program.IsBuilt(settings.sample_count);
+}
+
+bool BackgroundPass::BuildProgram(const SponzaSettingsValues& settings, bool wait)
+{
+    return m_program.Build(settings.sample_count, wait);
+}
+
+void BackgroundPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.Read(m_input.environment);
+    builder.Read(m_input.rtv);
+    builder.Read(m_input.dsv);
+    builder.Write(m_input.rtv);
 }
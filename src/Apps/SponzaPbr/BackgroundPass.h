@@ -3,7 +3,8 @@
 #include "Device/Device.h"
 #include "Geometry/Geometry.h"
 #include "GeometryPass.h"
-#include "ProgramRef/Background_PS.h"
+#include "ProgramPermutations.h"
+#include "ProgramRef/BackgroundCoverage_PS.h"
 #include "ProgramRef/Background_VS.h"
 #include "SponzaSettings.h"
 
@@ -15,6 +16,7 @@ public:
         std::shared_ptr<Resource>& environment;
         std::shared_ptr<Resource>& rtv;
         std::shared_ptr<Resource>& dsv;
+        ThreadPool& thread_pool;
     };
 
     struct Output {
@@ -27,14 +29,19 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual bool HasPrograms(const SponzaSettingsValues& settings) const override;
+    virtual bool BuildProgram(const SponzaSettingsValues& settings, bool wait) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     int m_width;
     int m_height;
     std::shared_ptr<Resource> m_sampler;
-    ProgramHolder<Background_VS, Background_PS> m_program;
+    ProgramPermutations<ProgramHolder<Background_VS, BackgroundCoverage_PS>> m_program;
 };
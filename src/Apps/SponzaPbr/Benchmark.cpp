@@ -0,0 +1,206 @@
+#include "Benchmark.h"
+
+#include "Culling.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+bool CameraPath::Load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    m_keyframes.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+        CameraKeyframe keyframe = {};
+        if (stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >>
+            keyframe.yaw >> keyframe.pitch >> keyframe.sun_angle) {
+            m_keyframes.push_back(keyframe);
+        }
+    }
+    return !m_keyframes.empty();
+}
+
+CameraKeyframe CameraPath::Sample(float time) const
+{
+    if (time <= m_keyframes.front().time) {
+        return m_keyframes.front();
+    }
+    if (time >= m_keyframes.back().time) {
+        return m_keyframes.back();
+    }
+
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+                               [](float time, const CameraKeyframe& keyframe) { return time < keyframe.time; });
+    size_t i = std::distance(m_keyframes.begin(), it) - 1;
+    const CameraKeyframe& p0 = m_keyframes[i == 0 ? i : i - 1];
+    const CameraKeyframe& p1 = m_keyframes[i];
+    const CameraKeyframe& p2 = m_keyframes[i + 1];
+    const CameraKeyframe& p3 = m_keyframes[std::min(i + 2, m_keyframes.size() - 1)];
+    float t = (time - p1.time) / (p2.time - p1.time);
+
+    float t2 = t * t;
+    float t3 = t2 * t;
+    CameraKeyframe res = {};
+    res.time = time;
+    res.position = 0.5f * ((2.0f * p1.position) + (-p0.position + p2.position) * t +
+                           (2.0f * p0.position - 5.0f * p1.position + 4.0f * p2.position - p3.position) * t2 +
+                           (-p0.position + 3.0f * p1.position - 3.0f * p2.position + p3.position) * t3);
+    res.yaw = glm::mix(p1.yaw, p2.yaw, t);
+    res.pitch = glm::mix(p1.pitch, p2.pitch, t);
+    res.sun_angle = glm::mix(p1.sun_angle, p2.sun_angle, t);
+    return res;
+}
+
+float CameraPath::GetDuration() const
+{
+    return m_keyframes.back().time;
+}
+
+void BenchmarkReport::AddFrame(uint32_t frame, float time, const FrameTiming& timing)
+{
+    m_frames.push_back({ frame, time, timing });
+}
+
+void BenchmarkReport::SetGpuTimes(const std::map<uint64_t, double>& gpu_ms)
+{
+    for (auto& frame : m_frames) {
+        auto it = gpu_ms.find(frame.timing.frame_index);
+        if (it != gpu_ms.end()) {
+            frame.timing.gpu_ms = it->second;
+        }
+    }
+}
+
+TimingSummary BenchmarkReport::Summarize(std::vector<double> values)
+{
+    TimingSummary summary;
+    if (values.empty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) { return values[static_cast<size_t>(p * (values.size() - 1))]; };
+    for (double value : values) {
+        summary.avg += value;
+    }
+    summary.avg /= values.size();
+    summary.p50 = percentile(0.5);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = values.back();
+    return summary;
+}
+
+TimingSummary BenchmarkReport::GetCpuSummary() const
+{
+    std::vector<double> values;
+    for (const auto& frame : m_frames) {
+        values.push_back(frame.timing.cpu_ms);
+    }
+    return Summarize(values);
+}
+
+TimingSummary BenchmarkReport::GetGpuSummary() const
+{
+    std::vector<double> values;
+    for (const auto& frame : m_frames) {
+        values.push_back(frame.timing.gpu_ms);
+    }
+    return Summarize(values);
+}
+
+bool BenchmarkReport::Save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::fixed << std::setprecision(4);
+
+    if (path.size() < 5 || path.substr(path.size() - 5) != ".json") {
+        file << "frame,time,cpu_ms,gpu_ms" << std::endl;
+        for (const auto& frame : m_frames) {
+            file << frame.frame << "," << frame.time << "," << frame.timing.cpu_ms << "," << frame.timing.gpu_ms
+                 << std::endl;
+        }
+        return file.good();
+    }
+
+    auto write_summary = [&](const std::string& name, const TimingSummary& summary) {
+        file << "    \"" << name << "\": { ";
+        file << "\"avg\": " << summary.avg << ", ";
+        file << "\"p50\": " << summary.p50 << ", ";
+        file << "\"p95\": " << summary.p95 << ", ";
+        file << "\"p99\": " << summary.p99 << ", ";
+        file << "\"max\": " << summary.max << " }";
+    };
+
+    file << "{" << std::endl;
+    file << "  \"frame_count\": " << m_frames.size() << "," << std::endl;
+    file << "  \"summary\": {" << std::endl;
+    write_summary("cpu_ms", GetCpuSummary());
+    file << "," << std::endl;
+    write_summary("gpu_ms", GetGpuSummary());
+    file << std::endl << "  }," << std::endl;
+    file << "  \"frames\": [" << std::endl;
+    for (size_t i = 0; i < m_frames.size(); ++i) {
+        const auto& frame = m_frames[i];
+        file << "    { \"frame\": " << frame.frame << ", \"time\": " << frame.time
+             << ", \"cpu_ms\": " << frame.timing.cpu_ms << ", \"gpu_ms\": " << frame.timing.gpu_ms << " }"
+             << (i + 1 < m_frames.size() ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl;
+    file << "}" << std::endl;
+    return file.good();
+}
+
+void RunCullingBenchmark(size_t box_count, uint32_t iterations)
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+    AABBList boxes;
+    boxes.Reserve(box_count);
+    for (size_t i = 0; i < box_count; ++i) {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        glm::vec3 size(extent(rng), extent(rng), extent(rng));
+        boxes.Add({ center - size, center + size });
+    }
+    glm::mat4 view_projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f) *
+                                glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = ExtractFrustum(view_projection);
+
+    std::pair<CullingKernel, const char*> kernels[] = {
+        { CullingKernel::kScalar, "scalar" },
+        { CullingKernel::kSse, "sse" },
+        { CullingKernel::kAvx, "avx" },
+    };
+    std::vector<uint8_t> visible;
+    for (const auto& kernel : kernels) {
+        if (!IsCullingKernelSupported(kernel.first)) {
+            std::cout << kernel.second << ": not compiled in" << std::endl;
+            continue;
+        }
+        CullAABBs(frustum, boxes, visible, kernel.first);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            CullAABBs(frustum, boxes, visible, kernel.first);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        size_t visible_count = std::count(visible.begin(), visible.end(), 1);
+        std::cout << kernel.second << ": " << std::fixed << std::setprecision(3)
+                  << ns / (static_cast<double>(box_count) * iterations) << " ns per box, " << visible_count << "/"
+                  << box_count << " visible" << std::endl;
+    }
+}
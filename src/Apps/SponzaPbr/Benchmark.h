@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct CameraKeyframe {
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float sun_angle;
+};
+
+// Text file with one "time x y z yaw pitch sun_angle" keyframe per line, '#' starts a comment.
+// Keyframes must be sorted by time. Positions use a Catmull-Rom spline, angles are interpolated linearly.
+class CameraPath {
+public:
+    bool Load(const std::string& path);
+    CameraKeyframe Sample(float time) const;
+    float GetDuration() const;
+
+private:
+    std::vector<CameraKeyframe> m_keyframes;
+};
+
+struct FrameTiming {
+    // Index of the rendered frame, the GPU time is resolved by it once the frame has completed.
+    uint64_t frame_index = 0;
+    double cpu_ms = 0;
+    double gpu_ms = 0;
+};
+
+struct TimingSummary {
+    double avg = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+class BenchmarkReport {
+public:
+    void AddFrame(uint32_t frame, float time, const FrameTiming& timing);
+    // Fills the GPU times of the added frames from GpuProfiler::TakeFrameTimes.
+    void SetGpuTimes(const std::map<uint64_t, double>& gpu_ms);
+    TimingSummary GetCpuSummary() const;
+    TimingSummary GetGpuSummary() const;
+    // The extension selects the output, .json gets a summary plus all frames, anything else is written as csv.
+    bool Save(const std::string& path) const;
+
+private:
+    static TimingSummary Summarize(std::vector<double> values);
+
+    struct Frame {
+        uint32_t frame;
+        float time;
+        FrameTiming timing;
+    };
+
+    std::vector<Frame> m_frames;
+};
+
+// Times every supported culling kernel on box_count random boxes and prints the cost per box.
+void RunCullingBenchmark(size_t box_count, uint32_t iterations);
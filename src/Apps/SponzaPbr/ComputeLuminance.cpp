@@ -1,5 +1,7 @@
 #include "ComputeLuminance.h"
 
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -50,14 +52,14 @@ void ComputeLuminance::GetLum1DPass_CS(RenderCommandList& command_list,
 
 void ComputeLuminance::Draw(RenderCommandList& command_list, size_t buf_id)
 {
-    m_HDRApply.ps.cbuffer.HDRSetting.gamma_correction = m_settings.Get<bool>("gamma_correction");
-    m_HDRApply.ps.cbuffer.HDRSetting.use_reinhard_tone_operator = m_settings.Get<bool>("use_reinhard_tone_operator");
-    m_HDRApply.ps.cbuffer.HDRSetting.use_tone_mapping = m_settings.Get<bool>("use_tone_mapping");
-    m_HDRApply.ps.cbuffer.HDRSetting.use_white_balance = m_settings.Get<bool>("use_white_balance");
-    m_HDRApply.ps.cbuffer.HDRSetting.use_filmic_hdr = m_settings.Get<bool>("use_filmic_hdr");
-    m_HDRApply.ps.cbuffer.HDRSetting.use_avg_lum = m_settings.Get<bool>("use_avg_lum") && !m_use_res.empty();
-    m_HDRApply.ps.cbuffer.HDRSetting.exposure = m_settings.Get<float>("exposure");
-    m_HDRApply.ps.cbuffer.HDRSetting.white = m_settings.Get<float>("white");
+    m_HDRApply.ps.cbuffer.HDRSetting.gamma_correction = m_settings.gamma_correction;
+    m_HDRApply.ps.cbuffer.HDRSetting.use_reinhard_tone_operator = m_settings.use_reinhard_tone_operator;
+    m_HDRApply.ps.cbuffer.HDRSetting.use_tone_mapping = m_settings.use_tone_mapping;
+    m_HDRApply.ps.cbuffer.HDRSetting.use_white_balance = m_settings.use_white_balance;
+    m_HDRApply.ps.cbuffer.HDRSetting.use_filmic_hdr = m_settings.use_filmic_hdr;
+    m_HDRApply.ps.cbuffer.HDRSetting.use_avg_lum = m_settings.use_avg_lum && !m_use_res.empty();
+    m_HDRApply.ps.cbuffer.HDRSetting.exposure = m_settings.exposure;
+    m_HDRApply.ps.cbuffer.HDRSetting.white = m_settings.white;
 
     command_list.UseProgram(m_HDRApply);
     command_list.Attach(m_HDRApply.ps.cbv.HDRSetting, m_HDRApply.ps.cbuffer.HDRSetting);
@@ -86,7 +88,7 @@ void ComputeLuminance::OnRender(RenderCommandList& command_list)
 {
     command_list.SetViewport(0, 0, m_width, m_height);
     size_t buf_id = 0;
-    if (m_settings.Get<bool>("use_tone_mapping")) {
+    if (m_settings.use_tone_mapping) {
         GetLum2DPass_CS(command_list, buf_id, m_thread_group_x, m_thread_group_y);
         for (int block_size = m_thread_group_x * m_thread_group_y; block_size > 1;) {
             uint32_t next_block_size = (block_size + 127) / 128;
@@ -125,7 +127,23 @@ void ComputeLuminance::CreateBuffers()
     }
 }
 
-void ComputeLuminance::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask ComputeLuminance::GetSponzaSettingsSubscription() const
+{
+    return {
+        SponzaSetting::gamma_correction, SponzaSetting::use_reinhard_tone_operator, SponzaSetting::use_tone_mapping,
+        SponzaSetting::use_white_balance, SponzaSetting::use_filmic_hdr, SponzaSetting::use_avg_lum,
+        SponzaSetting::exposure, SponzaSetting::white
+    };
+}
+
+void ComputeLuminance::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
     m_settings = settings;
 }
+
+void ComputeLuminance::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.Read(m_input.hdr_res);
+    builder.Write(m_input.rtv);
+    builder.Write(m_input.dsv);
+}
@@ -26,7 +26,10 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
     void GetLum2DPass_CS(RenderCommandList& command_list,
@@ -43,7 +46,7 @@ private:
 
     void Draw(RenderCommandList& command_list, size_t buf_id);
 
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     int m_width;
@@ -0,0 +1,207 @@
+#include "Culling.h"
+
+#if defined(__AVX__)
+#define CULLING_AVX 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE 1
+#endif
+
+#if defined(CULLING_AVX) || defined(CULLING_SSE)
+#include <immintrin.h>
+#endif
+
+AABB TransformAABB(const AABB& box, const glm::mat4& matrix)
+{
+    glm::vec3 center = glm::vec3(matrix * glm::vec4((box.min + box.max) * 0.5f, 1.0f));
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    glm::vec3 new_extent = glm::abs(glm::vec3(matrix[0])) * extent.x + glm::abs(glm::vec3(matrix[1])) * extent.y +
+                           glm::abs(glm::vec3(matrix[2])) * extent.z;
+    return { center - new_extent, center + new_extent };
+}
+
+Frustum ExtractFrustum(const glm::mat4& view_projection)
+{
+    auto row = [&](int i) {
+        return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(3) + row(2);
+    frustum.planes[5] = row(3) - row(2);
+    return frustum;
+}
+
+void AABBList::Clear()
+{
+    for (auto* values : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z }) {
+        values->clear();
+    }
+}
+
+void AABBList::Reserve(size_t count)
+{
+    for (auto* values : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z }) {
+        values->reserve(count);
+    }
+}
+
+void AABBList::Add(const AABB& box)
+{
+    min_x.push_back(box.min.x);
+    min_y.push_back(box.min.y);
+    min_z.push_back(box.min.z);
+    max_x.push_back(box.max.x);
+    max_y.push_back(box.max.y);
+    max_z.push_back(box.max.z);
+}
+
+size_t AABBList::Size() const
+{
+    return min_x.size();
+}
+
+namespace {
+
+// The corner of a box farthest along the plane normal is chosen by the sign of each normal component. The sign is
+// the same for every box, so it is resolved once per plane by picking the min or max array.
+struct PlaneTest {
+    const float* x;
+    const float* y;
+    const float* z;
+    glm::vec4 plane;
+};
+
+std::array<PlaneTest, 6> GetPlaneTests(const Frustum& frustum, const AABBList& boxes)
+{
+    std::array<PlaneTest, 6> tests;
+    for (size_t i = 0; i < tests.size(); ++i) {
+        const glm::vec4& plane = frustum.planes[i];
+        tests[i].x = plane.x >= 0 ? boxes.max_x.data() : boxes.min_x.data();
+        tests[i].y = plane.y >= 0 ? boxes.max_y.data() : boxes.min_y.data();
+        tests[i].z = plane.z >= 0 ? boxes.max_z.data() : boxes.min_z.data();
+        tests[i].plane = plane;
+    }
+    return tests;
+}
+
+void CullScalar(const std::array<PlaneTest, 6>& tests, size_t first, size_t last, uint8_t* visible)
+{
+    for (size_t i = first; i < last; ++i) {
+        bool inside = true;
+        for (const auto& test : tests) {
+            const glm::vec4& plane = test.plane;
+            if (plane.w + plane.x * test.x[i] + plane.y * test.y[i] + plane.z * test.z[i] < 0) {
+                inside = false;
+                break;
+            }
+        }
+        visible[i] = inside;
+    }
+}
+
+#if defined(CULLING_SSE)
+size_t CullSse(const std::array<PlaneTest, 6>& tests, size_t count, uint8_t* visible)
+{
+    size_t simd_count = count & ~size_t(3);
+    for (size_t i = 0; i < simd_count; i += 4) {
+        __m128 outside = _mm_setzero_ps();
+        for (const auto& test : tests) {
+            const glm::vec4& plane = test.plane;
+            __m128 distance = _mm_set1_ps(plane.w);
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.x), _mm_loadu_ps(test.x + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), _mm_loadu_ps(test.y + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), _mm_loadu_ps(test.z + i)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (size_t j = 0; j < 4; ++j) {
+            visible[i + j] = !(mask & (1 << j));
+        }
+    }
+    return simd_count;
+}
+#endif
+
+#if defined(CULLING_AVX)
+size_t CullAvx(const std::array<PlaneTest, 6>& tests, size_t count, uint8_t* visible)
+{
+    size_t simd_count = count & ~size_t(7);
+    for (size_t i = 0; i < simd_count; i += 8) {
+        __m256 outside = _mm256_setzero_ps();
+        for (const auto& test : tests) {
+            const glm::vec4& plane = test.plane;
+            __m256 distance = _mm256_set1_ps(plane.w);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(test.x + i)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(test.y + i)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(test.z + i)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        int mask = _mm256_movemask_ps(outside);
+        for (size_t j = 0; j < 8; ++j) {
+            visible[i + j] = !(mask & (1 << j));
+        }
+    }
+    return simd_count;
+}
+#endif
+
+} // namespace
+
+bool IsCullingKernelSupported(CullingKernel kernel)
+{
+    switch (kernel) {
+    case CullingKernel::kScalar:
+    case CullingKernel::kBest:
+        return true;
+#if defined(CULLING_SSE)
+    case CullingKernel::kSse:
+        return true;
+#endif
+#if defined(CULLING_AVX)
+    case CullingKernel::kAvx:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+void CullAABBs(const Frustum& frustum, const AABBList& boxes, std::vector<uint8_t>& visible, CullingKernel kernel)
+{
+    size_t count = boxes.Size();
+    visible.resize(count);
+    if (!count) {
+        return;
+    }
+    if (kernel == CullingKernel::kBest || !IsCullingKernelSupported(kernel)) {
+#if defined(CULLING_AVX)
+        kernel = CullingKernel::kAvx;
+#elif defined(CULLING_SSE)
+        kernel = CullingKernel::kSse;
+#else
+        kernel = CullingKernel::kScalar;
+#endif
+    }
+
+    std::array<PlaneTest, 6> tests = GetPlaneTests(frustum, boxes);
+    size_t done = 0;
+    switch (kernel) {
+#if defined(CULLING_AVX)
+    case CullingKernel::kAvx:
+        done = CullAvx(tests, count, visible.data());
+        break;
+#endif
+#if defined(CULLING_SSE)
+    case CullingKernel::kSse:
+        done = CullSse(tests, count, visible.data());
+        break;
+#endif
+    default:
+        break;
+    }
+    CullScalar(tests, done, count, visible.data());
+}
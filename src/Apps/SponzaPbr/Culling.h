@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Bounds of the transformed box, exact for affine matrices.
+AABB TransformAABB(const AABB& box, const glm::mat4& matrix);
+
+// Planes point inside, a point p is inside when dot(plane.xyz, p) + plane.w >= 0. Planes are not normalized.
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+};
+
+// Gribb-Hartmann extraction. The near plane uses the [-1, 1] depth range which also contains [0, 1], so the
+// result is conservative for either convention.
+Frustum ExtractFrustum(const glm::mat4& view_projection);
+
+// Structure of arrays so that the culling kernels can test several boxes per instruction.
+class AABBList {
+public:
+    void Clear();
+    void Reserve(size_t count);
+    void Add(const AABB& box);
+    size_t Size() const;
+
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> min_z;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+    std::vector<float> max_z;
+};
+
+enum class CullingKernel {
+    kScalar,
+    kSse,
+    kAvx,
+    // The widest kernel the binary was compiled with.
+    kBest,
+};
+
+bool IsCullingKernelSupported(CullingKernel kernel);
+
+// Writes 1 to visible[i] when box i intersects the frustum, 0 otherwise. Unsupported kernels fall back to kBest.
+// A box touching a plane counts as intersecting. An inverted box (min > max) is visible only when the box spanned by
+// its corners lies entirely inside the frustum, so empty bounds (min = FLT_MAX, max = -FLT_MAX) are always culled.
+void CullAABBs(const Frustum& frustum,
+               const AABBList& boxes,
+               std::vector<uint8_t>& visible,
+               CullingKernel kernel = CullingKernel::kBest);
@@ -1,5 +1,8 @@
 #include "Equirectangular2Cubemap.h"
 
+#include "GpuProfiler.h"
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -26,10 +29,11 @@ void Equirectangular2Cubemap::OnUpdate()
 
 void Equirectangular2Cubemap::OnRender(RenderCommandList& command_list)
 {
-    if (!is || m_settings.Get<bool>("irradiance_conversion_every_frame")) {
-        command_list.BeginEvent("DrawEquirectangular2Cubemap");
-        DrawEquirectangular2Cubemap(command_list);
-        command_list.EndEvent();
+    if (!is || m_settings.irradiance_conversion_every_frame) {
+        {
+            ScopedEvent event(command_list, "DrawEquirectangular2Cubemap");
+            DrawEquirectangular2Cubemap(command_list);
+        }
 
         is = true;
     }
@@ -103,13 +107,26 @@ void Equirectangular2Cubemap::CreateSizeDependentResources()
     }
 
     output.environment = m_device.CreateTexture(
-        BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kUnorderedAccess,
+        BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kUnorderedAccess | BindFlag::kCopySource |
+            BindFlag::kCopyDest,
         gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_texture_size, m_texture_size, 6, m_texture_mips);
     m_dsv = m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_texture_size,
                                    m_texture_size, 6);
 }
 
-void Equirectangular2Cubemap::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask Equirectangular2Cubemap::GetSponzaSettingsSubscription() const
+{
+    return { SponzaSetting::irradiance_conversion_every_frame };
+}
+
+void Equirectangular2Cubemap::OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                                     const SponzaSettingsMask& changes)
 {
     m_settings = settings;
 }
+
+void Equirectangular2Cubemap::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.Read(m_input.hdr);
+    builder.Write(output.environment);
+}
@@ -23,15 +23,24 @@ public:
 
     Equirectangular2Cubemap(RenderDevice& device, const Input& input);
 
+    // The output was restored from the IBL cache, it is drawn again only if a setting requires it.
+    void MarkBaked()
+    {
+        is = true;
+    }
+
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
     void DrawEquirectangular2Cubemap(RenderCommandList& command_list);
     void CreateSizeDependentResources();
 
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     std::shared_ptr<Resource> m_sampler;
@@ -0,0 +1,209 @@
+#include "FrameCapture.h"
+
+#include "Utilities/FormatHelper.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+
+std::vector<uint8_t> ReadbackTexture(RenderDevice& device,
+                                     const std::shared_ptr<Resource>& texture,
+                                     gli::format format,
+                                     uint32_t width,
+                                     uint32_t height)
+{
+    size_t num_bytes = 0;
+    size_t row_bytes = 0;
+    GetFormatInfo(width, height, format, num_bytes, row_bytes);
+    // D3D12 requires 256 byte aligned rows for texture to buffer copies.
+    uint32_t row_pitch = static_cast<uint32_t>((row_bytes + 255) & ~255ull);
+
+    std::shared_ptr<Resource> buffer =
+        device.CreateBuffer(BindFlag::kCopyDest, row_pitch * height, MemoryType::kReadback);
+    std::shared_ptr<RenderCommandList> command_list = device.CreateRenderCommandList();
+    BufferToTextureCopyRegion region = {};
+    region.buffer_row_pitch = row_pitch;
+    region.texture_extent = { width, height, 1 };
+    command_list->CopyTextureToBuffer(texture, buffer, { region });
+    command_list->Close();
+    device.ExecuteCommandLists({ command_list });
+    device.WaitForIdle();
+
+    std::vector<uint8_t> data(row_bytes * height);
+    uint8_t* mapped = buffer->Map();
+    for (uint32_t y = 0; y < height; ++y) {
+        std::memcpy(data.data() + y * row_bytes, mapped + y * row_pitch, row_bytes);
+    }
+    buffer->Unmap();
+    return data;
+}
+
+namespace {
+
+template <typename T>
+void WriteLE(std::vector<uint8_t>& out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void WriteBE(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (24 - 8 * i)));
+    }
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table = {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void WritePngChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+{
+    WriteBE(out, static_cast<uint32_t>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    WriteBE(out, Crc32(out.data() + start, out.size() - start));
+}
+
+bool WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return file.good();
+}
+
+} // namespace
+
+bool SavePng(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> raw;
+    size_t row_bytes = width * 4;
+    for (uint32_t y = 0; y < height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), data.begin() + y * row_bytes, data.begin() + (y + 1) * row_bytes);
+    }
+
+    // zlib stream made of stored deflate blocks, the dumps are for inspection and diffing so size doesn't matter.
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < raw.size() || offset == 0;) {
+        uint16_t size = static_cast<uint16_t>(std::min<size_t>(raw.size() - offset, 0xFFFF));
+        zlib.push_back(offset + size == raw.size() ? 1 : 0);
+        WriteLE<uint16_t>(zlib, size);
+        WriteLE<uint16_t>(zlib, ~size);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        offset += size;
+        if (size == 0) {
+            break;
+        }
+    }
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t x : raw) {
+        a = (a + x) % 65521;
+        b = (b + a) % 65521;
+    }
+    WriteBE(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    WriteBE(header, width);
+    WriteBE(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+    std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    WritePngChunk(out, "IHDR", header);
+    WritePngChunk(out, "IDAT", zlib);
+    WritePngChunk(out, "IEND", {});
+    return WriteFile(path, out);
+}
+
+bool SaveExr(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& data)
+{
+    auto write_attribute = [](std::vector<uint8_t>& out, const std::string& name, const std::string& type,
+                              const std::vector<uint8_t>& value) {
+        out.insert(out.end(), name.begin(), name.end());
+        out.push_back(0);
+        out.insert(out.end(), type.begin(), type.end());
+        out.push_back(0);
+        WriteLE<uint32_t>(out, static_cast<uint32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    };
+    auto write_float = [](std::vector<uint8_t>& out, float value) {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        WriteLE<uint32_t>(out, bits);
+    };
+
+    // Channels must be sorted by name, each one maps to a component of the RGBA source pixels.
+    const std::pair<char, size_t> channels[] = { { 'A', 3 }, { 'B', 2 }, { 'G', 1 }, { 'R', 0 } };
+
+    std::vector<uint8_t> out = { 0x76, 0x2F, 0x31, 0x01 };
+    WriteLE<uint32_t>(out, 2);
+
+    std::vector<uint8_t> value;
+    for (const auto& channel : channels) {
+        value.insert(value.end(), { static_cast<uint8_t>(channel.first), 0 });
+        WriteLE<uint32_t>(value, 2);
+        value.insert(value.end(), { 0, 0, 0, 0 });
+        WriteLE<uint32_t>(value, 1);
+        WriteLE<uint32_t>(value, 1);
+    }
+    value.push_back(0);
+    write_attribute(out, "channels", "chlist", value);
+    write_attribute(out, "compression", "compression", { 0 });
+    value.clear();
+    WriteLE<uint32_t>(value, 0);
+    WriteLE<uint32_t>(value, 0);
+    WriteLE<uint32_t>(value, width - 1);
+    WriteLE<uint32_t>(value, height - 1);
+    write_attribute(out, "dataWindow", "box2i", value);
+    write_attribute(out, "displayWindow", "box2i", value);
+    write_attribute(out, "lineOrder", "lineOrder", { 0 });
+    value.clear();
+    write_float(value, 1.0f);
+    write_attribute(out, "pixelAspectRatio", "float", value);
+    write_attribute(out, "screenWindowWidth", "float", value);
+    value.clear();
+    write_float(value, 0.0f);
+    write_float(value, 0.0f);
+    write_attribute(out, "screenWindowCenter", "v2f", value);
+    out.push_back(0);
+
+    uint32_t line_size = width * 4 * sizeof(float);
+    uint64_t offset = out.size() + height * sizeof(uint64_t);
+    for (uint32_t y = 0; y < height; ++y) {
+        WriteLE<uint64_t>(out, offset);
+        offset += 2 * sizeof(uint32_t) + line_size;
+    }
+
+    const float* pixels = reinterpret_cast<const float*>(data.data());
+    for (uint32_t y = 0; y < height; ++y) {
+        WriteLE<uint32_t>(out, y);
+        WriteLE<uint32_t>(out, line_size);
+        for (const auto& channel : channels) {
+            for (uint32_t x = 0; x < width; ++x) {
+                write_float(out, pixels[(y * width + x) * 4 + channel.second]);
+            }
+        }
+    }
+    return WriteFile(path, out);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "RenderDevice/RenderDevice.h"
+
+#include <gli/format.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Copies a single-sampled 2D texture to the CPU and waits for the copy, rows are returned tightly packed.
+std::vector<uint8_t> ReadbackTexture(RenderDevice& device,
+                                     const std::shared_ptr<Resource>& texture,
+                                     gli::format format,
+                                     uint32_t width,
+                                     uint32_t height);
+
+// Writes FORMAT_RGBA8_UNORM_PACK8 pixels as an uncompressed png.
+bool SavePng(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& data);
+
+// Writes FORMAT_RGBA32_SFLOAT_PACK32 pixels as an uncompressed scanline exr.
+bool SaveExr(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& data);
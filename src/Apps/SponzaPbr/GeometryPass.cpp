@@ -1,13 +1,61 @@
 #include "GeometryPass.h"
 
+#include "RenderGraph.h"
+#include "TextureData.h"
+
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+namespace {
+
+// Layout of D3D12_DRAW_INDEXED_ARGUMENTS and VkDrawIndexedIndirectCommand.
+struct IndirectDrawArgs {
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t start_index_location;
+    int32_t base_vertex_location;
+    uint32_t start_instance_location;
+};
+
+// Must match GeometryPassIndirect_PS.hlsl.
+constexpr uint32_t kHasNormalMap = 1 << 0;
+constexpr uint32_t kUseGlossInsteadOfRoughness = 1 << 1;
+constexpr uint32_t kPackedNormal = 1 << 2;
+
+template <typename Program>
+void SetViewProjection(Program& program, const glm::mat4& view, const glm::mat4& projection)
+{
+    program.vs.cbuffer.ConstantBuf.view = glm::transpose(view);
+    program.vs.cbuffer.ConstantBuf.projection = glm::transpose(projection);
+}
+
+} // namespace
+
 GeometryPass::GeometryPass(RenderDevice& device, const Input& input, int width, int height)
     : m_device(device)
     , m_input(input)
     , m_width(width)
     , m_height(height)
     , m_program(device)
+    , m_program_opaque(device, [](auto& program) { program.ps.desc.define["ALPHA_TEST"] = "0"; })
+    , m_program_depth(device)
+    , m_program_packed(device)
+    , m_program_opaque_packed(device, [](auto& program) { program.ps.desc.define["ALPHA_TEST"] = "0"; })
+    , m_program_depth_packed(device)
+    , m_program_indirect(device)
+    , m_program_hiz_init(device,
+                         input.thread_pool,
+                         "GeometryPass HiZ",
+                         GetSampleCounts(),
+                         SponzaSettingsValues().sample_count,
+                         "SAMPLE_COUNT",
+                         [](auto& program) -> auto& { return program.cs; })
+    , m_program_hiz_downsample(device)
+    , m_program_occlusion(device)
+    , m_meshlet_culler(device, input.meshlets, 1)
 {
     CreateSizeDependentResources();
     m_sampler = m_device.CreateSampler(
@@ -19,72 +67,570 @@ void GeometryPass::OnUpdate()
     glm::mat4 projection, view, model;
     m_input.camera.GetMatrix(projection, view, model);
 
-    m_program.vs.cbuffer.ConstantBuf.view = glm::transpose(view);
-    m_program.vs.cbuffer.ConstantBuf.projection = glm::transpose(projection);
+    SetViewProjection(m_program, view, projection);
+    SetViewProjection(m_program_opaque, view, projection);
+    SetViewProjection(m_program_depth, view, projection);
+    SetViewProjection(m_program_packed, view, projection);
+    SetViewProjection(m_program_opaque_packed, view, projection);
+    SetViewProjection(m_program_depth_packed, view, projection);
+    m_view_projection = projection * view;
+
+    if (m_settings.use_frustum_culling) {
+        m_culling.Update(m_input.scene_list, m_input.range_bounds, m_input.instances, m_view_projection);
+    }
 }
 
-void GeometryPass::OnRender(RenderCommandList& command_list)
+void GeometryPass::OnUpload(RenderCommandList& command_list)
 {
-    command_list.SetViewport(0, 0, m_width, m_height);
+    if (m_settings.use_indirect_draw && !m_indirect_initialized) {
+        m_indirect_supported = BuildIndirectDraws(command_list);
+        m_indirect_initialized = true;
+    }
+    if (!m_settings.use_indirect_draw || !m_indirect_supported) {
+        return;
+    }
+
+    UpdateMaterialViews(command_list);
+    uint32_t phase_count = m_settings.use_occlusion_culling ? 2 : 1;
+    if (m_settings.use_meshlet_culling && m_meshlet_culler.IsSupported()) {
+        m_meshlet_culler.Upload(command_list, m_input.scene_list, m_input.camera.GetCameraPos(), phase_count);
+    } else if (m_settings.use_occlusion_culling) {
+        std::vector<glm::mat4> matrices;
+        for (auto& model : m_input.scene_list) {
+            matrices.push_back(glm::transpose(model.matrix));
+        }
+        command_list.UpdateSubresource(m_model_matrices, 0, matrices.data());
+        for (uint32_t phase = 0; phase < phase_count; ++phase) {
+            command_list.UpdateSubresource(m_phase_draw_count[phase], 0, m_zero_counts.data());
+        }
+    }
+}
 
-    command_list.UseProgram(m_program);
-    command_list.Attach(m_program.vs.cbv.ConstantBuf, m_program.vs.cbuffer.ConstantBuf);
-    command_list.Attach(m_program.ps.cbv.Settings, m_program.ps.cbuffer.Settings);
+void GeometryPass::OnRender(RenderCommandList& command_list)
+{
+    if (!m_settings.use_indirect_draw || !m_indirect_supported) {
+        DrawDirect(command_list);
+        return;
+    }
 
-    command_list.Attach(m_program.ps.sampler.g_sampler, m_sampler);
+    if (m_settings.use_meshlet_culling && m_meshlet_culler.IsSupported()) {
+        DrawMeshlets(command_list);
+    } else if (m_settings.use_occlusion_culling) {
+        CullOcclusion(command_list, 0);
+        DrawIndirect(command_list, m_phase_draw_args[0], m_phase_draw_count[0], true);
+        BuildHiZ(command_list);
+        CullOcclusion(command_list, 1);
+        DrawIndirect(command_list, m_phase_draw_args[1], m_phase_draw_count[1], false);
+    } else {
+        DrawIndirect(command_list, m_draw_args, m_draw_count, true);
+    }
+}
 
+RenderPassBeginDesc GeometryPass::GetRenderPassDesc(bool clear)
+{
     RenderPassBeginDesc render_pass_desc = {};
-    render_pass_desc.colors[m_program.ps.om.rtv0].texture = output.position;
+    render_pass_desc.colors[m_program.ps.om.rtv0].texture = output.normal;
     render_pass_desc.colors[m_program.ps.om.rtv0].clear_color = { 0.0f, 0.0f, 0.0f, 1.0f };
-    render_pass_desc.colors[m_program.ps.om.rtv1].texture = output.normal;
+    render_pass_desc.colors[m_program.ps.om.rtv1].texture = output.albedo;
     render_pass_desc.colors[m_program.ps.om.rtv1].clear_color = { 0.0f, 0.0f, 0.0f, 1.0f };
-    render_pass_desc.colors[m_program.ps.om.rtv2].texture = output.albedo;
+    render_pass_desc.colors[m_program.ps.om.rtv2].texture = output.material;
     render_pass_desc.colors[m_program.ps.om.rtv2].clear_color = { 0.0f, 0.0f, 0.0f, 1.0f };
-    render_pass_desc.colors[m_program.ps.om.rtv3].texture = output.material;
-    render_pass_desc.colors[m_program.ps.om.rtv3].clear_color = { 0.0f, 0.0f, 0.0f, 1.0f };
     render_pass_desc.depth_stencil.texture = output.dsv;
     render_pass_desc.depth_stencil.clear_depth = 1.0f;
+    if (!clear) {
+        for (auto rtv : { m_program.ps.om.rtv0, m_program.ps.om.rtv1, m_program.ps.om.rtv2 }) {
+            render_pass_desc.colors[rtv].load_op = RenderPassLoadOp::kLoad;
+        }
+        render_pass_desc.depth_stencil.depth_load_op = RenderPassLoadOp::kLoad;
+    }
+    return render_pass_desc;
+}
 
-    bool skiped = false;
+void GeometryPass::ClassifyRanges()
+{
+    m_alpha_tested.clear();
+    for (auto& model : m_input.scene_list) {
+        auto& alpha_tested = m_alpha_tested.emplace_back();
+        for (auto& range : model.ia.ranges) {
+            auto& opacity = model.GetMaterial(range.id).texture.opacity;
+            alpha_tested.emplace_back(opacity->GetWidth() != 1 || opacity->GetHeight() != 1);
+        }
+    }
+}
+
+void GeometryPass::DrawDirect(RenderCommandList& command_list)
+{
+    command_list.SetViewport(0, 0, m_width, m_height);
+
+    // The pre-pass and the color pass select the same LODs, the equal depth test relies on it.
+    LodSelector lods(m_input.lods, m_input.range_bounds, m_settings.use_lod, m_input.camera.GetCameraPos(),
+                     m_input.camera.GetProjectionMatrix()[1][1], m_settings.lod_bias);
+
+    if (!m_settings.use_depth_prepass) {
+        command_list.BeginRenderPass(GetRenderPassDesc(true));
+        DrawRanges(command_list, m_program, RangeBucket::kAll, lods);
+        DrawRanges(command_list, m_program_packed, RangeBucket::kAll, lods);
+        command_list.EndRenderPass();
+        return;
+    }
+
+    if (m_alpha_tested.size() != m_input.scene_list.size()) {
+        ClassifyRanges();
+    }
+
+    DrawDepthPrePass(command_list, lods);
+
+    RenderPassBeginDesc render_pass_desc = GetRenderPassDesc(true);
+    render_pass_desc.depth_stencil.depth_load_op = RenderPassLoadOp::kLoad;
     command_list.BeginRenderPass(render_pass_desc);
+    command_list.SetDepthStencilState({ true, ComparisonFunc::kEqual });
+    DrawRanges(command_list, m_program_opaque, RangeBucket::kOpaque, lods);
+    DrawRanges(command_list, m_program_opaque_packed, RangeBucket::kOpaque, lods);
+    command_list.SetDepthStencilState({ true, ComparisonFunc::kLess });
+    DrawRanges(command_list, m_program, RangeBucket::kAlphaTested, lods);
+    DrawRanges(command_list, m_program_packed, RangeBucket::kAlphaTested, lods);
+    command_list.EndRenderPass();
+}
+
+void GeometryPass::DrawDepthPrePass(RenderCommandList& command_list, const LodSelector& lods)
+{
+    RenderPassBeginDesc render_pass_desc = {};
+    render_pass_desc.depth_stencil.texture = output.dsv;
+    render_pass_desc.depth_stencil.clear_depth = 1.0f;
+
+    command_list.BeginRenderPass(render_pass_desc);
+    DrawDepthRanges(command_list, m_program_depth, lods);
+    DrawDepthRanges(command_list, m_program_depth_packed, lods);
+    command_list.EndRenderPass();
+}
+
+bool GeometryPass::UsePackedVertices(size_t model_id) const
+{
+    return m_settings.use_packed_vertices && HasPackedVertices(m_input.packed_vertices, model_id);
+}
+
+template <typename Program>
+void GeometryPass::DrawDepthRanges(RenderCommandList& command_list, Program& program, const LodSelector& lods)
+{
+    constexpr bool packed = IsPackedProgram<Program>::value;
+    if (packed && !m_settings.use_packed_vertices) {
+        return;
+    }
+
+    command_list.UseProgram(program);
+    command_list.Attach(program.vs.cbv.ConstantBuf, program.vs.cbuffer.ConstantBuf);
+
+    bool skiped = false;
+    size_t model_id = 0;
     for (auto& model : m_input.scene_list) {
-        if (!skiped && m_settings.Get<bool>("skip_sponza_model")) {
+        size_t cur_model_id = model_id++;
+        if (!skiped && m_settings.skip_sponza_model) {
             skiped = true;
             continue;
         }
-        m_program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
-        m_program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
-        m_program.ps.cbuffer.Settings.ibl_source = model.ibl_source;
+        if (UsePackedVertices(cur_model_id) != packed) {
+            continue;
+        }
+        program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+        AttachInstances(command_list, program, m_input.instances, cur_model_id);
+        uint32_t instance_count = GetInstanceCount(m_input.instances, cur_model_id);
 
-        model.ia.indices.Bind(command_list);
-        model.ia.positions.BindToSlot(command_list, m_program.vs.ia.POSITION);
-        model.ia.normals.BindToSlot(command_list, m_program.vs.ia.NORMAL);
-        model.ia.texcoords.BindToSlot(command_list, m_program.vs.ia.TEXCOORD);
-        model.ia.tangents.BindToSlot(command_list, m_program.vs.ia.TANGENT);
+        lods.BindIndices(command_list, cur_model_id, model);
+        if constexpr (packed) {
+            AttachPackedVertices(command_list, program, m_input.packed_vertices[cur_model_id]);
+        } else {
+            model.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
+        }
 
-        for (auto& range : model.ia.ranges) {
+        for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+            if (m_alpha_tested[cur_model_id][range_id]) {
+                continue;
+            }
+            if (m_settings.use_frustum_culling && !m_culling.IsVisible(cur_model_id, range_id)) {
+                continue;
+            }
+            auto& range = model.ia.ranges[range_id];
+            RangeLod lod = lods.GetRange(cur_model_id, model, range_id);
+            DrawRange(command_list, program, m_input.packed_vertices, cur_model_id, range_id,
+                      range.base_vertex_location, lod, instance_count);
+        }
+    }
+}
+
+template <typename Program>
+void GeometryPass::DrawRanges(RenderCommandList& command_list,
+                              Program& program,
+                              RangeBucket bucket,
+                              const LodSelector& lods,
+                              bool only_direct_models)
+{
+    constexpr bool packed = IsPackedProgram<Program>::value;
+    if (packed && !m_settings.use_packed_vertices) {
+        return;
+    }
+
+    command_list.UseProgram(program);
+    command_list.Attach(program.vs.cbv.ConstantBuf, program.vs.cbuffer.ConstantBuf);
+    command_list.Attach(program.ps.cbv.Settings, program.ps.cbuffer.Settings);
+
+    command_list.Attach(program.ps.sampler.g_sampler, m_sampler);
+
+    bool skiped = false;
+    size_t model_id = 0;
+    for (auto& model : m_input.scene_list) {
+        size_t cur_model_id = model_id++;
+        if (!skiped && m_settings.skip_sponza_model) {
+            skiped = true;
+            continue;
+        }
+        if (only_direct_models && !m_indirect_models[cur_model_id].direct) {
+            continue;
+        }
+        if (UsePackedVertices(cur_model_id) != packed) {
+            continue;
+        }
+        program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+        program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+        program.ps.cbuffer.Settings.ibl_source = model.ibl_source;
+        AttachInstances(command_list, program, m_input.instances, cur_model_id);
+        uint32_t instance_count = GetInstanceCount(m_input.instances, cur_model_id);
+
+        lods.BindIndices(command_list, cur_model_id, model);
+        if constexpr (packed) {
+            AttachPackedVertices(command_list, program, m_input.packed_vertices[cur_model_id]);
+        } else {
+            model.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
+            model.ia.normals.BindToSlot(command_list, program.vs.ia.NORMAL);
+            model.ia.texcoords.BindToSlot(command_list, program.vs.ia.TEXCOORD);
+            model.ia.tangents.BindToSlot(command_list, program.vs.ia.TANGENT);
+        }
+
+        for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+            if (bucket != RangeBucket::kAll &&
+                m_alpha_tested[cur_model_id][range_id] != (bucket == RangeBucket::kAlphaTested)) {
+                continue;
+            }
+            if (m_settings.use_frustum_culling && !m_culling.IsVisible(cur_model_id, range_id)) {
+                continue;
+            }
+            auto& range = model.ia.ranges[range_id];
             auto& material = model.GetMaterial(range.id);
 
-            m_program.ps.cbuffer.Settings.use_normal_mapping =
-                material.texture.normal && m_settings.Get<bool>("normal_mapping");
-            m_program.ps.cbuffer.Settings.use_gloss_instead_of_roughness =
+            program.ps.cbuffer.Settings.use_normal_mapping = material.texture.normal && m_settings.normal_mapping;
+            program.ps.cbuffer.Settings.use_gloss_instead_of_roughness =
                 material.texture.glossiness && !material.texture.roughness;
-            m_program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.Get<bool>("use_flip_normal_y");
+            program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.use_flip_normal_y;
+            program.ps.cbuffer.Settings.use_packed_normal =
+                material.texture.normal && IsPackedNormalFormat(material.texture.normal->GetFormat());
+
+            command_list.Attach(program.ps.srv.normalMap, material.texture.normal);
+            command_list.Attach(program.ps.srv.albedoMap, material.texture.albedo);
+            command_list.Attach(program.ps.srv.glossMap, material.texture.glossiness);
+            command_list.Attach(program.ps.srv.roughnessMap, material.texture.roughness);
+            command_list.Attach(program.ps.srv.metalnessMap, material.texture.metalness);
+            command_list.Attach(program.ps.srv.aoMap, material.texture.occlusion);
+            command_list.Attach(program.ps.srv.alphaMap, material.texture.opacity);
 
-            command_list.Attach(m_program.ps.srv.normalMap, material.texture.normal);
-            command_list.Attach(m_program.ps.srv.albedoMap, material.texture.albedo);
-            command_list.Attach(m_program.ps.srv.glossMap, material.texture.glossiness);
-            command_list.Attach(m_program.ps.srv.roughnessMap, material.texture.roughness);
-            command_list.Attach(m_program.ps.srv.metalnessMap, material.texture.metalness);
-            command_list.Attach(m_program.ps.srv.aoMap, material.texture.occlusion);
-            command_list.Attach(m_program.ps.srv.alphaMap, material.texture.opacity);
+            RangeLod lod = lods.GetRange(cur_model_id, model, range_id);
+            DrawRange(command_list, program, m_input.packed_vertices, cur_model_id, range_id,
+                      range.base_vertex_location, lod, instance_count);
+        }
+    }
+}
+
+void GeometryPass::DrawIndirect(RenderCommandList& command_list,
+                                const std::shared_ptr<Resource>& draw_args,
+                                const std::shared_ptr<Resource>& draw_count,
+                                bool clear,
+                                const std::shared_ptr<Resource>& indices)
+{
+    command_list.SetViewport(0, 0, m_width, m_height);
+
+    command_list.UseProgram(m_program_indirect);
+    command_list.Attach(m_program_indirect.vs.cbv.ConstantBuf, m_program_indirect.vs.cbuffer.ConstantBuf);
+    command_list.Attach(m_program_indirect.ps.cbv.Settings, m_program_indirect.ps.cbuffer.Settings);
+    command_list.Attach(m_program_indirect.ps.sampler.g_sampler, m_sampler);
+    command_list.Attach(m_program_indirect.ps.srv.material_table, m_material_table);
+
+    m_program_indirect.vs.cbuffer.ConstantBuf.view = m_program.vs.cbuffer.ConstantBuf.view;
+    m_program_indirect.vs.cbuffer.ConstantBuf.projection = m_program.vs.cbuffer.ConstantBuf.projection;
+    m_program_indirect.ps.cbuffer.Settings.use_normal_mapping = m_settings.normal_mapping;
+    m_program_indirect.ps.cbuffer.Settings.use_flip_normal_y = m_settings.use_flip_normal_y;
+
+    command_list.BeginRenderPass(GetRenderPassDesc(clear));
+    size_t i = 0;
+    for (auto& model : m_input.scene_list) {
+        size_t model_id = i++;
+        auto& indirect = m_indirect_models[model_id];
+        size_t count_offset = sizeof(uint32_t) * model_id;
+        if (!indirect.draw_count || indirect.direct || (count_offset == 0 && m_settings.skip_sponza_model)) {
+            continue;
+        }
+        m_program_indirect.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+        m_program_indirect.vs.cbuffer.ConstantBuf.normalMatrix =
+            glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+        m_program_indirect.ps.cbuffer.Settings.ibl_source = model.ibl_source;
+        AttachInstances(command_list, m_program_indirect, m_input.instances, model_id);
 
-            command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location, 0);
+        if (indices) {
+            command_list.IASetIndexBuffer(indices, gli::format::FORMAT_R32_UINT_PACK32);
+        } else {
+            model.ia.indices.Bind(command_list);
         }
+        model.ia.positions.BindToSlot(command_list, m_program_indirect.vs.ia.POSITION);
+        model.ia.normals.BindToSlot(command_list, m_program_indirect.vs.ia.NORMAL);
+        model.ia.texcoords.BindToSlot(command_list, m_program_indirect.vs.ia.TEXCOORD);
+        model.ia.tangents.BindToSlot(command_list, m_program_indirect.vs.ia.TANGENT);
+        indirect.materials->BindToSlot(command_list, m_program_indirect.vs.ia.MATERIAL);
+
+        command_list.DrawIndexedIndirectCount(draw_args, indirect.args_offset, draw_count, count_offset,
+                                              indirect.draw_count, sizeof(IndirectDrawArgs));
+    }
+    // Drawn once per frame with the pass that clears, they are in the depth of the first phase like the rest.
+    if (m_has_direct_models && clear) {
+        LodSelector lods(m_input.lods, m_input.range_bounds, false, m_input.camera.GetCameraPos(),
+                         m_input.camera.GetProjectionMatrix()[1][1], m_settings.lod_bias);
+        DrawRanges(command_list, m_program, RangeBucket::kAll, lods, true);
+        DrawRanges(command_list, m_program_packed, RangeBucket::kAll, lods, true);
     }
     command_list.EndRenderPass();
 }
 
+void GeometryPass::DrawMeshlets(RenderCommandList& command_list)
+{
+    // The meshlet draw arguments follow the ranges in scene order like the ones of BuildIndirectDraws, so the
+    // offsets and counts of the indirect models apply to them.
+    MeshletCullingDesc desc = {};
+    desc.eye = m_input.camera.GetCameraPos();
+    desc.view_projection = m_view_projection;
+    if (m_settings.use_occlusion_culling && m_hiz_valid) {
+        desc.hiz = m_hiz;
+        desc.hiz_view_projection = m_hiz_view_projection;
+    }
+    m_meshlet_culler.Cull(command_list, desc);
+    DrawIndirect(command_list, m_meshlet_culler.GetDrawArgs(0), m_draw_count, true, m_meshlet_culler.GetIndices(0));
+    if (!m_settings.use_occlusion_culling) {
+        return;
+    }
+
+    BuildHiZ(command_list);
+    desc.phase = 1;
+    desc.hiz = m_hiz;
+    m_meshlet_culler.Cull(command_list, desc);
+    DrawIndirect(command_list, m_meshlet_culler.GetDrawArgs(1), m_draw_count, false, m_meshlet_culler.GetIndices(1));
+}
+
+std::shared_ptr<View> GeometryPass::CreateMaterialView(const std::shared_ptr<Resource>& texture)
+{
+    ViewDesc view_desc = {};
+    view_desc.bindless = true;
+    view_desc.dimension = ViewDimension::kTexture2D;
+    view_desc.view_type = ViewType::kTexture;
+    return m_device.CreateView(texture, view_desc);
+}
+
+void GeometryPass::UpdateMaterialViews(RenderCommandList& command_list)
+{
+    ++m_frame;
+    while (!m_retired_views.empty() && m_retired_views.front().first + kFrameCount < m_frame) {
+        m_retired_views.pop_front();
+    }
+
+    bool changed = false;
+    for (auto& slot : m_material_slots) {
+        if (slot.texture->get() == slot.resource) {
+            continue;
+        }
+        // Frames in flight may still read the old descriptor.
+        m_retired_views.emplace_back(m_frame, std::move(slot.view));
+        slot.resource = slot.texture->get();
+        slot.view = CreateMaterialView(*slot.texture);
+        m_material_table_data[slot.entry / 4][slot.entry % 4] = slot.view->GetDescriptorId();
+        changed = true;
+    }
+    if (changed) {
+        command_list.UpdateSubresource(m_material_table, 0, m_material_table_data.data());
+    }
+}
+
+bool GeometryPass::BuildIndirectDraws(RenderCommandList& command_list)
+{
+    std::vector<glm::uvec4> material_table;
+    std::vector<IndirectDrawArgs> draw_args;
+    std::vector<uint32_t> draw_count;
+    std::vector<glm::uvec4> range_info;
+    std::vector<glm::vec4> range_bounds;
+    std::vector<glm::uvec4> model_info;
+
+    m_has_direct_models = false;
+    for (auto& model : m_input.scene_list) {
+        uint32_t model_id = static_cast<uint32_t>(m_indirect_models.size());
+        // The material id is a per-vertex attribute, so every vertex must be referenced by a single range. This
+        // is how the model loader lays out meshes, other models fall back to direct draws.
+        const std::vector<uint32_t>& vertex_ranges = m_input.vertex_ranges[model_id];
+        bool shared_vertices = vertex_ranges.empty() && model.ia.positions.Count();
+
+        std::map<uint32_t, uint32_t> material_ids;
+        std::vector<uint32_t> range_materials(model.ia.ranges.size());
+        for (size_t range_id = 0; range_id < model.ia.ranges.size() && !shared_vertices; ++range_id) {
+            auto& range = model.ia.ranges[range_id];
+            auto it = material_ids.find(range.id);
+            if (it == material_ids.end()) {
+                auto& material = model.GetMaterial(range.id);
+                uint32_t flags = 0;
+                if (material.texture.normal) {
+                    flags |= kHasNormalMap;
+                }
+                if (material.texture.glossiness && !material.texture.roughness) {
+                    flags |= kUseGlossInsteadOfRoughness;
+                }
+                if (material.texture.normal && IsPackedNormalFormat(material.texture.normal->GetFormat())) {
+                    flags |= kPackedNormal;
+                }
+                it = material_ids.emplace(range.id, static_cast<uint32_t>(material_table.size() / 2)).first;
+                const std::shared_ptr<Resource>* textures[] = {
+                    &material.texture.albedo,    &material.texture.normal,    &material.texture.glossiness,
+                    &material.texture.roughness, &material.texture.metalness, &material.texture.occlusion,
+                    &material.texture.opacity,
+                };
+                size_t entry = material_table.size() * 4;
+                material_table.resize(material_table.size() + 2, glm::uvec4(~0u));
+                material_table.back().w = flags;
+                for (size_t i = 0; i < std::size(textures); ++i) {
+                    if (*textures[i]) {
+                        auto& slot = m_material_slots.emplace_back();
+                        slot.texture = textures[i];
+                        slot.resource = textures[i]->get();
+                        slot.view = CreateMaterialView(*textures[i]);
+                        slot.entry = entry + i;
+                        material_table[slot.entry / 4][slot.entry % 4] = slot.view->GetDescriptorId();
+                    }
+                }
+            }
+            range_materials[range_id] = it->second;
+        }
+        std::vector<uint32_t> vertex_materials;
+        if (!shared_vertices) {
+            vertex_materials.resize(vertex_ranges.size());
+            for (size_t vertex = 0; vertex < vertex_ranges.size(); ++vertex) {
+                if (vertex_ranges[vertex] != kNoVertexRange) {
+                    vertex_materials[vertex] = range_materials[vertex_ranges[vertex]];
+                }
+            }
+        }
+
+        uint32_t instance_count = GetInstanceCount(m_input.instances, model_id);
+        bool has_bounds = model_id < m_input.range_bounds.size() &&
+                          m_input.range_bounds[model_id].size() == model.ia.ranges.size() &&
+                          !model.bones.HasAnimation();
+        // The ranges of instanced models are not culled, their bounds are per instance.
+        bool never_culled = !has_bounds || instance_count != 1;
+        model_info.push_back({ static_cast<uint32_t>(draw_args.size()), never_culled ? 1u : 0u, instance_count, 0u });
+
+        IndirectModel indirect = {};
+        indirect.args_offset = sizeof(IndirectDrawArgs) * draw_args.size();
+        indirect.draw_count = static_cast<uint32_t>(model.ia.ranges.size());
+        indirect.direct = shared_vertices;
+        m_has_direct_models |= shared_vertices;
+        for (size_t i = 0; i < model.ia.ranges.size(); ++i) {
+            auto& range = model.ia.ranges[i];
+            draw_args.push_back({ range.index_count, instance_count, range.start_index_location,
+                                  static_cast<int32_t>(range.base_vertex_location), 0 });
+            range_info.push_back({ range.index_count, range.start_index_location,
+                                   static_cast<uint32_t>(range.base_vertex_location), model_id });
+            AABB box = has_bounds ? m_input.range_bounds[model_id][i] : AABB{};
+            range_bounds.emplace_back(box.min, 0.0f);
+            range_bounds.emplace_back(box.max, 0.0f);
+        }
+        if (!vertex_materials.empty()) {
+            indirect.materials.reset(new IAVertexBuffer(m_device, command_list, vertex_materials));
+        }
+        draw_count.push_back(indirect.draw_count);
+        m_indirect_models.emplace_back(std::move(indirect));
+    }
+
+    if (draw_args.empty()) {
+        return false;
+    }
+
+    m_material_table = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                             sizeof(glm::uvec4) * material_table.size());
+    command_list.UpdateSubresource(m_material_table, 0, material_table.data());
+    m_material_table_data = std::move(material_table);
+    m_draw_args = m_device.CreateBuffer(BindFlag::kIndirectBuffer | BindFlag::kCopyDest,
+                                        sizeof(IndirectDrawArgs) * draw_args.size());
+    command_list.UpdateSubresource(m_draw_args, 0, draw_args.data());
+    m_draw_count =
+        m_device.CreateBuffer(BindFlag::kIndirectBuffer | BindFlag::kCopyDest, sizeof(uint32_t) * draw_count.size());
+    command_list.UpdateSubresource(m_draw_count, 0, draw_count.data());
+
+    m_range_count = static_cast<uint32_t>(range_info.size());
+    m_zero_counts.assign(draw_count.size(), 0);
+    m_range_info = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                         sizeof(glm::uvec4) * range_info.size());
+    command_list.UpdateSubresource(m_range_info, 0, range_info.data());
+    m_range_bounds = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                           sizeof(glm::vec4) * range_bounds.size());
+    command_list.UpdateSubresource(m_range_bounds, 0, range_bounds.data());
+    m_model_info = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                         sizeof(glm::uvec4) * model_info.size());
+    command_list.UpdateSubresource(m_model_info, 0, model_info.data());
+    m_model_matrices = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                             sizeof(glm::mat4) * model_info.size());
+    m_occluded = m_device.CreateBuffer(BindFlag::kUnorderedAccess, sizeof(uint32_t) * range_info.size());
+    for (size_t phase = 0; phase < 2; ++phase) {
+        m_phase_draw_args[phase] = m_device.CreateBuffer(BindFlag::kIndirectBuffer | BindFlag::kUnorderedAccess,
+                                                         sizeof(IndirectDrawArgs) * draw_args.size());
+        m_phase_draw_count[phase] =
+            m_device.CreateBuffer(BindFlag::kIndirectBuffer | BindFlag::kUnorderedAccess | BindFlag::kCopyDest,
+                                  sizeof(uint32_t) * draw_count.size());
+    }
+    return true;
+}
+
+void GeometryPass::CullOcclusion(RenderCommandList& command_list, uint32_t phase)
+{
+    auto& settings = m_program_occlusion.cs.cbuffer.Settings;
+    settings.view_projection = glm::transpose(m_view_projection);
+    settings.hiz_view_projection = glm::transpose(phase == 0 ? m_hiz_view_projection : m_view_projection);
+    settings.range_count = m_range_count;
+    settings.phase = phase;
+    settings.use_hiz = phase == 1 || m_hiz_valid;
+
+    command_list.UseProgram(m_program_occlusion);
+    command_list.Attach(m_program_occlusion.cs.cbv.Settings, m_program_occlusion.cs.cbuffer.Settings);
+    command_list.Attach(m_program_occlusion.cs.srv.range_info, m_range_info);
+    command_list.Attach(m_program_occlusion.cs.srv.range_bounds, m_range_bounds);
+    command_list.Attach(m_program_occlusion.cs.srv.model_matrices, m_model_matrices);
+    command_list.Attach(m_program_occlusion.cs.srv.model_info, m_model_info);
+    command_list.Attach(m_program_occlusion.cs.srv.hiz, m_hiz);
+    command_list.Attach(m_program_occlusion.cs.uav.draw_args, m_phase_draw_args[phase]);
+    command_list.Attach(m_program_occlusion.cs.uav.draw_count, m_phase_draw_count[phase]);
+    command_list.Attach(m_program_occlusion.cs.uav.occluded, m_occluded);
+    command_list.Dispatch((m_range_count + 64 - 1) / 64, 1, 1);
+}
+
+void GeometryPass::BuildHiZ(RenderCommandList& command_list)
+{
+    auto& program_hiz_init = m_program_hiz_init.Get();
+    command_list.UseProgram(program_hiz_init);
+    command_list.Attach(program_hiz_init.cs.srv.depth, output.dsv);
+    command_list.Attach(program_hiz_init.cs.uav.hiz, m_hiz, { 0, 1 });
+    command_list.Dispatch((m_width + 8 - 1) / 8, (m_height + 8 - 1) / 8, 1);
+
+    command_list.UseProgram(m_program_hiz_downsample);
+    for (size_t i = 1; i < m_hiz_mips; ++i) {
+        command_list.Attach(m_program_hiz_downsample.cs.srv.inputTexture, m_hiz, { i - 1, 1 });
+        command_list.Attach(m_program_hiz_downsample.cs.uav.outputTexture, m_hiz, { i, 1 });
+        int width = std::max(m_width >> i, 1);
+        int height = std::max(m_height >> i, 1);
+        command_list.Dispatch((width + 8 - 1) / 8, (height + 8 - 1) / 8, 1);
+    }
+
+    m_hiz_view_projection = m_view_projection;
+    m_hiz_valid = true;
+}
+
 void GeometryPass::OnResize(int width, int height)
 {
     m_width = width;
@@ -92,29 +638,66 @@ void GeometryPass::OnResize(int width, int height)
     CreateSizeDependentResources();
 }
 
-void GeometryPass::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask GeometryPass::GetSponzaSettingsSubscription() const
+{
+    return {
+        SponzaSetting::sample_count, SponzaSetting::skip_sponza_model,
+        SponzaSetting::normal_mapping, SponzaSetting::use_flip_normal_y, SponzaSetting::use_indirect_draw,
+        SponzaSetting::use_frustum_culling, SponzaSetting::use_occlusion_culling, SponzaSetting::use_depth_prepass,
+        SponzaSetting::use_lod, SponzaSetting::lod_bias, SponzaSetting::use_packed_vertices,
+        SponzaSetting::use_meshlet_culling
+    };
+}
+
+void GeometryPass::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
-    SponzaSettings prev = m_settings;
     m_settings = settings;
-    if (prev.Get<uint32_t>("sample_count") != m_settings.Get<uint32_t>("sample_count")) {
+    if (changes.Test(SponzaSetting::sample_count)) {
+        m_program_hiz_init.Select(m_settings.sample_count);
         CreateSizeDependentResources();
     }
 }
 
 void GeometryPass::CreateSizeDependentResources()
 {
-    output.position = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                             gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-                                             m_settings.Get<uint32_t>("sample_count"), m_width, m_height, 1);
+    // Position is reconstructed from the depth buffer, see GBuffer.hlsli for the layout.
     output.normal = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                           gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-                                           m_settings.Get<uint32_t>("sample_count"), m_width, m_height, 1);
+                                           gli::format::FORMAT_RG16_SFLOAT_PACK16, m_settings.sample_count, m_width,
+                                           m_height, 1);
     output.albedo = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                           gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-                                           m_settings.Get<uint32_t>("sample_count"), m_width, m_height, 1);
+                                           gli::format::FORMAT_RGBA8_SRGB_PACK8, m_settings.sample_count, m_width,
+                                           m_height, 1);
     output.material = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                             gli::format::FORMAT_RGBA32_SFLOAT_PACK32,
-                                             m_settings.Get<uint32_t>("sample_count"), m_width, m_height, 1);
-    output.dsv = m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32,
-                                        m_settings.Get<uint32_t>("sample_count"), m_width, m_height, 1);
+                                             gli::format::FORMAT_RGBA8_UNORM_PACK8, m_settings.sample_count, m_width,
+                                             m_height, 1);
+    output.dsv = m_device.CreateTexture(BindFlag::kDepthStencil | BindFlag::kShaderResource,
+                                        gli::format::FORMAT_D32_SFLOAT_PACK32, m_settings.sample_count, m_width,
+                                        m_height, 1);
+
+    m_hiz_mips = 1;
+    while ((std::max(m_width, m_height) >> m_hiz_mips) > 0) {
+        ++m_hiz_mips;
+    }
+    m_hiz = m_device.CreateTexture(BindFlag::kShaderResource | BindFlag::kUnorderedAccess,
+                                   gli::format::FORMAT_R32_SFLOAT_PACK32, 1, m_width, m_height, 1, m_hiz_mips);
+    m_hiz_valid = false;
+}
+
+bool GeometryPass::HasPrograms(const SponzaSettingsValues& settings) const
+{
+    return m_program_hiz_init.IsBuilt(settings.sample_count);
+}
+
+bool GeometryPass::BuildProgram(const SponzaSettingsValues& settings, bool wait)
+{
+    return m_program_hiz_init.Build(settings.sample_count, wait);
+}
+
+void GeometryPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.AllowParallelRecording();
+    builder.Write(output.normal);
+    builder.Write(output.albedo);
+    builder.Write(output.material);
+    builder.Write(output.dsv);
 }
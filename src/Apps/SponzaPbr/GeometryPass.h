@@ -3,20 +3,47 @@
 #include "Camera/Camera.h"
 #include "Device/Device.h"
 #include "Geometry/Geometry.h"
+#include "Geometry/IABuffer.h"
+#include "ProgramRef/DepthPrePassPacked_VS.h"
+#include "ProgramRef/DepthPrePass_VS.h"
+#include "ProgramRef/GeometryPassIndirect_PS.h"
+#include "ProgramRef/GeometryPassIndirect_VS.h"
+#include "ProgramRef/GeometryPassPacked_VS.h"
 #include "ProgramRef/GeometryPass_PS.h"
 #include "ProgramRef/GeometryPass_VS.h"
+#include "ProgramRef/HiZDownsample_CS.h"
+#include "ProgramRef/HiZInit_CS.h"
+#include "ProgramRef/OcclusionCulling_CS.h"
+#include "PackedVertices.h"
+#include "ProgramPermutations.h"
 #include "RenderPass.h"
+#include "SceneBounds.h"
+#include "SceneInstances.h"
+#include "SceneLods.h"
+#include "SceneMeshlets.h"
+#include "SceneVertexRanges.h"
 #include "SponzaSettings.h"
 
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
 class GeometryPass : public IPass {
 public:
     struct Input {
         SceneModels& scene_list;
         const Camera& camera;
+        const ModelRangeBounds& range_bounds;
+        const SceneLods& lods;
+        const ScenePackedVertices& packed_vertices;
+        const SceneMeshlets& meshlets;
+        const SceneInstances& instances;
+        const ModelVertexRanges& vertex_ranges;
+        ThreadPool& thread_pool;
     };
 
     struct Output {
-        std::shared_ptr<Resource> position;
         std::shared_ptr<Resource> normal;
         std::shared_ptr<Resource> albedo;
         std::shared_ptr<Resource> material;
@@ -26,9 +53,15 @@ public:
     GeometryPass(RenderDevice& device, const Input& input, int width, int height);
 
     virtual void OnUpdate() override;
+    virtual void OnUpload(RenderCommandList& command_list) override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual bool HasPrograms(const SponzaSettingsValues& settings) const override;
+    virtual bool BuildProgram(const SponzaSettingsValues& settings, bool wait) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
     RenderDevice& m_device;
@@ -36,9 +69,109 @@ private:
     int m_width;
     int m_height;
     ProgramHolder<GeometryPass_PS, GeometryPass_VS> m_program;
+    ProgramHolder<GeometryPass_PS, GeometryPass_VS> m_program_opaque;
+    ProgramHolder<DepthPrePass_VS> m_program_depth;
+    ProgramHolder<GeometryPass_PS, GeometryPassPacked_VS> m_program_packed;
+    ProgramHolder<GeometryPass_PS, GeometryPassPacked_VS> m_program_opaque_packed;
+    ProgramHolder<DepthPrePassPacked_VS> m_program_depth_packed;
+    ProgramHolder<GeometryPassIndirect_PS, GeometryPassIndirect_VS> m_program_indirect;
+    ProgramPermutations<ProgramHolder<HiZInit_CS>> m_program_hiz_init;
+    ProgramHolder<HiZDownsample_CS> m_program_hiz_downsample;
+    ProgramHolder<OcclusionCulling_CS> m_program_occlusion;
 
     void CreateSizeDependentResources();
+    RenderPassBeginDesc GetRenderPassDesc(bool clear);
+    enum class RangeBucket {
+        kAll,
+        kOpaque,
+        kAlphaTested,
+    };
+
+    void ClassifyRanges();
+    void DrawDirect(RenderCommandList& command_list);
+    void DrawDepthPrePass(RenderCommandList& command_list, const LodSelector& lods);
+    // Draws the models whose vertex format matches the program, see IsPackedProgram.
+    template <typename Program>
+    void DrawDepthRanges(RenderCommandList& command_list, Program& program, const LodSelector& lods);
+    template <typename Program>
+    void DrawRanges(RenderCommandList& command_list,
+                    Program& program,
+                    RangeBucket bucket,
+                    const LodSelector& lods,
+                    bool only_direct_models = false);
+    bool UsePackedVertices(size_t model_id) const;
+    // The models bind their own index buffer unless indices is set, see MeshletCuller.
+    void DrawIndirect(RenderCommandList& command_list,
+                      const std::shared_ptr<Resource>& draw_args,
+                      const std::shared_ptr<Resource>& draw_count,
+                      bool clear,
+                      const std::shared_ptr<Resource>& indices = nullptr);
+    void DrawMeshlets(RenderCommandList& command_list);
+    // Creates the buffers of the indirect path from the data computed at load time, nothing is read back.
+    bool BuildIndirectDraws(RenderCommandList& command_list);
+    std::shared_ptr<View> CreateMaterialView(const std::shared_ptr<Resource>& texture);
+    // Points the material table at the textures which were replaced since it was written, see TextureStreamer.
+    void UpdateMaterialViews(RenderCommandList& command_list);
+    void CullOcclusion(RenderCommandList& command_list, uint32_t phase);
+    void BuildHiZ(RenderCommandList& command_list);
+
+    // Draw arguments of one model, its ranges are submitted with a single multi-draw-indirect call.
+    struct IndirectModel {
+        std::unique_ptr<IAVertexBuffer> materials;
+        uint64_t args_offset;
+        uint32_t draw_count;
+        // Ranges of the model share vertices, which can't have a material each. Its arguments are still written
+        // so the layouts stay in scene order, but the model is drawn with DrawRanges.
+        bool direct = false;
+    };
+
+    SceneCulling m_culling;
+
+    // Ranges with an opacity map are alpha tested, the rest are drawn after the depth pre-pass with an equal test.
+    std::vector<std::vector<bool>> m_alpha_tested;
+
+    bool m_indirect_initialized = false;
+    bool m_indirect_supported = false;
+    std::vector<IndirectModel> m_indirect_models;
+    bool m_has_direct_models = false;
+    // A texture of a material and the bindless view of it in the material table.
+    struct MaterialSlot {
+        const std::shared_ptr<Resource>* texture;
+        // The texture the view was created for.
+        Resource* resource;
+        std::shared_ptr<View> view;
+        // Component of the material table, four per element.
+        size_t entry;
+    };
+
+    std::vector<MaterialSlot> m_material_slots;
+    std::vector<glm::uvec4> m_material_table_data;
+    std::shared_ptr<Resource> m_material_table;
+    uint64_t m_frame = 0;
+    std::deque<std::pair<uint64_t, std::shared_ptr<View>>> m_retired_views;
+    std::shared_ptr<Resource> m_draw_args;
+    std::shared_ptr<Resource> m_draw_count;
+
+    // Two phase occlusion culling, phase 0 tests against the pyramid of the previous frame and phase 1 retests
+    // the occluded ranges against the pyramid built from the depth of phase 0.
+    glm::mat4 m_view_projection = glm::mat4(1.0f);
+    glm::mat4 m_hiz_view_projection = glm::mat4(1.0f);
+    std::shared_ptr<Resource> m_hiz;
+    size_t m_hiz_mips = 0;
+    bool m_hiz_valid = false;
+    uint32_t m_range_count = 0;
+    std::vector<uint32_t> m_zero_counts;
+    std::shared_ptr<Resource> m_range_info;
+    std::shared_ptr<Resource> m_range_bounds;
+    std::shared_ptr<Resource> m_model_info;
+    std::shared_ptr<Resource> m_model_matrices;
+    std::shared_ptr<Resource> m_occluded;
+    std::shared_ptr<Resource> m_phase_draw_args[2];
+    std::shared_ptr<Resource> m_phase_draw_count[2];
+
+    // Culls the meshlets instead of the ranges in the indirect path, the draws and materials stay per range.
+    MeshletCuller m_meshlet_culler;
 
     std::shared_ptr<Resource> m_sampler;
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
 };
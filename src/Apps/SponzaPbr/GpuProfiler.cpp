@@ -0,0 +1,226 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+namespace {
+
+thread_local std::vector<ProfileEvent>* g_sink = nullptr;
+thread_local uint32_t g_depth = 0;
+thread_local std::string g_path;
+
+double ElapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+std::string EscapeJson(const std::string& str)
+{
+    std::string res;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            res += buffer;
+        } else {
+            res += c;
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+ScopedEvent::ScopedEvent(RenderCommandList& command_list, const std::string& name)
+    : m_command_list(command_list)
+    , m_sink(g_sink)
+{
+    m_command_list.BeginEvent(name);
+    if (m_sink) {
+        m_parent_path_size = g_path.size();
+        g_path += "/" + name;
+        m_index = m_sink->size();
+        m_sink->push_back({ name, g_path, g_depth++ });
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedEvent::~ScopedEvent()
+{
+    m_command_list.EndEvent();
+    if (m_sink) {
+        (*m_sink)[m_index].cpu_ms = ElapsedMs(m_start, std::chrono::steady_clock::now());
+        g_path.resize(m_parent_path_size);
+        --g_depth;
+    }
+}
+
+void ScopedEvent::SetSink(std::vector<ProfileEvent>* sink)
+{
+    g_sink = sink;
+    g_depth = 0;
+    g_path.clear();
+}
+
+GpuProfiler::GpuProfiler(RenderDevice& device)
+    : m_device(device)
+    , m_thread(&GpuProfiler::WatcherLoop, this)
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+void GpuProfiler::AddFrame(std::vector<std::vector<ProfileEvent>> events,
+                           std::vector<uint64_t> fence_values,
+                           std::chrono::steady_clock::time_point submit_time,
+                           std::optional<uint64_t> frame_index)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back({ std::move(events), std::move(fence_values), submit_time, frame_index });
+        ++m_unresolved_count;
+    }
+    m_condition.notify_one();
+}
+
+void GpuProfiler::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_resolved.wait(lock, [&] { return m_unresolved_count == 0; });
+}
+
+std::map<uint64_t, double> GpuProfiler::TakeFrameTimes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::move(m_frame_times);
+}
+
+void GpuProfiler::WatcherLoop()
+{
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&] { return m_stop || !m_pending.empty(); });
+            if (m_stop) {
+                return;
+            }
+            frame = std::move(m_pending.front());
+            m_pending.pop_front();
+        }
+
+        // The GPU may have been idle between the previous frame and this submission.
+        std::chrono::steady_clock::time_point prev = std::max(m_last_completion, frame.submit_time);
+        std::chrono::steady_clock::time_point frame_start = prev;
+        std::vector<ProfileEvent> resolved;
+        for (size_t i = 0; i < frame.fence_values.size(); ++i) {
+            m_device.Wait(frame.fence_values[i]);
+            std::chrono::steady_clock::time_point completion = std::chrono::steady_clock::now();
+            if (!frame.events[i].empty()) {
+                frame.events[i].front().gpu_ms = ElapsedMs(prev, completion);
+            }
+            resolved.insert(resolved.end(), frame.events[i].begin(), frame.events[i].end());
+            prev = completion;
+        }
+        m_last_completion = prev;
+
+        // Several passes may have the same name, e.g. one irradiance conversion per probe.
+        std::map<std::string, size_t> repeats;
+        for (auto& event : resolved) {
+            size_t repeat = repeats[event.path]++;
+            if (repeat) {
+                event.path += "#" + std::to_string(repeat);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (frame.frame_index) {
+                m_frame_times[*frame.frame_index] = ElapsedMs(frame_start, prev);
+            }
+            if (!resolved.empty()) {
+                m_history.push_back(std::move(resolved));
+                if (m_history.size() > kHistorySize) {
+                    m_history.pop_front();
+                }
+            }
+            --m_unresolved_count;
+        }
+        m_resolved.notify_all();
+    }
+}
+
+std::vector<ProfileEvent> GpuProfiler::GetAverages() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_history.empty()) {
+        return {};
+    }
+
+    struct Sum {
+        double cpu_ms = 0;
+        double gpu_ms = 0;
+        size_t count = 0;
+        size_t gpu_count = 0;
+    };
+    std::map<std::string, Sum> sums;
+    for (const auto& frame : m_history) {
+        for (const auto& event : frame) {
+            auto& sum = sums[event.path];
+            sum.cpu_ms += event.cpu_ms;
+            ++sum.count;
+            if (event.gpu_ms >= 0) {
+                sum.gpu_ms += event.gpu_ms;
+                ++sum.gpu_count;
+            }
+        }
+    }
+
+    std::vector<ProfileEvent> res = m_history.back();
+    for (auto& event : res) {
+        const auto& sum = sums[event.path];
+        event.cpu_ms = sum.cpu_ms / sum.count;
+        if (sum.gpu_count) {
+            event.gpu_ms = sum.gpu_ms / sum.gpu_count;
+        }
+    }
+    return res;
+}
+
+bool GpuProfiler::SaveJson(const std::string& path) const
+{
+    std::vector<ProfileEvent> events = GetAverages();
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::fixed << std::setprecision(4);
+    file << "{" << std::endl;
+    file << "  \"events\": [" << std::endl;
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& event = events[i];
+        file << "    { \"name\": \"" << EscapeJson(event.name) << "\", \"path\": \"" << EscapeJson(event.path)
+             << "\", \"depth\": " << event.depth << ", \"cpu_ms\": " << event.cpu_ms;
+        if (event.gpu_ms >= 0) {
+            file << ", \"gpu_ms\": " << event.gpu_ms;
+        }
+        file << " }" << (i + 1 < events.size() ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl;
+    file << "}" << std::endl;
+    return file.good();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "RenderDevice/RenderDevice.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProfileEvent {
+    std::string name;
+    // Names of the enclosing events and of the event joined with '/', the n-th repeat of a path within a frame
+    // gets "#n" appended. Results of different frames are matched by it.
+    std::string path;
+    uint32_t depth = 0;
+    double cpu_ms = 0;
+    // Only known for top level events, i.e. whole passes.
+    double gpu_ms = -1;
+};
+
+// Replaces a BeginEvent/EndEvent pair. While a pass is recorded with profiling enabled the event is also
+// appended to the events of that pass together with its recording time.
+class ScopedEvent {
+public:
+    ScopedEvent(RenderCommandList& command_list, const std::string& name);
+    ~ScopedEvent();
+
+    // Selects where events recorded on the calling thread go, nullptr disables collection.
+    static void SetSink(std::vector<ProfileEvent>* sink);
+
+private:
+    RenderCommandList& m_command_list;
+    std::vector<ProfileEvent>* m_sink;
+    size_t m_index = 0;
+    size_t m_parent_path_size = 0;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// RenderDevice has no timestamp queries, so passes are measured by submitting each of them separately and
+// watching their fences from a background thread. A pass' GPU time is the time between the completion of the
+// previous submission and its own, results become available a few frames later without stalling the frame.
+class GpuProfiler {
+public:
+    GpuProfiler(RenderDevice& device);
+    ~GpuProfiler();
+
+    // events[i] belong to the submission that signaled fence_values[i], events[i][0] is the pass itself. With a
+    // frame_index the GPU time of the whole frame is also kept until TakeFrameTimes.
+    void AddFrame(std::vector<std::vector<ProfileEvent>> events,
+                  std::vector<uint64_t> fence_values,
+                  std::chrono::steady_clock::time_point submit_time,
+                  std::optional<uint64_t> frame_index = {});
+    // Blocks until every added frame is resolved.
+    void Flush();
+    // GPU times of the resolved frames by frame_index, removed from the profiler.
+    std::map<uint64_t, double> TakeFrameTimes();
+    // Averages over the last resolved frames, in the order of the latest frame.
+    std::vector<ProfileEvent> GetAverages() const;
+    bool SaveJson(const std::string& path) const;
+
+private:
+    struct Frame {
+        std::vector<std::vector<ProfileEvent>> events;
+        std::vector<uint64_t> fence_values;
+        std::chrono::steady_clock::time_point submit_time;
+        std::optional<uint64_t> frame_index;
+    };
+
+    void WatcherLoop();
+
+    static constexpr size_t kHistorySize = 64;
+
+    RenderDevice& m_device;
+    std::deque<Frame> m_pending;
+    std::deque<std::vector<ProfileEvent>> m_history;
+    std::map<uint64_t, double> m_frame_times;
+    std::chrono::steady_clock::time_point m_last_completion;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_resolved;
+    size_t m_unresolved_count = 0;
+    bool m_stop = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,185 @@
+#include "IBLCache.h"
+
+#include "AssetCache/BinaryCache.h"
+#include "Utilities/FormatHelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+constexpr uint32_t kIBLCacheMagic = 0x42494253; // "SBIB"
+// Must be increased whenever the file layout or a pass writing cached data changes.
+constexpr uint32_t kIBLCacheVersion = 1;
+
+struct TextureLayout {
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t levels;
+};
+
+TextureLayout GetTextureLayout(Resource& texture)
+{
+    return { static_cast<uint32_t>(texture.GetFormat()), static_cast<uint32_t>(texture.GetWidth()),
+             texture.GetHeight(), texture.GetLayerCount(), texture.GetLevelCount() };
+}
+
+uint32_t GetLevelSize(uint32_t size, uint32_t level)
+{
+    return std::max(size >> level, 1u);
+}
+
+void GetLevelInfo(const TextureLayout& layout, uint32_t level, size_t& num_bytes, size_t& row_bytes)
+{
+    GetFormatInfo(GetLevelSize(layout.width, level), GetLevelSize(layout.height, level),
+                  static_cast<gli::format>(layout.format), num_bytes, row_bytes);
+}
+
+} // namespace
+
+IBLCache::IBLCache(const std::string& path, uint64_t key)
+    : m_path(path)
+    , m_key(key)
+{
+}
+
+bool IBLCache::Load(RenderDevice& device, const std::vector<std::shared_ptr<Resource>>& textures)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedFile file(m_path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+
+    BinaryReader reader(file.GetData(), file.GetSize());
+    if (reader.Read<uint32_t>() != kIBLCacheMagic || reader.Read<uint32_t>() != kIBLCacheVersion ||
+        reader.Read<uint64_t>() != m_key || reader.Read<uint64_t>() != textures.size()) {
+        return false;
+    }
+
+    // Everything is validated before the first upload is recorded, so a damaged cache leaves the textures unbaked.
+    // Levels are stored layer by layer, which is the subresource order.
+    std::vector<std::vector<const uint8_t*>> subresources(textures.size());
+    bool valid = true;
+    for (size_t i = 0; i < textures.size() && valid && !reader.HasError(); ++i) {
+        TextureLayout layout = GetTextureLayout(*textures[i]);
+        TextureLayout cached = reader.Read<TextureLayout>();
+        if (std::memcmp(&layout, &cached, sizeof(layout)) != 0) {
+            return false;
+        }
+        for (uint32_t layer = 0; layer < layout.layers; ++layer) {
+            for (uint32_t level = 0; level < layout.levels; ++level) {
+                size_t num_bytes = 0;
+                size_t row_bytes = 0;
+                GetLevelInfo(layout, level, num_bytes, row_bytes);
+                size_t size = 0;
+                subresources[i].push_back(reader.ReadArray<uint8_t>(size));
+                valid &= size == num_bytes;
+            }
+        }
+    }
+    if (!valid || reader.HasError() || !reader.IsEnd()) {
+        std::cerr << "IBL cache " << m_path << " is damaged, it will be rebuilt" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<RenderCommandList> command_list = device.CreateRenderCommandList();
+    for (size_t i = 0; i < textures.size(); ++i) {
+        TextureLayout layout = GetTextureLayout(*textures[i]);
+        for (uint32_t layer = 0; layer < layout.layers; ++layer) {
+            for (uint32_t level = 0; level < layout.levels; ++level) {
+                size_t num_bytes = 0;
+                size_t row_bytes = 0;
+                GetLevelInfo(layout, level, num_bytes, row_bytes);
+                uint32_t subresource = layer * layout.levels + level;
+                command_list->UpdateSubresource(textures[i], subresource, subresources[i][subresource], row_bytes,
+                                                num_bytes);
+            }
+        }
+    }
+    command_list->Close();
+    device.ExecuteCommandLists({ command_list });
+    device.Wait(command_list->GetFenceValue());
+
+    std::cout << "IBL: restored from the cache in " << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms"
+              << std::endl;
+    return true;
+}
+
+void IBLCache::Save(RenderDevice& device, const std::vector<std::shared_ptr<Resource>>& textures)
+{
+    struct LevelLayout {
+        uint64_t offset;
+        uint32_t row_pitch;
+        size_t row_bytes;
+        size_t num_bytes;
+    };
+
+    std::vector<std::shared_ptr<Resource>> readbacks;
+    std::vector<std::vector<LevelLayout>> layouts;
+    std::shared_ptr<RenderCommandList> command_list = device.CreateRenderCommandList();
+    for (const auto& texture : textures) {
+        TextureLayout layout = GetTextureLayout(*texture);
+        auto& texture_layouts = layouts.emplace_back();
+        std::vector<BufferToTextureCopyRegion> regions;
+        uint64_t size = 0;
+        for (uint32_t layer = 0; layer < layout.layers; ++layer) {
+            for (uint32_t level = 0; level < layout.levels; ++level) {
+                // D3D12 requires 512 byte aligned placements and 256 byte aligned rows for texture to buffer copies.
+                LevelLayout level_layout = {};
+                GetLevelInfo(layout, level, level_layout.num_bytes, level_layout.row_bytes);
+                level_layout.offset = (size + 511) & ~511ull;
+                level_layout.row_pitch = static_cast<uint32_t>((level_layout.row_bytes + 255) & ~255ull);
+                size = level_layout.offset +
+                       level_layout.row_pitch * (level_layout.num_bytes / level_layout.row_bytes);
+                texture_layouts.push_back(level_layout);
+
+                BufferToTextureCopyRegion region = {};
+                region.buffer_offset = level_layout.offset;
+                region.buffer_row_pitch = level_layout.row_pitch;
+                region.texture_mip_level = level;
+                region.texture_array_layer = layer;
+                region.texture_extent = { GetLevelSize(layout.width, level), GetLevelSize(layout.height, level), 1 };
+                regions.push_back(region);
+            }
+        }
+        readbacks.emplace_back(device.CreateBuffer(BindFlag::kCopyDest, size, MemoryType::kReadback));
+        command_list->CopyTextureToBuffer(texture, readbacks.back(), regions);
+    }
+    command_list->Close();
+    device.ExecuteCommandLists({ command_list });
+    device.WaitForIdle();
+
+    BinaryWriter writer;
+    writer.Write(kIBLCacheMagic);
+    writer.Write(kIBLCacheVersion);
+    writer.Write(m_key);
+    writer.Write<uint64_t>(textures.size());
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        writer.Write(GetTextureLayout(*textures[i]));
+        const uint8_t* mapped = readbacks[i]->Map();
+        for (const LevelLayout& level_layout : layouts[i]) {
+            data.resize(level_layout.num_bytes);
+            for (size_t row = 0; row < level_layout.num_bytes / level_layout.row_bytes; ++row) {
+                std::memcpy(data.data() + row * level_layout.row_bytes,
+                            mapped + level_layout.offset + row * level_layout.row_pitch, level_layout.row_bytes);
+            }
+            writer.WriteArray(data);
+        }
+        readbacks[i]->Unmap();
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), ec);
+    if (!writer.Save(m_path)) {
+        std::cerr << "Failed to save IBL cache " << m_path << std::endl;
+    }
+}
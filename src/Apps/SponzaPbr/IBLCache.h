@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Device/Device.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The bake of the last configuration the app ran with, next to the scene caches.
+constexpr char kIBLCachePath[] = ASSETS_PATH "cache/scene.iblcache";
+
+// Baked image based lighting in one file: every level of every layer of the given textures, which are the BRDF LUT,
+// the environment cubemap, the probe captures of IBLCompute and the irradiance and prefiltered cubemaps. The key
+// is built by the caller from everything the bake reads, see Scene::GetIBLCacheKey. A cache is used only if the key
+// matches and every texture still has the format and size it was written with.
+class IBLCache {
+public:
+    IBLCache(const std::string& path, uint64_t key);
+
+    // Uploads the cached levels into textures and waits for the device. Returns false if the cache is missing,
+    // stale or damaged, the textures are left untouched then.
+    bool Load(RenderDevice& device, const std::vector<std::shared_ptr<Resource>>& textures);
+    // Reads textures back and writes the cache. The bake must be submitted, this waits for the device.
+    void Save(RenderDevice& device, const std::vector<std::shared_ptr<Resource>>& textures);
+
+private:
+    std::string m_path;
+    uint64_t m_key;
+};
@@ -1,13 +1,46 @@
 #include "IBLCompute.h"
 
+#include "RenderGraph.h"
+#include "TextureData.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
+namespace {
+
+template <typename Program>
+void SetCubeViewProjection(Program& program, const glm::vec3& position, float s_near, float s_far)
+{
+    glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 Down = glm::vec3(0.0f, -1.0f, 0.0f);
+    glm::vec3 Left = glm::vec3(-1.0f, 0.0f, 0.0f);
+    glm::vec3 Right = glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 ForwardRH = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 ForwardLH = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 BackwardRH = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 BackwardLH = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    program.vs.cbuffer.ConstantBuf.Projection =
+        glm::transpose(glm::perspective(glm::radians(90.0f), 1.0f, s_near, s_far));
+
+    std::array<glm::mat4, 6>& view = program.vs.cbuffer.ConstantBuf.View;
+    view[0] = glm::transpose(glm::lookAt(position, position + Right, Up));
+    view[1] = glm::transpose(glm::lookAt(position, position + Left, Up));
+    view[2] = glm::transpose(glm::lookAt(position, position + Up, BackwardRH));
+    view[3] = glm::transpose(glm::lookAt(position, position + Down, ForwardRH));
+    view[4] = glm::transpose(glm::lookAt(position, position + BackwardLH, Up));
+    view[5] = glm::transpose(glm::lookAt(position, position + ForwardLH, Up));
+}
+
+} // namespace
+
 IBLCompute::IBLCompute(RenderDevice& device, const Input& input)
     : m_device(device)
     , m_input(input)
     , m_program(device)
     , m_program_pre_pass(device)
+    , m_program_packed(device)
+    , m_program_pre_pass_packed(device)
     , m_program_backgroud(device)
     , m_program_downsample(device)
 {
@@ -22,21 +55,48 @@ IBLCompute::IBLCompute(RenderDevice& device, const Input& input)
         SamplerTextureAddressMode::kClamp,
         SamplerComparisonFunc::kLess,
     });
+
+    for (size_t i = 0;; ++i) {
+        if ((m_size >> i) % 8 != 0) {
+            break;
+        }
+        ++m_texture_mips;
+    }
+}
+
+void IBLCompute::CreateProbeTargets()
+{
+    for (auto& ibl_model : m_input.scene_list) {
+        if (!ibl_model.ibl_request || ibl_model.ibl_rtv) {
+            continue;
+        }
+
+        ibl_model.ibl_rtv = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource |
+                                                       BindFlag::kUnorderedAccess | BindFlag::kCopySource |
+                                                       BindFlag::kCopyDest,
+                                                   gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_size, m_size, 6,
+                                                   m_texture_mips);
+        ibl_model.ibl_dsv = m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1,
+                                                   m_size, m_size, 6);
+        m_pending_models.emplace_back(ibl_model);
+    }
 }
 
 void IBLCompute::OnUpdate()
 {
+    CreateProbeTargets();
+
     glm::vec3 camera_position = m_input.camera.GetCameraPos();
     m_program.ps.cbuffer.Light.viewPos = camera_position;
 
-    m_program.ps.cbuffer.ShadowParams.s_near = m_settings.Get<float>("s_near");
-    m_program.ps.cbuffer.ShadowParams.s_far = m_settings.Get<float>("s_far");
-    m_program.ps.cbuffer.ShadowParams.s_size = m_settings.Get<float>("s_size");
-    m_program.ps.cbuffer.ShadowParams.use_shadow = m_settings.Get<bool>("use_shadow");
+    m_program.ps.cbuffer.ShadowParams.s_near = m_settings.s_near;
+    m_program.ps.cbuffer.ShadowParams.s_far = m_settings.s_far;
+    m_program.ps.cbuffer.ShadowParams.s_size = m_settings.s_size;
+    m_program.ps.cbuffer.ShadowParams.use_shadow = m_settings.use_shadow;
     m_program.ps.cbuffer.ShadowParams.shadow_light_pos = m_input.light_pos;
 
-    m_program.ps.cbuffer.Settings.ambient_power = m_settings.Get<float>("ambient_power");
-    m_program.ps.cbuffer.Settings.light_power = m_settings.Get<float>("light_power");
+    m_program.ps.cbuffer.Settings.ambient_power = m_settings.ambient_power;
+    m_program.ps.cbuffer.Settings.light_power = m_settings.light_power;
 
     m_program.ps.cbuffer.Light.use_light = m_use_pre_pass;
 
@@ -45,13 +105,13 @@ void IBLCompute::OnUpdate()
         m_program.ps.cbuffer.Light.light_color[i] = glm::vec4(0);
     }
 
-    if (m_settings.Get<bool>("light_in_camera")) {
+    if (m_settings.light_in_camera) {
         m_program.ps.cbuffer.Light.light_pos[0] = glm::vec4(camera_position, 0);
         m_program.ps.cbuffer.Light.light_color[0] = glm::vec4(1, 1, 1, 0.0);
     }
-    if (m_settings.Get<bool>("additional_lights")) {
+    if (m_settings.additional_lights) {
         int i = 0;
-        if (m_settings.Get<bool>("light_in_camera")) {
+        if (m_settings.light_in_camera) {
             ++i;
         }
         for (int x = -13; x <= 13; ++x) {
@@ -60,7 +120,7 @@ void IBLCompute::OnUpdate()
                 if (i < std::size(m_program.ps.cbuffer.Light.light_pos)) {
                     m_program.ps.cbuffer.Light.light_pos[i] = glm::vec4(x, 1.5, z - 0.33, 0);
                     float color = 0.0;
-                    if (m_settings.Get<bool>("use_white_ligth")) {
+                    if (m_settings.use_white_ligth) {
                         color = 1;
                     }
                     m_program.ps.cbuffer.Light.light_color[i] =
@@ -71,151 +131,62 @@ void IBLCompute::OnUpdate()
             }
         }
     }
+
+    m_program_packed.ps.cbuffer.Light = m_program.ps.cbuffer.Light;
+    m_program_packed.ps.cbuffer.ShadowParams = m_program.ps.cbuffer.ShadowParams;
+    m_program_packed.ps.cbuffer.Settings = m_program.ps.cbuffer.Settings;
 }
 
 void IBLCompute::OnRender(RenderCommandList& command_list)
 {
     command_list.SetViewport(0, 0, m_size, m_size);
 
-    for (auto& ibl_model : m_input.scene_list) {
-        if (!ibl_model.ibl_request) {
-            continue;
-        }
-
-        size_t texture_mips = 0;
-        for (size_t i = 0;; ++i) {
-            if ((m_size >> i) % 8 != 0) {
-                break;
-            }
-            ++texture_mips;
-        }
-
-        if (!ibl_model.ibl_rtv) {
-            ibl_model.ibl_rtv =
-                m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kUnorderedAccess,
-                                       gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_size, m_size, 6, texture_mips);
-
-            ibl_model.ibl_dsv = m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32,
-                                                       1, m_size, m_size, 6);
-        } else {
-            continue;
-        }
-
+    for (auto& ibl_model : m_pending_models) {
         if (m_use_pre_pass) {
             DrawPrePass(command_list, ibl_model);
         }
         Draw(command_list, ibl_model);
         DrawBackgroud(command_list, ibl_model);
-        DrawDownSample(command_list, ibl_model, texture_mips);
+        DrawDownSample(command_list, ibl_model);
     }
+    m_pending_models.clear();
 }
 
-void IBLCompute::DrawPrePass(RenderCommandList& command_list, Model& ibl_model)
+LodSelector IBLCompute::CreateLodSelector(const Model& ibl_model) const
 {
-    command_list.UseProgram(m_program_pre_pass);
-    command_list.Attach(m_program_pre_pass.vs.cbv.ConstantBuf, m_program_pre_pass.vs.cbuffer.ConstantBuf);
-
-    command_list.Attach(m_program_pre_pass.ps.sampler.g_sampler, m_sampler);
-
-    glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
-    glm::vec3 Down = glm::vec3(0.0f, -1.0f, 0.0f);
-    glm::vec3 Left = glm::vec3(-1.0f, 0.0f, 0.0f);
-    glm::vec3 Right = glm::vec3(1.0f, 0.0f, 0.0f);
-    glm::vec3 ForwardRH = glm::vec3(0.0f, 0.0f, -1.0f);
-    glm::vec3 ForwardLH = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 BackwardRH = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 BackwardLH = glm::vec3(0.0f, 0.0f, -1.0f);
-
-    m_program_pre_pass.vs.cbuffer.ConstantBuf.Projection = glm::transpose(
-        glm::perspective(glm::radians(90.0f), 1.0f, m_settings.Get<float>("s_near"), m_settings.Get<float>("s_far")));
+    // The pre-pass and the color pass must select the same LODs for the depth test to match. The faces have a
+    // 90 degree field of view, so the projection scale is 1.
+    glm::vec3 position = glm::vec3(ibl_model.matrix * glm::vec4(ibl_model.model_center, 1.0));
+    return LodSelector(m_input.lods, m_input.range_bounds, m_settings.use_lod, position, 1.0f, m_settings.lod_bias);
+}
 
+void IBLCompute::DrawPrePass(RenderCommandList& command_list, Model& ibl_model)
+{
     glm::vec3 position = glm::vec3(ibl_model.matrix * glm::vec4(ibl_model.model_center, 1.0));
-    std::array<glm::mat4, 6>& view = m_program_pre_pass.vs.cbuffer.ConstantBuf.View;
-    view[0] = glm::transpose(glm::lookAt(position, position + Right, Up));
-    view[1] = glm::transpose(glm::lookAt(position, position + Left, Up));
-    view[2] = glm::transpose(glm::lookAt(position, position + Up, BackwardRH));
-    view[3] = glm::transpose(glm::lookAt(position, position + Down, ForwardRH));
-    view[4] = glm::transpose(glm::lookAt(position, position + BackwardLH, Up));
-    view[5] = glm::transpose(glm::lookAt(position, position + ForwardLH, Up));
+    SetCubeViewProjection(m_program_pre_pass, position, m_settings.s_near, m_settings.s_far);
+    SetCubeViewProjection(m_program_pre_pass_packed, position, m_settings.s_near, m_settings.s_far);
 
     RenderPassBeginDesc render_pass_desc = {};
     render_pass_desc.depth_stencil.texture = ibl_model.ibl_dsv;
     render_pass_desc.depth_stencil.clear_depth = 1.0f;
 
-    for (auto& model : m_input.scene_list) {
-        if (&ibl_model == &model) {
-            continue;
-        }
-        model.bones.UpdateAnimation(m_device, command_list, glfwGetTime());
-    }
-
+    LodSelector lods = CreateLodSelector(ibl_model);
     command_list.BeginRenderPass(render_pass_desc);
-    for (auto& model : m_input.scene_list) {
-        if (&ibl_model == &model) {
-            continue;
-        }
-
-        m_program_pre_pass.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
-        m_program_pre_pass.vs.cbuffer.ConstantBuf.normalMatrix =
-            glm::transpose(glm::transpose(glm::inverse(model.matrix)));
-
-        std::shared_ptr<Resource> bones_info_srv = model.bones.GetBonesInfo();
-        std::shared_ptr<Resource> bone_srv = model.bones.GetBone();
-
-        /*command_list.Attach(m_program_pre_pass.vs.srv.bone_info, bones_info_srv);
-        command_list.Attach(m_program_pre_pass.vs.srv.gBones, bone_srv);*/
-
-        model.ia.indices.Bind(command_list);
-        model.ia.positions.BindToSlot(command_list, m_program_pre_pass.vs.ia.POSITION);
-        model.ia.normals.BindToSlot(command_list, m_program_pre_pass.vs.ia.NORMAL);
-        model.ia.texcoords.BindToSlot(command_list, m_program_pre_pass.vs.ia.TEXCOORD);
-        model.ia.tangents.BindToSlot(command_list, m_program_pre_pass.vs.ia.TANGENT);
-        /*model.ia.bones_offset.BindToSlot(command_list, m_program_pre_pass.vs.ia.BONES_OFFSET);
-        model.ia.bones_count.BindToSlot(command_list, m_program_pre_pass.vs.ia.BONES_COUNT);*/
-
-        for (auto& range : model.ia.ranges) {
-            auto& material = model.GetMaterial(range.id);
-            command_list.Attach(m_program_pre_pass.ps.srv.alphaMap, material.texture.opacity);
-            command_list.DrawIndexed(range.index_count, 6, range.start_index_location, range.base_vertex_location, 0);
-        }
+    DrawPrePassModels(command_list, m_program_pre_pass, ibl_model, lods);
+    if (m_settings.use_packed_vertices) {
+        DrawPrePassModels(command_list, m_program_pre_pass_packed, ibl_model, lods);
     }
     command_list.EndRenderPass();
 }
 
 void IBLCompute::Draw(RenderCommandList& command_list, Model& ibl_model)
 {
-    command_list.UseProgram(m_program);
-    command_list.Attach(m_program.vs.cbv.ConstantBuf, m_program.vs.cbuffer.ConstantBuf);
-    command_list.Attach(m_program.ps.cbv.Light, m_program.ps.cbuffer.Light);
-    command_list.Attach(m_program.ps.cbv.ShadowParams, m_program.ps.cbuffer.ShadowParams);
-    command_list.Attach(m_program.ps.cbv.Settings, m_program.ps.cbuffer.Settings);
-
-    command_list.Attach(m_program.ps.sampler.g_sampler, m_sampler);
-    command_list.Attach(m_program.ps.sampler.LightCubeShadowComparsionSampler, m_compare_sampler);
-
-    glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
-    glm::vec3 Down = glm::vec3(0.0f, -1.0f, 0.0f);
-    glm::vec3 Left = glm::vec3(-1.0f, 0.0f, 0.0f);
-    glm::vec3 Right = glm::vec3(1.0f, 0.0f, 0.0f);
-    glm::vec3 ForwardRH = glm::vec3(0.0f, 0.0f, -1.0f);
-    glm::vec3 ForwardLH = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 BackwardRH = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 BackwardLH = glm::vec3(0.0f, 0.0f, -1.0f);
-
-    m_program.vs.cbuffer.ConstantBuf.Projection = glm::transpose(
-        glm::perspective(glm::radians(90.0f), 1.0f, m_settings.Get<float>("s_near"), m_settings.Get<float>("s_far")));
+    glm::vec3 position = glm::vec3(ibl_model.matrix * glm::vec4(ibl_model.model_center, 1.0));
+    SetCubeViewProjection(m_program, position, m_settings.s_near, m_settings.s_far);
+    SetCubeViewProjection(m_program_packed, position, m_settings.s_near, m_settings.s_far);
 
     glm::vec4 color = { 0.0f, 0.0f, 0.0f, 1.0f };
 
-    glm::vec3 position = glm::vec3(ibl_model.matrix * glm::vec4(ibl_model.model_center, 1.0));
-    std::array<glm::mat4, 6>& view = m_program.vs.cbuffer.ConstantBuf.View;
-    view[0] = glm::transpose(glm::lookAt(position, position + Right, Up));
-    view[1] = glm::transpose(glm::lookAt(position, position + Left, Up));
-    view[2] = glm::transpose(glm::lookAt(position, position + Up, BackwardRH));
-    view[3] = glm::transpose(glm::lookAt(position, position + Down, ForwardRH));
-    view[4] = glm::transpose(glm::lookAt(position, position + BackwardLH, Up));
-    view[5] = glm::transpose(glm::lookAt(position, position + ForwardLH, Up));
-
     RenderPassBeginDesc render_pass_desc = {};
     render_pass_desc.colors[m_program.ps.om.rtv0].texture = ibl_model.ibl_rtv;
     render_pass_desc.colors[m_program.ps.om.rtv0].view_desc.count = 1;
@@ -229,57 +200,129 @@ void IBLCompute::Draw(RenderCommandList& command_list, Model& ibl_model)
         render_pass_desc.depth_stencil.clear_depth = 1.0f;
     }
 
+    LodSelector lods = CreateLodSelector(ibl_model);
+    command_list.BeginRenderPass(render_pass_desc);
+    DrawModels(command_list, m_program, ibl_model, lods);
+    if (m_settings.use_packed_vertices) {
+        DrawModels(command_list, m_program_packed, ibl_model, lods);
+    }
+    command_list.EndRenderPass();
+}
+
+bool IBLCompute::UsePackedVertices(size_t model_id) const
+{
+    return m_settings.use_packed_vertices && HasPackedVertices(m_input.packed_vertices, model_id);
+}
+
+template <typename Program>
+void IBLCompute::DrawPrePassModels(RenderCommandList& command_list,
+                                   Program& program,
+                                   Model& ibl_model,
+                                   const LodSelector& lods)
+{
+    constexpr bool packed = IsPackedProgram<Program>::value;
+
+    command_list.UseProgram(program);
+    command_list.Attach(program.vs.cbv.ConstantBuf, program.vs.cbuffer.ConstantBuf);
+
+    command_list.Attach(program.ps.sampler.g_sampler, m_sampler);
+
+    size_t model_id = 0;
     for (auto& model : m_input.scene_list) {
-        if (&ibl_model == &model) {
+        size_t cur_model_id = model_id++;
+        if (&ibl_model == &model || UsePackedVertices(cur_model_id) != packed) {
             continue;
         }
-        model.bones.UpdateAnimation(m_device, command_list, glfwGetTime());
+
+        program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+        program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+        AttachInstances(command_list, program, m_input.instances, cur_model_id);
+        uint32_t instance_count = 6 * GetInstanceCount(m_input.instances, cur_model_id);
+
+        lods.BindIndices(command_list, cur_model_id, model);
+        if constexpr (packed) {
+            AttachPackedVertices(command_list, program, m_input.packed_vertices[cur_model_id]);
+        } else {
+            model.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
+            model.ia.normals.BindToSlot(command_list, program.vs.ia.NORMAL);
+            model.ia.texcoords.BindToSlot(command_list, program.vs.ia.TEXCOORD);
+            model.ia.tangents.BindToSlot(command_list, program.vs.ia.TANGENT);
+        }
+
+        for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+            auto& range = model.ia.ranges[range_id];
+            auto& material = model.GetMaterial(range.id);
+            command_list.Attach(program.ps.srv.alphaMap, material.texture.opacity);
+            RangeLod lod = lods.GetRange(cur_model_id, model, range_id);
+            DrawRange(command_list, program, m_input.packed_vertices, cur_model_id, range_id,
+                      range.base_vertex_location, lod, instance_count);
+        }
     }
+}
 
-    command_list.BeginRenderPass(render_pass_desc);
+template <typename Program>
+void IBLCompute::DrawModels(RenderCommandList& command_list,
+                            Program& program,
+                            Model& ibl_model,
+                            const LodSelector& lods)
+{
+    constexpr bool packed = IsPackedProgram<Program>::value;
+
+    command_list.UseProgram(program);
+    command_list.Attach(program.vs.cbv.ConstantBuf, program.vs.cbuffer.ConstantBuf);
+    command_list.Attach(program.ps.cbv.Light, program.ps.cbuffer.Light);
+    command_list.Attach(program.ps.cbv.ShadowParams, program.ps.cbuffer.ShadowParams);
+    command_list.Attach(program.ps.cbv.Settings, program.ps.cbuffer.Settings);
+
+    command_list.Attach(program.ps.sampler.g_sampler, m_sampler);
+    command_list.Attach(program.ps.sampler.LightCubeShadowComparsionSampler, m_compare_sampler);
+
+    size_t model_id = 0;
     for (auto& model : m_input.scene_list) {
-        if (&ibl_model == &model) {
+        size_t cur_model_id = model_id++;
+        if (&ibl_model == &model || UsePackedVertices(cur_model_id) != packed) {
             continue;
         }
 
-        m_program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
-        m_program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+        program.vs.cbuffer.ConstantBuf.model = glm::transpose(model.matrix);
+        program.vs.cbuffer.ConstantBuf.normalMatrix = glm::transpose(glm::transpose(glm::inverse(model.matrix)));
+        AttachInstances(command_list, program, m_input.instances, cur_model_id);
+        uint32_t instance_count = 6 * GetInstanceCount(m_input.instances, cur_model_id);
 
-        std::shared_ptr<Resource> bones_info_srv = model.bones.GetBonesInfo();
-        std::shared_ptr<Resource> bone_srv = model.bones.GetBone();
-
-        /*command_list.Attach(m_program.vs.srv.bone_info, bones_info_srv);
-        command_list.Attach(m_program.vs.srv.gBones, bone_srv);*/
-
-        model.ia.indices.Bind(command_list);
-        model.ia.positions.BindToSlot(command_list, m_program.vs.ia.POSITION);
-        model.ia.normals.BindToSlot(command_list, m_program.vs.ia.NORMAL);
-        model.ia.texcoords.BindToSlot(command_list, m_program.vs.ia.TEXCOORD);
-        model.ia.tangents.BindToSlot(command_list, m_program.vs.ia.TANGENT);
-        /*model.ia.bones_offset.BindToSlot(command_list, m_program.vs.ia.BONES_OFFSET);
-        model.ia.bones_count.BindToSlot(command_list, m_program.vs.ia.BONES_COUNT);*/
+        lods.BindIndices(command_list, cur_model_id, model);
+        if constexpr (packed) {
+            AttachPackedVertices(command_list, program, m_input.packed_vertices[cur_model_id]);
+        } else {
+            model.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
+            model.ia.normals.BindToSlot(command_list, program.vs.ia.NORMAL);
+            model.ia.texcoords.BindToSlot(command_list, program.vs.ia.TEXCOORD);
+            model.ia.tangents.BindToSlot(command_list, program.vs.ia.TANGENT);
+        }
 
-        for (auto& range : model.ia.ranges) {
+        for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+            auto& range = model.ia.ranges[range_id];
             auto& material = model.GetMaterial(range.id);
 
-            m_program.ps.cbuffer.Settings.use_normal_mapping =
-                material.texture.normal && m_settings.Get<bool>("normal_mapping");
-            m_program.ps.cbuffer.Settings.use_gloss_instead_of_roughness =
+            program.ps.cbuffer.Settings.use_normal_mapping = material.texture.normal && m_settings.normal_mapping;
+            program.ps.cbuffer.Settings.use_gloss_instead_of_roughness =
                 material.texture.glossiness && !material.texture.roughness;
-            m_program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.Get<bool>("use_flip_normal_y");
-
-            command_list.Attach(m_program.ps.srv.normalMap, material.texture.normal);
-            command_list.Attach(m_program.ps.srv.albedoMap, material.texture.albedo);
-            command_list.Attach(m_program.ps.srv.roughnessMap, material.texture.roughness);
-            command_list.Attach(m_program.ps.srv.metalnessMap, material.texture.metalness);
-            command_list.Attach(m_program.ps.srv.aoMap, material.texture.occlusion);
-            command_list.Attach(m_program.ps.srv.alphaMap, material.texture.opacity);
-            command_list.Attach(m_program.ps.srv.LightCubeShadowMap, m_input.shadow_pass.srv);
-
-            command_list.DrawIndexed(range.index_count, 6, range.start_index_location, range.base_vertex_location, 0);
+            program.ps.cbuffer.Settings.use_flip_normal_y = m_settings.use_flip_normal_y;
+            program.ps.cbuffer.Settings.use_packed_normal =
+                material.texture.normal && IsPackedNormalFormat(material.texture.normal->GetFormat());
+
+            command_list.Attach(program.ps.srv.normalMap, material.texture.normal);
+            command_list.Attach(program.ps.srv.albedoMap, material.texture.albedo);
+            command_list.Attach(program.ps.srv.roughnessMap, material.texture.roughness);
+            command_list.Attach(program.ps.srv.metalnessMap, material.texture.metalness);
+            command_list.Attach(program.ps.srv.aoMap, material.texture.occlusion);
+            command_list.Attach(program.ps.srv.alphaMap, material.texture.opacity);
+            command_list.Attach(program.ps.srv.LightCubeShadowMap, m_input.shadow_pass.srv);
+
+            RangeLod lod = lods.GetRange(cur_model_id, model, range_id);
+            DrawRange(command_list, program, m_input.packed_vertices, cur_model_id, range_id,
+                      range.base_vertex_location, lod, instance_count);
         }
     }
-    command_list.EndRenderPass();
 }
 
 void IBLCompute::DrawBackgroud(RenderCommandList& command_list, Model& ibl_model)
@@ -325,7 +368,7 @@ void IBLCompute::DrawBackgroud(RenderCommandList& command_list, Model& ibl_model
         m_program_backgroud.vs.cbuffer.ConstantBuf.face = i;
         m_program_backgroud.vs.cbuffer.ConstantBuf.view = glm::transpose(capture_views[i]);
         m_program_backgroud.vs.cbuffer.ConstantBuf.projection = glm::transpose(glm::perspective(
-            glm::radians(90.0f), 1.0f, m_settings.Get<float>("s_near"), m_settings.Get<float>("s_far")));
+            glm::radians(90.0f), 1.0f, m_settings.s_near, m_settings.s_far));
 
         for (auto& range : m_input.model_cube.ia.ranges) {
             command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location, 0);
@@ -334,17 +377,44 @@ void IBLCompute::DrawBackgroud(RenderCommandList& command_list, Model& ibl_model
     command_list.EndRenderPass();
 }
 
-void IBLCompute::DrawDownSample(RenderCommandList& command_list, Model& ibl_model, size_t texture_mips)
+void IBLCompute::DrawDownSample(RenderCommandList& command_list, Model& ibl_model)
 {
     command_list.UseProgram(m_program_downsample);
-    for (size_t i = 1; i < texture_mips; ++i) {
+    for (size_t i = 1; i < m_texture_mips; ++i) {
         command_list.Attach(m_program_downsample.cs.srv.inputTexture, ibl_model.ibl_rtv, { i - 1, 1 });
         command_list.Attach(m_program_downsample.cs.uav.outputTexture, ibl_model.ibl_rtv, { i, 1 });
         command_list.Dispatch((m_size >> i) / 8, (m_size >> i) / 8, 6);
     }
 }
 
-void IBLCompute::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask IBLCompute::GetSponzaSettingsSubscription() const
+{
+    return {
+        SponzaSetting::s_near, SponzaSetting::s_far, SponzaSetting::s_size, SponzaSetting::use_shadow,
+        SponzaSetting::ambient_power, SponzaSetting::light_power, SponzaSetting::light_in_camera,
+        SponzaSetting::additional_lights, SponzaSetting::use_white_ligth, SponzaSetting::normal_mapping,
+        SponzaSetting::use_flip_normal_y, SponzaSetting::use_lod, SponzaSetting::lod_bias,
+        SponzaSetting::use_packed_vertices
+    };
+}
+
+void IBLCompute::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
     m_settings = settings;
 }
+
+void IBLCompute::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.AllowParallelRecording();
+    bool has_pending_capture = !m_pending_models.empty();
+    for (auto& model : m_input.scene_list) {
+        if (model.ibl_request) {
+            has_pending_capture |= !model.ibl_rtv;
+            builder.Write(model.ibl_rtv);
+        }
+    }
+    if (has_pending_capture) {
+        builder.Read(m_input.shadow_pass.srv);
+        builder.Read(m_input.environment);
+    }
+}
@@ -6,10 +6,15 @@
 #include "ProgramRef/Background_PS.h"
 #include "ProgramRef/Background_VS.h"
 #include "ProgramRef/DownSample_CS.h"
+#include "PackedVertices.h"
+#include "ProgramRef/IBLComputePacked_VS.h"
 #include "ProgramRef/IBLComputePrePass_PS.h"
 #include "ProgramRef/IBLCompute_PS.h"
 #include "ProgramRef/IBLCompute_VS.h"
 #include "RenderPass.h"
+#include "SceneBounds.h"
+#include "SceneInstances.h"
+#include "SceneLods.h"
 #include "ShadowPass.h"
 #include "SponzaSettings.h"
 
@@ -25,6 +30,10 @@ public:
         glm::vec3& light_pos;
         Model& model_cube;
         std::shared_ptr<Resource>& environment;
+        const ModelRangeBounds& range_bounds;
+        const SceneLods& lods;
+        const ScenePackedVertices& packed_vertices;
+        const SceneInstances& instances;
     };
 
     struct Output {
@@ -32,25 +41,48 @@ public:
 
     IBLCompute(RenderDevice& device, const Input& input);
 
+    // Creates the capture targets of the models which request a probe and queues their captures, also done by
+    // OnUpdate. The targets can be filled from the IBL cache before MarkBaked drops the captures.
+    void CreateProbeTargets();
+    void MarkBaked()
+    {
+        m_pending_models.clear();
+    }
+
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
+    LodSelector CreateLodSelector(const Model& ibl_model) const;
     void DrawPrePass(RenderCommandList& command_list, Model& ibl_model);
     void Draw(RenderCommandList& command_list, Model& ibl_model);
+    // Draw the models whose vertex format matches the program, see IsPackedProgram.
+    template <typename Program>
+    void DrawPrePassModels(RenderCommandList& command_list, Program& program, Model& ibl_model,
+                           const LodSelector& lods);
+    template <typename Program>
+    void DrawModels(RenderCommandList& command_list, Program& program, Model& ibl_model, const LodSelector& lods);
+    bool UsePackedVertices(size_t model_id) const;
     void DrawBackgroud(RenderCommandList& command_list, Model& ibl_model);
-    void DrawDownSample(RenderCommandList& command_list, Model& ibl_model, size_t texture_mips);
-    SponzaSettings m_settings;
+    void DrawDownSample(RenderCommandList& command_list, Model& ibl_model);
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     ProgramHolder<IBLCompute_VS, IBLCompute_PS> m_program;
     ProgramHolder<IBLCompute_VS, IBLComputePrePass_PS> m_program_pre_pass;
+    ProgramHolder<IBLComputePacked_VS, IBLCompute_PS> m_program_packed;
+    ProgramHolder<IBLComputePacked_VS, IBLComputePrePass_PS> m_program_pre_pass_packed;
     ProgramHolder<Background_VS, Background_PS> m_program_backgroud;
     ProgramHolder<DownSample_CS> m_program_downsample;
     std::shared_ptr<Resource> m_dsv;
     std::shared_ptr<Resource> m_sampler;
     std::shared_ptr<Resource> m_compare_sampler;
     size_t m_size = 512;
+    size_t m_texture_mips = 0;
     bool m_use_pre_pass = true;
+    std::vector<std::reference_wrapper<Model>> m_pending_models;
 };
@@ -1,6 +1,7 @@
 #include "ImGuiPass.h"
 
 #include "Geometry/IABuffer.h"
+#include "RenderGraph.h"
 #include "Utilities/FormatHelper.h"
 
 #include <glm/glm.hpp>
@@ -50,17 +51,54 @@ ImGuiPass::~ImGuiPass()
     ImGui::DestroyContext();
 }
 
-void ImGuiPass::OnUpdate() {}
-
-void ImGuiPass::OnRender(RenderCommandList& command_list)
+void ImGuiPass::OnUpdate()
 {
-    if (glfwGetInputMode(m_window, GLFW_CURSOR) != GLFW_CURSOR_NORMAL) {
+    m_is_visible = glfwGetInputMode(m_window, GLFW_CURSOR) == GLFW_CURSOR_NORMAL;
+    if (!m_is_visible) {
         return;
     }
 
     m_imgui_settings.NewFrame();
+    if (m_input.settings.GetValues().use_gpu_profiler) {
+        DrawProfiler();
+    }
 
     ImGui::Render();
+}
+
+void ImGuiPass::DrawProfiler()
+{
+    ImGui::Begin("Profiler");
+    if (ImGui::Button("Save json")) {
+        m_input.profiler.SaveJson("SponzaPbr_profile.json");
+    }
+    ImGui::Columns(3);
+    ImGui::Text("Event");
+    ImGui::NextColumn();
+    ImGui::Text("CPU ms");
+    ImGui::NextColumn();
+    ImGui::Text("GPU ms");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& event : m_input.profiler.GetAverages()) {
+        ImGui::Text("%*s%s", static_cast<int>(event.depth * 2), "", event.name.c_str());
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", event.cpu_ms);
+        ImGui::NextColumn();
+        if (event.gpu_ms >= 0) {
+            ImGui::Text("%.3f", event.gpu_ms);
+        }
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
+void ImGuiPass::OnUpload(RenderCommandList& command_list)
+{
+    if (!m_is_visible) {
+        return;
+    }
 
     ImDrawData* draw_data = ImGui::GetDrawData();
 
@@ -84,12 +122,23 @@ void ImGuiPass::OnRender(RenderCommandList& command_list)
         }
     }
 
-    static uint32_t index = 0;
+    m_buffer_index = (m_buffer_index + 1) % m_positions_buffer.size();
+    uint32_t index = m_buffer_index;
     m_positions_buffer[index].reset(new IAVertexBuffer(m_device, command_list, positions));
     m_texcoords_buffer[index].reset(new IAVertexBuffer(m_device, command_list, texcoords));
     m_colors_buffer[index].reset(new IAVertexBuffer(m_device, command_list, colors));
     m_indices_buffer[index].reset(
         new IAIndexBuffer(m_device, command_list, indices, gli::format::FORMAT_R32_UINT_PACK32));
+}
+
+void ImGuiPass::OnRender(RenderCommandList& command_list)
+{
+    if (!m_is_visible) {
+        return;
+    }
+
+    ImDrawData* draw_data = ImGui::GetDrawData();
+    uint32_t index = m_buffer_index;
 
     command_list.UseProgram(m_program);
     command_list.Attach(m_program.vs.cbv.vertexBuffer, m_program.vs.cbuffer.vertexBuffer);
@@ -129,8 +178,6 @@ void ImGuiPass::OnRender(RenderCommandList& command_list)
         vtx_offset += cmd_list->VtxBuffer.Size;
     }
     command_list.EndRenderPass();
-
-    index = (index + 1) % 3;
 }
 
 void ImGuiPass::OnResize(int width, int height)
@@ -140,6 +187,13 @@ void ImGuiPass::OnResize(int width, int height)
     ImGui::GetIO().DisplaySize = ImVec2((float)m_width, (float)m_height);
 }
 
+void ImGuiPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.AllowParallelRecording();
+    builder.Read(m_input.rtv);
+    builder.Write(m_input.rtv);
+}
+
 void ImGuiPass::OnKey(int key, int action)
 {
     if (glfwGetInputMode(m_window, GLFW_CURSOR) == GLFW_CURSOR_NORMAL) {
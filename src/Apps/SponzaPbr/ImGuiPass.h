@@ -2,6 +2,7 @@
 
 #include "Device/Device.h"
 #include "Geometry/Geometry.h"
+#include "GpuProfiler.h"
 #include "ImGuiSettings.h"
 #include "ProgramRef/ImGuiPass_PS.h"
 #include "ProgramRef/ImGuiPass_VS.h"
@@ -15,6 +16,7 @@ public:
         std::shared_ptr<Resource>& rtv;
         IModifySponzaSettings& root_scene;
         SponzaSettings& settings;
+        const GpuProfiler& profiler;
     };
 
     struct Output {
@@ -29,8 +31,10 @@ public:
     ~ImGuiPass();
 
     virtual void OnUpdate() override;
+    virtual void OnUpload(RenderCommandList& command_list) override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
     virtual void OnKey(int key, int action) override;
     virtual void OnMouse(bool first, double xpos, double ypos) override;
@@ -39,6 +43,7 @@ public:
     virtual void OnInputChar(unsigned int ch) override;
 
 private:
+    void DrawProfiler();
     void CreateFontsTexture(RenderCommandList& command_list);
     void InitKey();
 
@@ -47,6 +52,7 @@ private:
     int m_width;
     int m_height;
     GLFWwindow* m_window;
+    bool m_is_visible = false;
 
     std::shared_ptr<Resource> m_font_texture_view;
     ProgramHolder<ImGuiPass_PS, ImGuiPass_VS> m_program;
@@ -54,6 +60,8 @@ private:
     std::array<std::unique_ptr<IAVertexBuffer>, 3> m_texcoords_buffer;
     std::array<std::unique_ptr<IAVertexBuffer>, 3> m_colors_buffer;
     std::array<std::unique_ptr<IAIndexBuffer>, 3> m_indices_buffer;
+    // Buffers of the frame, the others may still be read by the frames in flight.
+    uint32_t m_buffer_index = 0;
     std::shared_ptr<Resource> m_sampler;
     ImGuiSettings m_imgui_settings;
 };
@@ -20,14 +20,19 @@ public:
         ImGui::NewFrame();
         ImGui::Begin("SponzaSettings");
 
-        if (settings.Has("gpu_name")) {
-            std::string gpu_name = settings.Get<std::string>("gpu_name");
-            if (!gpu_name.empty()) {
-                ImGui::Text("%s", gpu_name.c_str());
-            }
+        const std::string& gpu_name = settings.GetGpuName();
+        if (!gpu_name.empty()) {
+            ImGui::Text("%s", gpu_name.c_str());
         }
 
         bool has_changed = settings.OnDraw();
+        if (ImGui::Button("Save preset")) {
+            settings.SavePreset(kPresetPath);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Load preset")) {
+            has_changed |= settings.LoadPreset(kPresetPath);
+        }
 
         ImGui::End();
         if (has_changed) {
@@ -43,6 +48,8 @@ public:
     }
 
 private:
+    static constexpr const char* kPresetPath = "SponzaPbr_preset.ini";
+
     IModifySponzaSettings& listener;
     SponzaSettings& settings;
 };
@@ -1,5 +1,8 @@
 #include "IrradianceConversion.h"
 
+#include "GpuProfiler.h"
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -26,14 +29,15 @@ void IrradianceConversion::OnUpdate()
 
 void IrradianceConversion::OnRender(RenderCommandList& command_list)
 {
-    if (!is || m_settings.Get<bool>("irradiance_conversion_every_frame")) {
-        command_list.BeginEvent("DrawIrradianceConvolution");
-        DrawIrradianceConvolution(command_list);
-        command_list.EndEvent();
-
-        command_list.BeginEvent("DrawPrefilter");
-        DrawPrefilter(command_list);
-        command_list.EndEvent();
+    if (!is || m_settings.irradiance_conversion_every_frame) {
+        {
+            ScopedEvent event(command_list, "DrawIrradianceConvolution");
+            DrawIrradianceConvolution(command_list);
+        }
+        {
+            ScopedEvent event(command_list, "DrawPrefilter");
+            DrawPrefilter(command_list);
+        }
 
         is = true;
     }
@@ -118,7 +122,7 @@ void IrradianceConversion::DrawPrefilter(RenderCommandList& command_list)
 
     size_t max_mip_levels = log2(m_input.prefilter.size);
     for (size_t mip = 0; mip < max_mip_levels; ++mip) {
-        command_list.BeginEvent(std::string("DrawPrefilter: mip " + std::to_string(mip)).c_str());
+        ScopedEvent mip_event(command_list, "DrawPrefilter: mip " + std::to_string(mip));
         command_list.SetViewport(0, 0, m_input.prefilter.size >> mip, m_input.prefilter.size >> mip);
         m_program_prefilter.ps.cbuffer.Settings.roughness = (float)mip / (float)(max_mip_levels - 1);
         m_program_prefilter.ps.cbuffer.Settings.resolution = m_input.prefilter.size;
@@ -134,8 +138,8 @@ void IrradianceConversion::DrawPrefilter(RenderCommandList& command_list)
 
         command_list.BeginRenderPass(render_pass_desc);
         for (uint32_t i = 0; i < 6; ++i) {
-            command_list.BeginEvent(
-                std::string("DrawPrefilter: mip " + std::to_string(mip) + " level " + std::to_string(i)).c_str());
+            ScopedEvent level_event(command_list,
+                                    "DrawPrefilter: mip " + std::to_string(mip) + " level " + std::to_string(i));
             m_program_prefilter.vs.cbuffer.ConstantBuf.face = 6 * m_input.prefilter.layer + i;
             m_program_prefilter.vs.cbuffer.ConstantBuf.view = glm::transpose(capture_views[i]);
             command_list.Attach(m_program_prefilter.ps.srv.environmentMap, m_input.environment);
@@ -143,14 +147,26 @@ void IrradianceConversion::DrawPrefilter(RenderCommandList& command_list)
                 command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location,
                                          0);
             }
-            command_list.EndEvent();
         }
         command_list.EndRenderPass();
-        command_list.EndEvent();
     }
 }
 
-void IrradianceConversion::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask IrradianceConversion::GetSponzaSettingsSubscription() const
+{
+    return { SponzaSetting::irradiance_conversion_every_frame };
+}
+
+void IrradianceConversion::OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                                  const SponzaSettingsMask& changes)
 {
     m_settings = settings;
 }
+
+void IrradianceConversion::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.AllowParallelRecording();
+    builder.Read(m_input.environment);
+    builder.Write(m_input.irradince.res);
+    builder.Write(m_input.prefilter.res);
+}
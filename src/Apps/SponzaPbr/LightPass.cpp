@@ -1,5 +1,7 @@
 #include "LightPass.h"
 
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -8,9 +10,14 @@ LightPass::LightPass(RenderDevice& device, const Input& input, int width, int he
     , m_input(input)
     , m_width(width)
     , m_height(height)
-    , m_program(device, std::bind(&LightPass::SetDefines, this, std::placeholders::_1))
+    , m_program(device,
+                input.thread_pool,
+                "LightPass",
+                GetSampleCounts(),
+                m_settings.sample_count,
+                "SAMPLE_COUNT",
+                [](auto& program) -> auto& { return program.ps; })
 {
-    CreateSizeDependentResources();
     m_sampler = m_device.CreateSampler({
         SamplerFilter::kAnisotropic,
         SamplerTextureAddressMode::kWrap,
@@ -30,66 +37,60 @@ LightPass::LightPass(RenderDevice& device, const Input& input, int width, int he
     });
 }
 
-void LightPass::SetDefines(ProgramHolder<LightPass_PS, LightPass_VS>& program)
-{
-    if (m_settings.Get<uint32_t>("sample_count") != 1) {
-        program.ps.desc.define["SAMPLE_COUNT"] = std::to_string(m_settings.Get<uint32_t>("sample_count"));
-    }
-}
-
 void LightPass::OnUpdate()
 {
+    auto& program = m_program.Get();
+
     glm::vec3 camera_position = m_input.camera.GetCameraPos();
 
-    m_program.ps.cbuffer.Light.viewPos = camera_position;
-    m_program.ps.cbuffer.Settings.use_ssao = m_settings.Get<bool>("use_ssao") || m_settings.Get<bool>("use_rtao");
-    m_program.ps.cbuffer.Settings.use_ao = m_settings.Get<bool>("use_ao");
-    m_program.ps.cbuffer.Settings.use_IBL_diffuse = m_settings.Get<bool>("use_IBL_diffuse");
-    m_program.ps.cbuffer.Settings.use_IBL_specular = m_settings.Get<bool>("use_IBL_specular");
-    m_program.ps.cbuffer.Settings.only_ambient = m_settings.Get<bool>("only_ambient");
-    m_program.ps.cbuffer.Settings.ambient_power = m_settings.Get<float>("ambient_power");
-    m_program.ps.cbuffer.Settings.light_power = m_settings.Get<float>("light_power");
-    m_program.ps.cbuffer.Settings.use_spec_ao_by_ndotv_roughness =
-        m_settings.Get<bool>("use_spec_ao_by_ndotv_roughness");
-    m_program.ps.cbuffer.Settings.show_only_position = m_settings.Get<bool>("show_only_position");
-    m_program.ps.cbuffer.Settings.show_only_albedo = m_settings.Get<bool>("show_only_albedo");
-    m_program.ps.cbuffer.Settings.show_only_normal = m_settings.Get<bool>("show_only_normal");
-    m_program.ps.cbuffer.Settings.show_only_roughness = m_settings.Get<bool>("show_only_roughness");
-    m_program.ps.cbuffer.Settings.show_only_metalness = m_settings.Get<bool>("show_only_metalness");
-    m_program.ps.cbuffer.Settings.show_only_ao = m_settings.Get<bool>("show_only_ao");
-    m_program.ps.cbuffer.Settings.use_f0_with_roughness = m_settings.Get<bool>("use_f0_with_roughness");
-
-    m_program.ps.cbuffer.ShadowParams.s_near = m_settings.Get<float>("s_near");
-    m_program.ps.cbuffer.ShadowParams.s_far = m_settings.Get<float>("s_far");
-    m_program.ps.cbuffer.ShadowParams.s_size = m_settings.Get<float>("s_size");
-    m_program.ps.cbuffer.ShadowParams.use_shadow = m_settings.Get<bool>("use_shadow");
-    m_program.ps.cbuffer.ShadowParams.shadow_light_pos = m_input.light_pos;
-
-    for (size_t i = 0; i < std::size(m_program.ps.cbuffer.Light.light_pos); ++i) {
-        m_program.ps.cbuffer.Light.light_pos[i] = glm::vec4(0);
-        m_program.ps.cbuffer.Light.light_color[i] = glm::vec4(0);
+    program.ps.cbuffer.Light.viewPos = camera_position;
+    program.ps.cbuffer.Settings.use_ssao = m_settings.use_ssao || m_settings.use_rtao;
+    program.ps.cbuffer.Settings.use_ao = m_settings.use_ao;
+    program.ps.cbuffer.Settings.use_IBL_diffuse = m_settings.use_IBL_diffuse;
+    program.ps.cbuffer.Settings.use_IBL_specular = m_settings.use_IBL_specular;
+    program.ps.cbuffer.Settings.only_ambient = m_settings.only_ambient;
+    program.ps.cbuffer.Settings.ambient_power = m_settings.ambient_power;
+    program.ps.cbuffer.Settings.light_power = m_settings.light_power;
+    program.ps.cbuffer.Settings.use_spec_ao_by_ndotv_roughness = m_settings.use_spec_ao_by_ndotv_roughness;
+    program.ps.cbuffer.Settings.show_only_position = m_settings.show_only_position;
+    program.ps.cbuffer.Settings.show_only_albedo = m_settings.show_only_albedo;
+    program.ps.cbuffer.Settings.show_only_normal = m_settings.show_only_normal;
+    program.ps.cbuffer.Settings.show_only_roughness = m_settings.show_only_roughness;
+    program.ps.cbuffer.Settings.show_only_metalness = m_settings.show_only_metalness;
+    program.ps.cbuffer.Settings.show_only_ao = m_settings.show_only_ao;
+    program.ps.cbuffer.Settings.use_f0_with_roughness = m_settings.use_f0_with_roughness;
+
+    program.ps.cbuffer.ShadowParams.s_near = m_settings.s_near;
+    program.ps.cbuffer.ShadowParams.s_far = m_settings.s_far;
+    program.ps.cbuffer.ShadowParams.s_size = m_settings.s_size;
+    program.ps.cbuffer.ShadowParams.use_shadow = m_settings.use_shadow;
+    program.ps.cbuffer.ShadowParams.shadow_light_pos = m_input.light_pos;
+
+    for (size_t i = 0; i < std::size(program.ps.cbuffer.Light.light_pos); ++i) {
+        program.ps.cbuffer.Light.light_pos[i] = glm::vec4(0);
+        program.ps.cbuffer.Light.light_color[i] = glm::vec4(0);
     }
 
-    m_program.ps.cbuffer.Light.light_count = 0;
-    if (m_settings.Get<bool>("light_in_camera")) {
-        m_program.ps.cbuffer.Light.light_pos[m_program.ps.cbuffer.Light.light_count] = glm::vec4(camera_position, 0);
-        m_program.ps.cbuffer.Light.light_color[m_program.ps.cbuffer.Light.light_count] = glm::vec4(1, 1, 1, 0.0);
-        ++m_program.ps.cbuffer.Light.light_count;
+    program.ps.cbuffer.Light.light_count = 0;
+    if (m_settings.light_in_camera) {
+        program.ps.cbuffer.Light.light_pos[program.ps.cbuffer.Light.light_count] = glm::vec4(camera_position, 0);
+        program.ps.cbuffer.Light.light_color[program.ps.cbuffer.Light.light_count] = glm::vec4(1, 1, 1, 0.0);
+        ++program.ps.cbuffer.Light.light_count;
     }
-    if (m_settings.Get<bool>("additional_lights")) {
+    if (m_settings.additional_lights) {
         for (int x = -13; x <= 13; ++x) {
             int q = 1;
             for (int z = -1; z <= 1; ++z) {
-                if (m_program.ps.cbuffer.Light.light_count < std::size(m_program.ps.cbuffer.Light.light_pos)) {
-                    m_program.ps.cbuffer.Light.light_pos[m_program.ps.cbuffer.Light.light_count] =
+                if (program.ps.cbuffer.Light.light_count < std::size(program.ps.cbuffer.Light.light_pos)) {
+                    program.ps.cbuffer.Light.light_pos[program.ps.cbuffer.Light.light_count] =
                         glm::vec4(x, 1.5, z - 0.33, 0);
                     float color = 0.0;
-                    if (m_settings.Get<bool>("use_white_ligth")) {
+                    if (m_settings.use_white_ligth) {
                         color = 1;
                     }
-                    m_program.ps.cbuffer.Light.light_color[m_program.ps.cbuffer.Light.light_count] =
+                    program.ps.cbuffer.Light.light_color[program.ps.cbuffer.Light.light_count] =
                         glm::vec4(q == 1 ? 1 : color, q == 2 ? 1 : color, q == 3 ? 1 : color, 0.0);
-                    ++m_program.ps.cbuffer.Light.light_count;
+                    ++program.ps.cbuffer.Light.light_count;
                     ++q;
                 }
             }
@@ -98,47 +99,50 @@ void LightPass::OnUpdate()
 
     glm::mat4 projection, view, model;
     m_input.camera.GetMatrix(projection, view, model);
-    m_program.ps.cbuffer.Light.inverted_mvp = glm::transpose(glm::inverse(projection * view));
+    program.ps.cbuffer.Light.inverted_mvp = glm::transpose(glm::inverse(projection * view));
 }
 
 void LightPass::OnRender(RenderCommandList& command_list)
 {
+    auto& program = m_program.Get();
+
     command_list.SetViewport(0, 0, m_width, m_height);
 
-    command_list.UseProgram(m_program);
-    command_list.Attach(m_program.ps.cbv.Light, m_program.ps.cbuffer.Light);
-    command_list.Attach(m_program.ps.cbv.Settings, m_program.ps.cbuffer.Settings);
-    command_list.Attach(m_program.ps.cbv.ShadowParams, m_program.ps.cbuffer.ShadowParams);
+    command_list.UseProgram(program);
+    command_list.Attach(program.ps.cbv.Light, program.ps.cbuffer.Light);
+    command_list.Attach(program.ps.cbv.Settings, program.ps.cbuffer.Settings);
+    command_list.Attach(program.ps.cbv.ShadowParams, program.ps.cbuffer.ShadowParams);
 
-    command_list.Attach(m_program.ps.sampler.g_sampler, m_sampler);
-    command_list.Attach(m_program.ps.sampler.brdf_sampler, m_sampler_brdf);
-    command_list.Attach(m_program.ps.sampler.LightCubeShadowComparsionSampler, m_compare_sampler);
+    command_list.Attach(program.ps.sampler.g_sampler, m_sampler);
+    command_list.Attach(program.ps.sampler.brdf_sampler, m_sampler_brdf);
+    command_list.Attach(program.ps.sampler.LightCubeShadowComparsionSampler, m_compare_sampler);
 
     m_input.model.ia.indices.Bind(command_list);
-    m_input.model.ia.positions.BindToSlot(command_list, m_program.vs.ia.POSITION);
-    m_input.model.ia.texcoords.BindToSlot(command_list, m_program.vs.ia.TEXCOORD);
+    m_input.model.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
+    m_input.model.ia.texcoords.BindToSlot(command_list, program.vs.ia.TEXCOORD);
 
     RenderPassBeginDesc render_pass_desc = {};
-    render_pass_desc.colors[m_program.ps.om.rtv0].texture = output.rtv;
-    render_pass_desc.colors[m_program.ps.om.rtv0].clear_color = { 0.0f, 0.0f, 0.0f, 1.0f };
+    render_pass_desc.colors[program.ps.om.rtv0].texture = output.rtv;
+    render_pass_desc.colors[program.ps.om.rtv0].clear_color = { 0.0f, 0.0f, 0.0f, 1.0f };
     render_pass_desc.depth_stencil.texture = m_depth_stencil_view;
     render_pass_desc.depth_stencil.clear_depth = 1.0f;
 
     command_list.BeginRenderPass(render_pass_desc);
     for (auto& range : m_input.model.ia.ranges) {
-        command_list.Attach(m_program.ps.srv.gNormal, m_input.geometry_pass.normal);
-        command_list.Attach(m_program.ps.srv.gAlbedo, m_input.geometry_pass.albedo);
-        command_list.Attach(m_program.ps.srv.gMaterial, m_input.geometry_pass.material);
-        if (m_settings.Get<bool>("use_rtao") && m_input.ray_tracing_ao) {
-            command_list.Attach(m_program.ps.srv.gSSAO, *m_input.ray_tracing_ao);
-        } else if (m_settings.Get<bool>("use_ssao")) {
-            command_list.Attach(m_program.ps.srv.gSSAO, m_input.ssao_pass.ao);
+        command_list.Attach(program.ps.srv.gDepth, m_input.geometry_pass.dsv);
+        command_list.Attach(program.ps.srv.gNormal, m_input.geometry_pass.normal);
+        command_list.Attach(program.ps.srv.gAlbedo, m_input.geometry_pass.albedo);
+        command_list.Attach(program.ps.srv.gMaterial, m_input.geometry_pass.material);
+        if (m_settings.use_rtao && m_input.ray_tracing_ao) {
+            command_list.Attach(program.ps.srv.gSSAO, *m_input.ray_tracing_ao);
+        } else if (m_settings.use_ssao) {
+            command_list.Attach(program.ps.srv.gSSAO, m_input.ssao_pass.ao);
         }
-        command_list.Attach(m_program.ps.srv.irradianceMap, m_input.irradince);
-        command_list.Attach(m_program.ps.srv.prefilterMap, m_input.prefilter);
-        command_list.Attach(m_program.ps.srv.brdfLUT, m_input.brdf);
-        if (m_settings.Get<bool>("use_shadow")) {
-            command_list.Attach(m_program.ps.srv.LightCubeShadowMap, m_input.shadow_pass.srv);
+        command_list.Attach(program.ps.srv.irradianceMap, m_input.irradince);
+        command_list.Attach(program.ps.srv.prefilterMap, m_input.prefilter);
+        command_list.Attach(program.ps.srv.brdfLUT, m_input.brdf);
+        if (m_settings.use_shadow) {
+            command_list.Attach(program.ps.srv.LightCubeShadowMap, m_input.shadow_pass.srv);
         }
 
         command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location, 0);
@@ -150,23 +154,59 @@ void LightPass::OnResize(int width, int height)
 {
     m_width = width;
     m_height = height;
-    CreateSizeDependentResources();
 }
 
-void LightPass::CreateSizeDependentResources()
+bool LightPass::HasPrograms(const SponzaSettingsValues& settings) const
+{
+    return m_program.IsBuilt(settings.sample_count);
+}
+
+bool LightPass::BuildProgram(const SponzaSettingsValues& settings, bool wait)
+{
+    return m_program.Build(settings.sample_count, wait);
+}
+
+void LightPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.Read(m_input.geometry_pass.dsv);
+    builder.Read(m_input.geometry_pass.normal);
+    builder.Read(m_input.geometry_pass.albedo);
+    builder.Read(m_input.geometry_pass.material);
+    if (m_settings.use_rtao && m_input.ray_tracing_ao) {
+        builder.Read(*m_input.ray_tracing_ao);
+    } else if (m_settings.use_ssao) {
+        builder.Read(m_input.ssao_pass.ao);
+    }
+    builder.Read(m_input.irradince);
+    builder.Read(m_input.prefilter);
+    builder.Read(m_input.brdf);
+    if (m_settings.use_shadow) {
+        builder.Read(m_input.shadow_pass.srv);
+    }
+    builder.CreateTransient(output.rtv, { BindFlag::kRenderTarget | BindFlag::kShaderResource,
+                                          gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height });
+    builder.CreateTransient(m_depth_stencil_view,
+                            { BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_width, m_height });
+}
+
+SponzaSettingsMask LightPass::GetSponzaSettingsSubscription() const
 {
-    output.rtv = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                        gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
-    m_depth_stencil_view =
-        m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_width, m_height, 1);
+    return {
+        SponzaSetting::sample_count, SponzaSetting::use_ao,
+        SponzaSetting::use_ssao, SponzaSetting::use_rtao, SponzaSetting::use_IBL_diffuse,
+        SponzaSetting::use_IBL_specular, SponzaSetting::only_ambient, SponzaSetting::ambient_power,
+        SponzaSetting::light_power, SponzaSetting::use_spec_ao_by_ndotv_roughness, SponzaSetting::show_only_position,
+        SponzaSetting::show_only_albedo, SponzaSetting::show_only_normal, SponzaSetting::show_only_roughness,
+        SponzaSetting::show_only_metalness, SponzaSetting::show_only_ao, SponzaSetting::use_f0_with_roughness,
+        SponzaSetting::s_near, SponzaSetting::s_far, SponzaSetting::s_size, SponzaSetting::use_shadow,
+        SponzaSetting::light_in_camera, SponzaSetting::additional_lights, SponzaSetting::use_white_ligth
+    };
 }
 
-void LightPass::OnModifySponzaSettings(const SponzaSettings& settings)
+void LightPass::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
-    SponzaSettings prev = m_settings;
     m_settings = settings;
-    if (prev.Get<uint32_t>("sample_count") != m_settings.Get<uint32_t>("sample_count")) {
-        m_program.ps.desc.define["SAMPLE_COUNT"] = std::to_string(m_settings.Get<uint32_t>("sample_count"));
-        m_program.UpdateProgram();
+    if (changes.Test(SponzaSetting::sample_count)) {
+        m_program.Select(m_settings.sample_count);
     }
 }
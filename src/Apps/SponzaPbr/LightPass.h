@@ -4,6 +4,7 @@
 #include "Geometry/Geometry.h"
 #include "GeometryPass.h"
 #include "IrradianceConversion.h"
+#include "ProgramPermutations.h"
 #include "ProgramRef/LightPass_PS.h"
 #include "ProgramRef/LightPass_VS.h"
 #include "RenderPass.h"
@@ -24,6 +25,7 @@ public:
         std::shared_ptr<Resource>& irradince;
         std::shared_ptr<Resource>& prefilter;
         std::shared_ptr<Resource>& brdf;
+        ThreadPool& thread_pool;
     };
 
     struct Output {
@@ -35,18 +37,20 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual bool HasPrograms(const SponzaSettingsValues& settings) const override;
+    virtual bool BuildProgram(const SponzaSettingsValues& settings, bool wait) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
-    void CreateSizeDependentResources();
-    void SetDefines(ProgramHolder<LightPass_PS, LightPass_VS>& program);
-
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     int m_width;
     int m_height;
-    ProgramHolder<LightPass_PS, LightPass_VS> m_program;
+    ProgramPermutations<ProgramHolder<LightPass_PS, LightPass_VS>> m_program;
     std::shared_ptr<Resource> m_depth_stencil_view;
     std::shared_ptr<Resource> m_sampler;
     std::shared_ptr<Resource> m_sampler_brdf;
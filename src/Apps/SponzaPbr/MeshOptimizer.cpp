@@ -0,0 +1,296 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kNoVertex = ~0u;
+
+// FIFO post-transform cache simulated with the time every vertex was last transformed.
+class VertexCache {
+public:
+    explicit VertexCache(size_t vertex_count)
+        : m_stamps(vertex_count, 0)
+    {
+    }
+
+    bool Contains(uint32_t vertex) const
+    {
+        return m_time - m_stamps[vertex] <= kVertexCacheSize;
+    }
+
+    // Returns true on a cache miss.
+    bool Access(uint32_t vertex)
+    {
+        if (Contains(vertex)) {
+            return false;
+        }
+        m_stamps[vertex] = m_time++;
+        return true;
+    }
+
+    uint32_t AccessTriangle(const uint32_t* triangle)
+    {
+        return Access(triangle[0]) + Access(triangle[1]) + Access(triangle[2]);
+    }
+
+    uint32_t Age(uint32_t vertex) const
+    {
+        return m_time - m_stamps[vertex];
+    }
+
+    void Reset()
+    {
+        m_time += kVertexCacheSize + 1;
+    }
+
+private:
+    std::vector<uint32_t> m_stamps;
+    uint32_t m_time = kVertexCacheSize + 1;
+};
+
+bool IsValid(const std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    return std::all_of(indices.begin(), indices.end(), [&](uint32_t index) { return index < vertex_count; });
+}
+
+} // namespace
+
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    VertexCacheStatistics statistics = {};
+    size_t triangle_count = indices.size() / 3;
+    if (!triangle_count || !IsValid(indices, vertex_count)) {
+        return statistics;
+    }
+
+    VertexCache cache(vertex_count);
+    std::vector<uint8_t> referenced(vertex_count, 0);
+    size_t misses = 0;
+    size_t unique = 0;
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        misses += cache.Access(indices[i]);
+        unique += !referenced[indices[i]];
+        referenced[indices[i]] = 1;
+    }
+    statistics.acmr = static_cast<float>(misses) / triangle_count;
+    statistics.atvr = static_cast<float>(misses) / unique;
+    return statistics;
+}
+
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (!triangle_count || !IsValid(indices, vertex_count)) {
+        return indices;
+    }
+
+    // Triangles adjacent to every vertex and the number of them which are not emitted yet.
+    std::vector<uint32_t> live(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; ++i) {
+        ++live[indices[i]];
+    }
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (size_t i = 0; i < vertex_count; ++i) {
+        offsets[i + 1] = offsets[i] + live[i];
+    }
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < triangle_count * 3; ++i) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    VertexCache cache(vertex_count);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(triangle_count * 3);
+
+    uint32_t cursor = 0;
+    auto skip_dead_end = [&]() -> uint32_t {
+        while (!dead_end.empty()) {
+            uint32_t vertex = dead_end.back();
+            dead_end.pop_back();
+            if (live[vertex]) {
+                return vertex;
+            }
+        }
+        for (; cursor < vertex_count; ++cursor) {
+            if (live[cursor]) {
+                return cursor;
+            }
+        }
+        return kNoVertex;
+    };
+
+    uint32_t fanning = skip_dead_end();
+    while (fanning != kNoVertex) {
+        candidates.clear();
+        for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; ++i) {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = 1;
+            for (uint32_t j = 0; j < 3; ++j) {
+                uint32_t vertex = indices[3 * triangle + j];
+                result.push_back(vertex);
+                dead_end.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                cache.Access(vertex);
+            }
+        }
+
+        // Prefer the oldest candidate which stays in the cache while its remaining triangles are emitted.
+        uint32_t next = kNoVertex;
+        int64_t best_priority = -1;
+        for (uint32_t vertex : candidates) {
+            if (!live[vertex]) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (cache.Age(vertex) + 2 * live[vertex] <= kVertexCacheSize) {
+                priority = cache.Age(vertex);
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                next = vertex;
+            }
+        }
+        fanning = next != kNoVertex ? next : skip_dead_end();
+    }
+    return result;
+}
+
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices,
+                                       const std::vector<glm::vec3>& positions,
+                                       float threshold)
+{
+    std::vector<uint32_t> optimized = OptimizeVertexCache(indices, positions.size());
+    size_t triangle_count = optimized.size() / 3;
+    if (triangle_count < 2 || !IsValid(optimized, positions.size())) {
+        return optimized;
+    }
+
+    // Hard boundaries are where the cache optimized order starts over and every vertex of a triangle misses.
+    VertexCache cache(positions.size());
+    std::vector<size_t> hard_boundaries = { 0 };
+    cache.AccessTriangle(&optimized[0]);
+    for (size_t i = 1; i < triangle_count; ++i) {
+        if (cache.AccessTriangle(&optimized[3 * i]) == 3) {
+            hard_boundaries.push_back(i);
+        }
+    }
+    hard_boundaries.push_back(triangle_count);
+
+    // Soft boundaries split the hard clusters wherever the cache miss ratio of a cold cache is already within the
+    // threshold of the one of the whole cluster.
+    std::vector<size_t> clusters;
+    for (size_t i = 0; i + 1 < hard_boundaries.size(); ++i) {
+        size_t begin = hard_boundaries[i];
+        size_t end = hard_boundaries[i + 1];
+        cache.Reset();
+        uint32_t misses = 0;
+        for (size_t j = begin; j < end; ++j) {
+            misses += cache.AccessTriangle(&optimized[3 * j]);
+        }
+        float limit = threshold * misses / (end - begin);
+
+        cache.Reset();
+        misses = 0;
+        size_t start = begin;
+        clusters.push_back(start);
+        for (size_t j = begin; j + 1 < end; ++j) {
+            misses += cache.AccessTriangle(&optimized[3 * j]);
+            if (misses <= limit * (j + 1 - start)) {
+                start = j + 1;
+                clusters.push_back(start);
+                misses = 0;
+                cache.Reset();
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    auto triangle_normal = [&](size_t triangle, glm::vec3& center) {
+        const glm::vec3& a = positions[optimized[3 * triangle + 0]];
+        const glm::vec3& b = positions[optimized[3 * triangle + 1]];
+        const glm::vec3& c = positions[optimized[3 * triangle + 2]];
+        center = (a + b + c) / 3.0f;
+        return glm::cross(b - a, c - a);
+    };
+
+    glm::vec3 mesh_center(0.0f);
+    float mesh_area = 0;
+    for (size_t i = 0; i < triangle_count; ++i) {
+        glm::vec3 center;
+        float area = glm::length(triangle_normal(i, center));
+        mesh_center += center * area;
+        mesh_area += area;
+    }
+    if (mesh_area > 0) {
+        mesh_center /= mesh_area;
+    }
+
+    struct Cluster {
+        size_t begin;
+        size_t end;
+        float sort_key;
+    };
+    std::vector<Cluster> sorted;
+    for (size_t i = 0; i + 1 < clusters.size(); ++i) {
+        glm::vec3 cluster_center(0.0f);
+        glm::vec3 cluster_normal(0.0f);
+        float cluster_area = 0;
+        for (size_t j = clusters[i]; j < clusters[i + 1]; ++j) {
+            glm::vec3 center;
+            glm::vec3 normal = triangle_normal(j, center);
+            float area = glm::length(normal);
+            cluster_center += center * area;
+            cluster_normal += normal;
+            cluster_area += area;
+        }
+        float sort_key = 0;
+        float normal_length = glm::length(cluster_normal);
+        if (cluster_area > 0 && normal_length > 0) {
+            sort_key = glm::dot(cluster_center / cluster_area - mesh_center, cluster_normal / normal_length);
+        }
+        sorted.push_back({ clusters[i], clusters[i + 1], sort_key });
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<uint32_t> result;
+    result.reserve(optimized.size());
+    for (const auto& cluster : sorted) {
+        result.insert(result.end(), optimized.begin() + 3 * cluster.begin, optimized.begin() + 3 * cluster.end);
+    }
+    return result;
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    std::vector<uint32_t> remap(vertex_count, kNoVertex);
+    if (!IsValid(indices, vertex_count)) {
+        for (uint32_t i = 0; i < vertex_count; ++i) {
+            remap[i] = i;
+        }
+        return remap;
+    }
+
+    uint32_t next = 0;
+    for (auto& index : indices) {
+        if (remap[index] == kNoVertex) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    for (auto& vertex : remap) {
+        if (vertex == kNoVertex) {
+            vertex = next++;
+        }
+    }
+    return remap;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Post-transform cache size the orderings are tuned for and analyzed with, a FIFO of this many vertices.
+constexpr size_t kVertexCacheSize = 16;
+
+struct VertexCacheStatistics {
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is the best case for large meshes, 3 the
+    // worst one.
+    float acmr = 0;
+    // Average transform to vertex ratio, transformed vertices per referenced vertex. 1 is the best case.
+    float atvr = 0;
+};
+
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count);
+
+// Reorders the triangles of an indexed triangle list for the post-transform cache, see Sander et al. "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw" (tipsify).
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count);
+
+// Reorders the triangles for the post-transform cache, splits them into clusters which keep the cache miss ratio
+// within threshold times the optimized one, and sorts the clusters so the ones facing away from the center of the
+// mesh are drawn first.
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices,
+                                       const std::vector<glm::vec3>& positions,
+                                       float threshold);
+
+// Renumbers the vertices in the order the indices reference them first, rewriting the indices in place. Returns
+// the new location of every old vertex, unreferenced vertices are moved after the referenced ones.
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertex_count);
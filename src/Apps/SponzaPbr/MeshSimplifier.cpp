@@ -0,0 +1,242 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+// Area weighted sum of squared distances to the planes of the adjacent triangles.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    void AddPlane(const glm::dvec3& n, double d, double w)
+    {
+        a00 += w * n.x * n.x;
+        a01 += w * n.x * n.y;
+        a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y;
+        a12 += w * n.y * n.z;
+        a22 += w * n.z * n.z;
+        b0 += w * n.x * d;
+        b1 += w * n.y * d;
+        b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void Add(const Quadric& other)
+    {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a11 += other.a11;
+        a12 += other.a12;
+        a22 += other.a22;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    double Evaluate(const glm::dvec3& p) const
+    {
+        double error = a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + a11 * p.y * p.y +
+                       2 * a12 * p.y * p.z + a22 * p.z * p.z + 2 * b0 * p.x + 2 * b1 * p.y + 2 * b2 * p.z + c;
+        return weight > 0 ? std::abs(error) / weight : 0;
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t from_version;
+    uint32_t to_version;
+
+    bool operator>(const Collapse& other) const
+    {
+        return cost > other.cost;
+    }
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+glm::dvec3 TriangleNormal(const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+{
+    return glm::cross(b - a, c - a);
+}
+
+} // namespace
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<glm::vec3>& positions,
+                                   const std::vector<uint32_t>& indices,
+                                   size_t target_index_count,
+                                   float target_error)
+{
+    size_t vertex_count = positions.size();
+    size_t triangle_count = indices.size() / 3;
+    if (indices.size() <= target_index_count || !vertex_count) {
+        return indices;
+    }
+
+    std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangle_count * 3);
+    std::vector<uint8_t> triangle_alive(triangle_count, 1);
+    std::vector<std::vector<uint32_t>> adjacency(vertex_count);
+    std::vector<Quadric> quadrics(vertex_count);
+    std::unordered_map<uint64_t, uint32_t> edge_use;
+    glm::vec3 extent_min = positions[0];
+    glm::vec3 extent_max = positions[0];
+    for (const auto& position : positions) {
+        extent_min = glm::min(extent_min, position);
+        extent_max = glm::max(extent_max, position);
+    }
+    double extent = glm::length(extent_max - extent_min);
+    double error_limit = target_error * extent * target_error * extent;
+
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        uint32_t* tri = &triangles[3 * t];
+        if (tri[0] >= vertex_count || tri[1] >= vertex_count || tri[2] >= vertex_count) {
+            return indices;
+        }
+        glm::dvec3 p0 = positions[tri[0]];
+        glm::dvec3 p1 = positions[tri[1]];
+        glm::dvec3 p2 = positions[tri[2]];
+        glm::dvec3 normal = TriangleNormal(p0, p1, p2);
+        double length = glm::length(normal);
+        if (length > 0) {
+            normal /= length;
+            for (int i = 0; i < 3; ++i) {
+                quadrics[tri[i]].AddPlane(normal, -glm::dot(normal, p0), length * 0.5);
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            adjacency[tri[i]].push_back(t);
+            ++edge_use[EdgeKey(tri[i], tri[(i + 1) % 3])];
+        }
+    }
+
+    // Open and non-manifold edges keep both of their vertices in place.
+    std::vector<uint8_t> locked(vertex_count, 0);
+    for (const auto& edge : edge_use) {
+        if (edge.second != 2) {
+            locked[edge.first >> 32] = 1;
+            locked[edge.first & 0xffffffff] = 1;
+        }
+    }
+
+    std::vector<uint8_t> removed(vertex_count, 0);
+    std::vector<uint32_t> version(vertex_count, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    auto push = [&](uint32_t from, uint32_t to) {
+        if (locked[from] || from == to) {
+            return;
+        }
+        Quadric quadric = quadrics[from];
+        quadric.Add(quadrics[to]);
+        queue.push({ quadric.Evaluate(positions[to]), from, to, version[from], version[to] });
+    };
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            push(triangles[3 * t + i], triangles[3 * t + (i + 1) % 3]);
+            push(triangles[3 * t + (i + 1) % 3], triangles[3 * t + i]);
+        }
+    }
+
+    size_t alive_count = triangle_count;
+    while (alive_count * 3 > target_index_count && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+        uint32_t u = collapse.from;
+        uint32_t v = collapse.to;
+        if (removed[u] || removed[v] || version[u] != collapse.from_version || version[v] != collapse.to_version) {
+            continue;
+        }
+        if (collapse.cost > error_limit) {
+            break;
+        }
+
+        // Reject collapses which would flip or degenerate the triangles that stay.
+        bool connected = false;
+        bool valid = true;
+        glm::dvec3 target = positions[v];
+        for (uint32_t t : adjacency[u]) {
+            if (!triangle_alive[t]) {
+                continue;
+            }
+            const uint32_t* tri = &triangles[3 * t];
+            if (tri[0] == v || tri[1] == v || tri[2] == v) {
+                connected = true;
+                continue;
+            }
+            glm::dvec3 p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+            glm::dvec3 before = TriangleNormal(p[0], p[1], p[2]);
+            for (int i = 0; i < 3; ++i) {
+                if (tri[i] == u) {
+                    p[i] = target;
+                }
+            }
+            glm::dvec3 after = TriangleNormal(p[0], p[1], p[2]);
+            if (glm::dot(before, after) <= 0.25 * glm::length(before) * glm::length(after)) {
+                valid = false;
+                break;
+            }
+        }
+        if (!connected || !valid) {
+            continue;
+        }
+
+        for (uint32_t t : adjacency[u]) {
+            if (!triangle_alive[t]) {
+                continue;
+            }
+            uint32_t* tri = &triangles[3 * t];
+            if (tri[0] == v || tri[1] == v || tri[2] == v) {
+                triangle_alive[t] = 0;
+                --alive_count;
+                continue;
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (tri[i] == u) {
+                    tri[i] = v;
+                }
+            }
+            adjacency[v].push_back(t);
+        }
+        adjacency[u].clear();
+        removed[u] = 1;
+        quadrics[v].Add(quadrics[u]);
+        ++version[v];
+
+        auto& v_adjacency = adjacency[v];
+        v_adjacency.erase(std::remove_if(v_adjacency.begin(), v_adjacency.end(),
+                                         [&](uint32_t t) { return !triangle_alive[t]; }),
+                          v_adjacency.end());
+        for (uint32_t t : v_adjacency) {
+            for (int i = 0; i < 3; ++i) {
+                uint32_t w = triangles[3 * t + i];
+                if (w != v) {
+                    push(w, v);
+                    push(v, w);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(alive_count * 3);
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        if (triangle_alive[t]) {
+            result.insert(result.end(), &triangles[3 * t], &triangles[3 * t] + 3);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Simplifies an indexed triangle list by collapsing vertices onto their neighbours, ordered by quadric error.
+// The result indexes the same vertices, so it can be drawn from the original vertex buffers. Vertices on open
+// edges are never moved; UV and normal seams split the vertices and are open edges of the index topology, so
+// they are preserved as well. Stops at target_index_count or when the error would exceed target_error, given
+// relative to the extent of the mesh.
+std::vector<uint32_t> SimplifyMesh(const std::vector<glm::vec3>& positions,
+                                   const std::vector<uint32_t>& indices,
+                                   size_t target_index_count,
+                                   float target_error);
@@ -0,0 +1,112 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kNoMeshlet = ~0u;
+
+void ComputeBounds(const std::vector<uint32_t>& indices,
+                   const std::vector<glm::vec3>& positions,
+                   const std::vector<glm::vec3>& normals,
+                   Meshlet& meshlet)
+{
+    meshlet.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    meshlet.bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < meshlet.index_count; ++i) {
+        const glm::vec3& position = positions[indices[meshlet.start_index + i]];
+        meshlet.bounds_min = glm::min(meshlet.bounds_min, position);
+        meshlet.bounds_max = glm::max(meshlet.bounds_max, position);
+    }
+
+    meshlet.cone_axis = glm::vec3(0.0f);
+    meshlet.cone_cutoff = 1.0f;
+    if (normals.size() != positions.size()) {
+        return;
+    }
+
+    std::vector<glm::vec3> triangle_normals;
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i < meshlet.index_count; i += 3) {
+        const uint32_t* triangle = &indices[meshlet.start_index + i];
+        const glm::vec3& a = positions[triangle[0]];
+        glm::vec3 normal = glm::cross(positions[triangle[1]] - a, positions[triangle[2]] - a);
+        float area = glm::length(normal);
+        if (area == 0) {
+            continue;
+        }
+        normal /= area;
+        if (glm::dot(normal, normals[triangle[0]] + normals[triangle[1]] + normals[triangle[2]]) < 0) {
+            return;
+        }
+        triangle_normals.push_back(normal);
+        axis += normal;
+    }
+    float axis_length = glm::length(axis);
+    if (triangle_normals.empty() || axis_length == 0) {
+        return;
+    }
+    axis /= axis_length;
+
+    // The normals lie within the angle acos(min_dot) of the axis, the eye has to be behind all of them.
+    float min_dot = 1.0f;
+    for (const auto& normal : triangle_normals) {
+        min_dot = std::min(min_dot, glm::dot(normal, axis));
+    }
+    if (min_dot <= 0) {
+        return;
+    }
+    meshlet.cone_axis = axis;
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+} // namespace
+
+std::vector<Meshlet> BuildMeshlets(const std::vector<uint32_t>& indices,
+                                   const std::vector<glm::vec3>& positions,
+                                   const std::vector<glm::vec3>& normals)
+{
+    std::vector<Meshlet> meshlets;
+    size_t triangle_count = indices.size() / 3;
+    if (!std::all_of(indices.begin(), indices.begin() + triangle_count * 3,
+                     [&](uint32_t index) { return index < positions.size(); })) {
+        return meshlets;
+    }
+
+    // Last meshlet which referenced every vertex.
+    std::vector<uint32_t> owner(positions.size(), kNoMeshlet);
+    Meshlet meshlet = {};
+    size_t vertex_count = 0;
+    for (size_t i = 0; i < triangle_count; ++i) {
+        const uint32_t* triangle = &indices[3 * i];
+        uint32_t meshlet_id = static_cast<uint32_t>(meshlets.size());
+        size_t new_vertices = 0;
+        for (size_t j = 0; j < 3; ++j) {
+            bool seen = owner[triangle[j]] == meshlet_id || (j > 0 && triangle[j] == triangle[0]) ||
+                        (j > 1 && triangle[j] == triangle[1]);
+            new_vertices += !seen;
+        }
+        if (meshlet.index_count &&
+            (vertex_count + new_vertices > kMeshletMaxVertices || meshlet.index_count / 3 + 1 > kMeshletMaxTriangles)) {
+            ComputeBounds(indices, positions, normals, meshlet);
+            meshlets.push_back(meshlet);
+            meshlet = { static_cast<uint32_t>(3 * i), 0 };
+            vertex_count = 0;
+            ++meshlet_id;
+        }
+        for (size_t j = 0; j < 3; ++j) {
+            if (owner[triangle[j]] != meshlet_id) {
+                owner[triangle[j]] = meshlet_id;
+                ++vertex_count;
+            }
+        }
+        meshlet.index_count += 3;
+    }
+    if (meshlet.index_count) {
+        ComputeBounds(indices, positions, normals, meshlet);
+        meshlets.push_back(meshlet);
+    }
+    return meshlets;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Limits of one meshlet, the ones recommended for mesh shaders so the clusters can be drawn by them later.
+constexpr size_t kMeshletMaxVertices = 64;
+constexpr size_t kMeshletMaxTriangles = 124;
+
+struct Meshlet {
+    // Triangles [start_index, start_index + index_count) of the input indices.
+    uint32_t start_index;
+    uint32_t index_count;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+    // Every triangle faces away from an eye e for which, with c and r the center and radius of the bounds,
+    // dot(c - e, cone_axis) >= cone_cutoff * length(c - e) + r. A cutoff of 1 never passes the test.
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+};
+
+// Splits an indexed triangle list into runs of consecutive triangles within the limits, so the meshlets keep the
+// order of the indices and need no index buffer of their own. The cone of a meshlet is disabled when the winding of
+// one of its triangles disagrees with its vertex normals, the normals may be empty to skip the cones.
+std::vector<Meshlet> BuildMeshlets(const std::vector<uint32_t>& indices,
+                                   const std::vector<glm::vec3>& positions,
+                                   const std::vector<glm::vec3>& normals);
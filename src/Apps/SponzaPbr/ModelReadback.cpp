@@ -0,0 +1,58 @@
+#include "ModelReadback.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::vector<std::vector<uint8_t>> ReadBackBuffers(RenderDevice& device,
+                                                  const std::vector<std::shared_ptr<Resource>>& buffers)
+{
+    std::vector<std::shared_ptr<Resource>> readbacks;
+    std::shared_ptr<RenderCommandList> command_list = device.CreateRenderCommandList();
+    for (const auto& buffer : buffers) {
+        size_t size = buffer->GetWidth();
+        readbacks.emplace_back(device.CreateBuffer(BindFlag::kCopyDest, size, MemoryType::kReadback));
+        command_list->CopyBuffer(buffer, readbacks.back(), { { 0, 0, size } });
+    }
+    command_list->Close();
+    device.ExecuteCommandLists({ command_list });
+    device.Wait(command_list->GetFenceValue());
+
+    std::vector<std::vector<uint8_t>> data(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        data[i].resize(buffers[i]->GetWidth());
+        std::memcpy(data[i].data(), readbacks[i]->Map(), data[i].size());
+        readbacks[i]->Unmap();
+    }
+    return data;
+}
+
+std::vector<uint32_t> UnpackIndices(const std::vector<uint8_t>& data, gli::format format)
+{
+    std::vector<uint32_t> indices;
+    if (format == gli::format::FORMAT_R16_UINT_PACK16) {
+        indices.resize(data.size() / sizeof(uint16_t));
+        for (size_t i = 0; i < indices.size(); ++i) {
+            uint16_t index;
+            std::memcpy(&index, &data[i * sizeof(uint16_t)], sizeof(index));
+            indices[i] = index;
+        }
+    } else {
+        indices.resize(data.size() / sizeof(uint32_t));
+        std::memcpy(indices.data(), data.data(), indices.size() * sizeof(uint32_t));
+    }
+    return indices;
+}
+
+void PackIndices(const std::vector<uint32_t>& indices, gli::format format, std::vector<uint8_t>& data)
+{
+    if (format == gli::format::FORMAT_R16_UINT_PACK16) {
+        data.resize(std::max(data.size(), indices.size() * sizeof(uint16_t)));
+        for (size_t i = 0; i < indices.size(); ++i) {
+            uint16_t index = static_cast<uint16_t>(indices[i]);
+            std::memcpy(&data[i * sizeof(uint16_t)], &index, sizeof(index));
+        }
+    } else {
+        data.resize(std::max(data.size(), indices.size() * sizeof(uint32_t)));
+        std::memcpy(data.data(), indices.data(), indices.size() * sizeof(uint32_t));
+    }
+}
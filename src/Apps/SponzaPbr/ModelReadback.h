@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <memory>
+#include <vector>
+
+// Copies whole buffers back to the CPU. The data must be uploaded, this waits for the device to finish.
+std::vector<std::vector<uint8_t>> ReadBackBuffers(RenderDevice& device,
+                                                  const std::vector<std::shared_ptr<Resource>>& buffers);
+
+// Conversion between the contents of an index buffer of the given format and 32 bit indices, PackIndices
+// overwrites the beginning of data and keeps the rest.
+std::vector<uint32_t> UnpackIndices(const std::vector<uint8_t>& data, gli::format format);
+void PackIndices(const std::vector<uint32_t>& indices, gli::format format, std::vector<uint8_t>& data);
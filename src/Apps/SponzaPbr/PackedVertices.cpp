@@ -0,0 +1,148 @@
+#include "PackedVertices.h"
+
+#include "ModelReadback.h"
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+constexpr size_t kFloatVertexSize = 2 * sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::vec3);
+
+// Same mapping as EncodeNormal in GBuffer.hlsli.
+glm::vec2 EncodeOctahedral(glm::vec3 n)
+{
+    float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (sum == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    n /= sum;
+    if (n.z >= 0.0f) {
+        return glm::vec2(n.x, n.y);
+    }
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+template <typename T>
+std::vector<T> ToVector(const std::vector<uint8_t>& data, size_t count)
+{
+    std::vector<T> result(count);
+    std::memcpy(result.data(), data.data(), count * sizeof(T));
+    return result;
+}
+
+} // namespace
+
+ScenePackedVertices BuildPackedVertices(RenderDevice& device, SceneModels& scene_list)
+{
+    ScenePackedVertices packed_vertices;
+    size_t float_size = 0;
+    size_t packed_size = 0;
+    std::shared_ptr<RenderCommandList> upload_command_list = device.CreateRenderCommandList();
+    for (auto& model : scene_list) {
+        auto& packed = packed_vertices.emplace_back();
+        size_t vertex_count = model.ia.positions.Count();
+        if (model.bones.HasAnimation() || model.ia.ranges.empty() || !vertex_count ||
+            model.ia.normals.Count() != vertex_count || model.ia.texcoords.Count() != vertex_count ||
+            model.ia.tangents.Count() != vertex_count) {
+            continue;
+        }
+
+        std::vector<std::vector<uint8_t>> data =
+            ReadBackBuffers(device, { model.ia.indices.GetBuffer(), model.ia.positions.GetBuffer(),
+                                      model.ia.normals.GetBuffer(), model.ia.texcoords.GetBuffer(),
+                                      model.ia.tangents.GetBuffer() });
+        if (data[1].size() < vertex_count * sizeof(glm::vec3) || data[2].size() < vertex_count * sizeof(glm::vec3) ||
+            data[3].size() < vertex_count * sizeof(glm::vec2) || data[4].size() < vertex_count * sizeof(glm::vec3)) {
+            continue;
+        }
+        std::vector<uint32_t> indices = UnpackIndices(data[0], model.ia.indices.Format());
+        std::vector<glm::vec3> positions = ToVector<glm::vec3>(data[1], vertex_count);
+        std::vector<glm::vec3> normals = ToVector<glm::vec3>(data[2], vertex_count);
+        std::vector<glm::vec2> texcoords = ToVector<glm::vec2>(data[3], vertex_count);
+        std::vector<glm::vec3> tangents = ToVector<glm::vec3>(data[4], vertex_count);
+
+        // Every vertex is quantized within the bounds of the range which references it. If ranges share vertices,
+        // all of them use the bounds of the whole model.
+        size_t range_count = model.ia.ranges.size();
+        std::vector<uint32_t> owner(vertex_count, static_cast<uint32_t>(range_count));
+        bool valid = true;
+        bool shared = false;
+        for (uint32_t range_id = 0; valid && range_id < range_count; ++range_id) {
+            const auto& range = model.ia.ranges[range_id];
+            valid &= range.start_index_location + range.index_count <= indices.size();
+            for (uint32_t i = 0; valid && i < range.index_count; ++i) {
+                int64_t vertex = indices[range.start_index_location + i];
+                vertex += range.base_vertex_location;
+                valid &= vertex >= 0 && vertex < static_cast<int64_t>(vertex_count);
+                if (!valid) {
+                    break;
+                }
+                shared |= owner[vertex] != range_count && owner[vertex] != range_id;
+                owner[vertex] = range_id;
+            }
+        }
+        if (!valid) {
+            continue;
+        }
+
+        // The last box bounds the whole model.
+        std::vector<AABB> boxes(range_count + 1, { glm::vec3(std::numeric_limits<float>::max()),
+                                                   glm::vec3(std::numeric_limits<float>::lowest()) });
+        for (size_t i = 0; i < vertex_count; ++i) {
+            if (shared) {
+                owner[i] = static_cast<uint32_t>(range_count);
+            }
+            for (AABB* box : { &boxes[owner[i]], &boxes.back() }) {
+                box->min = glm::min(box->min, positions[i]);
+                box->max = glm::max(box->max, positions[i]);
+            }
+        }
+        for (size_t range_id = 0; range_id < range_count; ++range_id) {
+            const AABB& box = boxes[shared ? range_count : range_id];
+            if (box.min.x > box.max.x) {
+                packed.dequantize.emplace_back(1.0f);
+            } else {
+                packed.dequantize.push_back(glm::translate(box.min) * glm::scale(box.max - box.min));
+            }
+        }
+
+        std::vector<PackedVertex> vertices(vertex_count);
+        for (size_t i = 0; i < vertex_count; ++i) {
+            const AABB& box = boxes[owner[i]];
+            glm::vec3 extent = box.max - box.min;
+            for (int j = 0; j < 3; ++j) {
+                float value = extent[j] > 0.0f ? (positions[i][j] - box.min[j]) / extent[j] : 0.0f;
+                vertices[i].position[j] = static_cast<uint16_t>(std::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+            }
+            vertices[i].position[3] = 0;
+            vertices[i].normal = glm::packSnorm2x16(EncodeOctahedral(normals[i]));
+            vertices[i].tangent = glm::packSnorm2x16(EncodeOctahedral(tangents[i]));
+            vertices[i].texcoord = glm::packHalf2x16(texcoords[i]);
+        }
+
+        packed.vertices = device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                              sizeof(PackedVertex) * vertices.size());
+        upload_command_list->UpdateSubresource(packed.vertices, 0, vertices.data());
+        float_size += kFloatVertexSize * vertex_count;
+        packed_size += sizeof(PackedVertex) * vertex_count;
+    }
+    upload_command_list->Close();
+    device.ExecuteCommandLists({ upload_command_list });
+    device.Wait(upload_command_list->GetFenceValue());
+
+    std::cout << "Packed vertices: " << float_size / 1024 << " KB in float streams, " << packed_size / 1024
+              << " KB packed" << std::endl;
+    return packed_vertices;
+}
+
+bool HasPackedVertices(const ScenePackedVertices& packed_vertices, size_t model_id)
+{
+    return model_id < packed_vertices.size() && packed_vertices[model_id].vertices;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "SceneLods.h"
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Layout of PackedVertex in PackedVertex.hlsli, 20 bytes in one stream instead of 44 bytes in four float streams.
+struct PackedVertex {
+    // Unorm within the bounds of the range, w is unused.
+    uint16_t position[4];
+    // Octahedral, snorm 2x16.
+    uint32_t normal;
+    uint32_t tangent;
+    // Half 2x16.
+    uint32_t texcoord;
+};
+
+struct PackedModel {
+    std::shared_ptr<Resource> vertices;
+    // Maps the quantized positions of every range to model space.
+    std::vector<glm::mat4> dequantize;
+};
+
+// Models with animation keep the float streams written by the skinning pass and have no packed vertices.
+using ScenePackedVertices = std::vector<PackedModel>;
+
+// Reads the float streams back and builds the packed vertices of every model. The model data must be uploaded,
+// this waits for the device to finish.
+ScenePackedVertices BuildPackedVertices(RenderDevice& device, SceneModels& scene_list);
+
+bool HasPackedVertices(const ScenePackedVertices& packed_vertices, size_t model_id);
+
+// True for programs whose vertex shader reads PackedVertex.hlsli instead of the float streams.
+template <typename Program, typename = void>
+struct IsPackedProgram : std::false_type {};
+
+template <typename Program>
+struct IsPackedProgram<Program, std::void_t<decltype(std::declval<Program&>().vs.srv.packed_vertices)>>
+    : std::true_type {};
+
+template <typename Program>
+void AttachPackedVertices(RenderCommandList& command_list, Program& program, const PackedModel& packed)
+{
+    command_list.Attach(program.vs.cbv.PackedParams, program.vs.cbuffer.PackedParams);
+    command_list.Attach(program.vs.srv.packed_vertices, packed.vertices);
+}
+
+// Draws a range with either vertex format. Packed vertices are read by SV_VertexID, so the base vertex is applied
+// in the vertex shader instead of the draw.
+template <typename Program>
+void DrawRange(RenderCommandList& command_list,
+               Program& program,
+               const ScenePackedVertices& packed_vertices,
+               size_t model_id,
+               size_t range_id,
+               int32_t base_vertex,
+               const RangeLod& lod,
+               uint32_t instance_count)
+{
+    if constexpr (IsPackedProgram<Program>::value) {
+        program.vs.cbuffer.PackedParams.dequantize = glm::transpose(packed_vertices[model_id].dequantize[range_id]);
+        program.vs.cbuffer.PackedParams.base_vertex = base_vertex;
+        command_list.DrawIndexed(lod.index_count, instance_count, lod.start_index_location, 0, 0);
+    } else {
+        command_list.DrawIndexed(lod.index_count, instance_count, lod.start_index_location, base_vertex, 0);
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "HLSLCompiler/Compiler.h"
+#include "Instance/BaseTypes.h"
+#include "RenderDevice/RenderDevice.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Programs of one ProgramHolder type for every value of a define on one of its shaders, so a settings change selects
+// a program instead of recompiling the shaders on the render thread. The constructor builds the initial value and
+// compiles the shaders of the other values passed to it on the thread pool, which doesn't touch the device. Build
+// creates the ProgramHolder of a value from its compiled shaders; the scene calls it on the render thread between
+// frames, see IPass::BuildProgram, and only passes a settings change on once every pass has its programs for it.
+//
+// Every permutation has its own constant buffers, passes write them to the program returned by Get every frame.
+template <typename Holder>
+class ProgramPermutations {
+public:
+    // get_shader returns the shader of a program the define is set on, e.g. program.ps.
+    template <typename GetShader>
+    ProgramPermutations(RenderDevice& device,
+                        ThreadPool& thread_pool,
+                        const std::string& name,
+                        const std::vector<uint32_t>& values,
+                        uint32_t value,
+                        const std::string& define,
+                        GetShader get_shader)
+        : m_device(device)
+        , m_thread_pool(thread_pool)
+        , m_name(name)
+        , m_define(define)
+        , m_get_desc([get_shader](Holder& program) -> ShaderDesc& { return get_shader(program).desc; })
+        , m_set_blob([get_shader](Holder& program, std::vector<uint8_t> blob) {
+            get_shader(program).blob = std::move(blob);
+        })
+    {
+        m_programs[value] = std::make_unique<Holder>(
+            m_device, [&](Holder& program) { m_get_desc(program).define[m_define] = std::to_string(value); });
+        m_active = m_programs[value].get();
+        for (uint32_t permutation : values) {
+            if (permutation != value) {
+                StartCompile(permutation);
+            }
+        }
+    }
+
+    Holder& Get()
+    {
+        return *m_active;
+    }
+
+    bool IsBuilt(uint32_t value) const
+    {
+        return m_programs.count(value);
+    }
+
+    // Creates the program of value once its shaders are compiled, starting the compilation if it wasn't started.
+    // Without wait nothing blocks and false is returned while they are compiling. Returns false if value is built.
+    bool Build(uint32_t value, bool wait)
+    {
+        if (IsBuilt(value)) {
+            return false;
+        }
+        if (!m_compiles.count(value)) {
+            StartCompile(value);
+        }
+        Compilation& compilation = m_compiles.at(value);
+        if (!wait && compilation.blob.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ShaderDesc desc = compilation.desc;
+        std::vector<uint8_t> blob = compilation.blob.get();
+        m_compiles.erase(value);
+        m_programs[value] = std::make_unique<Holder>(m_device, [&](Holder& program) {
+            m_get_desc(program) = desc;
+            m_set_blob(program, std::move(blob));
+        });
+        std::cout << m_name << ": permutation " << value << " built in " << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                  << " ms, " << m_hits << " hits, " << m_misses << " misses" << std::endl;
+        return true;
+    }
+
+    // A value which is not built yet is built first, waiting for its shaders.
+    void Select(uint32_t value)
+    {
+        if (IsBuilt(value)) {
+            ++m_hits;
+        } else {
+            ++m_misses;
+            Build(value, true);
+        }
+        m_active = m_programs[value].get();
+    }
+
+private:
+    struct Compilation {
+        ShaderDesc desc;
+        std::future<std::vector<uint8_t>> blob;
+    };
+
+    // Compiles the shader of the active program with the define changed, the desc is kept to create the program.
+    void StartCompile(uint32_t value)
+    {
+        ShaderDesc desc = m_get_desc(*m_active);
+        desc.define[m_define] = std::to_string(value);
+        ShaderBlobType blob_type = m_device.GetSupportedShaderBlobType();
+        m_compiles[value] = { desc, m_thread_pool.Push([desc, blob_type] { return Compile(desc, blob_type); }) };
+    }
+
+    RenderDevice& m_device;
+    ThreadPool& m_thread_pool;
+    std::string m_name;
+    std::string m_define;
+    std::function<ShaderDesc&(Holder& program)> m_get_desc;
+    std::function<void(Holder& program, std::vector<uint8_t> blob)> m_set_blob;
+    std::map<uint32_t, std::unique_ptr<Holder>> m_programs;
+    Holder* m_active = nullptr;
+    // Values whose shaders are compiling or compiled but have no program yet.
+    std::map<uint32_t, Compilation> m_compiles;
+    // Selects which found their program built and which had to build it.
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
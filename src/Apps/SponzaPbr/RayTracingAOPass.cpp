@@ -1,5 +1,7 @@
 #include "RayTracingAOPass.h"
 
+#include "RenderGraph.h"
+
 RayTracingAOPass::RayTracingAOPass(RenderDevice& device,
                                    RenderCommandList& command_list,
                                    const Input& input,
@@ -10,10 +12,12 @@ RayTracingAOPass::RayTracingAOPass(RenderDevice& device,
     , m_width(width)
     , m_height(height)
     , m_raytracing_program(device,
-                           [&](auto& program) {
-                               program.lib.desc.define["SAMPLE_COUNT"] =
-                                   std::to_string(m_settings.Get<uint32_t>("sample_count"));
-                           })
+                           input.thread_pool,
+                           "RayTracingAOPass",
+                           GetSampleCounts(),
+                           m_settings.sample_count,
+                           "SAMPLE_COUNT",
+                           [](auto& program) -> auto& { return program.lib; })
     , m_program_blur(device)
 {
     CreateSizeDependentResources();
@@ -24,7 +28,8 @@ RayTracingAOPass::RayTracingAOPass(RenderDevice& device,
     });
 
     std::vector<glm::uvec4> data;
-    for (auto& model : m_input.scene_list) {
+    for (size_t model_id = 0; model_id < m_input.scene_list.size(); ++model_id) {
+        auto& model = m_input.scene_list[model_id];
         for (auto& range : model.ia.ranges) {
             auto& material = model.GetMaterial(range.id);
             glm::uvec4 info = {};
@@ -53,7 +58,8 @@ RayTracingAOPass::RayTracingAOPass(RenderDevice& device,
                 view_desc));
             info.z = m_views.back()->GetDescriptorId();
 
-            data.emplace_back(info);
+            // InstanceID() of every top level entry of the range.
+            data.insert(data.end(), GetInstanceCount(m_input.instances, model_id), info);
         }
     }
 
@@ -61,23 +67,35 @@ RayTracingAOPass::RayTracingAOPass(RenderDevice& device,
     command_list.UpdateSubresource(m_buffer, 0, data.data());
 }
 
-void RayTracingAOPass::OnUpdate() {}
+void RayTracingAOPass::OnUpdate()
+{
+    auto& program = m_raytracing_program.Get();
+
+    glm::mat4 projection, view, model;
+    m_input.camera.GetMatrix(projection, view, model);
+    program.lib.cbuffer.Settings.inverted_mvp = glm::transpose(glm::inverse(projection * view));
+}
 
 void RayTracingAOPass::OnRender(RenderCommandList& command_list)
 {
-    if (!m_settings.Get<bool>("use_rtao")) {
+    if (!m_settings.use_rtao) {
         return;
     }
 
-    m_raytracing_program.lib.cbuffer.Settings.ao_radius = m_settings.Get<float>("ao_radius");
-    m_raytracing_program.lib.cbuffer.Settings.num_rays = m_settings.Get<int32_t>("rtao_num_rays");
-    m_raytracing_program.lib.cbuffer.Settings.use_alpha_test = m_settings.Get<bool>("use_alpha_test");
+    auto& program = m_raytracing_program.Get();
+
+    program.lib.cbuffer.Settings.ao_radius = m_settings.ao_radius;
+    program.lib.cbuffer.Settings.num_rays = m_settings.rtao_num_rays;
+    program.lib.cbuffer.Settings.use_alpha_test = m_settings.use_alpha_test;
 
     auto build_geometry = [&](bool force_rebuild) {
         size_t id = 0;
+        size_t geometry_id = 0;
         size_t node_updated = 0;
         bool has_dynamic_geometry = false;
-        for (auto& model : m_input.scene_list) {
+        for (size_t model_id = 0; model_id < m_input.scene_list.size(); ++model_id) {
+            auto& model = m_input.scene_list[model_id];
+            const auto& transforms = m_input.instances[model_id].transforms;
             for (auto& range : model.ia.ranges) {
                 auto& material = model.GetMaterial(range.id);
                 RaytracingGeometryFlags flags = RaytracingGeometryFlags::kOpaque;
@@ -86,6 +104,8 @@ void RayTracingAOPass::OnRender(RenderCommandList& command_list)
                 }
 
                 size_t cur_id = id++;
+                size_t first_geometry_id = geometry_id;
+                geometry_id += transforms.size();
                 if (!force_rebuild && !model.ia.positions.IsDynamic()) {
                     continue;
                 }
@@ -109,8 +129,8 @@ void RayTracingAOPass::OnRender(RenderCommandList& command_list)
                     m_bottom.resize(cur_id + 1);
                 }
 
-                if (cur_id >= m_geometry.size()) {
-                    m_geometry.resize(cur_id + 1);
+                if (geometry_id > m_geometry.size()) {
+                    m_geometry.resize(geometry_id);
                 }
 
                 auto& dst = m_bottom[cur_id];
@@ -133,7 +153,9 @@ void RayTracingAOPass::OnRender(RenderCommandList& command_list)
                     command_list.BuildBottomLevelAS(src, dst, descs, build_flags);
                 }
 
-                m_geometry[cur_id] = { dst, glm::transpose(model.matrix) };
+                for (size_t i = 0; i < transforms.size(); ++i) {
+                    m_geometry[first_geometry_id + i] = { dst, glm::transpose(transforms[i] * model.matrix) };
+                }
                 ++node_updated;
             }
         }
@@ -157,23 +179,23 @@ void RayTracingAOPass::OnRender(RenderCommandList& command_list)
     build_geometry(!m_is_initialized);
 
     if (!m_is_initialized) {
-        m_raytracing_program.lib.cbuffer.Settings.frame_index = 0;
+        program.lib.cbuffer.Settings.frame_index = 0;
     } else {
-        ++m_raytracing_program.lib.cbuffer.Settings.frame_index;
+        ++program.lib.cbuffer.Settings.frame_index;
     }
     m_is_initialized = true;
 
-    command_list.UseProgram(m_raytracing_program);
-    command_list.Attach(m_raytracing_program.lib.cbv.Settings, m_raytracing_program.lib.cbuffer.Settings);
-    command_list.Attach(m_raytracing_program.lib.srv.gPosition, m_input.geometry_pass.position);
-    command_list.Attach(m_raytracing_program.lib.srv.gNormal, m_input.geometry_pass.normal);
-    command_list.Attach(m_raytracing_program.lib.srv.geometry, m_top);
-    command_list.Attach(m_raytracing_program.lib.uav.result, m_ao);
-    command_list.Attach(m_raytracing_program.lib.sampler.gSampler, m_sampler);
-    command_list.Attach(m_raytracing_program.lib.srv.descriptor_offset, m_buffer);
+    command_list.UseProgram(program);
+    command_list.Attach(program.lib.cbv.Settings, program.lib.cbuffer.Settings);
+    command_list.Attach(program.lib.srv.gDepth, m_input.geometry_pass.dsv);
+    command_list.Attach(program.lib.srv.gNormal, m_input.geometry_pass.normal);
+    command_list.Attach(program.lib.srv.geometry, m_top);
+    command_list.Attach(program.lib.uav.result, m_ao);
+    command_list.Attach(program.lib.sampler.gSampler, m_sampler);
+    command_list.Attach(program.lib.srv.descriptor_offset, m_buffer);
     command_list.DispatchRays(m_width, m_height, 1);
 
-    if (m_settings.Get<bool>("use_ao_blur")) {
+    if (m_settings.use_ao_blur) {
         command_list.SetViewport(0, 0, m_width, m_height);
         command_list.UseProgram(m_program_blur);
         command_list.Attach(m_program_blur.ps.uav.out_uav, m_ao_blur);
@@ -211,12 +233,36 @@ void RayTracingAOPass::CreateSizeDependentResources()
                                        gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
 }
 
-void RayTracingAOPass::OnModifySponzaSettings(const SponzaSettings& settings)
+SponzaSettingsMask RayTracingAOPass::GetSponzaSettingsSubscription() const
+{
+    return {
+        SponzaSetting::sample_count, SponzaSetting::use_rtao,
+        SponzaSetting::ao_radius, SponzaSetting::rtao_num_rays, SponzaSetting::use_alpha_test,
+        SponzaSetting::use_ao_blur
+    };
+}
+
+void RayTracingAOPass::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
-    SponzaSettings prev = m_settings;
     m_settings = settings;
-    if (prev.Get<uint32_t>("sample_count") != m_settings.Get<uint32_t>("sample_count")) {
-        m_raytracing_program.lib.desc.define["SAMPLE_COUNT"] = std::to_string(m_settings.Get<uint32_t>("sample_count"));
-        m_raytracing_program.UpdateProgram();
+    if (changes.Test(SponzaSetting::sample_count)) {
+        m_raytracing_program.Select(m_settings.sample_count);
     }
 }
+
+bool RayTracingAOPass::HasPrograms(const SponzaSettingsValues& settings) const
+{
+    return m_raytracing_program.IsBuilt(settings.sample_count);
+}
+
+bool RayTracingAOPass::BuildProgram(const SponzaSettingsValues& settings, bool wait)
+{
+    return m_raytracing_program.Build(settings.sample_count, wait);
+}
+
+void RayTracingAOPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.Read(m_input.geometry_pass.dsv);
+    builder.Read(m_input.geometry_pass.normal);
+    builder.Write(output.ao);
+}
@@ -3,9 +3,11 @@
 #include "Device/Device.h"
 #include "Geometry/Geometry.h"
 #include "GeometryPass.h"
+#include "ProgramPermutations.h"
 #include "ProgramRef/RayTracingAO.h"
 #include "ProgramRef/SSAOBlurPass_PS.h"
 #include "ProgramRef/SSAOPass_VS.h"
+#include "SceneInstances.h"
 #include "SponzaSettings.h"
 
 class RayTracingAOPass : public IPass {
@@ -13,8 +15,10 @@ public:
     struct Input {
         GeometryPass::Output& geometry_pass;
         SceneModels& scene_list;
+        const SceneInstances& instances;
         Model& square;
         const Camera& camera;
+        ThreadPool& thread_pool;
     };
 
     struct Output {
@@ -26,17 +30,22 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual bool HasPrograms(const SponzaSettingsValues& settings) const override;
+    virtual bool BuildProgram(const SponzaSettingsValues& settings, bool wait) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
     void CreateSizeDependentResources();
 
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     int m_width;
     int m_height;
-    ProgramHolder<RayTracingAO> m_raytracing_program;
+    ProgramPermutations<ProgramHolder<RayTracingAO>> m_raytracing_program;
     ProgramHolder<SSAOBlurPass_PS, SSAOPass_VS> m_program_blur;
 
     std::vector<std::shared_ptr<Resource>> m_bottom;
@@ -46,6 +55,7 @@ private:
     bool m_is_initialized = false;
     std::shared_ptr<Resource> m_ao;
     std::shared_ptr<Resource> m_ao_blur;
+    // One top level entry per instance of every range, the bottom level structures are shared by the instances.
     std::vector<std::pair<std::shared_ptr<Resource>, glm::mat4>> m_geometry;
     std::shared_ptr<Resource> m_sampler;
     std::shared_ptr<Resource> m_buffer;
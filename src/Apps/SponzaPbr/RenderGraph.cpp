@@ -0,0 +1,229 @@
+#include "RenderGraph.h"
+
+#include <gli/gli.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <tuple>
+
+void RenderGraphBuilder::Read(const std::shared_ptr<Resource>& slot)
+{
+    m_reads.push_back(&slot);
+}
+
+void RenderGraphBuilder::Write(const std::shared_ptr<Resource>& slot)
+{
+    m_writes.push_back(&slot);
+}
+
+void RenderGraphBuilder::CreateTransient(std::shared_ptr<Resource>& slot, const RenderGraphTextureDesc& desc)
+{
+    m_transients.push_back({ &slot, desc });
+    m_writes.push_back(&slot);
+}
+
+void RenderGraphBuilder::Alias(std::shared_ptr<Resource>& slot, const std::shared_ptr<Resource>& source)
+{
+    m_aliases.push_back({ &slot, &source });
+}
+
+void RenderGraphBuilder::SideEffect()
+{
+    m_side_effect = true;
+}
+
+void RenderGraphBuilder::AllowParallelRecording()
+{
+    m_allow_parallel_recording = true;
+}
+
+bool RenderGraph::PhysicalKey::operator<(const PhysicalKey& other) const
+{
+    return std::tie(format, sample_count, width, height, depth, mip_levels) <
+           std::tie(other.format, other.sample_count, other.width, other.height, other.depth, other.mip_levels);
+}
+
+RenderGraph::RenderGraph(RenderDevice& device)
+    : m_device(device)
+{
+}
+
+void RenderGraph::AddPass(const std::string& name, IPass& pass)
+{
+    m_passes.push_back({ name, pass });
+}
+
+void RenderGraph::AddOutput(const std::shared_ptr<Resource>& slot)
+{
+    m_outputs.push_back(&slot);
+}
+
+RenderGraph::PhysicalKey RenderGraph::GetKey(const RenderGraphTextureDesc& desc)
+{
+    return { desc.format, desc.sample_count, desc.width, desc.height, desc.depth, desc.mip_levels };
+}
+
+uint64_t RenderGraph::GetSize(const PhysicalKey& key)
+{
+    gli::extent3d block_extent = gli::block_extent(key.format);
+    uint64_t size = 0;
+    for (int mip = 0; mip < key.mip_levels; ++mip) {
+        uint64_t width = std::max(key.width >> mip, 1);
+        uint64_t height = std::max(key.height >> mip, 1);
+        uint64_t blocks_x = (width + block_extent.x - 1) / block_extent.x;
+        uint64_t blocks_y = (height + block_extent.y - 1) / block_extent.y;
+        size += blocks_x * blocks_y * gli::block_size(key.format);
+    }
+    return size * key.depth * key.sample_count;
+}
+
+void RenderGraph::Compile()
+{
+    std::vector<RenderGraphBuilder> builders(m_passes.size());
+    for (size_t i = 0; i < m_passes.size(); ++i) {
+        m_passes[i].pass.get().OnSetupRenderGraph(builders[i]);
+    }
+
+    struct Logical {
+        const RenderGraphTextureDesc* desc = nullptr;
+        size_t first_use = std::numeric_limits<size_t>::max();
+        size_t last_use = 0;
+        size_t physical = std::numeric_limits<size_t>::max();
+    };
+    std::vector<Logical> logicals;
+    std::map<const std::shared_ptr<Resource>*, size_t> slot_to_logical;
+    auto get_logical = [&](const std::shared_ptr<Resource>* slot) {
+        auto it = slot_to_logical.find(slot);
+        if (it != slot_to_logical.end()) {
+            return it->second;
+        }
+        logicals.emplace_back();
+        return slot_to_logical[slot] = logicals.size() - 1;
+    };
+
+    std::vector<std::set<size_t>> pass_reads(m_passes.size());
+    std::vector<std::set<size_t>> pass_writes(m_passes.size());
+    for (size_t i = 0; i < m_passes.size(); ++i) {
+        auto& builder = builders[i];
+        for (auto& transient : builder.m_transients) {
+            logicals.emplace_back();
+            logicals.back().desc = &transient.desc;
+            slot_to_logical[transient.slot] = logicals.size() - 1;
+        }
+        for (auto& alias : builder.m_aliases) {
+            size_t logical = get_logical(alias.source);
+            slot_to_logical[alias.slot] = logical;
+            pass_writes[i].insert(logical);
+        }
+        for (auto& slot : builder.m_writes) {
+            pass_writes[i].insert(get_logical(slot));
+        }
+        for (auto& slot : builder.m_reads) {
+            pass_reads[i].insert(get_logical(slot));
+        }
+    }
+
+    std::set<size_t> live;
+    for (auto& slot : m_outputs) {
+        auto it = slot_to_logical.find(slot);
+        if (it != slot_to_logical.end()) {
+            live.insert(it->second);
+        }
+    }
+
+    std::vector<bool> is_active(m_passes.size());
+    for (size_t i = m_passes.size(); i-- > 0;) {
+        auto& builder = builders[i];
+        bool active = builder.m_side_effect || (pass_reads[i].empty() && pass_writes[i].empty());
+        for (size_t logical : pass_writes[i]) {
+            active |= live.count(logical) != 0;
+        }
+        if (!active) {
+            continue;
+        }
+        is_active[i] = true;
+        live.insert(pass_reads[i].begin(), pass_reads[i].end());
+    }
+
+    m_active_passes.clear();
+    for (size_t i = 0; i < m_passes.size(); ++i) {
+        if (!is_active[i]) {
+            continue;
+        }
+        size_t index = m_active_passes.size();
+        m_active_passes.push_back(m_passes[i]);
+        m_active_passes.back().allow_parallel_recording = builders[i].m_allow_parallel_recording;
+        for (auto* accesses : { &pass_reads[i], &pass_writes[i] }) {
+            for (size_t logical : *accesses) {
+                logicals[logical].first_use = std::min(logicals[logical].first_use, index);
+                logicals[logical].last_use = std::max(logicals[logical].last_use, index);
+            }
+        }
+    }
+
+    std::vector<size_t> order;
+    for (size_t i = 0; i < logicals.size(); ++i) {
+        if (logicals[i].desc && logicals[i].first_use != std::numeric_limits<size_t>::max()) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return logicals[a].first_use < logicals[b].first_use; });
+
+    std::vector<Physical> physical;
+    for (size_t i : order) {
+        auto& logical = logicals[i];
+        PhysicalKey key = GetKey(*logical.desc);
+        for (size_t j = 0; j < physical.size(); ++j) {
+            if (!(physical[j].key < key) && !(key < physical[j].key) && physical[j].last_use < logical.first_use) {
+                logical.physical = j;
+                break;
+            }
+        }
+        if (logical.physical == std::numeric_limits<size_t>::max()) {
+            physical.push_back({ key, logical.desc->bind_flag, 0, nullptr });
+            logical.physical = physical.size() - 1;
+        }
+        auto& entry = physical[logical.physical];
+        entry.bind_flag = entry.bind_flag | logical.desc->bind_flag;
+        entry.last_use = logical.last_use;
+    }
+
+    m_stats = {};
+    for (auto& entry : physical) {
+        auto it = std::find_if(m_physical.begin(), m_physical.end(), [&](const Physical& prev) {
+            return prev.resource && !(prev.key < entry.key) && !(entry.key < prev.key) &&
+                   prev.bind_flag == entry.bind_flag;
+        });
+        if (it != m_physical.end()) {
+            entry.resource = std::move(it->resource);
+        } else {
+            entry.resource = m_device.CreateTexture(entry.bind_flag, entry.key.format, entry.key.sample_count,
+                                                    entry.key.width, entry.key.height, entry.key.depth,
+                                                    entry.key.mip_levels);
+        }
+        ++m_stats.physical_count;
+        m_stats.physical_bytes += GetSize(entry.key);
+    }
+    m_physical = std::move(physical);
+
+    for (auto& builder : builders) {
+        for (auto& transient : builder.m_transients) {
+            auto& logical = logicals[slot_to_logical[transient.slot]];
+            if (logical.physical == std::numeric_limits<size_t>::max()) {
+                transient.slot->reset();
+                continue;
+            }
+            *transient.slot = m_physical[logical.physical].resource;
+            ++m_stats.transient_count;
+            m_stats.transient_bytes += GetSize(GetKey(transient.desc));
+        }
+    }
+    for (auto& builder : builders) {
+        for (auto& alias : builder.m_aliases) {
+            *alias.slot = *alias.source;
+        }
+    }
+    m_stats.culled_pass_count = m_passes.size() - m_active_passes.size();
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "RenderDevice/RenderDevice.h"
+#include "RenderPass.h"
+
+#include <gli/format.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct RenderGraphTextureDesc {
+    BindFlag bind_flag;
+    gli::format format;
+    uint32_t sample_count;
+    int width;
+    int height;
+    int depth = 1;
+    int mip_levels = 1;
+};
+
+class RenderGraphBuilder {
+public:
+    // Resources are identified by the address of the slot that holds them, which is how passes are already wired
+    // together through their Input/Output structs.
+    void Read(const std::shared_ptr<Resource>& slot);
+    void Write(const std::shared_ptr<Resource>& slot);
+    // The graph allocates the texture and stores it into the slot on compile. Transient textures with
+    // non-overlapping lifetimes share the same allocation.
+    void CreateTransient(std::shared_ptr<Resource>& slot, const RenderGraphTextureDesc& desc);
+    // Makes the slot refer to the same resource as the source slot, e.g. a pass output that is one of its
+    // internal transient textures.
+    void Alias(std::shared_ptr<Resource>& slot, const std::shared_ptr<Resource>& source);
+    // The pass does work that is not visible through its declared writes and must never be culled.
+    void SideEffect();
+    // OnRender only touches state owned by the pass, so it may be recorded on a worker thread. Such a pass must not
+    // create device objects in OnRender, which includes the upload buffers of UpdateSubresource and the vertex
+    // buffers of IAVertexBuffer, since RenderDevice is not known to be safe to use from several threads. They are
+    // created in IPass::OnUpload instead.
+    void AllowParallelRecording();
+
+private:
+    friend class RenderGraph;
+
+    struct Transient {
+        std::shared_ptr<Resource>* slot;
+        RenderGraphTextureDesc desc;
+    };
+
+    struct AliasDesc {
+        std::shared_ptr<Resource>* slot;
+        const std::shared_ptr<Resource>* source;
+    };
+
+    std::vector<const std::shared_ptr<Resource>*> m_reads;
+    std::vector<const std::shared_ptr<Resource>*> m_writes;
+    std::vector<Transient> m_transients;
+    std::vector<AliasDesc> m_aliases;
+    bool m_side_effect = false;
+    bool m_allow_parallel_recording = false;
+};
+
+class RenderGraph {
+public:
+    struct PassDesc {
+        std::string name;
+        std::reference_wrapper<IPass> pass;
+        bool allow_parallel_recording = false;
+    };
+
+    struct Stats {
+        size_t transient_count = 0;
+        size_t physical_count = 0;
+        uint64_t transient_bytes = 0;
+        uint64_t physical_bytes = 0;
+        size_t culled_pass_count = 0;
+    };
+
+    RenderGraph(RenderDevice& device);
+
+    void AddPass(const std::string& name, IPass& pass);
+    // Marks a resource consumed outside of the graph, e.g. the back buffer. Passes writing it are never culled.
+    void AddOutput(const std::shared_ptr<Resource>& slot);
+    void Compile();
+
+    const std::vector<PassDesc>& GetPasses() const
+    {
+        return m_passes;
+    }
+
+    const std::vector<PassDesc>& GetActivePasses() const
+    {
+        return m_active_passes;
+    }
+
+    const Stats& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct PhysicalKey {
+        gli::format format;
+        uint32_t sample_count;
+        int width;
+        int height;
+        int depth;
+        int mip_levels;
+
+        bool operator<(const PhysicalKey& other) const;
+    };
+
+    struct Physical {
+        PhysicalKey key;
+        BindFlag bind_flag;
+        size_t last_use;
+        std::shared_ptr<Resource> resource;
+    };
+
+    static PhysicalKey GetKey(const RenderGraphTextureDesc& desc);
+    static uint64_t GetSize(const PhysicalKey& key);
+
+    RenderDevice& m_device;
+    std::vector<PassDesc> m_passes;
+    std::vector<PassDesc> m_active_passes;
+    std::vector<const std::shared_ptr<Resource>*> m_outputs;
+    std::vector<Physical> m_physical;
+    Stats m_stats;
+};
@@ -7,11 +7,36 @@
 #include <memory>
 
 class RenderCommandList;
+class RenderGraphBuilder;
 
-class IPass : public WindowEvents, public IModifySponzaSettings {
+class IPass : public WindowEvents {
 public:
     virtual ~IPass() = default;
     virtual void OnUpdate() {}
+    // Called on the render thread after OnUpdate for the passes which are not culled. The device objects of the frame
+    // are created here and their uploads recorded into command_list, which is submitted ahead of the passes, so
+    // OnRender only records work with objects that already exist.
+    virtual void OnUpload(RenderCommandList& command_list) {}
     virtual void OnRender(RenderCommandList& command_list) = 0;
     virtual void OnResize(int width, int height) {}
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) {}
+    // OnModifySponzaSettings is only called when one of these settings changes, changes holds the subset that did.
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const
+    {
+        return {};
+    }
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes) {}
+    // Passes whose programs depend on settings, see ProgramPermutations. The scene calls BuildProgram on the render
+    // thread between frames and holds OnModifySponzaSettings back until HasPrograms is true for the new settings,
+    // so the previous programs and resources are used until then.
+    virtual bool HasPrograms(const SponzaSettingsValues& settings) const
+    {
+        return true;
+    }
+    // Creates one missing program settings need. Without wait returns false while its shaders are still compiling,
+    // otherwise only if nothing was missing.
+    virtual bool BuildProgram(const SponzaSettingsValues& settings, bool wait)
+    {
+        return false;
+    }
 };
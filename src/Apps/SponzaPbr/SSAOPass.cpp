@@ -1,10 +1,12 @@
 #include "SSAOPass.h"
 
+#include "RenderGraph.h"
 #include "Utilities/FormatHelper.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <random>
 
@@ -18,7 +20,13 @@ SSAOPass::SSAOPass(RenderDevice& device, RenderCommandList& command_list, const
     , m_input(input)
     , m_width(width)
     , m_height(height)
-    , m_program(device, std::bind(&SSAOPass::SetDefines, this, std::placeholders::_1))
+    , m_program(device,
+                input.thread_pool,
+                "SSAOPass",
+                GetSampleCounts(),
+                m_settings.sample_count,
+                "SAMPLE_COUNT",
+                [](auto& program) -> auto& { return program.ps; })
     , m_program_blur(device)
 {
     m_sampler = m_device.CreateSampler({
@@ -26,11 +34,11 @@ SSAOPass::SSAOPass(RenderDevice& device, RenderCommandList& command_list, const
         SamplerTextureAddressMode::kWrap,
         SamplerComparisonFunc::kNever,
     });
-    CreateSizeDependentResources();
 
     std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
-    int kernel_size = m_program.ps.cbuffer.SSAOBuffer.samples.size();
+    m_kernel.resize(m_program.Get().ps.cbuffer.SSAOBuffer.samples.size());
+    int kernel_size = m_kernel.size();
     for (int i = 0; i < kernel_size; ++i) {
         glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0,
                          randomFloats(generator));
@@ -41,7 +49,7 @@ SSAOPass::SSAOPass(RenderDevice& device, RenderCommandList& command_list, const
         // Scale samples s.t. they're more aligned to center of kernel
         scale = lerp(0.1f, 1.0f, scale * scale);
         sample *= scale;
-        m_program.ps.cbuffer.SSAOBuffer.samples[i] = glm::vec4(sample, 1.0f);
+        m_kernel[i] = glm::vec4(sample, 1.0f);
     }
 
     std::vector<glm::vec4> ssaoNoise;
@@ -59,50 +67,55 @@ SSAOPass::SSAOPass(RenderDevice& device, RenderCommandList& command_list, const
 
 void SSAOPass::OnUpdate()
 {
-    m_program.ps.cbuffer.SSAOBuffer.ao_radius = m_settings.Get<float>("ao_radius");
-    m_program.ps.cbuffer.SSAOBuffer.width = m_width;
-    m_program.ps.cbuffer.SSAOBuffer.height = m_height;
+    auto& program = m_program.Get();
+
+    std::copy(m_kernel.begin(), m_kernel.end(), program.ps.cbuffer.SSAOBuffer.samples.begin());
+    program.ps.cbuffer.SSAOBuffer.ao_radius = m_settings.ao_radius;
+    program.ps.cbuffer.SSAOBuffer.width = m_width;
+    program.ps.cbuffer.SSAOBuffer.height = m_height;
 
     glm::mat4 projection, view, model;
     m_input.camera.GetMatrix(projection, view, model);
-    m_program.ps.cbuffer.SSAOBuffer.projection = glm::transpose(projection);
-    m_program.ps.cbuffer.SSAOBuffer.view = glm::transpose(view);
-    m_program.ps.cbuffer.SSAOBuffer.viewInverse =
+    program.ps.cbuffer.SSAOBuffer.projection = glm::transpose(projection);
+    program.ps.cbuffer.SSAOBuffer.viewInverse =
         glm::transpose(glm::transpose(glm::inverse(m_input.camera.GetViewMatrix())));
+    program.ps.cbuffer.SSAOBuffer.projectionInverse = glm::transpose(glm::inverse(projection));
 }
 
 void SSAOPass::OnRender(RenderCommandList& command_list)
 {
-    if (!m_settings.Get<bool>("use_ssao")) {
+    if (!m_settings.use_ssao) {
         return;
     }
 
+    auto& program = m_program.Get();
+
     command_list.SetViewport(0, 0, m_width, m_height);
 
-    command_list.UseProgram(m_program);
-    command_list.Attach(m_program.ps.cbv.SSAOBuffer, m_program.ps.cbuffer.SSAOBuffer);
+    command_list.UseProgram(program);
+    command_list.Attach(program.ps.cbv.SSAOBuffer, program.ps.cbuffer.SSAOBuffer);
 
     glm::vec4 color = { 0.0f, 0.0f, 0.0f, 1.0f };
     RenderPassBeginDesc render_pass_desc = {};
-    render_pass_desc.colors[m_program.ps.om.rtv0].texture = m_ao;
-    render_pass_desc.colors[m_program.ps.om.rtv0].clear_color = color;
+    render_pass_desc.colors[program.ps.om.rtv0].texture = m_ao;
+    render_pass_desc.colors[program.ps.om.rtv0].clear_color = color;
     render_pass_desc.depth_stencil.texture = m_depth_stencil_view;
     render_pass_desc.depth_stencil.clear_depth = 1.0f;
 
     m_input.square.ia.indices.Bind(command_list);
-    m_input.square.ia.positions.BindToSlot(command_list, m_program.vs.ia.POSITION);
-    m_input.square.ia.texcoords.BindToSlot(command_list, m_program.vs.ia.TEXCOORD);
+    m_input.square.ia.positions.BindToSlot(command_list, program.vs.ia.POSITION);
+    m_input.square.ia.texcoords.BindToSlot(command_list, program.vs.ia.TEXCOORD);
 
     command_list.BeginRenderPass(render_pass_desc);
     for (auto& range : m_input.square.ia.ranges) {
-        command_list.Attach(m_program.ps.srv.gPosition, m_input.geometry_pass.position);
-        command_list.Attach(m_program.ps.srv.gNormal, m_input.geometry_pass.normal);
-        command_list.Attach(m_program.ps.srv.noiseTexture, m_noise_texture);
+        command_list.Attach(program.ps.srv.gDepth, m_input.geometry_pass.dsv);
+        command_list.Attach(program.ps.srv.gNormal, m_input.geometry_pass.normal);
+        command_list.Attach(program.ps.srv.noiseTexture, m_noise_texture);
         command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location, 0);
     }
     command_list.EndRenderPass();
 
-    if (m_settings.Get<bool>("use_ao_blur")) {
+    if (m_settings.use_ao_blur) {
         command_list.UseProgram(m_program_blur);
         command_list.Attach(m_program_blur.ps.uav.out_uav, m_ao_blur);
         command_list.Attach(m_program_blur.ps.sampler.g_sampler, m_sampler);
@@ -117,10 +130,6 @@ void SSAOPass::OnRender(RenderCommandList& command_list)
             command_list.DrawIndexed(range.index_count, 1, range.start_index_location, range.base_vertex_location, 0);
         }
         command_list.EndRenderPass();
-
-        output.ao = m_ao_blur;
-    } else {
-        output.ao = m_ao;
     }
 }
 
@@ -128,32 +137,48 @@ void SSAOPass::OnResize(int width, int height)
 {
     m_width = width;
     m_height = height;
-    CreateSizeDependentResources();
 }
 
-void SSAOPass::CreateSizeDependentResources()
+bool SSAOPass::HasPrograms(const SponzaSettingsValues& settings) const
 {
-    m_ao = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                  gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
-    m_ao_blur = m_device.CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kUnorderedAccess,
-                                       gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height, 1);
-    m_depth_stencil_view =
-        m_device.CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_width, m_height, 1);
+    return m_program.IsBuilt(settings.sample_count);
 }
 
-void SSAOPass::OnModifySponzaSettings(const SponzaSettings& settings)
+bool SSAOPass::BuildProgram(const SponzaSettingsValues& settings, bool wait)
 {
-    SponzaSettings prev = m_settings;
-    m_settings = settings;
-    if (prev.Get<uint32_t>("sample_count") != m_settings.Get<uint32_t>("sample_count")) {
-        m_program.ps.desc.define["SAMPLE_COUNT"] = std::to_string(m_settings.Get<uint32_t>("sample_count"));
-        m_program.UpdateProgram();
+    return m_program.Build(settings.sample_count, wait);
+}
+
+void SSAOPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.Read(m_input.geometry_pass.dsv);
+    builder.Read(m_input.geometry_pass.normal);
+    builder.CreateTransient(m_ao, { BindFlag::kRenderTarget | BindFlag::kShaderResource,
+                                    gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height });
+    builder.CreateTransient(m_depth_stencil_view,
+                            { BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_width, m_height });
+    if (m_settings.use_ao_blur) {
+        builder.CreateTransient(m_ao_blur,
+                                { BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kUnorderedAccess,
+                                  gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_width, m_height });
+        builder.Alias(output.ao, m_ao_blur);
+    } else {
+        builder.Alias(output.ao, m_ao);
     }
 }
 
-void SSAOPass::SetDefines(ProgramHolder<SSAOPass_PS, SSAOPass_VS>& program)
+SponzaSettingsMask SSAOPass::GetSponzaSettingsSubscription() const
+{
+    return {
+        SponzaSetting::sample_count, SponzaSetting::use_ssao,
+        SponzaSetting::use_ao_blur, SponzaSetting::ao_radius
+    };
+}
+
+void SSAOPass::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
-    if (m_settings.Get<uint32_t>("sample_count") != 1) {
-        program.ps.desc.define["SAMPLE_COUNT"] = std::to_string(m_settings.Get<uint32_t>("sample_count"));
+    m_settings = settings;
+    if (changes.Test(SponzaSetting::sample_count)) {
+        m_program.Select(m_settings.sample_count);
     }
 }
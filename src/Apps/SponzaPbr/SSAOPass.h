@@ -4,6 +4,7 @@
 #include "Device/Device.h"
 #include "Geometry/Geometry.h"
 #include "GeometryPass.h"
+#include "ProgramPermutations.h"
 #include "ProgramRef/SSAOBlurPass_PS.h"
 #include "ProgramRef/SSAOPass_PS.h"
 #include "ProgramRef/SSAOPass_VS.h"
@@ -15,6 +16,7 @@ public:
         GeometryPass::Output& geometry_pass;
         Model& square;
         const Camera& camera;
+        ThreadPool& thread_pool;
     };
 
     struct Output {
@@ -26,20 +28,24 @@ public:
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
     virtual void OnResize(int width, int height) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual bool HasPrograms(const SponzaSettingsValues& settings) const override;
+    virtual bool BuildProgram(const SponzaSettingsValues& settings, bool wait) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
-    void SetDefines(ProgramHolder<SSAOPass_PS, SSAOPass_VS>& program);
-    void CreateSizeDependentResources();
-
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     int m_width;
     int m_height;
     std::shared_ptr<Resource> m_noise_texture;
     std::shared_ptr<Resource> m_depth_stencil_view;
-    ProgramHolder<SSAOPass_PS, SSAOPass_VS> m_program;
+    ProgramPermutations<ProgramHolder<SSAOPass_PS, SSAOPass_VS>> m_program;
+    // Copied to the permutation in use every frame.
+    std::vector<glm::vec4> m_kernel;
     ProgramHolder<SSAOBlurPass_PS, SSAOPass_VS> m_program_blur;
     std::shared_ptr<Resource> m_ao;
     std::shared_ptr<Resource> m_ao_blur;
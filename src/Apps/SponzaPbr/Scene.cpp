@@ -1,71 +1,100 @@
 #include "Scene.h"
 
+#include "FrameCapture.h"
 #include "Utilities/SystemUtils.h"
 
 #include <GLFW/glfw3.h>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
 #include <chrono>
 
-Scene::Scene(const Settings& settings, std::shared_ptr<RenderDevice> device, GLFWwindow* window, int width, int height)
+namespace {
+
+constexpr char kEnvironmentPath[] = ASSETS_PATH "model/newport_loft.dds";
+
+} // namespace
+
+Scene::Scene(const Settings& settings,
+             std::shared_ptr<RenderDevice> device,
+             GLFWwindow* window,
+             int width,
+             int height,
+             bool headless)
     : m_device(device)
     , m_window(window)
+    , m_headless(headless)
     , m_width(width)
     , m_height(height)
     , m_upload_command_list(m_device->CreateRenderCommandList())
     , m_model_square(*m_device, *m_upload_command_list, ASSETS_PATH "model/square.obj")
     , m_model_cube(*m_device, *m_upload_command_list, ASSETS_PATH "model/cube.obj", ~aiProcess_FlipWindingOrder)
-    , m_skinning_pass(*m_device, { m_scene_list })
-    , m_geometry_pass(*m_device, { m_scene_list, m_camera }, width, height)
-    , m_shadow_pass(*m_device, { m_scene_list, m_camera, m_light_pos })
+    , m_program_thread_pool(1)
+    , m_skinning_pass(*m_device, { m_scene_list, m_time })
+    , m_geometry_pass(*m_device,
+                      { m_scene_list, m_camera, m_range_bounds, m_scene_lods, m_packed_vertices, m_meshlets,
+                        m_scene_instances, m_vertex_ranges, m_program_thread_pool },
+                      width,
+                      height)
+    , m_shadow_pass(
+          *m_device,
+          { m_scene_list, m_camera, m_light_pos, m_range_bounds, m_scene_lods, m_packed_vertices, m_meshlets,
+            m_scene_instances })
     , m_ssao_pass(*m_device,
                   *m_upload_command_list,
-                  { m_geometry_pass.output, m_model_square, m_camera },
+                  { m_geometry_pass.output, m_model_square, m_camera, m_program_thread_pool },
                   width,
                   height)
     , m_brdf(*m_device, { m_model_square })
     , m_equirectangular2cubemap(*m_device, { m_model_cube, m_equirectangular_environment })
     , m_ibl_compute(*m_device,
                     { m_shadow_pass.output, m_scene_list, m_camera, m_light_pos, m_model_cube,
-                      m_equirectangular2cubemap.output.environment })
-    , m_background_pass(*m_device,
-                        { m_model_cube, m_camera, m_equirectangular2cubemap.output.environment,
-                          m_geometry_pass.output.albedo, m_geometry_pass.output.dsv },
-                        width,
-                        height)
+                      m_equirectangular2cubemap.output.environment, m_range_bounds, m_scene_lods,
+                      m_packed_vertices, m_scene_instances })
     , m_light_pass(*m_device,
                    { m_geometry_pass.output, m_shadow_pass.output, m_ssao_pass.output, m_rtao, m_model_square, m_camera,
-                     m_light_pos, m_irradince, m_prefilter, m_brdf.output.brdf },
+                     m_light_pos, m_irradince, m_prefilter, m_brdf.output.brdf, m_program_thread_pool },
                    width,
                    height)
+    , m_background_pass(*m_device,
+                        { m_model_cube, m_camera, m_equirectangular2cubemap.output.environment,
+                          m_light_pass.output.rtv, m_geometry_pass.output.dsv, m_program_thread_pool },
+                        width,
+                        height)
     , m_compute_luminance(*m_device,
                           { m_light_pass.output.rtv, m_model_square, m_render_target_view, m_depth_stencil_view },
                           width,
                           height)
     , m_imgui_pass(*m_device,
                    *m_upload_command_list,
-                   { m_render_target_view, *this, m_settings },
+                   { m_render_target_view, *this, m_settings, m_gpu_profiler },
                    width,
                    height,
                    window)
+    , m_render_graph(*m_device)
+    , m_gpu_profiler(*m_device)
 {
+    AssetLoader asset_loader(*m_device, m_thread_pool);
+
 #if !defined(_DEBUG) && 1
-    m_scene_list.emplace_back(*m_device, *m_upload_command_list, ASSETS_PATH "model/sponza_pbr/sponza.obj");
-    m_scene_list.back().matrix = glm::scale(glm::vec3(0.01f));
+    AddSceneModel(asset_loader, ASSETS_PATH "model/sponza_pbr/sponza.obj",
+                  [](Model& model) { model.matrix = glm::scale(glm::vec3(0.01f)); });
 #endif
 
 #if 1
-    m_scene_list.emplace_back(*m_device, *m_upload_command_list, ASSETS_PATH "model/export3dcoat/export3dcoat.obj");
-    m_scene_list.back().matrix = glm::scale(glm::vec3(0.07f)) * glm::translate(glm::vec3(0.0f, 35.0f, 0.0f)) *
-                                 glm::rotate(glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    m_scene_list.back().ibl_request = true;
+    AddSceneModel(asset_loader, ASSETS_PATH "model/export3dcoat/export3dcoat.obj", [](Model& model) {
+        model.matrix = glm::scale(glm::vec3(0.07f)) * glm::translate(glm::vec3(0.0f, 35.0f, 0.0f)) *
+                       glm::rotate(glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        model.ibl_request = true;
+    });
 #endif
 
 #if 0
-    m_scene_list.emplace_back(*m_device, *m_upload_command_list,
-                              ASSETS_PATH "model/Mannequin_Animation/source/Mannequin_Animation.FBX");
-    m_scene_list.back().matrix = glm::scale(glm::vec3(0.07f)) * glm::translate(glm::vec3(75.0f, 0.0f, 0.0f)) *
-                                 glm::rotate(glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    AddSceneModel(asset_loader, ASSETS_PATH "model/Mannequin_Animation/source/Mannequin_Animation.FBX",
+                  [](Model& model) {
+                      model.matrix = glm::scale(glm::vec3(0.07f)) * glm::translate(glm::vec3(75.0f, 0.0f, 0.0f)) *
+                                     glm::rotate(glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                  });
 #endif
 
 #if 0
@@ -81,15 +110,32 @@ Scene::Scene(const Settings& settings, std::shared_ptr<RenderDevice> device, GLF
     float x = 300;
     for (const auto& test : hdr_tests)
     {
-        m_scene_list.emplace_back(*m_device, *m_upload_command_list, ASSETS_PATH"model/pbr_test/" + test.first + "/sphere.obj");
-        m_scene_list.back().matrix = glm::scale(glm::vec3(0.01f)) * glm::translate(glm::vec3(x, 500, 0.0f));
-        m_scene_list.back().ibl_request = test.second;
-        if (!test.second)
-            m_scene_list.back().ibl_source = 0;
+        AddSceneModel(asset_loader, ASSETS_PATH"model/pbr_test/" + test.first + "/sphere.obj", [x, test](Model& model)
+        {
+            model.matrix = glm::scale(glm::vec3(0.01f)) * glm::translate(glm::vec3(x, 500, 0.0f));
+            model.ibl_request = test.second;
+            if (!test.second)
+                model.ibl_source = 0;
+        });
         x += 50;
     }
 #endif
 
+    asset_loader.LoadTexture(kEnvironmentPath, TextureRole::kEnvironment, m_equirectangular_environment);
+    asset_loader.Finish(m_scene_list, m_scene_lods, m_model_infos);
+
+    m_scene_instances.resize(m_scene_list.size());
+#if 0
+    // A grid of copies of the last model, drawn with one instanced draw per range.
+    auto& grid = m_scene_instances.back().transforms;
+    grid.clear();
+    for (int i = -2; i <= 2; ++i) {
+        for (int j = -2; j <= 2; ++j) {
+            grid.push_back(glm::translate(glm::vec3(3.0f * i, 0.0f, 3.0f * j)));
+        }
+    }
+#endif
+
     for (auto& model : m_scene_list) {
         if (model.ibl_request) {
             ++m_ibl_count;
@@ -98,9 +144,6 @@ Scene::Scene(const Settings& settings, std::shared_ptr<RenderDevice> device, GLF
 
     CreateRT();
 
-    m_equirectangular_environment =
-        CreateTexture(*m_device, *m_upload_command_list, ASSETS_PATH "model/newport_loft.dds");
-
     size_t layer = 0;
     {
         IrradianceConversion::Target irradince{ m_irradince, m_depth_stencil_view_irradince, layer,
@@ -126,45 +169,71 @@ Scene::Scene(const Settings& settings, std::shared_ptr<RenderDevice> device, GLF
     }
 
     if (m_device->IsDxrSupported()) {
-        m_settings.Set("use_rtao", true);
+        m_settings.GetValues().use_rtao = true;
         m_ray_tracing_ao_pass.reset(
             new RayTracingAOPass(*m_device, *m_upload_command_list,
-                                 { m_geometry_pass.output, m_scene_list, m_model_square, m_camera }, width, height));
+                                 { m_geometry_pass.output, m_scene_list, m_scene_instances, m_model_square, m_camera,
+                                   m_program_thread_pool },
+                                 width, height));
         m_rtao = &m_ray_tracing_ao_pass->output.ao;
     }
 
-    m_passes.push_back({ "Skinning Pass", m_skinning_pass });
-    m_passes.push_back({ "Geometry Pass", m_geometry_pass });
-    m_passes.push_back({ "Shadow Pass", m_shadow_pass });
-    m_passes.push_back({ "SSAO Pass", m_ssao_pass });
+    m_render_graph.AddPass("Skinning Pass", m_skinning_pass);
+    m_render_graph.AddPass("Geometry Pass", m_geometry_pass);
+    m_render_graph.AddPass("Shadow Pass", m_shadow_pass);
+    m_render_graph.AddPass("SSAO Pass", m_ssao_pass);
     if (m_ray_tracing_ao_pass) {
-        m_passes.push_back({ "DXR AO Pass", *m_ray_tracing_ao_pass });
+        m_render_graph.AddPass("DXR AO Pass", *m_ray_tracing_ao_pass);
     }
 
-    m_passes.push_back({ "brdf Pass", m_brdf });
-    m_passes.push_back({ "equirectangular to cubemap Pass", m_equirectangular2cubemap });
-    m_passes.push_back({ "IBLCompute", m_ibl_compute });
+    m_render_graph.AddPass("brdf Pass", m_brdf);
+    m_render_graph.AddPass("equirectangular to cubemap Pass", m_equirectangular2cubemap);
+    m_render_graph.AddPass("IBLCompute", m_ibl_compute);
     for (auto& x : m_irradiance_conversion) {
-        m_passes.push_back({ "Irradiance Conversion Pass", *x });
+        m_render_graph.AddPass("Irradiance Conversion Pass", *x);
+    }
+    m_render_graph.AddPass("Light Pass", m_light_pass);
+    m_render_graph.AddPass("Background Pass", m_background_pass);
+    m_render_graph.AddPass("HDR Pass", m_compute_luminance);
+    if (!m_headless) {
+        m_render_graph.AddPass("ImGui Pass", m_imgui_pass);
     }
-    m_passes.push_back({ "Background Pass", m_background_pass });
-    m_passes.push_back({ "Light Pass", m_light_pass });
-    m_passes.push_back({ "HDR Pass", m_compute_luminance });
-    m_passes.push_back({ "ImGui Pass", m_imgui_pass });
+    m_render_graph.AddOutput(m_render_target_view);
 
     m_camera.SetCameraPos(glm::vec3(-3.0, 2.75, 0.0));
     m_camera.SetCameraYaw(-178.0f);
     m_camera.SetCameraYaw(-1.75f);
     m_camera.SetViewport(m_width, m_height);
 
-    for (uint32_t i = 0; i < kFrameCount * m_passes.size(); ++i) {
+    for (uint32_t i = 0; i < kFrameCount * (m_render_graph.GetPasses().size() + 1); ++i) {
         m_command_lists.emplace_back(m_device->CreateRenderCommandList());
     }
 
+    UploadSceneInstances(*m_device, *m_upload_command_list, m_scene_list, m_scene_instances);
     m_upload_command_list->Close();
     m_device->ExecuteCommandLists({ m_upload_command_list });
+    std::vector<bool> restored;
+    m_scene_sources_key = HashValue<uint64_t>(m_model_infos.size());
+    for (const auto& info : m_model_infos) {
+        restored.push_back(info.restored);
+        m_scene_sources_key = HashValue(info.source_key, m_scene_sources_key);
+    }
+    OptimizeSceneModels(*m_device, m_scene_list, restored);
+    m_range_bounds = ComputeRangeBounds(*m_device, m_scene_list);
+    m_vertex_ranges = ComputeVertexRanges(*m_device, m_scene_list);
+    BuildSceneLods(*m_device, m_scene_list, m_scene_lods);
+    SceneCache scene_cache;
+    for (size_t model_id = 0; model_id < m_scene_list.size(); ++model_id) {
+        const ModelLoadInfo& info = m_model_infos[model_id];
+        if (!info.restored && !info.skinned) {
+            scene_cache.Save(*m_device, info.source_key, m_scene_list[model_id], info.textures, info.uv_densities,
+                             m_scene_lods[model_id]);
+        }
+    }
+    m_packed_vertices = BuildPackedVertices(*m_device, m_scene_list);
+    m_meshlets = BuildSceneMeshlets(*m_device, m_scene_list, m_scene_instances);
 
-    m_settings.Set("gpu_name", m_device->GetGpuName());
+    m_settings.SetGpuName(m_device->GetGpuName());
     OnModifySponzaSettings(m_settings);
 }
 
@@ -175,44 +244,185 @@ Scene::~Scene()
 
 void Scene::RenderFrame()
 {
-    UpdateCameraMovement();
+    std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+    if (m_fixed_timestep > 0.0f) {
+        m_delta_time = m_fixed_timestep;
+    } else {
+        m_delta_time = std::chrono::duration<float>(frame_start - m_last_frame).count();
+    }
+    m_last_frame = frame_start;
+    m_time += m_delta_time;
 
-    static float angle = 0.0f;
-    static std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
-    std::chrono::time_point<std::chrono::system_clock> end = std::chrono::system_clock::now();
-    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    start = end;
+    UpdateCameraMovement();
 
-    if (m_settings.Get<bool>("dynamic_sun_position")) {
-        angle += elapsed / 2e6f;
+    if (m_settings.GetValues().dynamic_sun_position) {
+        m_angle += m_delta_time / 2.0f;
     }
 
     float light_r = 2.5;
-    m_light_pos = glm::vec3(light_r * cos(angle), 25.0f, light_r * sin(angle));
+    m_light_pos = glm::vec3(light_r * cos(m_angle), 25.0f, light_r * sin(m_angle));
+
+    const SponzaSettingsValues& settings = m_settings.GetValues();
+    if (settings.use_texture_streaming) {
+        if (!m_texture_streamer) {
+            m_texture_streamer.reset(
+                new TextureStreamer(*m_device, m_thread_pool, m_scene_list, m_model_infos, m_range_bounds));
+        }
+        m_texture_streamer->Update(m_scene_instances, m_camera, m_height,
+                                   static_cast<uint64_t>(std::max(settings.texture_budget_mb, 0)) << 20,
+                                   settings.texture_mip_bias);
+    } else if (m_texture_streamer) {
+        m_texture_streamer->MakeResident();
+        m_texture_streamer.reset();
+    }
+
+    if (!m_ibl_cache_checked) {
+        m_ibl_cache_checked = true;
+        // A single bake is cached, there is nothing to restore when it is redone every frame. Streamed textures
+        // would be captured by the probes at whatever level is resident.
+        uint64_t key = 0;
+        if (!settings.irradiance_conversion_every_frame && !m_texture_streamer) {
+            key = GetIBLCacheKey();
+        }
+        if (key) {
+            m_ibl_compute.CreateProbeTargets();
+            auto ibl_cache = std::make_unique<IBLCache>(kIBLCachePath, key);
+            if (ibl_cache->Load(*m_device, GetIBLTextures())) {
+                m_brdf.MarkBaked();
+                m_equirectangular2cubemap.MarkBaked();
+                m_ibl_compute.MarkBaked();
+                for (auto& irradiance_conversion : m_irradiance_conversion) {
+                    irradiance_conversion->MarkBaked();
+                }
+            } else {
+                m_ibl_cache = std::move(ibl_cache);
+            }
+        }
+    }
+
+    // While settings wait for their programs, the ones whose shaders finished compiling on m_program_thread_pool are
+    // created here, nothing is recorded on the device yet. A change of sample_count swaps the programs and the
+    // G-buffer of every pass in the same frame.
+    if (m_pending_changes.Any()) {
+        while (BuildProgram(false)) {
+        }
+        ApplySettingsChanges();
+    }
 
-    for (auto& desc : m_passes) {
+    for (auto& desc : m_render_graph.GetPasses()) {
         desc.pass.get().OnUpdate();
     }
 
-    m_render_target_view = m_device->GetBackBuffer(m_device->GetFrameIndex());
+    if (m_render_graph_dirty) {
+        m_render_graph.Compile();
+        m_render_graph_dirty = false;
+    }
 
-    std::vector<std::shared_ptr<RenderCommandList>> command_lists;
+    if (m_headless) {
+        m_render_target_view = m_offscreen_target;
+    } else {
+        m_render_target_view = m_device->GetBackBuffer(m_device->GetFrameIndex());
+    }
 
-    for (auto& desc : m_passes) {
+    const auto& passes = m_render_graph.GetActivePasses();
+    // The first command list holds the uploads of the passes, the others are recorded by one pass each.
+    std::vector<std::shared_ptr<RenderCommandList>> command_lists;
+    for (size_t i = 0; i <= passes.size(); ++i) {
         decltype(auto) command_list = m_command_lists[m_command_list_index];
         m_command_list_index = (m_command_list_index + 1) % m_command_lists.size();
         m_device->Wait(command_list->GetFenceValue());
         command_list->Reset();
-        command_list->BeginEvent(desc.name);
-        desc.pass.get().OnRender(*command_list);
-        command_list->EndEvent();
+        command_lists.emplace_back(command_list);
+    }
+    for (const auto& pass : passes) {
+        pass.pass.get().OnUpload(*command_lists.front());
+    }
+    command_lists.front()->Close();
+
+    bool profiling = m_settings.GetValues().use_gpu_profiler;
+    // Indexed like command_lists, the upload list has no events.
+    m_pass_events.assign(command_lists.size(), {});
+    auto record = [&](size_t i) {
+        auto& command_list = command_lists[i + 1];
+        ScopedEvent::SetSink(profiling ? &m_pass_events[i + 1] : nullptr);
+        {
+            ScopedEvent event(*command_list, passes[i].name);
+            passes[i].pass.get().OnRender(*command_list);
+        }
+        ScopedEvent::SetSink(nullptr);
         command_list->Close();
+    };
 
-        command_lists.emplace_back(command_list);
+    bool parallel_recording = m_settings.GetValues().use_parallel_recording;
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 0; i < passes.size(); ++i) {
+        if (parallel_recording && passes[i].allow_parallel_recording) {
+            tasks.emplace_back(m_thread_pool.Push([&record, i] { record(i); }));
+        }
+    }
+    for (size_t i = 0; i < passes.size(); ++i) {
+        if (!parallel_recording || !passes[i].allow_parallel_recording) {
+            record(i);
+        }
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+
+    // Only frames which are measured keep their GPU time in the profiler, nothing waits for the GPU here.
+    std::optional<uint64_t> frame_index;
+    if (m_measure_gpu_time) {
+        frame_index = m_frame_index;
+    }
+    std::chrono::steady_clock::time_point submit_time = std::chrono::steady_clock::now();
+    if (profiling) {
+        std::vector<uint64_t> fence_values;
+        for (auto& command_list : command_lists) {
+            m_device->ExecuteCommandLists({ command_list });
+            fence_values.push_back(command_list->GetFenceValue());
+        }
+        m_gpu_profiler.AddFrame(std::move(m_pass_events), std::move(fence_values), submit_time, frame_index);
+    } else {
+        m_device->ExecuteCommandLists(command_lists);
+        if (frame_index) {
+            m_gpu_profiler.AddFrame({ {} }, { command_lists.back()->GetFenceValue() }, submit_time, frame_index);
+        }
+    }
+
+    std::chrono::steady_clock::time_point submit_end = std::chrono::steady_clock::now();
+    m_frame_timing.frame_index = m_frame_index++;
+    m_frame_timing.cpu_ms = std::chrono::duration<double, std::milli>(submit_end - frame_start).count();
+
+    if (m_ibl_cache) {
+        m_ibl_cache->Save(*m_device, GetIBLTextures());
+        m_ibl_cache.reset();
+    }
+
+    if (!m_headless) {
+        m_device->Present();
+    }
+}
+
+bool Scene::SaveFrame(const std::string& path)
+{
+    m_device->WaitForIdle();
+    if (path.size() >= 4 && path.substr(path.size() - 4) == ".exr") {
+        if (m_settings.GetValues().sample_count != 1) {
+            return false;
+        }
+        std::vector<uint8_t> data = ReadbackTexture(*m_device, m_light_pass.output.rtv,
+                                                    gli::format::FORMAT_RGBA32_SFLOAT_PACK32, m_width, m_height);
+        return SaveExr(path, m_width, m_height, data);
     }
+    std::vector<uint8_t> data =
+        ReadbackTexture(*m_device, m_render_target_view, gli::format::FORMAT_RGBA8_UNORM_PACK8, m_width, m_height);
+    return SavePng(path, m_width, m_height, data);
+}
 
-    m_device->ExecuteCommandLists(command_lists);
-    m_device->Present();
+void Scene::EnableGpuProfiler()
+{
+    m_settings.GetValues().use_gpu_profiler = true;
+    OnModifySponzaSettings(m_settings);
 }
 
 void Scene::OnResize(int width, int height)
@@ -231,14 +441,17 @@ void Scene::OnResize(int width, int height)
         cmd = m_device->CreateRenderCommandList();
     }
 
-    m_device->Resize(m_width, m_height);
+    if (!m_headless) {
+        m_device->Resize(m_width, m_height);
+    }
     m_camera.SetViewport(m_width, m_height);
 
     CreateRT();
 
-    for (auto& desc : m_passes) {
+    for (auto& desc : m_render_graph.GetPasses()) {
         desc.pass.get().OnResize(width, height);
     }
+    m_render_graph_dirty = true;
 }
 
 void Scene::OnKey(int key, int action)
@@ -300,26 +513,78 @@ void Scene::OnInputChar(unsigned int ch)
 void Scene::OnModifySponzaSettings(const SponzaSettings& settings)
 {
     m_settings = settings;
-    for (auto& desc : m_passes) {
-        desc.pass.get().OnModifySponzaSettings(m_settings);
+    m_pending_changes = m_pending_changes | m_settings.TakeChanges();
+    if (!m_settings.GetValues().use_async_program_builds) {
+        while (!HasPrograms() && BuildProgram(true)) {
+        }
+    }
+    ApplySettingsChanges();
+}
+
+bool Scene::HasPrograms()
+{
+    for (auto& desc : m_render_graph.GetPasses()) {
+        if (!desc.pass.get().HasPrograms(m_settings.GetValues())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Scene::BuildProgram(bool wait)
+{
+    for (auto& desc : m_render_graph.GetPasses()) {
+        if (desc.pass.get().BuildProgram(m_settings.GetValues(), wait)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scene::ApplySettingsChanges()
+{
+    if (!m_pending_changes.Any() || !HasPrograms()) {
+        return;
+    }
+    for (auto& desc : m_render_graph.GetPasses()) {
+        SponzaSettingsMask pass_changes = m_pending_changes & desc.pass.get().GetSponzaSettingsSubscription();
+        if (pass_changes.Any()) {
+            desc.pass.get().OnModifySponzaSettings(m_settings.GetValues(), pass_changes);
+        }
     }
+    m_pending_changes = {};
+    m_render_graph_dirty = true;
+}
+
+void Scene::AddSceneModel(AssetLoader& asset_loader,
+                          const std::string& path,
+                          std::function<void(Model&)> setup,
+                          uint32_t flags)
+{
+    asset_loader.LoadModel({ path, flags }, std::move(setup));
 }
 
 void Scene::CreateRT()
 {
     m_depth_stencil_view = m_device->CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1,
                                                    m_width, m_height, 1);
+    if (m_headless) {
+        m_offscreen_target = m_device->CreateTexture(BindFlag::kRenderTarget | BindFlag::kCopySource,
+                                                     gli::format::FORMAT_RGBA8_UNORM_PACK8, 1, m_width, m_height, 1);
+    }
 
     if (m_irradince) {
         return;
     }
 
-    m_irradince = m_device->CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                          gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_irradince_texture_size,
-                                          m_irradince_texture_size, 6 * m_ibl_count);
-    m_prefilter = m_device->CreateTexture(BindFlag::kRenderTarget | BindFlag::kShaderResource,
-                                          gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_prefilter_texture_size,
-                                          m_prefilter_texture_size, 6 * m_ibl_count, log2(m_prefilter_texture_size));
+    // Copies are used by the IBL cache.
+    BindFlag ibl_flags =
+        BindFlag::kRenderTarget | BindFlag::kShaderResource | BindFlag::kCopySource | BindFlag::kCopyDest;
+    m_irradince = m_device->CreateTexture(ibl_flags, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1,
+                                          m_irradince_texture_size, m_irradince_texture_size, 6 * m_ibl_count);
+    m_prefilter =
+        m_device->CreateTexture(ibl_flags, gli::format::FORMAT_RGBA32_SFLOAT_PACK32, 1, m_prefilter_texture_size,
+                                m_prefilter_texture_size, 6 * m_ibl_count, log2(m_prefilter_texture_size));
 
     m_depth_stencil_view_irradince =
         m_device->CreateTexture(BindFlag::kDepthStencil, gli::format::FORMAT_D32_SFLOAT_PACK32, 1,
@@ -329,12 +594,76 @@ void Scene::CreateRT()
         m_prefilter_texture_size, 6 * m_ibl_count, log2(m_prefilter_texture_size));
 }
 
-void Scene::UpdateCameraMovement()
+uint64_t Scene::GetIBLCacheKey() const
+{
+    // The environment as it is loaded, the compressed cache entry if there is one.
+    std::string environment =
+        TextureCompressionCache(kTextureCachePath).Find(kEnvironmentPath, TextureRole::kEnvironment);
+    uint64_t key = 0;
+    if (!HashFile(environment.empty() ? kEnvironmentPath : environment, key)) {
+        return 0;
+    }
+
+    // The probes capture the scene: its models, their material textures, their placements and the lighting, view
+    // position and settings of IBLCompute. Entries of the texture cache are named by a hash of their source, so
+    // their paths stand for their contents.
+    key = HashValue(m_scene_sources_key, key);
+    for (const auto& info : m_model_infos) {
+        key = HashValue<uint64_t>(info.texture_files.size(), key);
+        for (const auto& texture : info.texture_files) {
+            if (texture.file != texture.path) {
+                key = HashString(texture.file, key);
+            } else if (!HashFile(texture.file, key, key)) {
+                return 0;
+            }
+        }
+    }
+    for (size_t model_id = 0; model_id < m_scene_list.size(); ++model_id) {
+        const Model& model = m_scene_list[model_id];
+        key = HashValue(model.matrix, key);
+        key = HashValue(model.ibl_request, key);
+        const auto& transforms = m_scene_instances[model_id].transforms;
+        key = HashBytes(transforms.data(), transforms.size() * sizeof(transforms.front()),
+                        HashValue<uint64_t>(transforms.size(), key));
+    }
+    key = HashValue(m_light_pos, key);
+    key = HashValue(m_camera.GetCameraPos(), key);
+    const SponzaSettingsValues& settings = m_settings.GetValues();
+    SponzaSettingsMask subscription = m_ibl_compute.GetSponzaSettingsSubscription();
+    for (const auto& info : GetSponzaSettingInfos()) {
+        if (subscription.Test(info.id)) {
+            key = HashBytes(reinterpret_cast<const uint8_t*>(&settings) + info.offset, info.size, key);
+        }
+    }
+
+    for (const char* shader : { "BRDF_VS.hlsl", "BRDF_PS.hlsl", "Cubemap_VS.hlsl", "Equirectangular2Cubemap_PS.hlsl",
+                                "DownSample_CS.hlsl", "IrradianceConvolution_PS.hlsl", "Prefilter_PS.hlsl",
+                                "IBLCompute_VS.hlsl", "IBLComputePacked_VS.hlsl", "IBLCompute_PS.hlsl",
+                                "IBLComputePrePass_PS.hlsl", "Background_VS.hlsl", "Background_PS.hlsl",
+                                "BoneTransform.hlsli", "Instancing.hlsli", "PackedVertex.hlsli" }) {
+        if (!HashFile(std::string(ASSETS_PATH "shaders/SponzaPbr/") + shader, key, key)) {
+            return 0;
+        }
+    }
+    return key;
+}
+
+std::vector<std::shared_ptr<Resource>> Scene::GetIBLTextures() const
 {
-    float currentFrame = static_cast<float>(glfwGetTime());
-    m_delta_time = currentFrame - m_last_frame;
-    m_last_frame = currentFrame;
+    std::vector<std::shared_ptr<Resource>> textures = { m_brdf.output.brdf,
+                                                        m_equirectangular2cubemap.output.environment };
+    for (const auto& model : m_scene_list) {
+        if (model.ibl_request) {
+            textures.push_back(model.ibl_rtv);
+        }
+    }
+    textures.push_back(m_irradince);
+    textures.push_back(m_prefilter);
+    return textures;
+}
 
+void Scene::UpdateCameraMovement()
+{
     if (m_keys[GLFW_KEY_W]) {
         m_camera.ProcessKeyboard(CameraMovement::kForward, m_delta_time);
     }
@@ -1,35 +1,57 @@
 #pragma once
+#include "AssetLoader.h"
 #include "BRDFGen.h"
 #include "BackgroundPass.h"
+#include "Benchmark.h"
 #include "Camera/Camera.h"
 #include "ComputeLuminance.h"
 #include "Equirectangular2Cubemap.h"
 #include "Geometry/Geometry.h"
 #include "GeometryPass.h"
+#include "GpuProfiler.h"
+#include "IBLCache.h"
 #include "IBLCompute.h"
 #include "ImGuiPass.h"
 #include "IrradianceConversion.h"
 #include "LightPass.h"
+#include "PackedVertices.h"
 #include "ProgramRef/GeometryPass_PS.h"
 #include "ProgramRef/GeometryPass_VS.h"
 #include "ProgramRef/LightPass_PS.h"
 #include "ProgramRef/LightPass_VS.h"
 #include "RayTracingAOPass.h"
 #include "RenderDevice/RenderDevice.h"
+#include "RenderGraph.h"
 #include "SSAOPass.h"
+#include "SceneBounds.h"
+#include "SceneCache.h"
+#include "SceneInstances.h"
+#include "SceneLods.h"
+#include "SceneMeshlets.h"
+#include "SceneOptimizer.h"
+#include "SceneVertexRanges.h"
 #include "ShadowPass.h"
 #include "SkinningPass.h"
 #include "SponzaSettings.h"
+#include "TextureStreaming.h"
+#include "ThreadPool.h"
 
 #include <glm/glm.hpp>
 
+#include <chrono>
+#include <functional>
 #include <map>
 #include <string>
 #include <vector>
 
 class Scene : public InputEvents, public WindowEvents, public IModifySponzaSettings {
 public:
-    Scene(const Settings& settings, std::shared_ptr<RenderDevice> device, GLFWwindow* window, int width, int height);
+    Scene(const Settings& settings,
+          std::shared_ptr<RenderDevice> device,
+          GLFWwindow* window,
+          int width,
+          int height,
+          bool headless = false);
     ~Scene();
 
     RenderDevice& GetRenderDevice()
@@ -37,7 +59,54 @@ public:
         return *m_device;
     }
 
+    Camera& GetCamera()
+    {
+        return m_camera;
+    }
+
+    void SetSunAngle(float angle)
+    {
+        m_angle = angle;
+    }
+
+    // Advances the scene clock by a fixed step per frame instead of the wall clock.
+    void SetFixedTimestep(float timestep)
+    {
+        m_fixed_timestep = timestep;
+    }
+
+    // Hands every frame to GpuProfiler so its GPU time can be taken with GpuProfiler::TakeFrameTimes.
+    void SetMeasureGpuTime(bool measure)
+    {
+        m_measure_gpu_time = measure;
+    }
+
+    float GetTime() const
+    {
+        return m_time;
+    }
+
+    const FrameTiming& GetFrameTiming() const
+    {
+        return m_frame_timing;
+    }
+
+    GpuProfiler& GetGpuProfiler()
+    {
+        return m_gpu_profiler;
+    }
+
+    // Changes made through the returned object are applied by passing it to OnModifySponzaSettings.
+    SponzaSettings& GetSettings()
+    {
+        return m_settings;
+    }
+
+    void EnableGpuProfiler();
+
     void RenderFrame();
+    // Writes the last rendered frame, the extension selects the final image (png) or the HDR light buffer (exr).
+    bool SaveFrame(const std::string& path);
 
     void OnResize(int width, int height) override;
 
@@ -49,23 +118,52 @@ public:
     virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
 
 private:
+    // The model is appended to m_scene_list by asset_loader.Finish, setup is called then.
+    void AddSceneModel(AssetLoader& asset_loader,
+                       const std::string& path,
+                       std::function<void(Model&)> setup,
+                       uint32_t flags = ~0u);
     void CreateRT();
+    // Hash of everything the IBL bake of the first frame reads, 0 if the environment can't be read.
+    uint64_t GetIBLCacheKey() const;
+    // Products of the IBL bake in the order they are cached.
+    std::vector<std::shared_ptr<Resource>> GetIBLTextures() const;
+    // Whether every pass has its programs for the current settings.
+    bool HasPrograms();
+    // Creates a missing program of the first pass that has one, see IPass::BuildProgram.
+    bool BuildProgram(bool wait);
+    // Passes m_pending_changes on once every pass has its programs for them.
+    void ApplySettingsChanges();
 
     std::shared_ptr<RenderDevice> m_device;
     GLFWwindow* m_window;
+    // Renders into m_offscreen_target and never presents, the swapchain of the hidden window is unused then.
+    bool m_headless;
 
     int m_width;
     int m_height;
     std::shared_ptr<RenderCommandList> m_upload_command_list;
     std::shared_ptr<Resource> m_render_target_view;
+    std::shared_ptr<Resource> m_offscreen_target;
     std::shared_ptr<Resource> m_depth_stencil_view;
     std::shared_ptr<Resource> m_equirectangular_environment;
 
     glm::vec3 m_light_pos;
 
     SceneModels m_scene_list;
+    std::vector<ModelLoadInfo> m_model_infos;
+    SceneInstances m_scene_instances;
+    ModelRangeBounds m_range_bounds;
+    ModelVertexRanges m_vertex_ranges;
+    SceneLods m_scene_lods;
+    ScenePackedVertices m_packed_vertices;
+    SceneMeshlets m_meshlets;
+    // Created when use_texture_streaming is first set, every texture is made resident again when it is cleared.
+    std::unique_ptr<TextureStreamer> m_texture_streamer;
     Model m_model_square;
     Model m_model_cube;
+    // Compiles the shaders of program permutations, separate from m_thread_pool so recording never waits for them.
+    ThreadPool m_program_thread_pool;
     SkinningPass m_skinning_pass;
     GeometryPass m_geometry_pass;
     ShadowPass m_shadow_pass;
@@ -81,18 +179,24 @@ private:
     std::shared_ptr<Resource> m_prefilter;
     std::shared_ptr<Resource> m_depth_stencil_view_irradince;
     std::shared_ptr<Resource> m_depth_stencil_view_prefilter;
-    BackgroundPass m_background_pass;
+    uint64_t m_scene_sources_key = 0;
+    bool m_ibl_cache_checked = false;
+    // Set on the first frame when the bake isn't restored, the products are saved once the frame is submitted.
+    std::unique_ptr<IBLCache> m_ibl_cache;
     LightPass m_light_pass;
+    BackgroundPass m_background_pass;
     ComputeLuminance m_compute_luminance;
     ImGuiPass m_imgui_pass;
     SponzaSettings m_settings;
+    // Changes the passes haven't seen yet, they keep the previous settings until their programs are built.
+    SponzaSettingsMask m_pending_changes;
     size_t m_irradince_texture_size = 16;
     size_t m_prefilter_texture_size = 512;
-    struct PassDesc {
-        std::string name;
-        std::reference_wrapper<IPass> pass;
-    };
-    std::vector<PassDesc> m_passes;
+    RenderGraph m_render_graph;
+    bool m_render_graph_dirty = true;
+    ThreadPool m_thread_pool;
+    GpuProfiler m_gpu_profiler;
+    std::vector<std::vector<ProfileEvent>> m_pass_events;
     std::vector<std::shared_ptr<RenderCommandList>> m_command_lists;
     size_t m_command_list_index = 0;
 
@@ -100,8 +204,13 @@ private:
 
     Camera m_camera;
     std::map<int, bool> m_keys;
-    float m_last_frame = 0.0;
+    std::chrono::steady_clock::time_point m_last_frame = std::chrono::steady_clock::now();
     float m_delta_time = 0.0f;
+    float m_fixed_timestep = 0.0f;
+    float m_time = 0.0f;
+    bool m_measure_gpu_time = false;
+    uint64_t m_frame_index = 0;
+    FrameTiming m_frame_timing;
     double m_last_x = 0.0f;
     double m_last_y = 0.0f;
     float m_angle = 0.0;
@@ -0,0 +1,114 @@
+#include "SceneBounds.h"
+
+#include "ProgramRef/RangeBounds_CS.h"
+
+#include <cstring>
+
+namespace {
+
+// Must match EncodeOrdered in RangeBounds_CS.hlsl.
+float DecodeOrdered(uint32_t bits)
+{
+    bits = (bits & 0x80000000) ? bits & ~0x80000000 : ~bits;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+ModelRangeBounds ComputeRangeBounds(RenderDevice& device, SceneModels& scene_list)
+{
+    size_t range_count = 0;
+    for (auto& model : scene_list) {
+        range_count += model.ia.ranges.size();
+    }
+    ModelRangeBounds bounds;
+    if (!range_count) {
+        return bounds;
+    }
+
+    std::vector<uint32_t> init(6 * range_count);
+    for (size_t i = 0; i < init.size(); ++i) {
+        init[i] = i % 6 < 3 ? ~0u : 0u;
+    }
+    size_t size = sizeof(uint32_t) * init.size();
+    std::shared_ptr<Resource> buffer =
+        device.CreateBuffer(BindFlag::kUnorderedAccess | BindFlag::kCopySource | BindFlag::kCopyDest, size);
+    std::shared_ptr<Resource> readback = device.CreateBuffer(BindFlag::kCopyDest, size, MemoryType::kReadback);
+
+    ProgramHolder<RangeBounds_CS> program(device);
+    std::shared_ptr<RenderCommandList> command_list = device.CreateRenderCommandList();
+    command_list->UpdateSubresource(buffer, 0, init.data());
+    command_list->UseProgram(program);
+    command_list->Attach(program.cs.cbv.cb, program.cs.cbuffer.cb);
+    command_list->Attach(program.cs.uav.out_bounds, buffer);
+
+    uint32_t range_id = 0;
+    for (auto& model : scene_list) {
+        command_list->Attach(program.cs.srv.index_buffer, model.ia.indices.GetBuffer());
+        command_list->Attach(program.cs.srv.in_position, model.ia.positions.GetBuffer());
+        for (auto& range : model.ia.ranges) {
+            program.cs.cbuffer.cb.IndexCount = range.index_count;
+            program.cs.cbuffer.cb.StartIndexLocation = range.start_index_location;
+            program.cs.cbuffer.cb.BaseVertexLocation = range.base_vertex_location;
+            program.cs.cbuffer.cb.RangeId = range_id++;
+            command_list->Dispatch((range.index_count + 256 - 1) / 256, 1, 1);
+        }
+    }
+    command_list->CopyBuffer(buffer, readback, { { 0, 0, size } });
+    command_list->Close();
+    device.ExecuteCommandLists({ command_list });
+    device.Wait(command_list->GetFenceValue());
+
+    const uint32_t* data = reinterpret_cast<const uint32_t*>(readback->Map());
+    for (auto& model : scene_list) {
+        auto& model_bounds = bounds.emplace_back();
+        for (size_t i = 0; i < model.ia.ranges.size(); ++i, data += 6) {
+            model_bounds.push_back({ { DecodeOrdered(data[0]), DecodeOrdered(data[1]), DecodeOrdered(data[2]) },
+                                     { DecodeOrdered(data[3]), DecodeOrdered(data[4]), DecodeOrdered(data[5]) } });
+        }
+    }
+    readback->Unmap();
+    return bounds;
+}
+
+void SceneCulling::Update(SceneModels& scene_list,
+                          const ModelRangeBounds& bounds,
+                          const SceneInstances& instances,
+                          const glm::mat4& view_projection)
+{
+    m_boxes.Clear();
+    m_offsets.clear();
+    size_t model_id = 0;
+    for (auto& model : scene_list) {
+        if (model_id >= bounds.size() || bounds[model_id].size() != model.ia.ranges.size() ||
+            model.bones.HasAnimation()) {
+            m_offsets.push_back(kAlwaysVisible);
+            ++model_id;
+            continue;
+        }
+        m_offsets.push_back(m_boxes.Size());
+        const auto& transforms = instances[model_id].transforms;
+        for (const auto& box : bounds[model_id]) {
+            AABB world = TransformAABB(box, transforms.front() * model.matrix);
+            for (size_t i = 1; i < transforms.size(); ++i) {
+                AABB instance = TransformAABB(box, transforms[i] * model.matrix);
+                world.min = glm::min(world.min, instance.min);
+                world.max = glm::max(world.max, instance.max);
+            }
+            m_boxes.Add(world);
+        }
+        ++model_id;
+    }
+
+    CullAABBs(ExtractFrustum(view_projection), m_boxes, m_visible);
+}
+
+bool SceneCulling::IsVisible(size_t model, size_t range) const
+{
+    if (model >= m_offsets.size() || m_offsets[model] == kAlwaysVisible) {
+        return true;
+    }
+    return m_visible[m_offsets[model] + range];
+}
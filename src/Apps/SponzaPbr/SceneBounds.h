@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Culling.h"
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+#include "SceneInstances.h"
+
+#include <vector>
+
+// Model space bounds of every range, indexed as [model][range].
+using ModelRangeBounds = std::vector<std::vector<AABB>>;
+
+// Reduces the vertices referenced by every range on the GPU and reads the result back. The model data must be
+// uploaded, this waits for the device to finish.
+ModelRangeBounds ComputeRangeBounds(RenderDevice& device, SceneModels& scene_list);
+
+// Frustum culling of the ranges of a scene. Models without bounds or with animation are always visible, the ranges
+// of an instanced model are tested with the union of the bounds of their instances.
+class SceneCulling {
+public:
+    void Update(SceneModels& scene_list,
+                const ModelRangeBounds& bounds,
+                const SceneInstances& instances,
+                const glm::mat4& view_projection);
+    bool IsVisible(size_t model, size_t range) const;
+
+private:
+    AABBList m_boxes;
+    std::vector<uint8_t> m_visible;
+    // Index of the first box of every model, kAlwaysVisible for models which are not culled.
+    std::vector<size_t> m_offsets;
+
+    static constexpr size_t kAlwaysVisible = ~size_t(0);
+};
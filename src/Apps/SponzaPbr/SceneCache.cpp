@@ -0,0 +1,185 @@
+#include "SceneCache.h"
+
+#include "ModelReadback.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+constexpr uint32_t kSceneCacheMagic = 0x43535053; // "SPSC"
+// Must be increased whenever the file layout or a stage writing cached data changes.
+constexpr uint32_t kSceneCacheVersion = 3;
+
+// Index buffer followed by the vertex streams the model has, the order in which they are cached.
+std::vector<std::shared_ptr<Resource>> GetStreams(Model& model)
+{
+    std::vector<std::shared_ptr<Resource>> streams = { model.ia.indices.GetBuffer() };
+    for (IAVertexBuffer* vertices : { &model.ia.positions, &model.ia.normals, &model.ia.texcoords, &model.ia.tangents,
+                                      &model.ia.bones_offset, &model.ia.bones_count }) {
+        if (vertices->Count()) {
+            streams.push_back(vertices->GetBuffer());
+        }
+    }
+    return streams;
+}
+
+// Ranges and stream sizes of the imported model, a cache written for another layout is not used.
+uint64_t HashLayout(Model& model)
+{
+    uint64_t hash = HashValue<uint64_t>(model.ia.ranges.size());
+    for (const auto& range : model.ia.ranges) {
+        hash = HashValue<uint64_t>(range.id, hash);
+        hash = HashValue<uint32_t>(range.index_count, hash);
+        hash = HashValue<uint32_t>(range.start_index_location, hash);
+        hash = HashValue<int32_t>(range.base_vertex_location, hash);
+    }
+    hash = HashValue<uint32_t>(static_cast<uint32_t>(model.ia.indices.Format()), hash);
+    for (const auto& stream : GetStreams(model)) {
+        hash = HashValue<uint64_t>(stream->GetWidth(), hash);
+    }
+    return hash;
+}
+
+} // namespace
+
+uint64_t GetSceneCacheKey(const ModelSource& source)
+{
+    uint64_t hash = 0;
+    if (!HashFile(source.path, hash)) {
+        return 0;
+    }
+    return HashValue(source.flags, hash);
+}
+
+SceneCache::SceneCache(const std::string& directory)
+    : m_directory(directory)
+{
+}
+
+bool SceneCache::Load(uint64_t key, CachedModel& model) const
+{
+    if (!key) {
+        return false;
+    }
+    MappedFile file(GetPath(key));
+    if (!file.IsOpen()) {
+        return false;
+    }
+    BinaryReader reader(file.GetData(), file.GetSize());
+    if (reader.Read<uint32_t>() != kSceneCacheMagic || reader.Read<uint32_t>() != kSceneCacheVersion ||
+        reader.Read<uint64_t>() != key) {
+        return false;
+    }
+
+    CachedModel result;
+    result.layout = reader.Read<uint64_t>();
+    for (size_t i = 0, count = reader.Read<uint64_t>(); i < count && !reader.HasError(); ++i) {
+        result.streams.push_back(reader.ReadVector<uint8_t>());
+    }
+    for (size_t i = 0, count = reader.Read<uint64_t>(); i < count && !reader.HasError(); ++i) {
+        auto& textures = result.textures.emplace_back();
+        for (size_t j = 0, texture_count = reader.Read<uint64_t>(); j < texture_count && !reader.HasError(); ++j) {
+            auto type = static_cast<aiTextureType>(reader.Read<uint32_t>());
+            std::vector<char> path = reader.ReadVector<char>();
+            textures.push_back({ type, std::string(path.begin(), path.end()) });
+        }
+    }
+    result.uv_densities = reader.ReadVector<float>();
+    result.lod_indices = reader.ReadVector<uint32_t>();
+    for (size_t i = 0, count = reader.Read<uint64_t>(); i < count && !reader.HasError(); ++i) {
+        result.lod_ranges.push_back(reader.ReadVector<RangeLod>());
+    }
+    bool valid = !result.streams.empty() && result.uv_densities.size() == result.textures.size();
+    for (const auto& range_lods : result.lod_ranges) {
+        for (const auto& lod : range_lods) {
+            valid &= lod.start_index_location + static_cast<uint64_t>(lod.index_count) <= result.lod_indices.size();
+        }
+    }
+    if (!valid || reader.HasError() || !reader.IsEnd()) {
+        std::cerr << "Scene cache " << GetPath(key) << " is damaged, it will be rebuilt" << std::endl;
+        return false;
+    }
+    model = std::move(result);
+    return true;
+}
+
+bool SceneCache::Restore(RenderCommandList& command_list, Model& model, const CachedModel& cached) const
+{
+    std::vector<std::shared_ptr<Resource>> streams = GetStreams(model);
+    if (cached.layout != HashLayout(model) || cached.streams.size() != streams.size() ||
+        (!cached.lod_ranges.empty() && cached.lod_ranges.size() != model.ia.ranges.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < streams.size(); ++i) {
+        if (cached.streams[i].size() != streams[i]->GetWidth()) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < streams.size(); ++i) {
+        command_list.UpdateSubresource(streams[i], 0, cached.streams[i].data());
+    }
+    return true;
+}
+
+bool SceneCache::Save(RenderDevice& device,
+                      uint64_t key,
+                      Model& model,
+                      const std::vector<std::vector<IMesh::Texture>>& textures,
+                      const std::vector<float>& uv_densities,
+                      const ModelLods& lods) const
+{
+    if (!key || textures.size() != uv_densities.size()) {
+        return false;
+    }
+
+    BinaryWriter writer;
+    writer.Write(kSceneCacheMagic);
+    writer.Write(kSceneCacheVersion);
+    writer.Write(key);
+    writer.Write(HashLayout(model));
+    std::vector<std::vector<uint8_t>> streams = ReadBackBuffers(device, GetStreams(model));
+    writer.Write<uint64_t>(streams.size());
+    for (const auto& data : streams) {
+        writer.WriteArray(data);
+    }
+    writer.Write<uint64_t>(textures.size());
+    for (const auto& mesh_textures : textures) {
+        writer.Write<uint64_t>(mesh_textures.size());
+        for (const auto& texture : mesh_textures) {
+            writer.Write<uint32_t>(texture.type);
+            writer.WriteArray(texture.path.data(), texture.path.size());
+        }
+    }
+    writer.WriteArray(uv_densities);
+
+    if (lods.indices && lods.ranges.size() == model.ia.ranges.size()) {
+        std::vector<std::vector<uint8_t>> lod_data = ReadBackBuffers(device, { lods.indices->GetBuffer() });
+        writer.WriteArray(UnpackIndices(lod_data.front(), lods.indices->Format()));
+        writer.Write<uint64_t>(lods.ranges.size());
+        for (const auto& range_lods : lods.ranges) {
+            writer.WriteArray(range_lods);
+        }
+    } else {
+        writer.WriteArray(std::vector<uint32_t>());
+        writer.Write<uint64_t>(0);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    std::string path = GetPath(key);
+    if (!writer.Save(path)) {
+        std::cerr << "Failed to save scene cache " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string SceneCache::GetPath(uint64_t key) const
+{
+    std::ostringstream path;
+    path << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".sponzacache";
+    return path.str();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "AssetCache/BinaryCache.h"
+#include "SceneLods.h"
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// File a scene model was imported from.
+struct ModelSource {
+    std::string path;
+    // Flags passed to the importer, ~0 keeps every default import step.
+    uint32_t flags = ~0u;
+};
+
+// Directory of the scene caches, next to the texture cache of the texture compressor.
+constexpr char kSceneCachePath[] = ASSETS_PATH "cache/scenes";
+
+// Key of the cache of a source, a hash of the source file and the import flags. 0 if the source can't be read.
+uint64_t GetSceneCacheKey(const ModelSource& source);
+
+// Load-time products of a static scene model as read from its cache.
+struct CachedModel {
+    // Ranges and stream sizes of the imported model the streams were written for.
+    uint64_t layout = 0;
+    // Index buffer followed by the vertex streams the model has, in the final layout, i.e. after
+    // OptimizeSceneModels.
+    std::vector<std::vector<uint8_t>> streams;
+    // Material textures the importer listed for every mesh and their uv densities, indexed by range id.
+    std::vector<std::vector<IMesh::Texture>> textures;
+    std::vector<float> uv_densities;
+    // LODs of BuildSceneLods, empty if the model had none.
+    std::vector<uint32_t> lod_indices;
+    std::vector<std::vector<RangeLod>> lod_ranges;
+};
+
+// Load-time products of static scene models in "<directory>/<key>.sponzacache". Model has no constructor taking
+// pre-imported data, so the importer still runs and the cached streams are uploaded over the imported ones. The
+// cache saves the stages which follow the import, the texture lists of the meshes and the LODs. Skinned models are
+// not cached, their bones and animations come from the importer.
+class SceneCache {
+public:
+    explicit SceneCache(const std::string& directory = kSceneCachePath);
+
+    // Maps and validates the cache of key, false if there is none or it is damaged. Safe to call from any thread.
+    bool Load(uint64_t key, CachedModel& model) const;
+    // Records the upload of the cached streams over the imported ones, false if model was imported with another
+    // layout than the cache was written for.
+    bool Restore(RenderCommandList& command_list, Model& model, const CachedModel& cached) const;
+    // Reads the final streams of model back and writes them with the textures and uv densities of every mesh,
+    // indexed by range id, and the LODs. The model data must be uploaded, this waits for the device to finish.
+    bool Save(RenderDevice& device,
+              uint64_t key,
+              Model& model,
+              const std::vector<std::vector<IMesh::Texture>>& textures,
+              const std::vector<float>& uv_densities,
+              const ModelLods& lods) const;
+
+private:
+    std::string GetPath(uint64_t key) const;
+
+    std::string m_directory;
+};
@@ -0,0 +1,29 @@
+#include "SceneInstances.h"
+
+void UploadSceneInstances(RenderDevice& device,
+                          RenderCommandList& command_list,
+                          const SceneModels& scene_list,
+                          SceneInstances& instances)
+{
+    instances.resize(scene_list.size());
+    for (auto& model_instances : instances) {
+        if (model_instances.transforms.empty()) {
+            model_instances.transforms.emplace_back(1.0f);
+        }
+        std::vector<glm::mat4> transforms;
+        for (const auto& transform : model_instances.transforms) {
+            transforms.push_back(glm::transpose(transform));
+        }
+        model_instances.buffer = device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                                     sizeof(glm::mat4) * transforms.size());
+        command_list.UpdateSubresource(model_instances.buffer, 0, transforms.data());
+    }
+}
+
+uint32_t GetInstanceCount(const SceneInstances& instances, size_t model_id)
+{
+    if (model_id >= instances.size()) {
+        return 1;
+    }
+    return static_cast<uint32_t>(instances[model_id].transforms.size());
+}
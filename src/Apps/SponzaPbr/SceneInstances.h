@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// Placements of one loaded model, every instance is drawn with world = transform * model.matrix. The transforms must
+// be rigid with a uniform scale, see Instancing.hlsli. A model is drawn once with its own matrix by default.
+struct ModelInstances {
+    std::vector<glm::mat4> transforms = { glm::mat4(1.0f) };
+    // StructuredBuffer<float4x4> instances of the vertex shaders.
+    std::shared_ptr<Resource> buffer;
+};
+
+using SceneInstances = std::vector<ModelInstances>;
+
+// Adds the default instance for models without placements and uploads the transforms of every model.
+void UploadSceneInstances(RenderDevice& device,
+                          RenderCommandList& command_list,
+                          const SceneModels& scene_list,
+                          SceneInstances& instances);
+
+uint32_t GetInstanceCount(const SceneInstances& instances, size_t model_id);
+
+template <typename Program>
+void AttachInstances(RenderCommandList& command_list,
+                     Program& program,
+                     const SceneInstances& instances,
+                     size_t model_id)
+{
+    command_list.Attach(program.vs.srv.instances, instances[model_id].buffer);
+}
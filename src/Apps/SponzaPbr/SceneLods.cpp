@@ -0,0 +1,136 @@
+#include "SceneLods.h"
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ModelReadback.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Error of LOD 1 relative to the extent of a range, doubled for every next LOD.
+constexpr float kLodError = 0.01f;
+// A LOD which keeps more than this share of the triangles of the previous one ends the chain.
+constexpr float kMinLodReduction = 0.8f;
+// Ranges projected to at least this share of the viewport height use LOD 0, every halving selects the next LOD.
+constexpr float kFullDetailScreenSize = 0.5f;
+
+} // namespace
+
+void BuildSceneLods(RenderDevice& device, SceneModels& scene_list, SceneLods& lods)
+{
+    lods.resize(scene_list.size());
+    std::shared_ptr<RenderCommandList> upload_command_list = device.CreateRenderCommandList();
+    for (size_t model_id = 0; model_id < scene_list.size(); ++model_id) {
+        auto& model = scene_list[model_id];
+        auto& model_lods = lods[model_id];
+        size_t vertex_count = model.ia.positions.Count();
+        if (model_lods.indices || model.ia.ranges.empty() || !vertex_count) {
+            continue;
+        }
+
+        std::vector<std::vector<uint8_t>> data =
+            ReadBackBuffers(device, { model.ia.indices.GetBuffer(), model.ia.positions.GetBuffer() });
+        std::vector<uint32_t> indices = UnpackIndices(data[0], model.ia.indices.Format());
+        std::vector<glm::vec3> positions(std::min(vertex_count, data[1].size() / sizeof(glm::vec3)));
+        std::memcpy(positions.data(), data[1].data(), positions.size() * sizeof(glm::vec3));
+        if (!std::all_of(model.ia.ranges.begin(), model.ia.ranges.end(), [&](const auto& range) {
+                return range.start_index_location + range.index_count <= indices.size();
+            })) {
+            continue;
+        }
+
+        std::vector<uint32_t> lod_indices;
+        for (auto& range : model.ia.ranges) {
+            auto& range_lods = model_lods.ranges.emplace_back();
+            auto first = indices.begin() + range.start_index_location;
+            std::vector<uint32_t> lod(first, first + range.index_count);
+            range_lods.push_back({ range.index_count, static_cast<uint32_t>(lod_indices.size()) });
+            lod_indices.insert(lod_indices.end(), lod.begin(), lod.end());
+
+            size_t base_vertex = std::max<int64_t>(range.base_vertex_location, 0);
+            if (lod.empty() || base_vertex >= positions.size()) {
+                continue;
+            }
+            size_t window_size = std::min<size_t>(*std::max_element(lod.begin(), lod.end()) + 1,
+                                                  positions.size() - base_vertex);
+            std::vector<glm::vec3> window(positions.begin() + base_vertex,
+                                          positions.begin() + base_vertex + window_size);
+
+            float error = kLodError;
+            while (range_lods.size() < kMaxLodCount) {
+                std::vector<uint32_t> next = SimplifyMesh(window, lod, lod.size() / 2, error);
+                if (next.empty() || next.size() > lod.size() * kMinLodReduction) {
+                    break;
+                }
+                next = OptimizeVertexCache(next, window.size());
+                range_lods.push_back(
+                    { static_cast<uint32_t>(next.size()), static_cast<uint32_t>(lod_indices.size()) });
+                lod_indices.insert(lod_indices.end(), next.begin(), next.end());
+                lod = std::move(next);
+                error *= 2;
+            }
+        }
+        model_lods.indices.reset(new IAIndexBuffer(device, *upload_command_list, lod_indices,
+                                                   gli::format::FORMAT_R32_UINT_PACK32));
+    }
+    upload_command_list->Close();
+    device.ExecuteCommandLists({ upload_command_list });
+    device.Wait(upload_command_list->GetFenceValue());
+}
+
+LodSelector::LodSelector(const SceneLods& lods,
+                         const ModelRangeBounds& bounds,
+                         bool enabled,
+                         const glm::vec3& eye,
+                         float projection_scale,
+                         float lod_bias)
+    : m_lods(lods)
+    , m_bounds(bounds)
+    , m_enabled(enabled)
+    , m_eye(eye)
+    , m_projection_scale(projection_scale)
+    , m_lod_bias(lod_bias)
+{
+}
+
+void LodSelector::BindIndices(RenderCommandList& command_list, size_t model_id, Model& model) const
+{
+    if (HasLods(model_id, model)) {
+        m_lods[model_id].indices->Bind(command_list);
+    } else {
+        model.ia.indices.Bind(command_list);
+    }
+}
+
+RangeLod LodSelector::GetRange(size_t model_id, const Model& model, size_t range_id) const
+{
+    const auto& range = model.ia.ranges[range_id];
+    if (!HasLods(model_id, model)) {
+        return { range.index_count, range.start_index_location };
+    }
+    const auto& range_lods = m_lods[model_id].ranges[range_id];
+    if (model_id >= m_bounds.size() || m_bounds[model_id].size() != model.ia.ranges.size()) {
+        return range_lods.front();
+    }
+
+    AABB box = TransformAABB(m_bounds[model_id][range_id], model.matrix);
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    float radius = glm::length(box.max - box.min) * 0.5f;
+    float distance = glm::length(center - m_eye);
+    if (distance <= radius) {
+        return range_lods.front();
+    }
+    float screen_size = radius * m_projection_scale / distance;
+    float lod = std::floor(std::log2(kFullDetailScreenSize / screen_size) + m_lod_bias);
+    size_t lod_id = static_cast<size_t>(std::clamp(lod, 0.0f, static_cast<float>(range_lods.size() - 1)));
+    return range_lods[lod_id];
+}
+
+bool LodSelector::HasLods(size_t model_id, const Model& model) const
+{
+    return m_enabled && model_id < m_lods.size() && m_lods[model_id].indices &&
+           m_lods[model_id].ranges.size() == model.ia.ranges.size();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "SceneBounds.h"
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+#include "Geometry/IABuffer.h"
+
+#include <memory>
+#include <vector>
+
+constexpr size_t kMaxLodCount = 5;
+
+// Index range of one LOD, drawn with the base vertex of the original range.
+struct RangeLod {
+    uint32_t index_count;
+    uint32_t start_index_location;
+};
+
+// Every LOD of every range of a model in a single index buffer. LOD 0 is a copy of the original range, so a model
+// binds one index buffer whatever LODs its ranges use.
+struct ModelLods {
+    std::unique_ptr<IAIndexBuffer> indices;
+    // Indexed as [range][lod].
+    std::vector<std::vector<RangeLod>> ranges;
+};
+
+using SceneLods = std::vector<ModelLods>;
+
+// Reads the index and position buffers back and simplifies every range into up to kMaxLodCount LODs, each with
+// about half the triangles of the previous one. Models which already have LODs in lods, e.g. restored from the
+// scene cache, are kept. The model data must be uploaded, this waits for the device to finish.
+void BuildSceneLods(RenderDevice& device, SceneModels& scene_list, SceneLods& lods);
+
+// Picks the LOD of every range for one view from the projected size of its bounds.
+class LodSelector {
+public:
+    // projection_scale is the [1][1] element of the projection matrix, a positive lod_bias selects coarser LODs.
+    LodSelector(const SceneLods& lods,
+                const ModelRangeBounds& bounds,
+                bool enabled,
+                const glm::vec3& eye,
+                float projection_scale,
+                float lod_bias);
+
+    void BindIndices(RenderCommandList& command_list, size_t model_id, Model& model) const;
+    RangeLod GetRange(size_t model_id, const Model& model, size_t range_id) const;
+
+private:
+    bool HasLods(size_t model_id, const Model& model) const;
+
+    const SceneLods& m_lods;
+    const ModelRangeBounds& m_bounds;
+    bool m_enabled;
+    glm::vec3 m_eye;
+    float m_projection_scale;
+    float m_lod_bias;
+};
@@ -0,0 +1,239 @@
+#include "SceneMeshlets.h"
+
+#include "MeshletBuilder.h"
+#include "ModelReadback.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Layout of Meshlet in MeshletCulling_CS.hlsl.
+struct GpuMeshlet {
+    glm::vec3 bounds_min;
+    uint32_t start_index;
+    glm::vec3 bounds_max;
+    uint32_t index_count;
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+    uint32_t range;
+    uint32_t model;
+    uint32_t never_culled;
+    uint32_t padding;
+};
+
+// Draw arguments of a range are a D3D12_DRAW_INDEXED_ARGUMENTS or VkDrawIndexedIndirectCommand.
+constexpr size_t kDrawArgsCount = 5;
+
+// Rows of groups of one dispatch, the limit of a dimension is 65535 groups.
+constexpr uint32_t kMaxGroupsPerRow = 65535;
+
+std::vector<glm::vec3> ReadVec3(const std::vector<uint8_t>& data, size_t count)
+{
+    std::vector<glm::vec3> values;
+    if (data.size() == count * sizeof(glm::vec3)) {
+        values.resize(count);
+        std::memcpy(values.data(), data.data(), data.size());
+    }
+    return values;
+}
+
+} // namespace
+
+SceneMeshlets BuildSceneMeshlets(RenderDevice& device,
+                                 SceneModels& scene_list,
+                                 const SceneInstances& instances)
+{
+    SceneMeshlets scene_meshlets;
+    std::vector<GpuMeshlet> meshlets;
+    std::vector<uint32_t> meshlet_indices;
+    uint32_t model_id = 0;
+    for (auto& model : scene_list) {
+        uint32_t cur_model_id = model_id++;
+        scene_meshlets.first_range.push_back(static_cast<uint32_t>(scene_meshlets.range_offsets.size()));
+        if (model.ia.ranges.empty()) {
+            continue;
+        }
+
+        size_t vertex_count = model.ia.positions.Count();
+        std::vector<std::shared_ptr<Resource>> buffers = { model.ia.indices.GetBuffer() };
+        uint32_t instance_count = GetInstanceCount(instances, cur_model_id);
+        bool cullable = !model.bones.HasAnimation() && vertex_count && instance_count == 1;
+        if (cullable) {
+            buffers.push_back(model.ia.positions.GetBuffer());
+        }
+        if (cullable && model.ia.normals.Count() == vertex_count) {
+            buffers.push_back(model.ia.normals.GetBuffer());
+        }
+        std::vector<std::vector<uint8_t>> data = ReadBackBuffers(device, buffers);
+        std::vector<uint32_t> indices = UnpackIndices(data[0], model.ia.indices.Format());
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        if (cullable) {
+            positions = ReadVec3(data[1], vertex_count);
+        }
+        if (data.size() > 2) {
+            normals = ReadVec3(data[2], vertex_count);
+        }
+
+        for (auto& range : model.ia.ranges) {
+            uint32_t range_id = static_cast<uint32_t>(scene_meshlets.range_offsets.size());
+            scene_meshlets.range_offsets.push_back(scene_meshlets.index_count);
+            scene_meshlets.range_base_vertices.push_back(range.base_vertex_location);
+            scene_meshlets.range_instance_counts.push_back(instance_count);
+            if (!range.index_count || range.start_index_location + range.index_count > indices.size()) {
+                continue;
+            }
+
+            auto first = indices.begin() + range.start_index_location;
+            std::vector<uint32_t> range_indices(first, first + range.index_count);
+            size_t window_size = *std::max_element(range_indices.begin(), range_indices.end()) + 1;
+            size_t base_vertex = std::max(range.base_vertex_location, 0);
+
+            std::vector<Meshlet> range_meshlets;
+            if (!positions.empty() && range.base_vertex_location >= 0 && base_vertex + window_size <= vertex_count) {
+                std::vector<glm::vec3> window(positions.begin() + base_vertex,
+                                              positions.begin() + base_vertex + window_size);
+                std::vector<glm::vec3> window_normals;
+                auto& opacity = model.GetMaterial(range.id).texture.opacity;
+                if (!normals.empty() && opacity->GetWidth() == 1 && opacity->GetHeight() == 1) {
+                    window_normals.assign(normals.begin() + base_vertex, normals.begin() + base_vertex + window_size);
+                }
+                range_meshlets = BuildMeshlets(range_indices, window, window_normals);
+            }
+
+            uint32_t start_index = static_cast<uint32_t>(meshlet_indices.size());
+            if (range_meshlets.empty()) {
+                meshlets.push_back({ {}, start_index, {}, range.index_count, {}, 1.0f, range_id, cur_model_id, 1, 0 });
+            }
+            for (const auto& meshlet : range_meshlets) {
+                meshlets.push_back({ meshlet.bounds_min, start_index + meshlet.start_index, meshlet.bounds_max,
+                                     meshlet.index_count, meshlet.cone_axis, meshlet.cone_cutoff, range_id,
+                                     cur_model_id, 0, 0 });
+            }
+            meshlet_indices.insert(meshlet_indices.end(), range_indices.begin(), range_indices.end());
+            scene_meshlets.index_count += range.index_count;
+        }
+    }
+
+    if (meshlets.empty()) {
+        return scene_meshlets;
+    }
+    std::cout << "Meshlets: " << meshlets.size() << " in " << scene_meshlets.range_offsets.size() << " ranges"
+              << std::endl;
+
+    scene_meshlets.meshlet_count = static_cast<uint32_t>(meshlets.size());
+    scene_meshlets.meshlets = device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                                  sizeof(GpuMeshlet) * meshlets.size());
+    scene_meshlets.indices = device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                                 sizeof(uint32_t) * meshlet_indices.size());
+    std::shared_ptr<RenderCommandList> upload_command_list = device.CreateRenderCommandList();
+    upload_command_list->UpdateSubresource(scene_meshlets.meshlets, 0, meshlets.data());
+    upload_command_list->UpdateSubresource(scene_meshlets.indices, 0, meshlet_indices.data());
+    upload_command_list->Close();
+    device.ExecuteCommandLists({ upload_command_list });
+    device.Wait(upload_command_list->GetFenceValue());
+    return scene_meshlets;
+}
+
+MeshletCuller::MeshletCuller(RenderDevice& device, const SceneMeshlets& meshlets, uint32_t instance_count)
+    : m_device(device)
+    , m_meshlets(meshlets)
+    , m_instance_count(instance_count)
+    , m_program(device)
+{
+}
+
+bool MeshletCuller::IsSupported() const
+{
+    return m_meshlets.meshlet_count != 0;
+}
+
+void MeshletCuller::Upload(RenderCommandList& command_list,
+                           const SceneModels& scene_list,
+                           const glm::vec3& eye,
+                           uint32_t phase_count)
+{
+    if (m_empty_args.empty()) {
+        for (size_t i = 0; i < m_meshlets.range_offsets.size(); ++i) {
+            uint32_t instance_count = m_instance_count * m_meshlets.range_instance_counts[i];
+            m_empty_args.insert(m_empty_args.end(), { 0, instance_count, m_meshlets.range_offsets[i],
+                                                      static_cast<uint32_t>(m_meshlets.range_base_vertices[i]), 0 });
+        }
+        m_model_matrices = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                                 sizeof(glm::mat4) * scene_list.size());
+        m_model_eyes = m_device.CreateBuffer(BindFlag::kShaderResource | BindFlag::kCopyDest,
+                                             sizeof(glm::vec4) * scene_list.size());
+        m_occluded = m_device.CreateBuffer(BindFlag::kUnorderedAccess, sizeof(uint32_t) * m_meshlets.meshlet_count);
+    }
+
+    std::vector<glm::mat4> matrices;
+    std::vector<glm::vec4> eyes;
+    for (auto& model : scene_list) {
+        matrices.push_back(glm::transpose(model.matrix));
+        eyes.push_back(glm::inverse(model.matrix) * glm::vec4(eye, 1.0f));
+    }
+    command_list.UpdateSubresource(m_model_matrices, 0, matrices.data());
+    command_list.UpdateSubresource(m_model_eyes, 0, eyes.data());
+    for (uint32_t phase = 0; phase < phase_count; ++phase) {
+        if (!m_indices[phase]) {
+            CreatePhaseResources(phase);
+        }
+        command_list.UpdateSubresource(m_draw_args[phase], 0, m_empty_args.data());
+    }
+}
+
+void MeshletCuller::Cull(RenderCommandList& command_list, const MeshletCullingDesc& desc)
+{
+    auto& settings = m_program.cs.cbuffer.Settings;
+    settings.view_projection = glm::transpose(desc.view_projection);
+    settings.hiz_view_projection = glm::transpose(desc.phase == 0 ? desc.hiz_view_projection : desc.view_projection);
+    settings.meshlet_count = m_meshlets.meshlet_count;
+    settings.phase = desc.phase;
+    settings.use_hiz = !!desc.hiz;
+    settings.max_distance = desc.max_distance;
+    settings.eye = desc.eye;
+
+    command_list.UseProgram(m_program);
+    command_list.Attach(m_program.cs.cbv.Settings, m_program.cs.cbuffer.Settings);
+    command_list.Attach(m_program.cs.srv.meshlets, m_meshlets.meshlets);
+    command_list.Attach(m_program.cs.srv.meshlet_indices, m_meshlets.indices);
+    command_list.Attach(m_program.cs.srv.model_matrices, m_model_matrices);
+    command_list.Attach(m_program.cs.srv.model_eyes, m_model_eyes);
+    command_list.Attach(m_program.cs.srv.hiz, desc.hiz);
+    command_list.Attach(m_program.cs.uav.indices, m_indices[desc.phase]);
+    command_list.Attach(m_program.cs.uav.draw_args, m_draw_args[desc.phase]);
+    command_list.Attach(m_program.cs.uav.occluded, m_occluded);
+    command_list.Dispatch(std::min(m_meshlets.meshlet_count, kMaxGroupsPerRow),
+                          (m_meshlets.meshlet_count + kMaxGroupsPerRow - 1) / kMaxGroupsPerRow, 1);
+}
+
+void MeshletCuller::BindIndices(RenderCommandList& command_list, uint32_t phase) const
+{
+    command_list.IASetIndexBuffer(m_indices[phase], gli::format::FORMAT_R32_UINT_PACK32);
+}
+
+const std::shared_ptr<Resource>& MeshletCuller::GetIndices(uint32_t phase) const
+{
+    return m_indices[phase];
+}
+
+const std::shared_ptr<Resource>& MeshletCuller::GetDrawArgs(uint32_t phase) const
+{
+    return m_draw_args[phase];
+}
+
+uint64_t MeshletCuller::GetDrawArgsOffset(size_t model_id, size_t range_id) const
+{
+    return sizeof(uint32_t) * kDrawArgsCount * (m_meshlets.first_range[model_id] + range_id);
+}
+
+void MeshletCuller::CreatePhaseResources(uint32_t phase)
+{
+    m_indices[phase] = m_device.CreateBuffer(BindFlag::kIndexBuffer | BindFlag::kUnorderedAccess,
+                                             sizeof(uint32_t) * m_meshlets.index_count);
+    m_draw_args[phase] = m_device.CreateBuffer(BindFlag::kIndirectBuffer | BindFlag::kUnorderedAccess |
+                                                   BindFlag::kCopyDest,
+                                               sizeof(uint32_t) * m_empty_args.size());
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+#include "ProgramRef/MeshletCulling_CS.h"
+#include "SceneInstances.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// Meshlets of every range of the scene. The triangles of a range are written to its own region of the culled index
+// buffer, the regions and draw arguments follow the ranges of all models in scene order.
+struct SceneMeshlets {
+    // MeshletCulling_CS.hlsl layout, see GpuMeshlet in SceneMeshlets.cpp.
+    std::shared_ptr<Resource> meshlets;
+    // Indices of the meshlets relative to the base vertex of their range, in meshlet order.
+    std::shared_ptr<Resource> indices;
+    uint32_t meshlet_count = 0;
+    uint32_t index_count = 0;
+    // Index of the first range of every model among the ranges of the scene.
+    std::vector<uint32_t> first_range;
+    // Start of every range in the culled index buffer.
+    std::vector<uint32_t> range_offsets;
+    std::vector<int32_t> range_base_vertices;
+    std::vector<uint32_t> range_instance_counts;
+};
+
+// Reads the index, position and normal buffers back and splits every range into meshlets. Ranges of animated or
+// instanced models and of models whose buffers can't be read become a single meshlet which is never culled, ranges
+// with an opacity map get no cone as they are usually double sided. The model data must be uploaded, this waits for
+// the device to finish.
+SceneMeshlets BuildSceneMeshlets(RenderDevice& device, SceneModels& scene_list, const SceneInstances& instances);
+
+struct MeshletCullingDesc {
+    uint32_t phase = 0;
+    // Eye of the backface cone test.
+    glm::vec3 eye = {};
+    // Frustum of the view, unused when max_distance is set.
+    glm::mat4 view_projection = glm::mat4(1.0f);
+    // Meshlets further than this from the eye are culled, the frustum test is skipped. Used for the six faces of a
+    // cube map at once.
+    float max_distance = 0;
+    // Two phase occlusion culling as in OcclusionCulling_CS.hlsl, phase 0 tests against a pyramid built with
+    // hiz_view_projection and phase 1 retests its occluded meshlets. No test without a pyramid.
+    std::shared_ptr<Resource> hiz;
+    glm::mat4 hiz_view_projection = glm::mat4(1.0f);
+};
+
+// Culls the meshlets of the scene on the GPU and compacts the triangles of the visible ones into an index buffer
+// with one indexed indirect draw per range. Every range is drawn instance_count times per instance of its model.
+class MeshletCuller {
+public:
+    MeshletCuller(RenderDevice& device, const SceneMeshlets& meshlets, uint32_t instance_count);
+
+    bool IsSupported() const;
+    // Creates the buffers of phases 0 to phase_count - 1 and records the uploads of the frame, see IPass::OnUpload.
+    // Must be recorded ahead of every Cull of the frame.
+    void Upload(RenderCommandList& command_list,
+                const SceneModels& scene_list,
+                const glm::vec3& eye,
+                uint32_t phase_count);
+    // Creates no device objects, so it may be recorded on a worker thread.
+    void Cull(RenderCommandList& command_list, const MeshletCullingDesc& desc);
+
+    // The indices are relative to the base vertex of the range, which is part of the draw arguments.
+    void BindIndices(RenderCommandList& command_list, uint32_t phase) const;
+    const std::shared_ptr<Resource>& GetIndices(uint32_t phase) const;
+    const std::shared_ptr<Resource>& GetDrawArgs(uint32_t phase) const;
+    uint64_t GetDrawArgsOffset(size_t model_id, size_t range_id) const;
+
+private:
+    void CreatePhaseResources(uint32_t phase);
+
+    RenderDevice& m_device;
+    const SceneMeshlets& m_meshlets;
+    uint32_t m_instance_count;
+    ProgramHolder<MeshletCulling_CS> m_program;
+    // Draw arguments with no indices, copied over the ones of the phase before every culling.
+    std::vector<uint32_t> m_empty_args;
+    std::shared_ptr<Resource> m_model_matrices;
+    std::shared_ptr<Resource> m_model_eyes;
+    std::shared_ptr<Resource> m_occluded;
+    std::shared_ptr<Resource> m_indices[2];
+    std::shared_ptr<Resource> m_draw_args[2];
+};
@@ -0,0 +1,136 @@
+#include "SceneOptimizer.h"
+
+#include "MeshOptimizer.h"
+#include "ModelReadback.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+// Overdraw clusters keep the cache miss ratio within this factor of the cache optimized order.
+constexpr float kOverdrawThreshold = 1.05f;
+
+// Indices of all ranges with the base vertex applied, in draw order.
+std::vector<uint32_t> GetDrawnIndices(const Model& model, const std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> drawn;
+    for (const auto& range : model.ia.ranges) {
+        for (uint32_t i = 0; i < range.index_count; ++i) {
+            drawn.push_back(indices[range.start_index_location + i] + range.base_vertex_location);
+        }
+    }
+    return drawn;
+}
+
+} // namespace
+
+void OptimizeSceneModels(RenderDevice& device, SceneModels& scene_list, const std::vector<bool>& skip)
+{
+    std::shared_ptr<RenderCommandList> upload_command_list = device.CreateRenderCommandList();
+    size_t model_id = 0;
+    for (auto& model : scene_list) {
+        size_t cur_model_id = model_id++;
+        size_t vertex_count = model.ia.positions.Count();
+        if ((cur_model_id < skip.size() && skip[cur_model_id]) || model.ia.ranges.empty() || !vertex_count ||
+            model.ia.positions.GetBuffer()->GetWidth() != vertex_count * sizeof(glm::vec3)) {
+            continue;
+        }
+
+        // Vertex fetch reordering moves the vertices of every stream, it is skipped if a stream can't follow or
+        // ranges share vertices.
+        bool reorder_vertices = true;
+        std::vector<std::shared_ptr<Resource>> buffers = { model.ia.indices.GetBuffer() };
+        for (IAVertexBuffer* vertices : { &model.ia.positions, &model.ia.normals, &model.ia.texcoords,
+                                          &model.ia.tangents, &model.ia.bones_offset, &model.ia.bones_count }) {
+            if (!vertices->Count()) {
+                continue;
+            }
+            if (vertices->Count() != vertex_count || vertices->GetBuffer()->GetWidth() % vertex_count != 0) {
+                reorder_vertices = false;
+                continue;
+            }
+            buffers.push_back(vertices->GetBuffer());
+        }
+        std::vector<std::vector<uint8_t>> data = ReadBackBuffers(device, buffers);
+        std::vector<uint32_t> indices = UnpackIndices(data.front(), model.ia.indices.Format());
+
+        // Vertices referenced by every range, [base_vertex_location, base_vertex_location + window_size).
+        std::vector<size_t> window_sizes;
+        bool valid = true;
+        for (const auto& range : model.ia.ranges) {
+            size_t window_size = 0;
+            valid &= range.base_vertex_location >= 0;
+            valid &= range.start_index_location + range.index_count <= indices.size();
+            for (uint32_t i = 0; valid && i < range.index_count; ++i) {
+                window_size = std::max<size_t>(window_size, indices[range.start_index_location + i] + 1);
+            }
+            valid &= static_cast<size_t>(std::max(range.base_vertex_location, 0)) + window_size <= vertex_count;
+            window_sizes.push_back(window_size);
+        }
+        if (!valid) {
+            std::cerr << "Model " << cur_model_id << ": ranges are out of bounds, optimization is skipped" << std::endl;
+            continue;
+        }
+
+        std::vector<size_t> order(model.ia.ranges.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return model.ia.ranges[a].base_vertex_location < model.ia.ranges[b].base_vertex_location;
+        });
+        for (size_t i = 0; i + 1 < order.size(); ++i) {
+            size_t end = model.ia.ranges[order[i]].base_vertex_location + window_sizes[order[i]];
+            if (end > static_cast<size_t>(model.ia.ranges[order[i + 1]].base_vertex_location)) {
+                reorder_vertices = false;
+            }
+        }
+
+        std::vector<glm::vec3> positions(vertex_count);
+        std::memcpy(positions.data(), data[1].data(), positions.size() * sizeof(glm::vec3));
+
+        VertexCacheStatistics before = AnalyzeVertexCache(GetDrawnIndices(model, indices), vertex_count);
+
+        std::vector<std::vector<uint8_t>> reordered = data;
+        for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+            const auto& range = model.ia.ranges[range_id];
+            size_t base_vertex = range.base_vertex_location;
+            auto first = indices.begin() + range.start_index_location;
+            std::vector<uint32_t> range_indices(first, first + range.index_count);
+            std::vector<glm::vec3> window(positions.begin() + base_vertex,
+                                          positions.begin() + base_vertex + window_sizes[range_id]);
+
+            range_indices = OptimizeOverdraw(range_indices, window, kOverdrawThreshold);
+            if (reorder_vertices) {
+                std::vector<uint32_t> remap = OptimizeVertexFetch(range_indices, window.size());
+                for (size_t i = 1; i < data.size(); ++i) {
+                    size_t stride = data[i].size() / vertex_count;
+                    for (size_t j = 0; j < remap.size(); ++j) {
+                        std::memcpy(&reordered[i][(base_vertex + remap[j]) * stride],
+                                    &data[i][(base_vertex + j) * stride], stride);
+                    }
+                }
+            }
+            std::copy(range_indices.begin(), range_indices.end(), first);
+        }
+
+        VertexCacheStatistics after = AnalyzeVertexCache(GetDrawnIndices(model, indices), vertex_count);
+        std::cout << "Model " << cur_model_id << ": ACMR " << std::fixed << std::setprecision(3) << before.acmr
+                  << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr
+                  << (reorder_vertices ? "" : ", vertex order is kept") << std::endl;
+
+        PackIndices(indices, model.ia.indices.Format(), data.front());
+        upload_command_list->UpdateSubresource(buffers.front(), 0, data.front().data());
+        if (reorder_vertices) {
+            for (size_t i = 1; i < buffers.size(); ++i) {
+                upload_command_list->UpdateSubresource(buffers[i], 0, reordered[i].data());
+            }
+        }
+    }
+    upload_command_list->Close();
+    device.ExecuteCommandLists({ upload_command_list });
+    device.Wait(upload_command_list->GetFenceValue());
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <vector>
+
+// Reorders the triangles of every range for the post-transform cache and overdraw, then renumbers the vertices
+// of every range in the order they are fetched. The IA buffers are read back and rewritten in place and the
+// ACMR/ATVR of every model before and after is written to stdout. The model data must be uploaded, this waits
+// for the device to finish. Models marked in skip, e.g. restored from the scene cache, are left as they are.
+void OptimizeSceneModels(RenderDevice& device, SceneModels& scene_list, const std::vector<bool>& skip = {});
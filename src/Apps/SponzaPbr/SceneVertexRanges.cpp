@@ -0,0 +1,41 @@
+#include "SceneVertexRanges.h"
+
+#include "ModelReadback.h"
+
+ModelVertexRanges ComputeVertexRanges(RenderDevice& device, SceneModels& scene_list)
+{
+    std::vector<std::shared_ptr<Resource>> index_buffers;
+    for (auto& model : scene_list) {
+        index_buffers.push_back(model.ia.indices.GetBuffer());
+    }
+    std::vector<std::vector<uint8_t>> index_data = ReadBackBuffers(device, index_buffers);
+
+    ModelVertexRanges vertex_ranges;
+    for (size_t model_id = 0; model_id < scene_list.size(); ++model_id) {
+        auto& model = scene_list[model_id];
+        std::vector<uint32_t> indices = UnpackIndices(index_data[model_id], model.ia.indices.Format());
+        auto& model_ranges = vertex_ranges.emplace_back(model.ia.positions.Count(), kNoVertexRange);
+        bool shared_vertices = false;
+        for (uint32_t range_id = 0; range_id < model.ia.ranges.size() && !shared_vertices; ++range_id) {
+            auto& range = model.ia.ranges[range_id];
+            if (range.start_index_location + range.index_count > indices.size()) {
+                shared_vertices = true;
+                break;
+            }
+            for (uint32_t i = 0; i < range.index_count; ++i) {
+                int64_t vertex = range.base_vertex_location;
+                vertex += indices[range.start_index_location + i];
+                if (vertex < 0 || vertex >= static_cast<int64_t>(model_ranges.size()) ||
+                    (model_ranges[vertex] != kNoVertexRange && model_ranges[vertex] != range_id)) {
+                    shared_vertices = true;
+                    break;
+                }
+                model_ranges[vertex] = range_id;
+            }
+        }
+        if (shared_vertices) {
+            model_ranges.clear();
+        }
+    }
+    return vertex_ranges;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t kNoVertexRange = ~0u;
+
+// Range of every vertex of a model, indexed as [model][vertex], kNoVertexRange for vertices of no range. Empty for
+// models whose ranges share vertices, those can't have a per-vertex attribute per range.
+using ModelVertexRanges = std::vector<std::vector<uint32_t>>;
+
+// Reads the index buffers back and assigns the vertices to the ranges referencing them. The model data must be
+// uploaded, this waits for the device to finish.
+ModelVertexRanges ComputeVertexRanges(RenderDevice& device, SceneModels& scene_list);
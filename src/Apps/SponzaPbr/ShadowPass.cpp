@@ -1,5 +1,7 @@
 #include "ShadowPass.h"
 
+#include "RenderGraph.h"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -7,6 +9,8 @@ ShadowPass::ShadowPass(RenderDevice& device, const Input& input)
     : m_device(device)
     , m_input(input)
     , m_program(device)
+    , m_program_packed(device)
+    , m_meshlet_culler(device, input.meshlets, 6)
 {
     CreateSizeDependentResources();
     m_sampler = m_device.CreateSampler({
@@ -30,7 +34,7 @@ void ShadowPass::OnUpdate()
     glm::vec3 position = m_input.light_pos;
 
     m_program.vs.cbuffer.VSParams.Projection = glm::transpose(
-        glm::perspective(glm::radians(90.0f), 1.0f, m_settings.Get<float>("s_near"), m_settings.Get<float>("s_far")));
+        glm::perspective(glm::radians(90.0f), 1.0f, m_settings.s_near, m_settings.s_far));
 
     std::array<glm::mat4, 6>& view = m_program.vs.cbuffer.VSParams.View;
     view[0] = glm::transpose(glm::lookAt(position, position + Right, Up));
@@ -39,62 +43,138 @@ void ShadowPass::OnUpdate()
     view[3] = glm::transpose(glm::lookAt(position, position + Down, ForwardRH));
     view[4] = glm::transpose(glm::lookAt(position, position + BackwardLH, Up));
     view[5] = glm::transpose(glm::lookAt(position, position + ForwardLH, Up));
+
+    m_program_packed.vs.cbuffer.VSParams.Projection = m_program.vs.cbuffer.VSParams.Projection;
+    m_program_packed.vs.cbuffer.VSParams.View = view;
+}
+
+void ShadowPass::OnUpload(RenderCommandList& command_list)
+{
+    if (m_settings.use_shadow && UseMeshlets()) {
+        m_meshlet_culler.Upload(command_list, m_input.scene_list, m_input.light_pos, 1);
+    }
 }
 
 void ShadowPass::OnRender(RenderCommandList& command_list)
 {
-    if (!m_settings.Get<bool>("use_shadow")) {
+    if (!m_settings.use_shadow) {
         return;
     }
 
-    command_list.SetViewport(0, 0, m_settings.Get<float>("s_size"), m_settings.Get<float>("s_size"));
-
-    command_list.UseProgram(m_program);
-    command_list.Attach(m_program.vs.cbv.VSParams, m_program.vs.cbuffer.VSParams);
-    command_list.Attach(m_program.ps.sampler.g_sampler, m_sampler);
+    command_list.SetViewport(0, 0, m_settings.s_size, m_settings.s_size);
 
     glm::vec4 color = { 0.0f, 0.0f, 0.0f, 1.0f };
     RenderPassBeginDesc render_pass_desc = {};
     render_pass_desc.depth_stencil.texture = output.srv;
     render_pass_desc.depth_stencil.clear_depth = 1.0f;
 
+    // All six faces are drawn with one instanced draw, so the meshlets are culled against all of them at once.
+    if (UseMeshlets()) {
+        MeshletCullingDesc desc = {};
+        desc.eye = m_input.light_pos;
+        desc.max_distance = m_settings.s_far;
+        m_meshlet_culler.Cull(command_list, desc);
+    }
+
+    // The distance to the light selects the LOD for all faces. The faces have a 90 degree field of view, so the
+    // projection scale is 1. Culled meshlets are drawn at full detail.
+    LodSelector lods(m_input.lods, m_input.range_bounds, m_settings.use_lod && !UseMeshlets(), m_input.light_pos,
+                     1.0f, m_settings.lod_bias);
+
     command_list.BeginRenderPass(render_pass_desc);
+    DrawModels(command_list, m_program, lods);
+    if (m_settings.use_packed_vertices) {
+        DrawModels(command_list, m_program_packed, lods);
+    }
+    command_list.EndRenderPass();
+}
+
+template <typename Program>
+void ShadowPass::DrawModels(RenderCommandList& command_list, Program& program, const LodSelector& lods)
+{
+    constexpr bool packed = IsPackedProgram<Program>::value;
+    bool use_meshlets = !packed && UseMeshlets();
+
+    command_list.UseProgram(program);
+    command_list.Attach(program.vs.cbv.VSParams, program.vs.cbuffer.VSParams);
+    command_list.Attach(program.ps.sampler.g_sampler, m_sampler);
+
+    size_t model_id = 0;
     for (auto& model : m_input.scene_list) {
-        m_program.vs.cbuffer.VSParams.World = glm::transpose(model.matrix);
+        size_t cur_model_id = model_id++;
+        if ((m_settings.use_packed_vertices && HasPackedVertices(m_input.packed_vertices, cur_model_id)) != packed) {
+            continue;
+        }
+        program.vs.cbuffer.VSParams.World = glm::transpose(model.matrix);
+        AttachInstances(command_list, program, m_input.instances, cur_model_id);
 
         command_list.SetRasterizeState({ FillMode::kSolid, CullMode::kBack, 4096 });
 
-        model.ia.indices.Bind(command_list);
-        model.ia.positions.BindToSlot(command_list, m_program.vs.ia.SV_POSITION);
-        model.ia.texcoords.BindToSlot(command_list, m_program.vs.ia.TEXCOORD);
+        if (use_meshlets) {
+            m_meshlet_culler.BindIndices(command_list, 0);
+        } else {
+            lods.BindIndices(command_list, cur_model_id, model);
+        }
+        if constexpr (packed) {
+            AttachPackedVertices(command_list, program, m_input.packed_vertices[cur_model_id]);
+        } else {
+            model.ia.positions.BindToSlot(command_list, program.vs.ia.SV_POSITION);
+            model.ia.texcoords.BindToSlot(command_list, program.vs.ia.TEXCOORD);
+        }
 
-        for (auto& range : model.ia.ranges) {
+        for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+            auto& range = model.ia.ranges[range_id];
             auto& material = model.GetMaterial(range.id);
 
-            if (m_settings.Get<bool>("shadow_discard")) {
-                command_list.Attach(m_program.ps.srv.alphaMap, material.texture.opacity);
+            if (m_settings.shadow_discard) {
+                command_list.Attach(program.ps.srv.alphaMap, material.texture.opacity);
             } else {
-                command_list.Attach(m_program.ps.srv.alphaMap);
+                command_list.Attach(program.ps.srv.alphaMap);
             }
 
-            command_list.DrawIndexed(range.index_count, 6, range.start_index_location, range.base_vertex_location, 0);
+            if (use_meshlets) {
+                command_list.DrawIndexedIndirect(m_meshlet_culler.GetDrawArgs(0),
+                                                 m_meshlet_culler.GetDrawArgsOffset(cur_model_id, range_id));
+                continue;
+            }
+            RangeLod lod = lods.GetRange(cur_model_id, model, range_id);
+            DrawRange(command_list, program, m_input.packed_vertices, cur_model_id, range_id,
+                      range.base_vertex_location, lod, 6 * GetInstanceCount(m_input.instances, cur_model_id));
         }
     }
-    command_list.EndRenderPass();
+}
+
+bool ShadowPass::UseMeshlets() const
+{
+    return m_settings.use_meshlet_culling && m_meshlet_culler.IsSupported();
 }
 
 void ShadowPass::CreateSizeDependentResources()
 {
     output.srv = m_device.CreateTexture(BindFlag::kDepthStencil | BindFlag::kShaderResource,
-                                        gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_settings.Get<float>("s_size"),
-                                        m_settings.Get<float>("s_size"), 6);
+                                        gli::format::FORMAT_D32_SFLOAT_PACK32, 1, m_settings.s_size, m_settings.s_size,
+                                        6);
+}
+
+SponzaSettingsMask ShadowPass::GetSponzaSettingsSubscription() const
+{
+    return {
+        SponzaSetting::use_shadow, SponzaSetting::shadow_discard, SponzaSetting::s_near, SponzaSetting::s_far,
+        SponzaSetting::s_size, SponzaSetting::use_lod, SponzaSetting::lod_bias, SponzaSetting::use_packed_vertices,
+        SponzaSetting::use_meshlet_culling
+    };
 }
 
-void ShadowPass::OnModifySponzaSettings(const SponzaSettings& settings)
+void ShadowPass::OnModifySponzaSettings(const SponzaSettingsValues& settings, const SponzaSettingsMask& changes)
 {
-    SponzaSettings prev = m_settings;
     m_settings = settings;
-    if (prev.Get<float>("s_size") != m_settings.Get<float>("s_size")) {
+    if (changes.Test(SponzaSetting::s_size)) {
         CreateSizeDependentResources();
     }
 }
+
+void ShadowPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
+{
+    builder.AllowParallelRecording();
+    builder.Write(output.srv);
+}
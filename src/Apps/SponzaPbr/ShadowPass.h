@@ -3,9 +3,15 @@
 #include "Camera/Camera.h"
 #include "Device/Device.h"
 #include "Geometry/Geometry.h"
+#include "PackedVertices.h"
+#include "ProgramRef/ShadowPassPacked_VS.h"
 #include "ProgramRef/ShadowPass_PS.h"
 #include "ProgramRef/ShadowPass_VS.h"
 #include "RenderPass.h"
+#include "SceneBounds.h"
+#include "SceneInstances.h"
+#include "SceneLods.h"
+#include "SceneMeshlets.h"
 #include "SponzaSettings.h"
 
 class ShadowPass : public IPass {
@@ -14,6 +20,11 @@ public:
         SceneModels& scene_list;
         const Camera& camera;
         glm::vec3& light_pos;
+        const ModelRangeBounds& range_bounds;
+        const SceneLods& lods;
+        const ScenePackedVertices& packed_vertices;
+        const SceneMeshlets& meshlets;
+        const SceneInstances& instances;
     };
 
     struct Output {
@@ -23,15 +34,25 @@ public:
     ShadowPass(RenderDevice& device, const Input& input);
 
     virtual void OnUpdate() override;
+    virtual void OnUpload(RenderCommandList& command_list) override;
     virtual void OnRender(RenderCommandList& command_list) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual SponzaSettingsMask GetSponzaSettingsSubscription() const override;
+    virtual void OnModifySponzaSettings(const SponzaSettingsValues& settings,
+                                        const SponzaSettingsMask& changes) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
     void CreateSizeDependentResources();
+    template <typename Program>
+    void DrawModels(RenderCommandList& command_list, Program& program, const LodSelector& lods);
+    bool UseMeshlets() const;
 
-    SponzaSettings m_settings;
+    SponzaSettingsValues m_settings;
     RenderDevice& m_device;
     Input m_input;
     ProgramHolder<ShadowPass_VS, ShadowPass_PS> m_program;
+    ProgramHolder<ShadowPassPacked_VS, ShadowPass_PS> m_program_packed;
+    // Culls the meshlets of the models with float streams by distance and facing to the light.
+    MeshletCuller m_meshlet_culler;
     std::shared_ptr<Resource> m_sampler;
 };
@@ -1,5 +1,7 @@
 #include "SkinningPass.h"
 
+#include "RenderGraph.h"
+
 SkinningPass::SkinningPass(RenderDevice& device, const Input& input)
     : m_device(device)
     , m_input(input)
@@ -15,7 +17,7 @@ void SkinningPass::OnRender(RenderCommandList& command_list)
     command_list.Attach(m_program.cs.cbv.cb, m_program.cs.cbuffer.cb);
 
     for (auto& model : m_input.scene_list) {
-        model.bones.UpdateAnimation(m_device, command_list, glfwGetTime());
+        model.bones.UpdateAnimation(m_device, command_list, m_input.time);
     }
 
     for (auto& model : m_input.scene_list) {
@@ -49,7 +51,7 @@ void SkinningPass::OnRender(RenderCommandList& command_list)
     }
 }
 
-void SkinningPass::OnModifySponzaSettings(const SponzaSettings& settings)
+void SkinningPass::OnSetupRenderGraph(RenderGraphBuilder& builder)
 {
-    m_settings = settings;
+    builder.SideEffect();
 }
@@ -10,6 +10,7 @@ class SkinningPass : public IPass {
 public:
     struct Input {
         SceneModels& scene_list;
+        const float& time;
     };
 
     struct Output {
@@ -19,10 +20,9 @@ public:
 
     virtual void OnUpdate() override;
     virtual void OnRender(RenderCommandList& command_list) override;
-    virtual void OnModifySponzaSettings(const SponzaSettings& settings) override;
+    virtual void OnSetupRenderGraph(RenderGraphBuilder& builder) override;
 
 private:
-    SponzaSettings m_settings;
     RenderDevice& m_device;
     Input m_input;
     ProgramHolder<Skinning_CS> m_program;
@@ -3,6 +3,11 @@
 #include <imgui.h>
 
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 HotKey::HotKey(std::function<void()> on_key)
     : m_on_key(on_key)
@@ -23,19 +28,166 @@ bool HotKey::OnKey(int key)
     return false;
 }
 
+const std::vector<SponzaSettingInfo>& GetSponzaSettingInfos()
+{
+    static const std::vector<SponzaSettingInfo> infos = {
+#define SPONZA_SETTINGS_INFO(type, name, value) \
+    { SponzaSetting::name, #name, offsetof(SponzaSettingsValues, name), sizeof(type), typeid(type) },
+        SPONZA_SETTINGS(SPONZA_SETTINGS_INFO)
+#undef SPONZA_SETTINGS_INFO
+    };
+    return infos;
+}
+
+const std::vector<uint32_t>& GetSampleCounts()
+{
+    static const std::vector<uint32_t> sample_counts = { 1, 2, 4, 8 };
+    return sample_counts;
+}
+
+const SponzaSettingInfo* FindSponzaSetting(const std::string& name)
+{
+    for (const auto& info : GetSponzaSettingInfos()) {
+        if (info.name == name) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+const void* SponzaSettings::GetPointer(const std::string& key, std::type_index type) const
+{
+    const SponzaSettingInfo* info = FindSponzaSetting(key);
+    if (!info) {
+        throw std::out_of_range("Unknown setting " + key);
+    }
+    if (info->type != type) {
+        throw std::invalid_argument("Wrong type for setting " + key);
+    }
+    return reinterpret_cast<const uint8_t*>(&m_values) + info->offset;
+}
+
+std::string TrimSettingText(const std::string& str)
+{
+    size_t first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return {};
+    }
+    size_t last = str.find_last_not_of(" \t\r");
+    return str.substr(first, last - first + 1);
+}
+
+namespace {
+
+bool ParseSetting(SponzaSettingsValues& values, const std::string& key, const std::string& value)
+{
+    const SponzaSettingInfo* info = FindSponzaSetting(key);
+    if (!info) {
+        return false;
+    }
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(&values) + info->offset;
+    std::istringstream stream(TrimSettingText(value));
+    if (info->type == typeid(bool)) {
+        std::string str = stream.str();
+        if (str == "1" || str == "true") {
+            *reinterpret_cast<bool*>(ptr) = true;
+        } else if (str == "0" || str == "false") {
+            *reinterpret_cast<bool*>(ptr) = false;
+        } else {
+            return false;
+        }
+        return true;
+    } else if (info->type == typeid(uint32_t)) {
+        stream >> *reinterpret_cast<uint32_t*>(ptr);
+    } else if (info->type == typeid(int32_t)) {
+        stream >> *reinterpret_cast<int32_t*>(ptr);
+    } else if (info->type == typeid(float)) {
+        stream >> *reinterpret_cast<float*>(ptr);
+    } else {
+        return false;
+    }
+    return !stream.fail();
+}
+
+} // namespace
+
+bool SponzaSettings::SetFromString(const std::string& key, const std::string& value)
+{
+    return SetFromStrings({ { key, value } });
+}
+
+bool SponzaSettings::SetFromStrings(const std::vector<std::pair<std::string, std::string>>& entries)
+{
+    SponzaSettingsValues values = m_values;
+    for (const auto& entry : entries) {
+        if (!ParseSetting(values, entry.first, entry.second)) {
+            return false;
+        }
+    }
+    m_values = values;
+    return true;
+}
+
+std::string SponzaSettings::GetAsString(const std::string& key) const
+{
+    const SponzaSettingInfo* info = FindSponzaSetting(key);
+    if (!info) {
+        return {};
+    }
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(&m_values) + info->offset;
+    std::ostringstream stream;
+    if (info->type == typeid(bool)) {
+        stream << (*reinterpret_cast<const bool*>(ptr) ? "true" : "false");
+    } else if (info->type == typeid(uint32_t)) {
+        stream << *reinterpret_cast<const uint32_t*>(ptr);
+    } else if (info->type == typeid(int32_t)) {
+        stream << *reinterpret_cast<const int32_t*>(ptr);
+    } else if (info->type == typeid(float)) {
+        stream << std::setprecision(std::numeric_limits<float>::max_digits10) << *reinterpret_cast<const float*>(ptr);
+    }
+    return stream.str();
+}
+
+bool SponzaSettings::LoadPreset(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = TrimSettingText(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) {
+            return false;
+        }
+        entries.emplace_back(TrimSettingText(line.substr(0, pos)), line.substr(pos + 1));
+    }
+    return SetFromStrings(entries);
+}
+
+bool SponzaSettings::SavePreset(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    for (const auto& info : GetSponzaSettingInfos()) {
+        file << info.name << " = " << GetAsString(info.name) << std::endl;
+    }
+    return file.good();
+}
+
 template <typename T>
 void SponzaSettings::add_combo(const std::string& label,
                                const std::vector<std::string>& items,
-                               const std::vector<T>& items_data,
-                               T value)
-{
-    m_settings[label] = value;
-    int index = 0;
-    for (size_t i = 0; i < items_data.size(); ++i) {
-        if (items_data[i] == value) {
-            index = static_cast<int>(i);
-        }
-    }
+                               const std::vector<T>& items_data)
+{
+    T* value = const_cast<T*>(static_cast<const T*>(GetPointer(label, typeid(T))));
     struct Capture {
         std::vector<std::string> items;
     } capture = { items };
@@ -50,110 +202,137 @@ void SponzaSettings::add_combo(const std::string& label,
         *text = capture.items[index].c_str();
         return true;
     };
-    m_items.push_back([index, capture, label, fn, items, items_data, this]() mutable {
+    m_items.push_back([value, capture, label, fn, items, items_data]() mutable {
+        int index = 0;
+        for (size_t i = 0; i < items_data.size(); ++i) {
+            if (items_data[i] == *value) {
+                index = static_cast<int>(i);
+            }
+        }
         if (ImGui::Combo(label.c_str(), &index, fn, &capture, static_cast<int>(items.size()))) {
-            m_settings[label] = items_data[index];
+            *value = items_data[index];
             return true;
         }
         return false;
     });
 }
 
-HotKey& SponzaSettings::add_checkbox(const std::string& label, bool value)
+HotKey& SponzaSettings::add_checkbox(const std::string& label)
 {
-    m_settings[label] = value;
-    m_items.push_back([this, label]() mutable {
-        bool value = Get<bool>(label);
-        auto res = ImGui::Checkbox(label.c_str(), &value);
-        m_settings[label] = value;
-        return res;
-    });
-    m_hotkeys.emplace_back([this, label] { m_settings[label] = !Get<bool>(label); });
+    bool* value = const_cast<bool*>(static_cast<const bool*>(GetPointer(label, typeid(bool))));
+    m_items.push_back([value, label]() { return ImGui::Checkbox(label.c_str(), value); });
+    m_hotkeys.emplace_back([value] { *value = !*value; });
     return m_hotkeys.back();
 }
 
-void SponzaSettings::add_slider_int(const std::string& label, int32_t value, int min, int max)
+void SponzaSettings::add_slider_int(const std::string& label, int min, int max)
 {
-    m_settings[label] = value;
-    m_items.push_back([this, label, min, max]() mutable {
-        int32_t value = Get<int32_t>(label);
-        auto res = ImGui::SliderInt(label.c_str(), &value, min, max);
-        m_settings[label] = value;
-        return res;
-    });
+    int32_t* value = const_cast<int32_t*>(static_cast<const int32_t*>(GetPointer(label, typeid(int32_t))));
+    m_items.push_back([value, label, min, max]() { return ImGui::SliderInt(label.c_str(), value, min, max); });
 }
 
-void SponzaSettings::add_slider(const std::string& label, float value, float min, float max, bool linear)
+void SponzaSettings::add_slider(const std::string& label, float min, float max, bool linear)
 {
-    m_settings[label] = value;
+    float* value = const_cast<float*>(static_cast<const float*>(GetPointer(label, typeid(float))));
     if (linear) {
-        m_items.push_back([this, label, min, max]() mutable {
-            float value = Get<float>(label);
-            auto res = ImGui::SliderFloat(label.c_str(), &value, min, max);
-            m_settings[label] = value;
-            return res;
-        });
+        m_items.push_back([value, label, min, max]() { return ImGui::SliderFloat(label.c_str(), value, min, max); });
     } else {
-        m_items.push_back([this, label, min, max]() mutable {
-            float value = Get<float>(label);
-            auto res = ImGui::SliderFloat(label.c_str(), &value, min, max, "%.3f", 2);
-            m_settings[label] = value;
-            return res;
-        });
+        m_items.push_back(
+            [value, label, min, max]() { return ImGui::SliderFloat(label.c_str(), value, min, max, "%.3f", 2); });
     }
 }
 
 SponzaSettings::SponzaSettings()
 {
-    std::vector<std::string> sample_count_str = { "Off" };
-    std::vector<uint32_t> sample_count = { 1 };
-    for (uint32_t i = 2; i <= 8; i *= 2) {
-        sample_count_str.push_back("x" + std::to_string(i));
-        sample_count.push_back(i);
-    }
-
-    add_combo("sample_count", sample_count_str, sample_count, sample_count.front());
-    add_checkbox("gamma_correction", true);
-    add_checkbox("use_reinhard_tone_operator", false);
-    add_checkbox("use_tone_mapping", true);
-    add_checkbox("use_white_balance", true);
-    add_checkbox("use_filmic_hdr", false);
-    add_checkbox("use_avg_lum", false);
-    add_checkbox("use_ao", false);
-    add_checkbox("use_ssao", true);
-    add_checkbox("use_rtao", false);
-    add_checkbox("use_ao_blur", true);
-    add_slider_int("rtao_num_rays", 6, 1, 128);
-    add_slider("ao_radius", 0.05, 0.01, 5, false);
-    add_checkbox("use_alpha_test", true);
-    add_checkbox("use_shadow", true);
-    add_checkbox("use_white_ligth", true);
-    add_checkbox("use_IBL_diffuse", true);
-    add_checkbox("use_IBL_specular", true);
-    add_checkbox("skip_sponza_model", false);
-    add_checkbox("only_ambient", false);
-    add_checkbox("light_in_camera", false);
-    add_checkbox("additional_lights", false);
-    add_checkbox("show_only_ao", false);
-    add_checkbox("show_only_position", false);
-    add_checkbox("show_only_albedo", false);
-    add_checkbox("show_only_normal", false);
-    add_checkbox("show_only_roughness", false);
-    add_checkbox("show_only_metalness", false);
-    add_checkbox("use_f0_with_roughness", false);
-    add_checkbox("use_flip_normal_y", false);
-    add_checkbox("use_spec_ao_by_ndotv_roughness", true);
-    add_checkbox("irradiance_conversion_every_frame", false);
-    add_slider("ambient_power", 1.0, 0.01, 10, true);
-    add_slider("light_power", acos(-1.0), 0.01, 10, true);
-    add_slider("exposure", 1, 0, 5, false);
-    add_slider("white", 1, 0, 5, false);
-    add_checkbox("normal_mapping", true).BindKey(GLFW_KEY_N);
-    add_checkbox("shadow_discard", true).BindKey(GLFW_KEY_J);
-    add_checkbox("dynamic_sun_position", false).BindKey(GLFW_KEY_SPACE);
-    add_slider("s_near", 0.1, 0.01, 10, true);
-    add_slider("s_far", 1024.0, 128, 4096, true);
-    add_slider("s_size", 2048, 128, 8192, true);
+    std::vector<std::string> sample_count_str;
+    for (uint32_t sample_count : GetSampleCounts()) {
+        sample_count_str.push_back(sample_count == 1 ? "Off" : "x" + std::to_string(sample_count));
+    }
+
+    add_combo("sample_count", sample_count_str, GetSampleCounts());
+    add_checkbox("use_async_program_builds");
+    add_checkbox("gamma_correction");
+    add_checkbox("use_reinhard_tone_operator");
+    add_checkbox("use_tone_mapping");
+    add_checkbox("use_white_balance");
+    add_checkbox("use_filmic_hdr");
+    add_checkbox("use_avg_lum");
+    add_checkbox("use_ao");
+    add_checkbox("use_ssao");
+    add_checkbox("use_rtao");
+    add_checkbox("use_ao_blur");
+    add_slider_int("rtao_num_rays", 1, 128);
+    add_slider("ao_radius", 0.01, 5, false);
+    add_checkbox("use_alpha_test");
+    add_checkbox("use_shadow");
+    add_checkbox("use_white_ligth");
+    add_checkbox("use_IBL_diffuse");
+    add_checkbox("use_IBL_specular");
+    add_checkbox("skip_sponza_model");
+    add_checkbox("only_ambient");
+    add_checkbox("light_in_camera");
+    add_checkbox("additional_lights");
+    add_checkbox("show_only_ao");
+    add_checkbox("show_only_position");
+    add_checkbox("show_only_albedo");
+    add_checkbox("show_only_normal");
+    add_checkbox("show_only_roughness");
+    add_checkbox("show_only_metalness");
+    add_checkbox("use_f0_with_roughness");
+    add_checkbox("use_flip_normal_y");
+    add_checkbox("use_spec_ao_by_ndotv_roughness");
+    add_checkbox("irradiance_conversion_every_frame");
+    add_checkbox("use_parallel_recording");
+    add_checkbox("use_gpu_profiler");
+    add_checkbox("use_indirect_draw");
+    add_checkbox("use_frustum_culling");
+    add_checkbox("use_occlusion_culling");
+    add_checkbox("use_depth_prepass");
+    add_checkbox("use_lod");
+    add_slider("lod_bias", -2, 4, true);
+    add_checkbox("use_packed_vertices");
+    add_checkbox("use_meshlet_culling");
+    add_checkbox("use_texture_streaming");
+    add_slider_int("texture_budget_mb", 64, 4096);
+    add_slider("texture_mip_bias", -2, 4, true);
+    add_slider("ambient_power", 0.01, 10, true);
+    add_slider("light_power", 0.01, 10, true);
+    add_slider("exposure", 0, 5, false);
+    add_slider("white", 0, 5, false);
+    add_checkbox("normal_mapping").BindKey(GLFW_KEY_N);
+    add_checkbox("shadow_discard").BindKey(GLFW_KEY_J);
+    add_checkbox("dynamic_sun_position").BindKey(GLFW_KEY_SPACE);
+    add_slider("s_near", 0.01, 10, true);
+    add_slider("s_far", 128, 4096, true);
+    add_slider("s_size", 128, 8192, true);
+}
+
+SponzaSettings::SponzaSettings(const SponzaSettings& other)
+    : SponzaSettings()
+{
+    *this = other;
+}
+
+SponzaSettings& SponzaSettings::operator=(const SponzaSettings& other)
+{
+    m_values = other.m_values;
+    m_committed = other.m_committed;
+    m_gpu_name = other.m_gpu_name;
+    return *this;
+}
+
+SponzaSettingsMask SponzaSettings::TakeChanges()
+{
+    SponzaSettingsMask changes;
+    const uint8_t* values = reinterpret_cast<const uint8_t*>(&m_values);
+    const uint8_t* committed = reinterpret_cast<const uint8_t*>(&m_committed);
+    for (const auto& info : GetSponzaSettingInfos()) {
+        if (std::memcmp(values + info.offset, committed + info.offset, info.size) != 0) {
+            changes.Set(info.id);
+        }
+    }
+    m_committed = m_values;
+    return changes;
 }
 
 bool SponzaSettings::OnDraw()
@@ -1,13 +1,151 @@
 #pragma once
 #include <GLFW/glfw3.h>
 
-#include <any>
+#include <bitset>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
-#include <map>
+#include <initializer_list>
+#include <stdexcept>
 #include <string>
+#include <typeindex>
+#include <utility>
 #include <vector>
 
+// Every setting with its type and default value. Names are used by the UI and for serialization, code reads the
+// field of the same name from SponzaSettingsValues.
+#define SPONZA_SETTINGS(X)                                  \
+    X(uint32_t, sample_count, 1)                            \
+    X(bool, use_async_program_builds, true)                 \
+    X(bool, gamma_correction, true)                         \
+    X(bool, use_reinhard_tone_operator, false)              \
+    X(bool, use_tone_mapping, true)                         \
+    X(bool, use_white_balance, true)                        \
+    X(bool, use_filmic_hdr, false)                          \
+    X(bool, use_avg_lum, false)                             \
+    X(bool, use_ao, false)                                  \
+    X(bool, use_ssao, true)                                 \
+    X(bool, use_rtao, false)                                \
+    X(bool, use_ao_blur, true)                              \
+    X(int32_t, rtao_num_rays, 6)                            \
+    X(float, ao_radius, 0.05f)                              \
+    X(bool, use_alpha_test, true)                           \
+    X(bool, use_shadow, true)                               \
+    X(bool, use_white_ligth, true)                          \
+    X(bool, use_IBL_diffuse, true)                          \
+    X(bool, use_IBL_specular, true)                         \
+    X(bool, skip_sponza_model, false)                       \
+    X(bool, only_ambient, false)                            \
+    X(bool, light_in_camera, false)                         \
+    X(bool, additional_lights, false)                       \
+    X(bool, show_only_ao, false)                            \
+    X(bool, show_only_position, false)                      \
+    X(bool, show_only_albedo, false)                        \
+    X(bool, show_only_normal, false)                        \
+    X(bool, show_only_roughness, false)                     \
+    X(bool, show_only_metalness, false)                     \
+    X(bool, use_f0_with_roughness, false)                   \
+    X(bool, use_flip_normal_y, false)                       \
+    X(bool, use_spec_ao_by_ndotv_roughness, true)           \
+    X(bool, irradiance_conversion_every_frame, false)       \
+    X(bool, use_parallel_recording, false)                  \
+    X(bool, use_gpu_profiler, false)                        \
+    X(bool, use_indirect_draw, false)                       \
+    X(bool, use_frustum_culling, true)                      \
+    X(bool, use_occlusion_culling, false)                   \
+    X(bool, use_depth_prepass, false)                       \
+    X(bool, use_lod, false)                                 \
+    X(float, lod_bias, 0.0f)                                \
+    X(bool, use_packed_vertices, false)                     \
+    X(bool, use_meshlet_culling, false)                     \
+    X(bool, use_texture_streaming, false)                   \
+    X(int32_t, texture_budget_mb, 1024)                     \
+    X(float, texture_mip_bias, 0.0f)                        \
+    X(float, ambient_power, 1.0f)                           \
+    X(float, light_power, 3.14159265f)                      \
+    X(float, exposure, 1.0f)                                \
+    X(float, white, 1.0f)                                   \
+    X(bool, normal_mapping, true)                           \
+    X(bool, shadow_discard, true)                           \
+    X(bool, dynamic_sun_position, false)                    \
+    X(float, s_near, 0.1f)                                  \
+    X(float, s_far, 1024.0f)                                \
+    X(float, s_size, 2048.0f)
+
+// Plain snapshot of all settings, passes keep a copy and read the fields directly.
+struct SponzaSettingsValues {
+#define SPONZA_SETTINGS_FIELD(type, name, value) type name = value;
+    SPONZA_SETTINGS(SPONZA_SETTINGS_FIELD)
+#undef SPONZA_SETTINGS_FIELD
+};
+
+enum class SponzaSetting {
+#define SPONZA_SETTINGS_ENUM(type, name, value) name,
+    SPONZA_SETTINGS(SPONZA_SETTINGS_ENUM)
+#undef SPONZA_SETTINGS_ENUM
+        kCount
+};
+
+class SponzaSettingsMask {
+public:
+    SponzaSettingsMask() = default;
+
+    SponzaSettingsMask(std::initializer_list<SponzaSetting> settings)
+    {
+        for (SponzaSetting setting : settings) {
+            Set(setting);
+        }
+    }
+
+    void Set(SponzaSetting setting)
+    {
+        m_bits.set(static_cast<size_t>(setting));
+    }
+
+    bool Test(SponzaSetting setting) const
+    {
+        return m_bits.test(static_cast<size_t>(setting));
+    }
+
+    bool Any() const
+    {
+        return m_bits.any();
+    }
+
+    SponzaSettingsMask operator&(const SponzaSettingsMask& other) const
+    {
+        SponzaSettingsMask res;
+        res.m_bits = m_bits & other.m_bits;
+        return res;
+    }
+
+    SponzaSettingsMask operator|(const SponzaSettingsMask& other) const
+    {
+        SponzaSettingsMask res;
+        res.m_bits = m_bits | other.m_bits;
+        return res;
+    }
+
+private:
+    std::bitset<static_cast<size_t>(SponzaSetting::kCount)> m_bits;
+};
+
+struct SponzaSettingInfo {
+    SponzaSetting id;
+    const char* name;
+    size_t offset;
+    size_t size;
+    std::type_index type;
+};
+
+const std::vector<SponzaSettingInfo>& GetSponzaSettingInfos();
+// Returns nullptr for unknown names.
+const SponzaSettingInfo* FindSponzaSetting(const std::string& name);
+// Values offered for sample_count, the programs with a SAMPLE_COUNT define are built for each of them.
+const std::vector<uint32_t>& GetSampleCounts();
+// Strips spaces, tabs and carriage returns from both ends, used by the preset and sweep parsers.
+std::string TrimSettingText(const std::string& str);
+
 class HotKey {
 public:
     HotKey(std::function<void()> on_key);
@@ -22,40 +160,77 @@ private:
 class SponzaSettings {
 public:
     SponzaSettings();
+    // The UI items are bound to the object that created them, so copies only take over the values.
+    SponzaSettings(const SponzaSettings& other);
+    SponzaSettings& operator=(const SponzaSettings& other);
 
     bool OnDraw();
     bool OnKey(int key, int action);
+    // Returns the settings whose values differ from the previous call, the first call compares with the defaults.
+    SponzaSettingsMask TakeChanges();
+
+    const SponzaSettingsValues& GetValues() const
+    {
+        return m_values;
+    }
+
+    SponzaSettingsValues& GetValues()
+    {
+        return m_values;
+    }
 
     bool Has(const std::string& key) const
     {
-        return m_settings.count(key);
+        return FindSponzaSetting(key) != nullptr;
     }
 
+    // Name based access for the UI and serialization, code that knows the setting uses GetValues().
     template <typename T>
     T Get(const std::string& key) const
     {
-        return std::any_cast<T>(m_settings.at(key));
+        return *static_cast<const T*>(GetPointer(key, typeid(T)));
     }
 
     template <typename T>
     void Set(const std::string& key, const T& value)
     {
-        m_settings[key] = value;
+        *static_cast<T*>(const_cast<void*>(GetPointer(key, typeid(T)))) = value;
+    }
+
+    // Text conversion used by presets, sweeps and --set, bools accept 0/1/true/false. Either every value is
+    // applied or, if one of them is malformed or names an unknown setting, none.
+    bool SetFromString(const std::string& key, const std::string& value);
+    bool SetFromStrings(const std::vector<std::pair<std::string, std::string>>& entries);
+    std::string GetAsString(const std::string& key) const;
+    // Presets are "name = value" lines, '#' starts a comment. Settings missing from the file keep their values,
+    // nothing is applied if a line is malformed.
+    bool LoadPreset(const std::string& path);
+    bool SavePreset(const std::string& path) const;
+
+    const std::string& GetGpuName() const
+    {
+        return m_gpu_name;
+    }
+
+    void SetGpuName(const std::string& gpu_name)
+    {
+        m_gpu_name = gpu_name;
     }
 
 private:
+    const void* GetPointer(const std::string& key, std::type_index type) const;
+
     template <typename T>
-    void add_combo(const std::string& label,
-                   const std::vector<std::string>& items,
-                   const std::vector<T>& items_data,
-                   T value);
-    HotKey& add_checkbox(const std::string& label, bool value);
-    void add_slider_int(const std::string& label, int32_t value, int min, int max);
-    void add_slider(const std::string& label, float value, float min, float max, bool linear);
+    void add_combo(const std::string& label, const std::vector<std::string>& items, const std::vector<T>& items_data);
+    HotKey& add_checkbox(const std::string& label);
+    void add_slider_int(const std::string& label, int min, int max);
+    void add_slider(const std::string& label, float min, float max, bool linear);
 
     std::vector<std::function<bool(void)>> m_items;
     std::vector<HotKey> m_hotkeys;
-    std::map<std::string, std::any> m_settings;
+    SponzaSettingsValues m_values;
+    SponzaSettingsValues m_committed;
+    std::string m_gpu_name;
 };
 
 class IModifySponzaSettings {
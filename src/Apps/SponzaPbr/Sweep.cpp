@@ -0,0 +1,111 @@
+#include "Sweep.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+bool SettingsSweep::Load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    m_axes.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        line = TrimSettingText(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) {
+            std::cerr << "Malformed sweep line: " << line << std::endl;
+            return false;
+        }
+        SweepAxis axis = { TrimSettingText(line.substr(0, pos)) };
+        if (!FindSponzaSetting(axis.name)) {
+            std::cerr << "Unknown setting in sweep: " << axis.name << std::endl;
+            return false;
+        }
+        std::istringstream values(line.substr(pos + 1));
+        std::string value;
+        while (std::getline(values, value, ',')) {
+            value = TrimSettingText(value);
+            if (!value.empty()) {
+                axis.values.push_back(value);
+            }
+        }
+        if (axis.values.empty()) {
+            std::cerr << "Sweep axis without values: " << axis.name << std::endl;
+            return false;
+        }
+        m_axes.push_back(axis);
+    }
+    return !m_axes.empty();
+}
+
+size_t SettingsSweep::GetCellCount() const
+{
+    if (m_axes.empty()) {
+        return 0;
+    }
+    size_t count = 1;
+    for (const auto& axis : m_axes) {
+        count *= axis.values.size();
+    }
+    return count;
+}
+
+std::vector<std::string> SettingsSweep::GetCellValues(size_t cell) const
+{
+    std::vector<std::string> values(m_axes.size());
+    for (size_t i = m_axes.size(); i-- > 0;) {
+        const auto& axis = m_axes[i];
+        values[i] = axis.values[cell % axis.values.size()];
+        cell /= axis.values.size();
+    }
+    return values;
+}
+
+bool SettingsSweep::Apply(size_t cell, SponzaSettings& settings) const
+{
+    std::vector<std::string> values = GetCellValues(cell);
+    std::vector<std::pair<std::string, std::string>> entries;
+    for (size_t i = 0; i < m_axes.size(); ++i) {
+        entries.emplace_back(m_axes[i].name, values[i]);
+    }
+    return settings.SetFromStrings(entries);
+}
+
+const std::vector<SweepAxis>& SettingsSweep::GetAxes() const
+{
+    return m_axes;
+}
+
+void SettingsSweep::AddResult(size_t cell, const BenchmarkReport& report)
+{
+    m_results.push_back({ cell, report.GetCpuSummary(), report.GetGpuSummary() });
+}
+
+bool SettingsSweep::Save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::fixed << std::setprecision(4);
+
+    for (const auto& axis : m_axes) {
+        file << axis.name << ",";
+    }
+    file << "cpu_avg_ms,cpu_p95_ms,cpu_max_ms,gpu_avg_ms,gpu_p95_ms,gpu_max_ms" << std::endl;
+    for (const auto& result : m_results) {
+        for (const auto& value : GetCellValues(result.cell)) {
+            file << value << ",";
+        }
+        file << result.cpu_ms.avg << "," << result.cpu_ms.p95 << "," << result.cpu_ms.max << ",";
+        file << result.gpu_ms.avg << "," << result.gpu_ms.p95 << "," << result.gpu_ms.max << std::endl;
+    }
+    return file.good();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Benchmark.h"
+#include "SponzaSettings.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct SweepAxis {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+// Text file with one "name = value, value, ..." axis per line, '#' starts a comment.
+// Cells are the cartesian product of all axes, the last axis changes fastest.
+class SettingsSweep {
+public:
+    bool Load(const std::string& path);
+    size_t GetCellCount() const;
+    std::vector<std::string> GetCellValues(size_t cell) const;
+    // Sets the values of the cell, settings are left unchanged if one of them is invalid.
+    bool Apply(size_t cell, SponzaSettings& settings) const;
+    const std::vector<SweepAxis>& GetAxes() const;
+
+    void AddResult(size_t cell, const BenchmarkReport& report);
+    // One csv row per cell: the axis values followed by the cpu and gpu frame time summaries.
+    bool Save(const std::string& path) const;
+
+private:
+    struct Result {
+        size_t cell;
+        TimingSummary cpu_ms;
+        TimingSummary gpu_ms;
+    };
+
+    std::vector<SweepAxis> m_axes;
+    std::vector<Result> m_results;
+};
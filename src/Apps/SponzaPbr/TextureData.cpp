@@ -0,0 +1,60 @@
+#include "TextureData.h"
+
+#include "Utilities/FormatHelper.h"
+
+#include <gli/gli.hpp>
+
+#include <algorithm>
+
+uint32_t GetTextureLevelSize(uint32_t size, uint32_t level)
+{
+    return std::max(size >> level, 1u);
+}
+
+bool IsPackedNormalFormat(gli::format format)
+{
+    return format == gli::format::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+}
+
+bool LoadTextureData(const std::string& path, TextureData& data, uint32_t first_level, uint32_t count)
+{
+    gli::texture texture = gli::load(path);
+    if (texture.empty() || texture.target() != gli::TARGET_2D || texture.layers() != 1 || texture.faces() != 1) {
+        return false;
+    }
+    uint32_t level_count = static_cast<uint32_t>(texture.levels());
+    if (first_level >= level_count) {
+        return false;
+    }
+
+    TextureData result;
+    result.format = texture.format();
+    result.width = static_cast<uint32_t>(texture.extent(0).x);
+    result.height = static_cast<uint32_t>(texture.extent(0).y);
+    result.level_count = level_count;
+    result.first_level = first_level;
+    for (uint32_t level = first_level; level < level_count && level - first_level < count; ++level) {
+        const uint8_t* level_data = static_cast<const uint8_t*>(texture.data(0, 0, level));
+        result.levels.emplace_back(level_data, level_data + texture.size(level));
+    }
+    data = std::move(result);
+    return true;
+}
+
+std::shared_ptr<Resource> CreateTextureFromData(RenderDevice& device,
+                                                RenderCommandList& command_list,
+                                                const TextureData& data)
+{
+    std::shared_ptr<Resource> resource = device.CreateTexture(
+        BindFlag::kShaderResource | BindFlag::kCopyDest, data.format, 1,
+        GetTextureLevelSize(data.width, data.first_level), GetTextureLevelSize(data.height, data.first_level), 1,
+        static_cast<uint32_t>(data.levels.size()));
+    for (uint32_t i = 0; i < data.levels.size(); ++i) {
+        size_t num_bytes = 0;
+        size_t row_bytes = 0;
+        GetFormatInfo(GetTextureLevelSize(data.width, data.first_level + i),
+                      GetTextureLevelSize(data.height, data.first_level + i), data.format, num_bytes, row_bytes);
+        command_list.UpdateSubresource(resource, i, data.levels[i].data(), row_bytes, num_bytes);
+    }
+    return resource;
+}
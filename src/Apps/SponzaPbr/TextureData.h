@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Device/Device.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Levels of a 2D texture file decoded on the CPU, so that reading and decoding need no device.
+struct TextureData {
+    gli::format format = gli::format::FORMAT_UNDEFINED;
+    // Size of level 0 of the file.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Levels of the whole chain in the file.
+    uint32_t level_count = 0;
+    // levels[i] is level first_level + i of the file, tightly packed.
+    uint32_t first_level = 0;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+uint32_t GetTextureLevelSize(uint32_t size, uint32_t level);
+
+// True for BC5, which the texture cache stores normal maps in. Only xy are stored, the shaders reconstruct z.
+bool IsPackedNormalFormat(gli::format format);
+
+// Reads up to count levels of a DDS or KTX file starting at first_level, the rest of the chain with the default
+// count. False for other formats and for arrays, cubemaps and volumes, which CreateTexture of the texture module
+// has to load.
+bool LoadTextureData(const std::string& path, TextureData& data, uint32_t first_level = 0, uint32_t count = ~0u);
+
+// Creates a texture whose top level is data.levels[0] and records the upload of every level on command_list.
+std::shared_ptr<Resource> CreateTextureFromData(RenderDevice& device,
+                                                RenderCommandList& command_list,
+                                                const TextureData& data);
@@ -0,0 +1,358 @@
+#include "TextureStreaming.h"
+
+#include "Utilities/FormatHelper.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+namespace {
+
+// Textures start with the levels of at most this size resident.
+constexpr uint32_t kBaseResidentSize = 128;
+// Upload volume of one update, the remaining reads are uploaded by the next updates.
+constexpr uint64_t kMaxUploadBytes = 32ull << 20;
+// Reads for more detail in flight at once, evictions are never held back.
+constexpr size_t kMaxPendingReads = 16;
+
+bool IsReady(const std::future<TextureData>& load)
+{
+    return load.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+} // namespace
+
+float ComputeUvDensity(const IMesh& mesh)
+{
+    if (mesh.texcoords.size() != mesh.positions.size()) {
+        return 0;
+    }
+    // Twice the areas of the triangles, the factor cancels out.
+    double area = 0;
+    double uv_area = 0;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        uint32_t ids[3] = { mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] };
+        if (std::max({ ids[0], ids[1], ids[2] }) >= mesh.positions.size()) {
+            continue;
+        }
+        area += glm::length(glm::cross(mesh.positions[ids[1]] - mesh.positions[ids[0]],
+                                       mesh.positions[ids[2]] - mesh.positions[ids[0]]));
+        glm::vec2 e1 = mesh.texcoords[ids[1]] - mesh.texcoords[ids[0]];
+        glm::vec2 e2 = mesh.texcoords[ids[2]] - mesh.texcoords[ids[0]];
+        uv_area += std::abs(e1.x * e2.y - e1.y * e2.x);
+    }
+    if (area == 0) {
+        return 0;
+    }
+    return static_cast<float>(std::sqrt(uv_area / area));
+}
+
+TextureStreamer::TextureStreamer(RenderDevice& device,
+                                 ThreadPool& thread_pool,
+                                 SceneModels& scene_list,
+                                 const std::vector<ModelLoadInfo>& infos,
+                                 const ModelRangeBounds& bounds)
+    : m_device(device)
+    , m_thread_pool(thread_pool)
+    , m_scene_list(scene_list)
+    , m_bounds(bounds)
+{
+    std::map<Resource*, size_t> texture_ids;
+    m_uv_densities.resize(m_scene_list.size());
+    for (size_t model_id = 0; model_id < m_scene_list.size() && model_id < infos.size(); ++model_id) {
+        auto& model = m_scene_list[model_id];
+        m_uv_densities[model_id] = infos[model_id].uv_densities;
+        for (const auto& texture_file : infos[model_id].texture_files) {
+            std::string extension = texture_file.file.substr(texture_file.file.find_last_of('.') + 1);
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (extension != "dds" && extension != "ktx") {
+                continue;
+            }
+            for (const auto& [mesh_id, type] : texture_file.slots) {
+                auto* slot = GetMaterialSlot(model.GetMaterial(mesh_id), type, texture_file.path);
+                if (!slot || type == aiTextureType_OPACITY) {
+                    continue;
+                }
+                const std::shared_ptr<Resource>& resource = *slot;
+                if (!resource || resource->GetLevelCount() < 2 || resource->GetLayerCount() != 1) {
+                    continue;
+                }
+                auto it = texture_ids.find(resource.get());
+                if (it == texture_ids.end()) {
+                    it = texture_ids.emplace(resource.get(), m_textures.size()).first;
+                    auto& texture = m_textures.emplace_back();
+                    texture.file = texture_file.file;
+                    texture.format = resource->GetFormat();
+                    texture.width = static_cast<uint32_t>(resource->GetWidth());
+                    texture.height = resource->GetHeight();
+                    for (uint32_t level = 0; level < resource->GetLevelCount(); ++level) {
+                        size_t num_bytes = 0;
+                        size_t row_bytes = 0;
+                        GetFormatInfo(GetTextureLevelSize(texture.width, level),
+                                      GetTextureLevelSize(texture.height, level), texture.format, num_bytes,
+                                      row_bytes);
+                        texture.level_bytes.push_back(num_bytes);
+                    }
+                    // Block compressed textures need at least one block in either direction on the top level.
+                    texture.base_level = 0;
+                    while (std::max(GetTextureLevelSize(texture.width, texture.base_level),
+                                    GetTextureLevelSize(texture.height, texture.base_level)) > kBaseResidentSize &&
+                           std::min(GetTextureLevelSize(texture.width, texture.base_level + 1),
+                                    GetTextureLevelSize(texture.height, texture.base_level + 1)) >= 4) {
+                        ++texture.base_level;
+                    }
+                    texture.resident_level = 0;
+                    texture.wanted_level = texture.base_level;
+                }
+                auto& texture = m_textures[it->second];
+                if (std::find(texture.slots.begin(), texture.slots.end(), slot) == texture.slots.end()) {
+                    texture.slots.push_back(slot);
+                }
+                for (size_t range_id = 0; range_id < model.ia.ranges.size(); ++range_id) {
+                    if (model.ia.ranges[range_id].id == mesh_id &&
+                        std::find(texture.ranges.begin(), texture.ranges.end(), std::make_pair(model_id, range_id)) ==
+                            texture.ranges.end()) {
+                        texture.ranges.emplace_back(model_id, range_id);
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t full_bytes = 0;
+    for (auto& texture : m_textures) {
+        full_bytes += GetChainBytes(texture, 0);
+        m_resident_bytes += GetChainBytes(texture, 0);
+        m_target_bytes += GetChainBytes(texture, 0);
+        if (texture.base_level) {
+            RequestLevel(texture, texture.base_level);
+        }
+    }
+    for (uint32_t i = 0; i < kFrameCount; ++i) {
+        m_command_lists.emplace_back(m_device.CreateRenderCommandList());
+    }
+
+    std::cout << "Texture streaming: " << m_textures.size() << " textures, " << std::fixed << std::setprecision(1)
+              << m_target_bytes / 1048576.0 << " of " << full_bytes / 1048576.0 << " MB resident once the base levels"
+              << " are read" << std::endl;
+}
+
+void TextureStreamer::Update(const SceneInstances& instances,
+                             const Camera& camera,
+                             int viewport_height,
+                             uint64_t budget_bytes,
+                             float mip_bias)
+{
+    ++m_update;
+    while (!m_retired.empty() && m_retired.front().first + kFrameCount < m_update) {
+        m_retired.pop_front();
+    }
+
+    RenderCommandList* command_list = nullptr;
+    auto get_command_list = [&]() -> RenderCommandList& {
+        if (!command_list) {
+            command_list = m_command_lists[m_update % m_command_lists.size()].get();
+            m_device.Wait(command_list->GetFenceValue());
+            command_list->Reset();
+        }
+        return *command_list;
+    };
+
+    // Finished reads, the ones over the upload volume of this update are uploaded by the next ones.
+    uint64_t upload_bytes = 0;
+    size_t pending_reads = 0;
+    for (auto& texture : m_textures) {
+        if (!texture.load.valid()) {
+            continue;
+        }
+        if (IsReady(texture.load) &&
+            (!upload_bytes || upload_bytes + GetChainBytes(texture, texture.loading_level) <= kMaxUploadBytes)) {
+            upload_bytes += Upload(get_command_list(), texture);
+        } else if (texture.loading_level < texture.resident_level) {
+            ++pending_reads;
+        }
+    }
+
+    ComputeWantedLevels(instances, camera, viewport_height, mip_bias);
+    std::vector<StreamedTexture*> requests;
+    for (auto& texture : m_textures) {
+        if (texture.wanted_level <= GetTargetLevel(texture)) {
+            texture.last_used = m_update;
+        }
+        if (texture.wanted_level < GetTargetLevel(texture) && !texture.load.valid() && !texture.file.empty()) {
+            requests.push_back(&texture);
+        }
+    }
+    // Textures furthest from the level they need first.
+    std::stable_sort(requests.begin(), requests.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+        return a->resident_level - a->wanted_level > b->resident_level - b->wanted_level;
+    });
+
+    // Drops one level of the least recently used texture which has more than it needs.
+    auto evict = [&] {
+        StreamedTexture* victim = nullptr;
+        for (auto& texture : m_textures) {
+            if (!texture.load.valid() && !texture.file.empty() && texture.resident_level < texture.wanted_level &&
+                (!victim || texture.last_used < victim->last_used)) {
+                victim = &texture;
+            }
+        }
+        if (victim) {
+            RequestLevel(*victim, victim->resident_level + 1);
+        }
+        return victim != nullptr;
+    };
+
+    while (m_target_bytes > budget_bytes && evict()) {
+    }
+    for (StreamedTexture* texture : requests) {
+        if (pending_reads >= kMaxPendingReads) {
+            break;
+        }
+        uint32_t level = texture->resident_level - 1;
+        uint64_t added_bytes = texture->level_bytes[level];
+        while (m_target_bytes + added_bytes > budget_bytes && evict()) {
+        }
+        if (m_target_bytes + added_bytes > budget_bytes) {
+            break;
+        }
+        RequestLevel(*texture, level);
+        ++pending_reads;
+    }
+
+    if (command_list) {
+        command_list->Close();
+        m_device.ExecuteCommandLists({ m_command_lists[m_update % m_command_lists.size()] });
+    }
+}
+
+void TextureStreamer::MakeResident()
+{
+    for (auto& texture : m_textures) {
+        // Reads of coarser chains are of no use anymore.
+        if (texture.load.valid() && texture.loading_level != 0) {
+            texture.load.wait();
+            m_target_bytes = m_target_bytes - GetChainBytes(texture, texture.loading_level) +
+                             GetChainBytes(texture, texture.resident_level);
+            texture.load = {};
+        }
+        if (texture.resident_level && !texture.load.valid() && !texture.file.empty()) {
+            RequestLevel(texture, 0);
+        }
+    }
+    std::shared_ptr<RenderCommandList> command_list = m_device.CreateRenderCommandList();
+    for (auto& texture : m_textures) {
+        if (texture.load.valid()) {
+            texture.load.wait();
+            Upload(*command_list, texture);
+        }
+    }
+    command_list->Close();
+    m_device.ExecuteCommandLists({ command_list });
+    m_device.WaitForIdle();
+    m_retired.clear();
+}
+
+void TextureStreamer::ComputeWantedLevels(const SceneInstances& instances,
+                                          const Camera& camera,
+                                          int viewport_height,
+                                          float mip_bias)
+{
+    glm::vec3 eye = camera.GetCameraPos();
+    // Pixels covered by one world unit at distance 1.
+    float pixel_scale = viewport_height * camera.GetProjectionMatrix()[1][1] * 0.5f;
+    for (auto& texture : m_textures) {
+        uint32_t wanted = static_cast<uint32_t>(texture.level_bytes.size() - 1);
+        float texture_size = static_cast<float>(std::max(texture.width, texture.height));
+        for (const auto& [model_id, range_id] : texture.ranges) {
+            auto& model = m_scene_list[model_id];
+            uint32_t mesh_id = model.ia.ranges[range_id].id;
+            float density = mesh_id < m_uv_densities[model_id].size() ? m_uv_densities[model_id][mesh_id] : 0;
+            // Without bounds or texcoords the ranges need every level.
+            if (density == 0 || model_id >= m_bounds.size() || m_bounds[model_id].size() != model.ia.ranges.size() ||
+                model.bones.HasAnimation() || model_id >= instances.size()) {
+                wanted = 0;
+                break;
+            }
+            for (const auto& transform : instances[model_id].transforms) {
+                glm::mat4 world = transform * model.matrix;
+                AABB box = TransformAABB(m_bounds[model_id][range_id], world);
+                float distance = glm::length(glm::max(glm::max(box.min - eye, eye - box.max), glm::vec3(0.0f)));
+                float scale = std::cbrt(std::abs(glm::determinant(glm::mat3(world))));
+                if (distance == 0 || scale == 0) {
+                    wanted = 0;
+                    break;
+                }
+                float texels = density / scale * texture_size;
+                float pixels = pixel_scale / distance;
+                float level = std::floor(std::log2(texels / pixels) + mip_bias);
+                wanted = std::min(wanted, static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(wanted))));
+            }
+            if (wanted == 0) {
+                break;
+            }
+        }
+        texture.wanted_level = std::min(wanted, texture.base_level);
+    }
+}
+
+uint64_t TextureStreamer::GetChainBytes(const StreamedTexture& texture, uint32_t level) const
+{
+    uint64_t size = 0;
+    for (size_t i = level; i < texture.level_bytes.size(); ++i) {
+        size += texture.level_bytes[i];
+    }
+    return size;
+}
+
+uint32_t TextureStreamer::GetTargetLevel(const StreamedTexture& texture) const
+{
+    return texture.load.valid() ? texture.loading_level : texture.resident_level;
+}
+
+void TextureStreamer::RequestLevel(StreamedTexture& texture, uint32_t level)
+{
+    m_target_bytes = m_target_bytes - GetChainBytes(texture, GetTargetLevel(texture)) + GetChainBytes(texture, level);
+    texture.loading_level = level;
+    texture.load = m_thread_pool.Push([file = texture.file, level] {
+        TextureData data;
+        if (!LoadTextureData(file, data, level)) {
+            return TextureData();
+        }
+        return data;
+    });
+}
+
+uint64_t TextureStreamer::Upload(RenderCommandList& command_list, StreamedTexture& texture)
+{
+    TextureData data = texture.load.get();
+    uint32_t level = texture.loading_level;
+    bool matches = data.format == texture.format && data.width == texture.width && data.height == texture.height &&
+                   data.level_count == texture.level_bytes.size() && data.first_level == level;
+    for (size_t i = 0; i < data.levels.size() && matches; ++i) {
+        matches = data.levels[i].size() == texture.level_bytes[level + i];
+    }
+    if (!matches || data.levels.empty()) {
+        std::cerr << "Texture streaming: " << texture.file << " changed or can't be read, it stays at level "
+                  << texture.resident_level << std::endl;
+        m_target_bytes = m_target_bytes - GetChainBytes(texture, level) +
+                         GetChainBytes(texture, texture.resident_level);
+        // No file marks the texture as no longer streamed.
+        texture.file.clear();
+        return 0;
+    }
+
+    std::shared_ptr<Resource> resource = CreateTextureFromData(m_device, command_list, data);
+    m_retired.emplace_back(m_update, *texture.slots.front());
+    for (auto* slot : texture.slots) {
+        *slot = resource;
+    }
+    m_resident_bytes =
+        m_resident_bytes - GetChainBytes(texture, texture.resident_level) + GetChainBytes(texture, level);
+    texture.resident_level = level;
+    return GetChainBytes(texture, level);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "AssetLoader.h"
+#include "Camera/Camera.h"
+#include "Device/Device.h"
+#include "Geometry/Geometry.h"
+#include "SceneBounds.h"
+#include "SceneInstances.h"
+#include "TextureData.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Texel footprint of the triangles of mesh in uv units per model space unit, 0 when it is unknown.
+float ComputeUvDensity(const IMesh& mesh);
+
+// Mip residency of the material textures. Every texture is recreated from the file the asset loader read it from,
+// starting at the levels of at most kBaseResidentSize. Every update estimates the level each texture needs from the
+// screen size of the ranges that sample it, and adds or drops one level per texture within a memory budget. A level
+// change reads the chain from that level on on the thread pool, the texture is recreated once the read is done, so
+// the render thread neither reads files nor waits for them. Textures which are more detailed than needed are
+// evicted least recently used first, only when a texture that needs more detail does not fit.
+//
+// A new texture replaces the shared_ptr in the materials. Passes which bind the materials per draw pick it up, the
+// indirect material table of GeometryPass is refreshed when it sees the swap. Opacity maps stay fully resident
+// since the meshlet and ray tracing data keep references to them, so do textures that were not read from a DDS or
+// KTX file.
+class TextureStreamer {
+public:
+    // infos are the ones the asset loader returned for scene_list. The materials keep their textures until the
+    // base levels are read.
+    TextureStreamer(RenderDevice& device,
+                    ThreadPool& thread_pool,
+                    SceneModels& scene_list,
+                    const std::vector<ModelLoadInfo>& infos,
+                    const ModelRangeBounds& bounds);
+
+    // Must be called before the frame is recorded, the uploads are submitted ahead of the frame's command lists.
+    // A positive mip_bias selects coarser levels.
+    void Update(const SceneInstances& instances,
+                const Camera& camera,
+                int viewport_height,
+                uint64_t budget_bytes,
+                float mip_bias);
+    // Reads and uploads every level of every texture and waits for it, used when streaming is turned off.
+    void MakeResident();
+
+    uint64_t GetResidentBytes() const
+    {
+        return m_resident_bytes;
+    }
+
+private:
+    struct StreamedTexture {
+        // Material slots which reference the texture.
+        std::vector<std::shared_ptr<Resource>*> slots;
+        // Ranges which sample the texture as (model, range).
+        std::vector<std::pair<size_t, size_t>> ranges;
+        std::string file;
+        gli::format format;
+        uint32_t width;
+        uint32_t height;
+        // Size of every level of the chain.
+        std::vector<uint64_t> level_bytes;
+        // Most detailed level kept when nothing needs more.
+        uint32_t base_level;
+        // Most detailed level of the GPU copy.
+        uint32_t resident_level;
+        uint32_t wanted_level;
+        // Most detailed level of the chain being read, valid while load is.
+        uint32_t loading_level = 0;
+        // The chain from loading_level on, no levels if the file can't be read anymore.
+        std::future<TextureData> load;
+        // Update in which the resident levels were last needed.
+        uint64_t last_used = 0;
+    };
+
+    void ComputeWantedLevels(const SceneInstances& instances,
+                             const Camera& camera,
+                             int viewport_height,
+                             float mip_bias);
+    // Size of the levels from level to the end of the chain.
+    uint64_t GetChainBytes(const StreamedTexture& texture, uint32_t level) const;
+    // Level the texture will have once its pending read is uploaded.
+    uint32_t GetTargetLevel(const StreamedTexture& texture) const;
+    // Starts reading the chain of the texture from level on.
+    void RequestLevel(StreamedTexture& texture, uint32_t level);
+    // Recreates the GPU copy from a finished read, returns the uploaded size. A texture whose file doesn't match
+    // anymore keeps its GPU copy and is not streamed from then on.
+    uint64_t Upload(RenderCommandList& command_list, StreamedTexture& texture);
+
+    RenderDevice& m_device;
+    ThreadPool& m_thread_pool;
+    SceneModels& m_scene_list;
+    const ModelRangeBounds& m_bounds;
+    std::vector<StreamedTexture> m_textures;
+    // Per model, indexed by range id.
+    std::vector<std::vector<float>> m_uv_densities;
+    uint64_t m_resident_bytes = 0;
+    // Resident size once the pending reads are uploaded, the budget is checked against it.
+    uint64_t m_target_bytes = 0;
+    uint64_t m_update = 0;
+    std::vector<std::shared_ptr<RenderCommandList>> m_command_lists;
+    // Replaced textures stay alive until the frames that may sample them are finished.
+    std::deque<std::pair<uint64_t, std::shared_ptr<Resource>>> m_retired;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    ThreadPool(size_t thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    ~ThreadPool();
+
+    template <typename Fn>
+    std::future<std::invoke_result_t<Fn>> Push(Fn&& fn)
+    {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Fn>()>>(std::forward<Fn>(fn));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace_back([task] { (*task)(); });
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+    size_t GetThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop = false;
+};
@@ -1,18 +1,167 @@
 #include "AppBox/AppBox.h"
+#include "AppOptions.h"
 #include "AppSettings/ArgsParser.h"
+#include "Benchmark.h"
 #include "Scene.h"
+#include "Sweep.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
 
 int main(int argc, char* argv[])
 {
     Settings settings = ParseArgs(argc, argv);
+    AppOptions options;
+    if (!ParseAppOptions(argc, argv, options)) {
+        PrintAppOptionsUsage(argv[0]);
+        return 1;
+    }
+    if (options.cull_benchmark) {
+        RunCullingBenchmark(options.cull_benchmark, 1000);
+        return 0;
+    }
     AppBox app("SponzaPbr", settings);
     AppSize rect = app.GetAppSize();
-    Scene scene(settings, CreateRenderDevice(settings, app.GetNativeWindow(), rect.width(), rect.height()), app.GetWindow(),
-                rect.width(), rect.height());
+    int width = options.headless ? options.width : rect.width();
+    int height = options.headless ? options.height : rect.height();
+    if (options.headless) {
+        // The device is still created for the window, hidden and sized like the offscreen target Scene renders
+        // into. Its swapchain is never presented, see CMakeLists.txt for what this needs from GLFW.
+        glfwHideWindow(app.GetWindow());
+        glfwSetWindowSize(app.GetWindow(), width, height);
+    }
+    Scene scene(settings, CreateRenderDevice(settings, app.GetNativeWindow(), width, height), app.GetWindow(), width,
+                height, options.headless);
     app.SubscribeEvents(&scene, &scene);
     app.SetGpuName(scene.GetRenderDevice().GetGpuName());
-    while (!app.PollEvents()) {
+
+    SponzaSettings& sponza_settings = scene.GetSettings();
+    // Measured and captured frames must not be drawn with the previous settings while programs are built, presets
+    // and overrides may still turn the background builds on.
+    if (options.headless || !options.benchmark_path.empty() || !options.sweep_path.empty()) {
+        sponza_settings.GetValues().use_async_program_builds = false;
+    }
+    if (!options.preset.empty() && !sponza_settings.LoadPreset(options.preset)) {
+        std::cerr << "Failed to load preset " << options.preset << std::endl;
+        return 1;
+    }
+    for (const auto& entry : options.overrides) {
+        size_t pos = entry.find('=');
+        if (pos == std::string::npos || !sponza_settings.SetFromString(entry.substr(0, pos), entry.substr(pos + 1))) {
+            std::cerr << "Invalid setting override " << entry << std::endl;
+            return 1;
+        }
+    }
+    scene.OnModifySponzaSettings(sponza_settings);
+    if (!options.save_preset.empty() && !sponza_settings.SavePreset(options.save_preset)) {
+        std::cerr << "Failed to save preset " << options.save_preset << std::endl;
+    }
+
+    CameraPath camera_path;
+    BenchmarkReport report;
+    bool benchmark = !options.benchmark_path.empty();
+    if (benchmark) {
+        if (!camera_path.Load(options.benchmark_path)) {
+            std::cerr << "Failed to load camera path " << options.benchmark_path << std::endl;
+            return 1;
+        }
+        if (options.frames == 0) {
+            uint32_t path_frames = static_cast<uint32_t>(std::ceil(camera_path.GetDuration() / options.timestep));
+            options.frames = options.warmup_frames + path_frames + 1;
+        }
+        scene.SetMeasureGpuTime(true);
+    }
+    scene.SetFixedTimestep(options.timestep);
+    if (!options.profile_report.empty()) {
+        scene.EnableGpuProfiler();
+    }
+
+    auto apply_keyframe = [&](float path_time) {
+        CameraKeyframe keyframe = camera_path.Sample(path_time);
+        scene.GetCamera().SetCameraPos(keyframe.position);
+        scene.GetCamera().SetCameraYaw(keyframe.yaw);
+        scene.GetCamera().SetCameraPitch(keyframe.pitch);
+        scene.SetSunAngle(keyframe.sun_angle);
+    };
+
+    if (!options.sweep_path.empty()) {
+        SettingsSweep sweep;
+        if (!sweep.Load(options.sweep_path)) {
+            std::cerr << "Failed to load sweep " << options.sweep_path << std::endl;
+            return 1;
+        }
+        scene.SetMeasureGpuTime(true);
+        bool closed = false;
+        for (size_t cell = 0; cell < sweep.GetCellCount() && !closed; ++cell) {
+            if (!sweep.Apply(cell, sponza_settings)) {
+                std::cerr << "Failed to apply sweep cell " << cell << std::endl;
+                continue;
+            }
+            scene.OnModifySponzaSettings(sponza_settings);
+            BenchmarkReport cell_report;
+            for (uint32_t frame = 0; frame < options.warmup_frames + options.sweep_frames; ++frame) {
+                if (!options.headless && app.PollEvents()) {
+                    closed = true;
+                    break;
+                }
+                float path_time = (static_cast<float>(frame) - options.warmup_frames) * options.timestep;
+                if (benchmark) {
+                    apply_keyframe(path_time);
+                }
+                scene.RenderFrame();
+                if (frame >= options.warmup_frames) {
+                    cell_report.AddFrame(frame - options.warmup_frames, path_time, scene.GetFrameTiming());
+                }
+            }
+            if (!closed) {
+                scene.GetGpuProfiler().Flush();
+                cell_report.SetGpuTimes(scene.GetGpuProfiler().TakeFrameTimes());
+                sweep.AddResult(cell, cell_report);
+                std::cout << "Sweep cell " << cell + 1 << "/" << sweep.GetCellCount() << " done" << std::endl;
+            }
+        }
+        if (!sweep.Save(options.sweep_report)) {
+            std::cerr << "Failed to save " << options.sweep_report << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    for (uint32_t frame = 0; options.frames == 0 || frame < options.frames; ++frame) {
+        if (!options.headless && app.PollEvents()) {
+            break;
+        }
+        float path_time = (static_cast<float>(frame) - options.warmup_frames) * options.timestep;
+        if (benchmark) {
+            apply_keyframe(path_time);
+        }
         scene.RenderFrame();
+        if (benchmark && frame >= options.warmup_frames) {
+            report.AddFrame(frame - options.warmup_frames, path_time, scene.GetFrameTiming());
+        }
+        if (options.dump_frames.count(frame)) {
+            std::string path = options.dump_prefix + std::to_string(frame) + "." + options.dump_format;
+            if (!scene.SaveFrame(path)) {
+                std::cerr << "Failed to save " << path << std::endl;
+            }
+        }
+    }
+
+    scene.GetGpuProfiler().Flush();
+    if (benchmark) {
+        report.SetGpuTimes(scene.GetGpuProfiler().TakeFrameTimes());
+    }
+    if (!options.profile_report.empty()) {
+        if (!scene.GetGpuProfiler().SaveJson(options.profile_report)) {
+            std::cerr << "Failed to save " << options.profile_report << std::endl;
+        }
+    }
+    if (benchmark && !report.Save(options.benchmark_report)) {
+        std::cerr << "Failed to save " << options.benchmark_report << std::endl;
+        return 1;
     }
     return 0;
 }
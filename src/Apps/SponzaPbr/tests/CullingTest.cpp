@@ -0,0 +1,145 @@
+#include "Culling.h"
+
+#include <cfloat>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool condition, const std::string& message)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++g_failures;
+    }
+}
+
+const std::pair<CullingKernel, const char*> kKernels[] = {
+    { CullingKernel::kScalar, "scalar" },
+    { CullingKernel::kSse, "sse" },
+    { CullingKernel::kAvx, "avx" },
+    { CullingKernel::kBest, "best" },
+};
+
+// The identity matrix gives the clip cube, every plane is x, y or z = +-1.
+Frustum GetClipCube()
+{
+    return ExtractFrustum(glm::mat4(1.0f));
+}
+
+struct Case {
+    const char* name;
+    AABB box;
+    bool visible;
+};
+
+// Each case is repeated so that it lands in the vector part and in the scalar tail of every kernel.
+void TestCases(const Case* cases, size_t count)
+{
+    constexpr size_t kRepeats = 19;
+    AABBList boxes;
+    for (size_t repeat = 0; repeat < kRepeats; ++repeat) {
+        for (size_t i = 0; i < count; ++i) {
+            boxes.Add(cases[i].box);
+        }
+    }
+    std::vector<uint8_t> visible;
+    for (const auto& kernel : kKernels) {
+        if (!IsCullingKernelSupported(kernel.first)) {
+            continue;
+        }
+        CullAABBs(GetClipCube(), boxes, visible, kernel.first);
+        Check(visible.size() == boxes.Size(), std::string(kernel.second) + ": result size");
+        for (size_t i = 0; i < visible.size(); ++i) {
+            const Case& test_case = cases[i % count];
+            Check(visible[i] == test_case.visible,
+                  std::string(kernel.second) + ": " + test_case.name + " at " + std::to_string(i));
+        }
+    }
+}
+
+void TestTouchingPlanes()
+{
+    const Case cases[] = {
+        { "inside", { glm::vec3(-0.5f), glm::vec3(0.5f) }, true },
+        { "touching -x from outside", { glm::vec3(-2.0f, -0.5f, -0.5f), glm::vec3(-1.0f, 0.5f, 0.5f) }, true },
+        { "touching +x from outside", { glm::vec3(1.0f, -0.5f, -0.5f), glm::vec3(2.0f, 0.5f, 0.5f) }, true },
+        { "touching +y from outside", { glm::vec3(-0.5f, 1.0f, -0.5f), glm::vec3(0.5f, 2.0f, 0.5f) }, true },
+        { "touching -z from outside", { glm::vec3(-0.5f, -0.5f, -2.0f), glm::vec3(0.5f, 0.5f, -1.0f) }, true },
+        { "past +x", { glm::vec3(1.25f, -0.5f, -0.5f), glm::vec3(2.0f, 0.5f, 0.5f) }, false },
+        { "past -y", { glm::vec3(-0.5f, -2.0f, -0.5f), glm::vec3(0.5f, -1.25f, 0.5f) }, false },
+        { "containing the frustum", { glm::vec3(-10.0f), glm::vec3(10.0f) }, true },
+    };
+    TestCases(cases, std::size(cases));
+}
+
+void TestDegenerateAndInverted()
+{
+    const Case cases[] = {
+        { "point inside", { glm::vec3(0.25f), glm::vec3(0.25f) }, true },
+        { "point on a corner", { glm::vec3(1.0f), glm::vec3(1.0f) }, true },
+        { "point outside", { glm::vec3(1.5f, 0.0f, 0.0f), glm::vec3(1.5f, 0.0f, 0.0f) }, false },
+        { "flat inside", { glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(0.5f, 0.0f, 0.5f) }, true },
+        { "flat outside", { glm::vec3(-0.5f, 0.0f, 1.5f), glm::vec3(0.5f, 0.0f, 1.5f) }, false },
+        { "empty bounds", { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) }, false },
+        { "inverted inside", { glm::vec3(0.5f), glm::vec3(-0.5f) }, true },
+        { "inverted crossing a plane", { glm::vec3(1.5f, 0.5f, 0.5f), glm::vec3(0.5f, -0.5f, -0.5f) }, false },
+    };
+    TestCases(cases, std::size(cases));
+}
+
+void TestKernelsAgree()
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> extent(0.0f, 1.0f);
+    glm::mat4 view_projection(1.0f);
+    view_projection[0][0] = 0.75f;
+    view_projection[1][0] = 0.25f;
+    view_projection[2][1] = 0.5f;
+    view_projection[3][2] = 0.125f;
+    Frustum frustum = ExtractFrustum(view_projection);
+
+    for (size_t count : { 0, 1, 3, 4, 7, 8, 9, 1000, 1003 }) {
+        AABBList boxes;
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            glm::vec3 size(extent(rng), extent(rng), extent(rng));
+            boxes.Add({ center - size, center + size });
+        }
+        std::vector<uint8_t> expected;
+        CullAABBs(frustum, boxes, expected, CullingKernel::kScalar);
+        std::vector<uint8_t> visible;
+        for (const auto& kernel : kKernels) {
+            if (!IsCullingKernelSupported(kernel.first)) {
+                continue;
+            }
+            CullAABBs(frustum, boxes, visible, kernel.first);
+            Check(visible == expected, std::string(kernel.second) + ": differs from scalar for " +
+                                           std::to_string(count) + " boxes");
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    TestTouchingPlanes();
+    TestDegenerateAndInverted();
+    TestKernelsAgree();
+    for (const auto& kernel : kKernels) {
+        std::cout << kernel.second << ": " << (IsCullingKernelSupported(kernel.first) ? "tested" : "not compiled in")
+                  << std::endl;
+    }
+    if (g_failures) {
+        std::cerr << g_failures << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
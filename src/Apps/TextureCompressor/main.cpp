@@ -0,0 +1,133 @@
+#include "AssetCache/MaterialLibrary.h"
+#include "AssetCache/TextureCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TextureJob {
+    std::string path;
+    TextureRole role;
+    CompressionResult result;
+};
+
+const char* GetStatusName(CompressionStatus status)
+{
+    switch (status) {
+    case CompressionStatus::kCompressed:
+        return "compressed";
+    case CompressionStatus::kCached:
+        return "cached";
+    case CompressionStatus::kKept:
+        return "kept";
+    default:
+        return "failed";
+    }
+}
+
+void PrintUsage()
+{
+    std::cout << "Usage: TextureCompressor [--cache <dir>] [--force] [--hdr <file>]... [<obj>]..." << std::endl
+              << "  Compresses the textures of the material libraries of every OBJ and every HDR environment map"
+              << std::endl
+              << "  into the texture cache, " << kTextureCachePath << " by default." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string cache_path = kTextureCachePath;
+    bool force = false;
+    std::vector<TextureJob> jobs;
+    auto add_job = [&](const std::string& path, TextureRole role) {
+        bool known = std::any_of(jobs.begin(), jobs.end(),
+                                 [&](const TextureJob& job) { return job.path == path && job.role == role; });
+        if (!known) {
+            jobs.push_back({ path, role, {} });
+        }
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        bool has_value = i + 1 < argc;
+        if (arg == "--cache" && has_value) {
+            cache_path = argv[++i];
+        } else if (arg == "--force") {
+            force = true;
+        } else if (arg == "--hdr" && has_value) {
+            add_job(argv[++i], TextureRole::kEnvironment);
+        } else if (arg.rfind("--", 0) == 0) {
+            PrintUsage();
+            return 1;
+        } else {
+            std::vector<MaterialTexture> textures = GetMaterialTextures(arg);
+            if (textures.empty()) {
+                std::cerr << "No material textures in " << arg << std::endl;
+            }
+            for (const auto& texture : textures) {
+                TextureRole role;
+                if (GetMtlTextureRole(texture.keyword, role)) {
+                    add_job(texture.path, role);
+                }
+            }
+        }
+    }
+    if (jobs.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    // Jobs are taken in order by every worker, results are printed as they complete.
+    TextureCompressionCache cache(cache_path);
+    std::atomic<size_t> next_job(0);
+    std::mutex output_mutex;
+    auto worker = [&] {
+        for (size_t index = next_job++; index < jobs.size(); index = next_job++) {
+            TextureJob& job = jobs[index];
+            job.result = cache.Compress(job.path, job.role, force);
+
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << std::left << std::setw(10) << GetStatusName(job.result.status) << " " << std::setw(11)
+                      << GetTextureRoleName(job.role) << " " << job.path;
+            if (job.result.status == CompressionStatus::kCompressed) {
+                std::cout << " (" << job.result.source_format << ", " << job.result.source_size << " -> "
+                          << job.result.compressed_size << " bytes, rmse " << std::fixed << std::setprecision(4)
+                          << job.result.rmse << ")";
+            } else if (job.result.status == CompressionStatus::kKept) {
+                std::cout << " (already " << job.result.source_format << ")";
+            }
+            std::cout << std::endl;
+        }
+    };
+    std::vector<std::thread> threads(std::max(1u, std::thread::hardware_concurrency()));
+    for (auto& thread : threads) {
+        thread = std::thread(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t source_size = 0;
+    uint64_t compressed_size = 0;
+    size_t failed = 0;
+    for (const auto& job : jobs) {
+        if (job.result.status == CompressionStatus::kFailed) {
+            ++failed;
+            continue;
+        }
+        source_size += job.result.source_size;
+        compressed_size += job.result.status == CompressionStatus::kKept ? job.result.source_size
+                                                                          : job.result.compressed_size;
+    }
+    std::cout << jobs.size() << " textures, " << failed << " failed, " << source_size << " -> " << compressed_size
+              << " bytes in " << cache_path << std::endl;
+    return failed ? 1 : 0;
+}
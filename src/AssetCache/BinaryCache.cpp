@@ -0,0 +1,154 @@
+#include "BinaryCache.h"
+
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t HashString(const std::string& str, uint64_t seed)
+{
+    return HashBytes(str.data(), str.size(), HashValue<uint64_t>(str.size(), seed));
+}
+
+bool HashFile(const std::string& path, uint64_t& hash, uint64_t seed)
+{
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    hash = HashBytes(file.GetData(), file.GetSize(), HashValue<uint64_t>(file.GetSize(), seed));
+    return true;
+}
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    m_file = file;
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        return;
+    }
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        return;
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data) {
+        m_size = static_cast<size_t>(size.QuadPart);
+    }
+#else
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd == -1) {
+        return;
+    }
+    struct stat info = {};
+    if (fstat(m_fd, &info) != 0 || info.st_size == 0) {
+        return;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+    if (m_fd != -1) {
+        close(m_fd);
+    }
+#endif
+}
+
+bool BinaryWriter::Save(const std::string& path) const
+{
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+        if (!file.good()) {
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+void BinaryWriter::WriteBytes(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_data.insert(m_data.end(), bytes, bytes + size);
+}
+
+void BinaryWriter::Align()
+{
+    m_data.resize((m_data.size() + kBinaryAlignment - 1) / kBinaryAlignment * kBinaryAlignment);
+}
+
+BinaryReader::BinaryReader(const uint8_t* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+{
+}
+
+const uint8_t* BinaryReader::ReadBytes(size_t size)
+{
+    if (m_error || size > m_size - m_offset) {
+        m_error = true;
+        return nullptr;
+    }
+    const uint8_t* data = m_data + m_offset;
+    m_offset += size;
+    return data;
+}
+
+void BinaryReader::Align()
+{
+    size_t offset = (m_offset + kBinaryAlignment - 1) / kBinaryAlignment * kBinaryAlignment;
+    if (offset > m_size) {
+        m_error = true;
+        return;
+    }
+    m_offset = offset;
+}
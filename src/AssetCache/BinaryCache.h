@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// 64 bit FNV-1a, continues from seed so several inputs can be chained into one key.
+constexpr uint64_t kHashSeed = 0xcbf29ce484222325ull;
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = kHashSeed);
+uint64_t HashString(const std::string& str, uint64_t seed = kHashSeed);
+
+template <typename T>
+uint64_t HashValue(const T& value, uint64_t seed = kHashSeed)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    return HashBytes(&value, sizeof(value), seed);
+}
+
+// Hash of the contents of a file, false if it can't be read.
+bool HashFile(const std::string& path, uint64_t& hash, uint64_t seed = kHashSeed);
+
+// Read-only mapping of a whole file, closed on destruction.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const
+    {
+        return m_data != nullptr;
+    }
+
+    const uint8_t* GetData() const
+    {
+        return m_data;
+    }
+
+    size_t GetSize() const
+    {
+        return m_size;
+    }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// Appends values and arrays to a byte buffer. Arrays start at kBinaryAlignment so they can be used in place from
+// a mapping.
+constexpr size_t kBinaryAlignment = 16;
+
+class BinaryWriter {
+public:
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(&value, sizeof(value));
+    }
+
+    template <typename T>
+    void WriteArray(const T* data, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write<uint64_t>(count);
+        Align();
+        WriteBytes(data, count * sizeof(T));
+    }
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& data)
+    {
+        WriteArray(data.data(), data.size());
+    }
+
+    // Unaligned bytes without a size, for files with a layout of their own.
+    void WriteBytes(const void* data, size_t size);
+
+    const std::vector<uint8_t>& GetData() const
+    {
+        return m_data;
+    }
+
+    // Writes to path.tmp first and renames it, so a reader never sees a partial file.
+    bool Save(const std::string& path) const;
+
+private:
+    void Align();
+
+    std::vector<uint8_t> m_data;
+};
+
+// Reads what BinaryWriter wrote. Reading past the end sets the error state and returns zeroes and empty arrays.
+class BinaryReader {
+public:
+    BinaryReader(const uint8_t* data, size_t size);
+
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value = {};
+        if (const uint8_t* src = ReadBytes(sizeof(T))) {
+            std::memcpy(&value, src, sizeof(T));
+        }
+        return value;
+    }
+
+    // Pointer into the data, count is set to the number of elements.
+    template <typename T>
+    const T* ReadArray(size_t& count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        count = 0;
+        uint64_t size = Read<uint64_t>();
+        Align();
+        if (m_error || size > (m_size - m_offset) / sizeof(T)) {
+            m_error = true;
+            return nullptr;
+        }
+        count = static_cast<size_t>(size);
+        return reinterpret_cast<const T*>(ReadBytes(count * sizeof(T)));
+    }
+
+    template <typename T>
+    std::vector<T> ReadVector()
+    {
+        size_t count = 0;
+        const T* data = ReadArray<T>(count);
+        return data ? std::vector<T>(data, data + count) : std::vector<T>();
+    }
+
+    bool HasError() const
+    {
+        return m_error;
+    }
+
+    bool IsEnd() const
+    {
+        return m_offset == m_size;
+    }
+
+private:
+    const uint8_t* ReadBytes(size_t size);
+    void Align();
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_error = false;
+};
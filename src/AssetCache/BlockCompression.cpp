@@ -0,0 +1,518 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+// Interpolation weights of 4 bit indices in BC6H and BC7.
+constexpr int kWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Largest finite half float, the upper bound of BC6H unsigned values.
+constexpr float kMaxHalfBits = 0x7bff;
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* data)
+        : m_data(data)
+    {
+        std::memset(m_data, 0, 16);
+    }
+
+    void Write(uint32_t value, uint32_t bit_count)
+    {
+        for (uint32_t i = 0; i < bit_count; ++i, ++m_offset) {
+            m_data[m_offset / 8] |= ((value >> i) & 1) << (m_offset % 8);
+        }
+    }
+
+private:
+    uint8_t* m_data;
+    uint32_t m_offset = 0;
+};
+
+template <int N>
+void GetPrincipalAxis(const float (&points)[16][N], float (&mean)[N], float (&axis)[N])
+{
+    std::fill(std::begin(mean), std::end(mean), 0.0f);
+    for (const auto& point : points) {
+        for (int c = 0; c < N; ++c) {
+            mean[c] += point[c] / 16;
+        }
+    }
+    float covariance[N][N] = {};
+    for (const auto& point : points) {
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                covariance[i][j] += (point[i] - mean[i]) * (point[j] - mean[j]);
+            }
+        }
+    }
+
+    std::fill(std::begin(axis), std::end(axis), 1.0f);
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[N] = {};
+        float length = 0;
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            length += next[i] * next[i];
+        }
+        if (length < 1e-12f) {
+            break;
+        }
+        length = std::sqrt(length);
+        for (int i = 0; i < N; ++i) {
+            axis[i] = next[i] / length;
+        }
+    }
+}
+
+// Ends of the principal axis through the points.
+template <int N>
+void GetAxisEndpoints(const float (&points)[16][N], float (&e0)[N], float (&e1)[N])
+{
+    float mean[N];
+    float axis[N];
+    GetPrincipalAxis(points, mean, axis);
+    float min_t = 0;
+    float max_t = 0;
+    for (const auto& point : points) {
+        float t = 0;
+        for (int c = 0; c < N; ++c) {
+            t += (point[c] - mean[c]) * axis[c];
+        }
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+    for (int c = 0; c < N; ++c) {
+        e0[c] = mean[c] + axis[c] * min_t;
+        e1[c] = mean[c] + axis[c] * max_t;
+    }
+}
+
+// Nearest palette entry of every point, returns the squared error.
+template <int N>
+float SelectIndices(const float (&points)[16][N], const float (&palette)[16][N], int palette_size, int (&indices)[16])
+{
+    float error = 0;
+    for (int i = 0; i < 16; ++i) {
+        float best = INFINITY;
+        for (int j = 0; j < palette_size; ++j) {
+            float distance = 0;
+            for (int c = 0; c < N; ++c) {
+                float d = points[i][c] - palette[j][c];
+                distance += d * d;
+            }
+            if (distance < best) {
+                best = distance;
+                indices[i] = j;
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+// Endpoints which minimize the squared error of the interpolated values for fixed indices. Returns false if all
+// pixels use the same weight.
+template <int N>
+bool SolveEndpoints(const float (&points)[16][N], const int (&indices)[16], float (&e0)[N], float (&e1)[N])
+{
+    float aa = 0, ab = 0, bb = 0;
+    float ax[N] = {};
+    float bx[N] = {};
+    for (int i = 0; i < 16; ++i) {
+        float b = kWeights4[indices[i]] / 64.0f;
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < N; ++c) {
+            ax[c] += a * points[i][c];
+            bx[c] += b * points[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < N; ++c) {
+        e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+        e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+    }
+    return true;
+}
+
+struct BC7Mode6 {
+    int endpoints[2][4];
+    int pbits[2];
+    int indices[16];
+    float error = INFINITY;
+};
+
+// Tries every p-bit combination for the endpoints, which are in [0, 255].
+void QuantizeBC7Mode6(const float (&points)[16][4], const float (&e0)[4], const float (&e1)[4], BC7Mode6& best)
+{
+    for (int p0 = 0; p0 < 2; ++p0) {
+        for (int p1 = 0; p1 < 2; ++p1) {
+            BC7Mode6 mode = {};
+            mode.pbits[0] = p0;
+            mode.pbits[1] = p1;
+            int unquantized[2][4];
+            for (int c = 0; c < 4; ++c) {
+                mode.endpoints[0][c] = std::clamp(static_cast<int>(std::lround((e0[c] - p0) / 2)), 0, 127);
+                mode.endpoints[1][c] = std::clamp(static_cast<int>(std::lround((e1[c] - p1) / 2)), 0, 127);
+                unquantized[0][c] = mode.endpoints[0][c] << 1 | p0;
+                unquantized[1][c] = mode.endpoints[1][c] << 1 | p1;
+            }
+            float palette[16][4];
+            for (int i = 0; i < 16; ++i) {
+                for (int c = 0; c < 4; ++c) {
+                    palette[i][c] = static_cast<float>(
+                        ((64 - kWeights4[i]) * unquantized[0][c] + kWeights4[i] * unquantized[1][c] + 32) >> 6);
+                }
+            }
+            mode.error = SelectIndices(points, palette, 16, mode.indices);
+            if (mode.error < best.error) {
+                best = mode;
+            }
+        }
+    }
+}
+
+// BC6H unsigned endpoints are interpolated as 16 bit values, see the "Unquantize" and "FinishUnquantize" steps of
+// the format description.
+int UnquantizeBC6H(int value)
+{
+    if (value == 0) {
+        return 0;
+    }
+    if (value == 1023) {
+        return 0xffff;
+    }
+    return ((value << 16) + 0x8000) >> 10;
+}
+
+// Nearest 10 bit endpoint of a half float bit pattern.
+int QuantizeBC6H(float half_bits)
+{
+    float unquantized = half_bits * 64 / 31;
+    int estimate = std::clamp(static_cast<int>(std::lround((unquantized - 32) / 64)), 0, 1023);
+    int best = estimate;
+    for (int value = std::max(estimate - 1, 0); value <= std::min(estimate + 1, 1023); ++value) {
+        if (std::abs(UnquantizeBC6H(value) - unquantized) < std::abs(UnquantizeBC6H(best) - unquantized)) {
+            best = value;
+        }
+    }
+    return best;
+}
+
+struct BC6HMode11 {
+    int endpoints[2][3];
+    int indices[16];
+    float error = INFINITY;
+};
+
+void QuantizeBC6HMode11(const float (&points)[16][3], const float (&e0)[3], const float (&e1)[3], BC6HMode11& best)
+{
+    BC6HMode11 mode = {};
+    for (int c = 0; c < 3; ++c) {
+        mode.endpoints[0][c] = QuantizeBC6H(std::clamp(e0[c], 0.0f, kMaxHalfBits));
+        mode.endpoints[1][c] = QuantizeBC6H(std::clamp(e1[c], 0.0f, kMaxHalfBits));
+    }
+    float palette[16][3];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            int value = ((64 - kWeights4[i]) * UnquantizeBC6H(mode.endpoints[0][c]) +
+                         kWeights4[i] * UnquantizeBC6H(mode.endpoints[1][c]) + 32) >>
+                        6;
+            palette[i][c] = static_cast<float>((value * 31) >> 6);
+        }
+    }
+    mode.error = SelectIndices(points, palette, 16, mode.indices);
+    if (mode.error < best.error) {
+        best = mode;
+    }
+}
+
+// The first index of a BC6H or BC7 block has an implicit zero high bit, the endpoints are swapped if it is set.
+template <int N>
+void FixAnchorIndex(int (&endpoints)[2][N], int (&indices)[16], int (*pbits)[2] = nullptr)
+{
+    if (indices[0] < 8) {
+        return;
+    }
+    std::swap(endpoints[0], endpoints[1]);
+    if (pbits) {
+        std::swap((*pbits)[0], (*pbits)[1]);
+    }
+    for (int& index : indices) {
+        index = 15 - index;
+    }
+}
+
+void DecodeColorBlock(const uint8_t block[8], float rgba[64], bool bc1)
+{
+    uint16_t c0 = block[0] | block[1] << 8;
+    uint16_t c1 = block[2] | block[3] << 8;
+    float colors[4][4];
+    for (int i = 0; i < 2; ++i) {
+        uint16_t c = i == 0 ? c0 : c1;
+        colors[i][0] = ((c >> 11) & 31) / 31.0f;
+        colors[i][1] = ((c >> 5) & 63) / 63.0f;
+        colors[i][2] = (c & 31) / 31.0f;
+        colors[i][3] = 1.0f;
+    }
+    for (int c = 0; c < 4; ++c) {
+        if (!bc1 || c0 > c1) {
+            colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+            colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+        } else {
+            colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+            colors[3][c] = 0.0f;
+        }
+    }
+    uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+    for (int i = 0; i < 16; ++i) {
+        std::memcpy(&rgba[i * 4], colors[(indices >> (2 * i)) & 3], sizeof(colors[0]));
+    }
+}
+
+} // namespace
+
+float EncodeBC4Block(const float values[16], uint8_t block[8])
+{
+    float points[16][1];
+    float min_value = 255;
+    float max_value = 0;
+    for (int i = 0; i < 16; ++i) {
+        points[i][0] = std::clamp(values[i], 0.0f, 1.0f) * 255;
+        min_value = std::min(min_value, points[i][0]);
+        max_value = std::max(max_value, points[i][0]);
+    }
+    int e0 = static_cast<int>(std::lround(max_value));
+    int e1 = static_cast<int>(std::lround(min_value));
+    float palette[16][1] = { { static_cast<float>(e0) }, { static_cast<float>(e1) } };
+    if (e0 > e1) {
+        for (int k = 1; k < 7; ++k) {
+            palette[k + 1][0] = ((7 - k) * e0 + k * e1) / 7.0f;
+        }
+    } else {
+        for (int k = 1; k < 5; ++k) {
+            palette[k + 1][0] = ((5 - k) * e0 + k * e1) / 5.0f;
+        }
+        palette[6][0] = 0;
+        palette[7][0] = 255;
+    }
+    int indices[16];
+    float error = SelectIndices(points, palette, 8, indices);
+
+    block[0] = static_cast<uint8_t>(e0);
+    block[1] = static_cast<uint8_t>(e1);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i) {
+        bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    return error / (255.0f * 255.0f);
+}
+
+float EncodeBC5Block(const float values[32], uint8_t block[16])
+{
+    float x[16];
+    float y[16];
+    for (int i = 0; i < 16; ++i) {
+        x[i] = values[2 * i];
+        y[i] = values[2 * i + 1];
+    }
+    return EncodeBC4Block(x, block) + EncodeBC4Block(y, block + 8);
+}
+
+float EncodeBC7Block(const float rgba[64], uint8_t block[16])
+{
+    float points[16][4];
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            points[i][c] = std::clamp(rgba[i * 4 + c], 0.0f, 1.0f) * 255;
+        }
+    }
+
+    float e0[4];
+    float e1[4];
+    GetAxisEndpoints(points, e0, e1);
+    BC7Mode6 best;
+    QuantizeBC7Mode6(points, e0, e1, best);
+    if (SolveEndpoints(points, best.indices, e0, e1)) {
+        QuantizeBC7Mode6(points, e0, e1, best);
+    }
+    FixAnchorIndex(best.endpoints, best.indices, &best.pbits);
+
+    BitWriter writer(block);
+    writer.Write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        writer.Write(best.endpoints[0][c], 7);
+        writer.Write(best.endpoints[1][c], 7);
+    }
+    writer.Write(best.pbits[0], 1);
+    writer.Write(best.pbits[1], 1);
+    for (int i = 0; i < 16; ++i) {
+        writer.Write(best.indices[i], i == 0 ? 3 : 4);
+    }
+    return best.error / (255.0f * 255.0f);
+}
+
+float EncodeBC6HBlock(const float rgb[48], uint8_t block[16])
+{
+    // Interpolation happens on the bit patterns of the half floats, which are close to logarithmic, so the
+    // endpoints are fit to the bit patterns too.
+    float points[16][3];
+    float min_point[3] = { kMaxHalfBits, kMaxHalfBits, kMaxHalfBits };
+    float max_point[3] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            float value = rgb[i * 3 + c];
+            value = std::isnan(value) ? 0.0f : std::max(value, 0.0f);
+            points[i][c] = std::min(static_cast<float>(FloatToHalf(value)), kMaxHalfBits);
+            min_point[c] = std::min(min_point[c], points[i][c]);
+            max_point[c] = std::max(max_point[c], points[i][c]);
+        }
+    }
+
+    BC6HMode11 best;
+    QuantizeBC6HMode11(points, min_point, max_point, best);
+    float e0[3];
+    float e1[3];
+    GetAxisEndpoints(points, e0, e1);
+    QuantizeBC6HMode11(points, e0, e1, best);
+    if (SolveEndpoints(points, best.indices, e0, e1)) {
+        QuantizeBC6HMode11(points, e0, e1, best);
+    }
+    FixAnchorIndex(best.endpoints, best.indices);
+
+    BitWriter writer(block);
+    writer.Write(0x03, 5);
+    for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 3; ++c) {
+            writer.Write(best.endpoints[e][c], 10);
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        writer.Write(best.indices[i], i == 0 ? 3 : 4);
+    }
+    return best.error;
+}
+
+void DecodeBC1Block(const uint8_t block[8], float rgba[64], bool has_alpha)
+{
+    DecodeColorBlock(block, rgba, true);
+    if (!has_alpha) {
+        for (int i = 0; i < 16; ++i) {
+            rgba[i * 4 + 3] = 1.0f;
+        }
+    }
+}
+
+void DecodeBC2Block(const uint8_t block[16], float rgba[64])
+{
+    DecodeColorBlock(block + 8, rgba, false);
+    for (int i = 0; i < 16; ++i) {
+        rgba[i * 4 + 3] = ((block[i / 2] >> (4 * (i % 2))) & 15) / 15.0f;
+    }
+}
+
+void DecodeBC3Block(const uint8_t block[16], float rgba[64])
+{
+    DecodeColorBlock(block + 8, rgba, false);
+    DecodeBC4Block(block, rgba + 3, 4);
+}
+
+void DecodeBC4Block(const uint8_t block[8], float values[16], int stride)
+{
+    int e0 = block[0];
+    int e1 = block[1];
+    float palette[8] = { e0 / 255.0f, e1 / 255.0f };
+    if (e0 > e1) {
+        for (int k = 1; k < 7; ++k) {
+            palette[k + 1] = ((7 - k) * e0 + k * e1) / (7 * 255.0f);
+        }
+    } else {
+        for (int k = 1; k < 5; ++k) {
+            palette[k + 1] = ((5 - k) * e0 + k * e1) / (5 * 255.0f);
+        }
+        palette[6] = 0.0f;
+        palette[7] = 1.0f;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) {
+        bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i) {
+        values[i * stride] = palette[(bits >> (3 * i)) & 7];
+    }
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (((bits >> 23) & 0xff) == 0xff) {
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t middle = 1u << (shift - 1);
+        if (rest > middle || (rest == middle && (half & 1))) {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = sign | static_cast<uint32_t>(exponent) << 10 | mantissa >> 13;
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        ++half;
+    }
+    return static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | mantissa << 13;
+    } else if (exponent != 0) {
+        bits = sign | (exponent + 127 - 15) << 23 | mantissa << 13;
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | exponent << 23 | (mantissa & 0x3ff) << 13;
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Encoders and decoders of single 4x4 blocks, pixels are in row order. Unorm channels are floats in [0, 1], HDR
+// channels are linear floats, negative values are clamped to 0. The encoders return the squared error of the block
+// summed over its channels, in the units of the input.
+
+// 8 bytes, one channel.
+float EncodeBC4Block(const float values[16], uint8_t block[8]);
+// 16 bytes, two channels interleaved as xy.
+float EncodeBC5Block(const float values[32], uint8_t block[16]);
+// 16 bytes, RGBA. Mode 6 only, one subset with 7.7.7.7 endpoints, a p-bit each and 4 bit indices.
+float EncodeBC7Block(const float rgba[64], uint8_t block[16]);
+// 16 bytes, unsigned RGB. Mode 11 only, one region with 10 bit endpoints and 4 bit indices.
+float EncodeBC6HBlock(const float rgb[48], uint8_t block[16]);
+
+// Decoders of the source formats, BC1 and BC3 write RGBA, BC4 one channel.
+void DecodeBC1Block(const uint8_t block[8], float rgba[64], bool has_alpha = true);
+void DecodeBC2Block(const uint8_t block[16], float rgba[64]);
+void DecodeBC3Block(const uint8_t block[16], float rgba[64]);
+void DecodeBC4Block(const uint8_t block[8], float values[16], int stride = 1);
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
@@ -0,0 +1,62 @@
+#include "MaterialLibrary.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+std::string GetDirectory(const std::string& path)
+{
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+}
+
+} // namespace
+
+std::vector<MaterialTexture> GetMaterialTextures(const std::string& obj_path)
+{
+    std::vector<std::string> libraries;
+    std::ifstream obj(obj_path);
+    std::string line;
+    while (std::getline(obj, line)) {
+        std::istringstream stream(line);
+        std::string keyword, library;
+        if (!(stream >> keyword)) {
+            continue;
+        }
+        if (keyword == "v") {
+            break;
+        }
+        if (keyword == "mtllib" && stream >> library) {
+            libraries.push_back(GetDirectory(obj_path) + library);
+        }
+    }
+
+    std::set<std::pair<std::string, std::string>> textures;
+    for (const auto& library : libraries) {
+        std::ifstream mtl(library);
+        while (std::getline(mtl, line)) {
+            std::istringstream stream(line);
+            std::string keyword, token, file;
+            if (!(stream >> keyword) || (keyword.rfind("map_", 0) != 0 && keyword != "bump" && keyword != "norm")) {
+                continue;
+            }
+            while (stream >> token) {
+                file = token;
+            }
+            std::replace(file.begin(), file.end(), '\\', '/');
+            if (!file.empty()) {
+                textures.emplace(GetDirectory(library) + file, keyword);
+            }
+        }
+    }
+
+    std::vector<MaterialTexture> result;
+    for (const auto& texture : textures) {
+        result.push_back({ texture.first, texture.second });
+    }
+    return result;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct MaterialTexture {
+    std::string path;
+    // Statement of the material library which references the file, e.g. "map_Kd".
+    std::string keyword;
+};
+
+// Texture files referenced by the material libraries of an OBJ, the last token of a map statement is the file.
+// Only the header of the OBJ is read, the libraries are expected before the first vertex.
+std::vector<MaterialTexture> GetMaterialTextures(const std::string& obj_path);
@@ -0,0 +1,248 @@
+#include "TextureCompression.h"
+
+#include "BinaryCache.h"
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Must be increased whenever an encoder or the mip generation changes, old entries are then left unused.
+constexpr uint32_t kEncoderVersion = 1;
+
+constexpr uint32_t kDxgiFormatBC4 = 80;
+constexpr uint32_t kDxgiFormatBC5 = 83;
+constexpr uint32_t kDxgiFormatBC6H = 95;
+constexpr uint32_t kDxgiFormatBC7 = 98;
+
+uint32_t GetBitsPerPixel(TextureRole role)
+{
+    return role == TextureRole::kMask ? 4 : 8;
+}
+
+// The encoder of a role reads the first channels of every pixel.
+int GetChannelCount(TextureRole role)
+{
+    switch (role) {
+    case TextureRole::kAlbedo:
+        return 4;
+    case TextureRole::kNormal:
+        return 2;
+    case TextureRole::kMask:
+        return 1;
+    default:
+        return 3;
+    }
+}
+
+std::vector<uint8_t> CompressLevel(const TextureImage& image, TextureRole role, double& error)
+{
+    uint32_t blocks_x = (image.width + 3) / 4;
+    uint32_t blocks_y = (image.height + 3) / 4;
+    uint32_t block_size = GetBitsPerPixel(role) * 2;
+    std::vector<uint8_t> data(static_cast<size_t>(blocks_x) * blocks_y * block_size);
+    int channels = GetChannelCount(role);
+    error = 0;
+    for (uint32_t by = 0; by < blocks_y; ++by) {
+        for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+            float values[64];
+            for (uint32_t i = 0; i < 16; ++i) {
+                // Pixels outside of the image repeat the last row or column.
+                const float* pixel = image.GetPixel(std::min(bx * 4 + i % 4, image.width - 1),
+                                                    std::min(by * 4 + i / 4, image.height - 1));
+                std::copy(pixel, pixel + channels, &values[i * channels]);
+            }
+            uint8_t* block = &data[(static_cast<size_t>(by) * blocks_x + bx) * block_size];
+            switch (role) {
+            case TextureRole::kAlbedo:
+                error += EncodeBC7Block(values, block);
+                break;
+            case TextureRole::kNormal:
+                error += EncodeBC5Block(values, block);
+                break;
+            case TextureRole::kMask:
+                error += EncodeBC4Block(values, block);
+                break;
+            default:
+                error += EncodeBC6HBlock(values, block);
+                break;
+            }
+        }
+    }
+    error /= static_cast<double>(blocks_x) * blocks_y * 16 * channels;
+    return data;
+}
+
+void Write32(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+{
+    std::memcpy(&data[offset], &value, sizeof(value));
+}
+
+uint64_t GetFileSize(const std::string& path)
+{
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+} // namespace
+
+const char* GetTextureRoleName(TextureRole role)
+{
+    switch (role) {
+    case TextureRole::kAlbedo:
+        return "albedo";
+    case TextureRole::kNormal:
+        return "normal";
+    case TextureRole::kMask:
+        return "mask";
+    default:
+        return "environment";
+    }
+}
+
+bool GetMtlTextureRole(const std::string& keyword, TextureRole& role)
+{
+    if (keyword == "map_Kd") {
+        role = TextureRole::kAlbedo;
+    } else if (keyword == "map_bump" || keyword == "bump" || keyword == "map_Kn" || keyword == "norm") {
+        role = TextureRole::kNormal;
+    } else if (keyword == "map_Ks" || keyword == "map_Ns" || keyword == "map_d" || keyword == "map_Ka" ||
+               keyword == "map_Pr" || keyword == "map_Pm" || keyword == "map_ao") {
+        role = TextureRole::kMask;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+CompressedTexture CompressTexture(const TextureImage& image, TextureRole role)
+{
+    CompressedTexture texture;
+    texture.width = image.width;
+    texture.height = image.height;
+    switch (role) {
+    case TextureRole::kAlbedo:
+        texture.dxgi_format = kDxgiFormatBC7;
+        break;
+    case TextureRole::kNormal:
+        texture.dxgi_format = kDxgiFormatBC5;
+        break;
+    case TextureRole::kMask:
+        texture.dxgi_format = kDxgiFormatBC4;
+        break;
+    default:
+        texture.dxgi_format = kDxgiFormatBC6H;
+        break;
+    }
+
+    const TextureImage* level = &image;
+    TextureImage next;
+    while (true) {
+        double error = 0;
+        texture.levels.push_back(CompressLevel(*level, role, error));
+        if (texture.levels.size() == 1) {
+            texture.rmse = static_cast<float>(std::sqrt(error));
+        }
+        if (level->width == 1 && level->height == 1) {
+            break;
+        }
+        next = DownsampleImage(*level, role == TextureRole::kNormal);
+        level = &next;
+    }
+    return texture;
+}
+
+bool SaveCompressedTexture(const std::string& path, const CompressedTexture& texture)
+{
+    // DDS_HEADER followed by DDS_HEADER_DXT10.
+    std::vector<uint8_t> header(148);
+    Write32(header, 0, 0x20534444); // "DDS "
+    Write32(header, 4, 124);
+    // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE
+    Write32(header, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000);
+    Write32(header, 12, texture.height);
+    Write32(header, 16, texture.width);
+    Write32(header, 20, static_cast<uint32_t>(texture.levels.front().size()));
+    Write32(header, 28, static_cast<uint32_t>(texture.levels.size()));
+    Write32(header, 76, 32);
+    Write32(header, 80, 0x4); // DDPF_FOURCC
+    Write32(header, 84, 0x30315844); // "DX10"
+    // DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP
+    Write32(header, 108, 0x8 | 0x1000 | 0x400000);
+    Write32(header, 128, texture.dxgi_format);
+    Write32(header, 132, 3); // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    Write32(header, 140, 1);
+
+    BinaryWriter writer;
+    writer.WriteBytes(header.data(), header.size());
+    for (const auto& level : texture.levels) {
+        writer.WriteBytes(level.data(), level.size());
+    }
+    return writer.Save(path);
+}
+
+TextureCompressionCache::TextureCompressionCache(const std::string& directory)
+    : m_directory(directory)
+{
+}
+
+std::string TextureCompressionCache::Find(const std::string& source, TextureRole role) const
+{
+    uint64_t key = 0;
+    if (!HashFile(source, key)) {
+        return {};
+    }
+    std::string path = GetPath(HashValue(kEncoderVersion, HashValue(role, key)));
+    return GetFileSize(path) ? path : std::string();
+}
+
+CompressionResult TextureCompressionCache::Compress(const std::string& source, TextureRole role, bool force) const
+{
+    CompressionResult result;
+    uint64_t key = 0;
+    if (!HashFile(source, key)) {
+        return result;
+    }
+    result.source_size = GetFileSize(source);
+    result.path = GetPath(HashValue(kEncoderVersion, HashValue(role, key)));
+    if (!force && GetFileSize(result.path)) {
+        result.status = CompressionStatus::kCached;
+        result.compressed_size = GetFileSize(result.path);
+        return result;
+    }
+
+    TextureImage image;
+    if (!LoadTextureImage(source, image)) {
+        return result;
+    }
+    result.source_format = image.source_format;
+    if (image.source_block_compressed && image.source_bits_per_pixel <= GetBitsPerPixel(role)) {
+        result.status = CompressionStatus::kKept;
+        result.path = source;
+        return result;
+    }
+
+    CompressedTexture texture = CompressTexture(image, role);
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (!SaveCompressedTexture(result.path, texture)) {
+        return result;
+    }
+    result.status = CompressionStatus::kCompressed;
+    result.compressed_size = GetFileSize(result.path);
+    result.rmse = texture.rmse;
+    return result;
+}
+
+std::string TextureCompressionCache::GetPath(uint64_t key) const
+{
+    std::ostringstream path;
+    path << m_directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".dds";
+    return path.str();
+}
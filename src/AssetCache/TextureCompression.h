@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TextureImage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How a texture is sampled, which selects its block format.
+enum class TextureRole {
+    // BC7, RGBA.
+    kAlbedo,
+    // BC5, the xy of a tangent space normal, z has to be reconstructed.
+    kNormal,
+    // BC4, the red channel. Roughness, metalness, ambient occlusion, opacity.
+    kMask,
+    // BC6H, unsigned HDR RGB.
+    kEnvironment,
+};
+
+const char* GetTextureRoleName(TextureRole role);
+
+// Role of a texture referenced by a map statement of an OBJ material library, false for unknown statements.
+bool GetMtlTextureRole(const std::string& keyword, TextureRole& role);
+
+struct CompressedTexture {
+    // DXGI_FORMAT of the blocks.
+    uint32_t dxgi_format = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Full mip chain, the top level first.
+    std::vector<std::vector<uint8_t>> levels;
+    // Root mean square error of the top level per channel. BC6H measures it on the bit patterns of the half floats.
+    float rmse = 0;
+};
+
+CompressedTexture CompressTexture(const TextureImage& image, TextureRole role);
+bool SaveCompressedTexture(const std::string& path, const CompressedTexture& texture);
+
+enum class CompressionStatus {
+    kCompressed,
+    // The cache already has the result.
+    kCached,
+    // The source is block compressed with no more bits per pixel than the format of the role, converting it would
+    // not reduce memory. No cache entry is written and the source is used as is.
+    kKept,
+    kFailed,
+};
+
+struct CompressionResult {
+    CompressionStatus status = CompressionStatus::kFailed;
+    std::string path;
+    std::string source_format;
+    uint64_t source_size = 0;
+    uint64_t compressed_size = 0;
+    float rmse = 0;
+};
+
+// Cache written by the texture compressor and read by the app.
+constexpr char kTextureCachePath[] = ASSETS_PATH "cache/textures";
+
+// Compressed textures in "<directory>/<key>.dds". The key is a hash of the contents of the source, the role and
+// the encoder version, so an entry never needs to be invalidated and sources can move freely.
+class TextureCompressionCache {
+public:
+    explicit TextureCompressionCache(const std::string& directory);
+
+    // Path of the cached version of source, empty if it is not cached.
+    std::string Find(const std::string& source, TextureRole role) const;
+    CompressionResult Compress(const std::string& source, TextureRole role, bool force = false) const;
+
+private:
+    std::string GetPath(uint64_t key) const;
+
+    std::string m_directory;
+};
@@ -0,0 +1,460 @@
+#include "TextureImage.h"
+
+#include "BinaryCache.h"
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 |
+           static_cast<uint32_t>(d) << 24;
+}
+
+constexpr uint32_t kDdsMagic = MakeFourCC('D', 'D', 'S', ' ');
+constexpr size_t kDdsHeaderSize = 128;
+constexpr size_t kDdsDx10HeaderSize = 20;
+constexpr uint32_t kDdpfAlphaPixels = 0x1;
+constexpr uint32_t kDdpfFourCC = 0x4;
+constexpr uint32_t kDdpfRgb = 0x40;
+constexpr uint32_t kDdpfLuminance = 0x20000;
+
+enum class SourceFormat {
+    kUnknown,
+    kBC1,
+    kBC2,
+    kBC3,
+    kBC4,
+    kBC5,
+    kRGBA8,
+    kBGRA8,
+    kRGBA16,
+    kRGBA16F,
+    kRGBA32F,
+    kRGB32F,
+    // Uncompressed with channel masks, see DecodeMasked.
+    kMasked,
+};
+
+SourceFormat GetDxgiFormat(uint32_t dxgi_format)
+{
+    switch (dxgi_format) {
+    case 2:
+        return SourceFormat::kRGBA32F;
+    case 6:
+        return SourceFormat::kRGB32F;
+    case 10:
+        return SourceFormat::kRGBA16F;
+    case 11:
+        return SourceFormat::kRGBA16;
+    case 28:
+    case 29:
+        return SourceFormat::kRGBA8;
+    case 71:
+    case 72:
+        return SourceFormat::kBC1;
+    case 74:
+    case 75:
+        return SourceFormat::kBC2;
+    case 77:
+    case 78:
+        return SourceFormat::kBC3;
+    case 80:
+        return SourceFormat::kBC4;
+    case 83:
+        return SourceFormat::kBC5;
+    case 87:
+    case 91:
+        return SourceFormat::kBGRA8;
+    default:
+        return SourceFormat::kUnknown;
+    }
+}
+
+SourceFormat GetFourCCFormat(uint32_t four_cc)
+{
+    switch (four_cc) {
+    case MakeFourCC('D', 'X', 'T', '1'):
+        return SourceFormat::kBC1;
+    case MakeFourCC('D', 'X', 'T', '2'):
+    case MakeFourCC('D', 'X', 'T', '3'):
+        return SourceFormat::kBC2;
+    case MakeFourCC('D', 'X', 'T', '4'):
+    case MakeFourCC('D', 'X', 'T', '5'):
+        return SourceFormat::kBC3;
+    case MakeFourCC('A', 'T', 'I', '1'):
+    case MakeFourCC('B', 'C', '4', 'U'):
+        return SourceFormat::kBC4;
+    case MakeFourCC('A', 'T', 'I', '2'):
+    case MakeFourCC('B', 'C', '5', 'U'):
+        return SourceFormat::kBC5;
+    // D3DFMT values stored as the four character code.
+    case 36:
+        return SourceFormat::kRGBA16;
+    case 113:
+        return SourceFormat::kRGBA16F;
+    case 116:
+        return SourceFormat::kRGBA32F;
+    default:
+        return SourceFormat::kUnknown;
+    }
+}
+
+const char* GetFormatName(SourceFormat format)
+{
+    switch (format) {
+    case SourceFormat::kBC1:
+        return "BC1";
+    case SourceFormat::kBC2:
+        return "BC2";
+    case SourceFormat::kBC3:
+        return "BC3";
+    case SourceFormat::kBC4:
+        return "BC4";
+    case SourceFormat::kBC5:
+        return "BC5";
+    case SourceFormat::kRGBA8:
+    case SourceFormat::kBGRA8:
+    case SourceFormat::kMasked:
+        return "RGBA8";
+    case SourceFormat::kRGBA16:
+        return "RGBA16";
+    case SourceFormat::kRGBA16F:
+        return "RGBA16F";
+    case SourceFormat::kRGBA32F:
+        return "RGBA32F";
+    case SourceFormat::kRGB32F:
+        return "RGB32F";
+    default:
+        return "unknown";
+    }
+}
+
+uint32_t GetBlockSize(SourceFormat format)
+{
+    switch (format) {
+    case SourceFormat::kBC1:
+    case SourceFormat::kBC4:
+        return 8;
+    case SourceFormat::kBC2:
+    case SourceFormat::kBC3:
+    case SourceFormat::kBC5:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+uint32_t GetPixelSize(SourceFormat format, uint32_t masked_bit_count)
+{
+    switch (format) {
+    case SourceFormat::kRGBA8:
+    case SourceFormat::kBGRA8:
+        return 4;
+    case SourceFormat::kRGBA16:
+    case SourceFormat::kRGBA16F:
+        return 8;
+    case SourceFormat::kRGBA32F:
+        return 16;
+    case SourceFormat::kRGB32F:
+        return 12;
+    case SourceFormat::kMasked:
+        return masked_bit_count / 8;
+    default:
+        return 0;
+    }
+}
+
+uint32_t Read32(const uint8_t* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+float DecodeMasked(uint32_t pixel, uint32_t mask)
+{
+    if (!mask) {
+        return 0.0f;
+    }
+    uint32_t shift = 0;
+    while (!((mask >> shift) & 1)) {
+        ++shift;
+    }
+    return static_cast<float>((pixel & mask) >> shift) / static_cast<float>(mask >> shift);
+}
+
+bool LoadDds(const uint8_t* data, size_t size, TextureImage& image)
+{
+    if (size < kDdsHeaderSize || Read32(data) != kDdsMagic) {
+        return false;
+    }
+    image.height = Read32(data + 12);
+    image.width = Read32(data + 16);
+    uint32_t pf_flags = Read32(data + 80);
+    uint32_t four_cc = Read32(data + 84);
+    uint32_t bit_count = Read32(data + 88);
+    uint32_t masks[4] = { Read32(data + 92), Read32(data + 96), Read32(data + 100), Read32(data + 104) };
+    if (!(pf_flags & kDdpfAlphaPixels)) {
+        masks[3] = 0;
+    }
+
+    size_t offset = kDdsHeaderSize;
+    SourceFormat format = SourceFormat::kUnknown;
+    if ((pf_flags & kDdpfFourCC) && four_cc == MakeFourCC('D', 'X', '1', '0')) {
+        if (size < kDdsHeaderSize + kDdsDx10HeaderSize) {
+            return false;
+        }
+        format = GetDxgiFormat(Read32(data + kDdsHeaderSize));
+        offset += kDdsDx10HeaderSize;
+    } else if (pf_flags & kDdpfFourCC) {
+        format = GetFourCCFormat(four_cc);
+    } else if ((pf_flags & (kDdpfRgb | kDdpfLuminance)) && (bit_count == 8 || bit_count == 16 || bit_count == 24 ||
+                                                            bit_count == 32)) {
+        format = SourceFormat::kMasked;
+        if (pf_flags & kDdpfLuminance) {
+            masks[1] = masks[2] = masks[0];
+        }
+    }
+    if (format == SourceFormat::kUnknown || !image.width || !image.height) {
+        return false;
+    }
+
+    image.source_format = GetFormatName(format);
+    image.pixels.assign(static_cast<size_t>(image.width) * image.height * 4, 0.0f);
+    if (uint32_t block_size = GetBlockSize(format)) {
+        image.source_block_compressed = true;
+        image.source_bits_per_pixel = block_size / 2;
+        uint32_t blocks_x = (image.width + 3) / 4;
+        uint32_t blocks_y = (image.height + 3) / 4;
+        if (size - offset < static_cast<size_t>(blocks_x) * blocks_y * block_size) {
+            return false;
+        }
+        for (uint32_t by = 0; by < blocks_y; ++by) {
+            for (uint32_t bx = 0; bx < blocks_x; ++bx, offset += block_size) {
+                float rgba[64] = {};
+                const uint8_t* block = data + offset;
+                switch (format) {
+                case SourceFormat::kBC1:
+                    DecodeBC1Block(block, rgba);
+                    break;
+                case SourceFormat::kBC2:
+                    DecodeBC2Block(block, rgba);
+                    break;
+                case SourceFormat::kBC3:
+                    DecodeBC3Block(block, rgba);
+                    break;
+                case SourceFormat::kBC4:
+                    DecodeBC4Block(block, rgba, 4);
+                    break;
+                default:
+                    DecodeBC4Block(block, rgba, 4);
+                    DecodeBC4Block(block + 8, rgba + 1, 4);
+                    break;
+                }
+                for (uint32_t i = 0; i < 16; ++i) {
+                    uint32_t x = bx * 4 + i % 4;
+                    uint32_t y = by * 4 + i / 4;
+                    if (x < image.width && y < image.height) {
+                        float* pixel = &image.pixels[(static_cast<size_t>(y) * image.width + x) * 4];
+                        std::memcpy(pixel, &rgba[i * 4], 4 * sizeof(float));
+                        if (format == SourceFormat::kBC4 || format == SourceFormat::kBC5) {
+                            pixel[3] = 1.0f;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    uint32_t pixel_size = GetPixelSize(format, bit_count);
+    image.source_bits_per_pixel = pixel_size * 8;
+    size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+    if (!pixel_size || size - offset < pixel_count * pixel_size) {
+        return false;
+    }
+    for (size_t i = 0; i < pixel_count; ++i) {
+        const uint8_t* src = data + offset + i * pixel_size;
+        float* dst = &image.pixels[i * 4];
+        switch (format) {
+        case SourceFormat::kRGBA8:
+        case SourceFormat::kBGRA8:
+            for (int c = 0; c < 4; ++c) {
+                dst[c] = src[c] / 255.0f;
+            }
+            if (format == SourceFormat::kBGRA8) {
+                std::swap(dst[0], dst[2]);
+            }
+            break;
+        case SourceFormat::kRGBA16:
+        case SourceFormat::kRGBA16F:
+            for (int c = 0; c < 4; ++c) {
+                uint16_t value = static_cast<uint16_t>(src[2 * c] | src[2 * c + 1] << 8);
+                dst[c] = format == SourceFormat::kRGBA16F ? HalfToFloat(value) : value / 65535.0f;
+            }
+            break;
+        case SourceFormat::kRGBA32F:
+        case SourceFormat::kRGB32F:
+            std::memcpy(dst, src, pixel_size);
+            if (format == SourceFormat::kRGB32F) {
+                dst[3] = 1.0f;
+            }
+            break;
+        default: {
+            uint32_t pixel = 0;
+            std::memcpy(&pixel, src, pixel_size);
+            for (int c = 0; c < 4; ++c) {
+                dst[c] = DecodeMasked(pixel, masks[c]);
+            }
+            if (!masks[3]) {
+                dst[3] = 1.0f;
+            }
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+void DecodeRgbe(const uint8_t rgbe[4], float* rgba)
+{
+    float scale = rgbe[3] ? std::ldexp(1.0f, rgbe[3] - 136) : 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        rgba[c] = rgbe[c] * scale;
+    }
+    rgba[3] = 1.0f;
+}
+
+bool LoadHdr(const uint8_t* data, size_t size, TextureImage& image)
+{
+    size_t offset = 0;
+    auto read_line = [&](std::string& line) {
+        line.clear();
+        while (offset < size && data[offset] != '\n') {
+            line.push_back(static_cast<char>(data[offset++]));
+        }
+        return offset++ < size;
+    };
+
+    std::string line;
+    if (!read_line(line) || line.rfind("#?", 0) != 0) {
+        return false;
+    }
+    while (read_line(line) && !line.empty()) {
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            return false;
+        }
+    }
+    std::string y_axis, x_axis;
+    int height = 0, width = 0;
+    if (!read_line(line) || !(std::istringstream(line) >> y_axis >> height >> x_axis >> width) || y_axis != "-Y" ||
+        x_axis != "+X" || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.source_format = "RGBE";
+    image.source_bits_per_pixel = 32;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    std::vector<uint8_t> scanline(static_cast<size_t>(width) * 4);
+    for (int y = 0; y < height; ++y) {
+        if (size - offset < 4) {
+            return false;
+        }
+        const uint8_t* header = data + offset;
+        bool rle = width >= 8 && width < 32768 && header[0] == 2 && header[1] == 2 && !(header[2] & 0x80);
+        if (!rle) {
+            if (size - offset < scanline.size()) {
+                return false;
+            }
+            std::memcpy(scanline.data(), data + offset, scanline.size());
+            offset += scanline.size();
+        } else {
+            if ((header[2] << 8 | header[3]) != width) {
+                return false;
+            }
+            offset += 4;
+            // Run length encoded channel by channel.
+            for (int c = 0; c < 4; ++c) {
+                for (int x = 0; x < width;) {
+                    if (offset >= size) {
+                        return false;
+                    }
+                    int count = data[offset++];
+                    bool run = count > 128;
+                    if (run) {
+                        count -= 128;
+                    }
+                    if (!count || x + count > width || offset + (run ? 1 : count) > size) {
+                        return false;
+                    }
+                    for (int i = 0; i < count; ++i, ++x) {
+                        scanline[x * 4 + c] = run ? data[offset] : data[offset + i];
+                    }
+                    offset += run ? 1 : count;
+                }
+            }
+        }
+        for (int x = 0; x < width; ++x) {
+            DecodeRgbe(&scanline[x * 4], &image.pixels[(static_cast<size_t>(y) * width + x) * 4]);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool LoadTextureImage(const std::string& path, TextureImage& image)
+{
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    image = {};
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == "hdr") {
+        return LoadHdr(file.GetData(), file.GetSize(), image);
+    }
+    return LoadDds(file.GetData(), file.GetSize(), image);
+}
+
+TextureImage DownsampleImage(const TextureImage& image, bool normal_map)
+{
+    TextureImage next;
+    next.width = std::max(image.width / 2, 1u);
+    next.height = std::max(image.height / 2, 1u);
+    next.pixels.resize(static_cast<size_t>(next.width) * next.height * 4);
+    for (uint32_t y = 0; y < next.height; ++y) {
+        for (uint32_t x = 0; x < next.width; ++x) {
+            float* dst = &next.pixels[(static_cast<size_t>(y) * next.width + x) * 4];
+            for (uint32_t i = 0; i < 4; ++i) {
+                const float* src = image.GetPixel(std::min(x * 2 + i % 2, image.width - 1),
+                                                  std::min(y * 2 + i / 2, image.height - 1));
+                for (int c = 0; c < 4; ++c) {
+                    dst[c] += src[c] / 4;
+                }
+            }
+            if (normal_map) {
+                float normal[3];
+                float length = 0;
+                for (int c = 0; c < 3; ++c) {
+                    normal[c] = dst[c] * 2 - 1;
+                    length += normal[c] * normal[c];
+                }
+                length = std::sqrt(length);
+                for (int c = 0; c < 3 && length > 0; ++c) {
+                    dst[c] = normal[c] / length * 0.5f + 0.5f;
+                }
+            }
+        }
+    }
+    return next;
+}
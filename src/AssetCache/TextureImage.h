@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Uncompressed RGBA image with float channels, unorm sources are in [0, 1].
+struct TextureImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> pixels;
+    // Format of the top level in the source file, e.g. "BC1" or "RGBA8".
+    std::string source_format;
+    // Bits per pixel of the source format.
+    uint32_t source_bits_per_pixel = 0;
+    bool source_block_compressed = false;
+
+    const float* GetPixel(uint32_t x, uint32_t y) const
+    {
+        return &pixels[(static_cast<size_t>(y) * width + x) * 4];
+    }
+};
+
+// Reads the top level of a dds (BC1-BC5 and 8, 16 and 32 bit per channel RGBA, legacy or DX10 header) or of a
+// Radiance hdr file. Returns false for anything else.
+bool LoadTextureImage(const std::string& path, TextureImage& image);
+
+// The next level of a mip chain, a 2x2 box filter. Odd sizes repeat the last row or column.
+TextureImage DownsampleImage(const TextureImage& image, bool normal_map);